@@ -21,6 +21,7 @@
 #include "common/platform.h"
 #include "admin/list_tasks_command.h"
 
+#include <algorithm>
 #include <iostream>
 
 #include "admin/registered_admin_connection.h"
@@ -43,16 +44,27 @@ void ListTasksCommand::run(const Options& options) const {
 	}
 
 	ServerConnection connection(options.argument(0), options.argument(1));
-	std::vector<JobInfo> jobs_info;
+	std::vector<JobProgressInfo> jobs_info;
 
-	auto request = cltoma::listTasks::build(true);
+	auto request = cltoma::listTasks::build();
 	auto response = connection.sendAndReceive(request, SAU_MATOCL_LIST_TASKS);
-	matocl::listTasks::deserialize(response, jobs_info);
+	PacketVersion version;
+	deserializePacketVersionNoHeader(response, version);
+	if (version == matocl::listTasks::kWithProgress) {
+		matocl::listTasks::deserialize(response, jobs_info);
+	} else {
+		// masters which do not report progress
+		std::vector<JobInfo> legacy_jobs_info;
+		matocl::listTasks::deserialize(response, legacy_jobs_info);
+		for (const JobInfo &job_info : legacy_jobs_info) {
+			jobs_info.push_back({job_info.id, job_info.description, 0, 0, 0});
+		}
+	}
 	if (jobs_info.empty()) {
 		std::cout << "No tasks are being executed" << std::endl;
 	}
 
-	for (const JobInfo &job_info : jobs_info) {
+	for (const JobProgressInfo &job_info : jobs_info) {
 		std::ios::fmtflags f(std::cout.flags());
 		std::cout << "Id: 0x";
 		std::cout.width(5);
@@ -60,5 +72,12 @@ void ListTasksCommand::run(const Options& options) const {
 		std::cout.width(15);
 		std::cout << std::left << job_info.description << std::endl;
 		std::cout.flags(f);
+		if (version == matocl::listTasks::kWithProgress) {
+			uint64_t rate = job_info.processed_entries / std::max<uint32_t>(job_info.running_time, 1);
+			std::cout << "    processed: " << job_info.processed_entries
+			          << ", queued tasks: " << job_info.queued_tasks
+			          << ", running for " << job_info.running_time << " s"
+			          << " (" << rate << " entries/s)" << std::endl;
+		}
 	}
 }
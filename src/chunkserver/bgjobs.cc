@@ -104,10 +104,8 @@ struct chunk_prefetch_args {
 	uint64_t chunkId;
 	uint32_t chunkVersion;
 	ChunkPartType chunkType;
-	uint16_t blocknum;
-	uint32_t offset, size;
-	uint32_t crc;
-	const uint8_t *buffer;
+	const ChunkBlockWrite *writes;  // owned by the caller
+	uint32_t count;
 };
 
 struct chunk_get_blocks_args {
@@ -282,10 +280,9 @@ void* job_worker(void *th_arg) {
 				if (jstate==JSTATE_DISABLED) {
 					status = SAUNAFS_ERROR_NOTDONE;
 				} else {
-				    status = hddChunkWriteBlock(
+				    status = hddChunkWriteBlocks(
 				        wrargs->chunkId, wrargs->chunkVersion,
-				        wrargs->chunkType, wrargs->blocknum, wrargs->offset,
-				        wrargs->size, wrargs->crc, wrargs->buffer);
+				        wrargs->chunkType, wrargs->writes, wrargs->count);
 				}
 				break;
 			}
@@ -585,7 +582,7 @@ uint32_t job_prefetch(void *jpool, uint64_t chunkid, uint32_t version, ChunkPart
 
 uint32_t job_write(void *jpool, void (*callback)(uint8_t status, void *extra), void *extra,
 		uint64_t chunkId, uint32_t chunkVersion, ChunkPartType chunkType,
-		uint16_t blocknum, uint32_t offset, uint32_t size, uint32_t crc, const uint8_t *buffer) {
+		const ChunkBlockWrite *writes, uint32_t count) {
 	TRACETHIS();
 	jobpool* jp = (jobpool*)jpool;
 	chunk_write_args *args;
@@ -594,11 +591,8 @@ uint32_t job_write(void *jpool, void (*callback)(uint8_t status, void *extra), v
 	args->chunkId = chunkId;
 	args->chunkVersion = chunkVersion;
 	args->chunkType = chunkType,
-	args->blocknum = blocknum;
-	args->offset = offset;
-	args->size = size;
-	args->crc = crc;
-	args->buffer = buffer;
+	args->writes = writes;
+	args->count = count;
 	return job_new(jp, OP_WRITE, args, callback, extra);
 }
 
@@ -25,6 +25,7 @@
 #include <inttypes.h>
 #include <vector>
 
+#include "chunkserver-common/disk_interface.h"
 #include "chunkserver/output_buffer.h"
 #include "common/chunk_type_with_address.h"
 
@@ -90,7 +91,7 @@ uint32_t job_prefetch(void *jpool, uint64_t chunkid, uint32_t version, ChunkPart
 		uint32_t firstBlockToBePrefetched, uint32_t nrOfBlocksToBePrefetched) ;
 uint32_t job_write(void *jpool, void (*callback)(uint8_t status, void *extra), void *extra,
 		uint64_t chunkId, uint32_t chunkVersion, ChunkPartType chunkType,
-		uint16_t blocknum, uint32_t offset, uint32_t size, uint32_t crc, const uint8_t *buffer);
+		const ChunkBlockWrite *writes, uint32_t count);
 uint32_t job_get_blocks(void *jpool, void (*callback)(uint8_t status, void *extra), void *extra,
 		uint64_t chunkId, uint32_t version, ChunkPartType chunkType, uint16_t* blocks);
 uint32_t job_replicate(void *jpool, void (*callback)(uint8_t status, void *extra), void *extra,
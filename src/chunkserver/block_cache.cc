@@ -0,0 +1,193 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+
+#include "chunkserver/block_cache.h"
+
+#include <cstring>
+
+#include "common/crc.h"
+
+void BlockCache::Shard::remove(EntryList::iterator entry) {
+	freeSlots.push_back(entry->slot);
+
+	auto chunkIt = blocksPerChunk.find(entry->key.chunk);
+	if (--chunkIt->second == 0) {
+		blocksPerChunk.erase(chunkIt);
+	}
+
+	index.erase(entry->key);
+	(entry->isProtected ? protectedEntries : probation).erase(entry);
+}
+
+void BlockCache::setCapacity(uint64_t capacityBytes) {
+	const uint64_t slotsPerShard = capacityBytes / SFSBLOCKSIZE / kShardCount;
+
+	for (auto &shard : shards_) {
+		std::lock_guard lock(shard.mutex);
+
+		shard.index.clear();
+		shard.blocksPerChunk.clear();
+		shard.probation.clear();
+		shard.protectedEntries.clear();
+
+		// Release the old memory before allocating the new one
+		shard.memory.reset();
+		shard.memory =
+		    std::make_unique<AlignedBuffer>(slotsPerShard * SFSBLOCKSIZE);
+
+		shard.freeSlots.clear();
+		shard.freeSlots.reserve(slotsPerShard);
+		for (uint64_t slot = slotsPerShard; slot > 0; --slot) {
+			shard.freeSlots.push_back(slot - 1);
+		}
+		shard.protectedCapacity = slotsPerShard * kProtectedPercent / 100;
+	}
+
+	capacity_ = slotsPerShard * kShardCount * SFSBLOCKSIZE;
+}
+
+bool BlockCache::get(const ChunkWithType &chunk, uint16_t block,
+                     const std::function<void(const uint8_t *)> &copy) {
+	if (!enabled()) {
+		return false;
+	}
+
+	auto &shard = shardFor(chunk);
+	std::lock_guard lock(shard.mutex);
+
+	auto it = shard.index.find(BlockKey{chunk, block});
+	if (it == shard.index.end()) {
+		++misses_;
+		return false;
+	}
+
+	auto entry = it->second;
+	if (entry->isProtected) {
+		shard.protectedEntries.splice(shard.protectedEntries.begin(),
+		                              shard.protectedEntries, entry);
+	} else if (shard.protectedCapacity > 0) {
+		// Read for the second time, so it is not part of a scan
+		entry->isProtected = true;
+		shard.protectedEntries.splice(shard.protectedEntries.begin(),
+		                              shard.probation, entry);
+
+		if (shard.protectedEntries.size() > shard.protectedCapacity) {
+			// Give the least recently used protected block another chance
+			auto demoted = std::prev(shard.protectedEntries.end());
+			demoted->isProtected = false;
+			shard.probation.splice(shard.probation.begin(),
+			                       shard.protectedEntries, demoted);
+		}
+	} else {
+		shard.probation.splice(shard.probation.begin(), shard.probation,
+		                       entry);
+	}
+
+	copy(shard.slotData(entry->slot));
+	++hits_;
+
+	return true;
+}
+
+void BlockCache::put(const ChunkWithType &chunk, uint16_t block,
+                     const uint8_t *data) {
+	if (!enabled()) {
+		return;
+	}
+
+	auto &shard = shardFor(chunk);
+	std::lock_guard lock(shard.mutex);
+
+	BlockKey key{chunk, block};
+	auto it = shard.index.find(key);
+	if (it != shard.index.end()) {
+		std::memcpy(shard.slotData(it->second->slot), data, SFSBLOCKSIZE);
+		return;
+	}
+
+	if (shard.freeSlots.empty()) {
+		if (!shard.probation.empty()) {
+			shard.remove(std::prev(shard.probation.end()));
+		} else if (!shard.protectedEntries.empty()) {
+			shard.remove(std::prev(shard.protectedEntries.end()));
+		} else {
+			return;  // No memory in this shard
+		}
+	}
+
+	uint32_t slot = shard.freeSlots.back();
+	shard.freeSlots.pop_back();
+	std::memcpy(shard.slotData(slot), data, SFSBLOCKSIZE);
+
+	shard.probation.push_front(Entry{key, slot, false});
+	shard.index.emplace(key, shard.probation.begin());
+	++shard.blocksPerChunk[chunk];
+}
+
+bool BlockCache::putVerified(const ChunkWithType &chunk, uint16_t block,
+                             const uint8_t *data, uint32_t crc) {
+	if (!enabled()) {
+		return true;
+	}
+	if (mycrc32(0, data, SFSBLOCKSIZE) != crc) {
+		return false;
+	}
+	put(chunk, block, data);
+	return true;
+}
+
+void BlockCache::erase(const ChunkWithType &chunk, uint16_t block) {
+	if (!enabled()) {
+		return;
+	}
+
+	auto &shard = shardFor(chunk);
+	std::lock_guard lock(shard.mutex);
+
+	auto it = shard.index.find(BlockKey{chunk, block});
+	if (it != shard.index.end()) {
+		shard.remove(it->second);
+	}
+}
+
+void BlockCache::eraseChunk(const ChunkWithType &chunk) {
+	if (!enabled()) {
+		return;
+	}
+
+	auto &shard = shardFor(chunk);
+	std::lock_guard lock(shard.mutex);
+
+	auto chunkIt = shard.blocksPerChunk.find(chunk);
+	if (chunkIt == shard.blocksPerChunk.end()) {
+		return;
+	}
+
+	uint32_t remaining = chunkIt->second;
+	for (uint32_t block = 0; block < SFSBLOCKSINCHUNK && remaining > 0;
+	     ++block) {
+		auto it =
+		    shard.index.find(BlockKey{chunk, static_cast<uint16_t>(block)});
+		if (it != shard.index.end()) {
+			shard.remove(it->second);
+			--remaining;
+		}
+	}
+}
@@ -0,0 +1,157 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "chunkserver-common/chunk_map.h"
+#include "chunkserver-common/disk_utils.h"
+#include "chunkserver/aligned_allocator.h"
+
+/// Cache of chunk data blocks kept by the chunkserver itself, so that hot
+/// blocks can be served without the page cache (e.g. with HDD_DIRECT_IO).
+///
+/// The memory is allocated up front in slots of SFSBLOCKSIZE bytes. Eviction
+/// is a segmented LRU: new blocks enter a probationary segment and only move
+/// to the protected segment when read again, so a single pass over many
+/// chunks (a scan) can only evict other blocks read once.
+///
+/// All blocks of a chunk share the same shard, which lets the callers drop a
+/// whole chunk cheaply. Callers must hold the chunk lock while reading and
+/// inserting or invalidating its blocks, so the cache never keeps stale data.
+class BlockCache {
+public:
+	/// Number of independently locked parts of the cache
+	static constexpr uint32_t kShardCount = 16;
+	/// Percentage of the slots of a shard used by the protected segment
+	static constexpr uint32_t kProtectedPercent = 80;
+
+	BlockCache() = default;
+
+	BlockCache(const BlockCache &) = delete;
+	BlockCache(BlockCache &&) = delete;
+	BlockCache &operator=(const BlockCache &) = delete;
+	BlockCache &operator=(BlockCache &&) = delete;
+	~BlockCache() = default;
+
+	/// Drops all the cached blocks and reserves memory for at most
+	/// capacityBytes of data (0 disables the cache)
+	void setCapacity(uint64_t capacityBytes);
+
+	/// Returns the number of bytes reserved for the cached blocks
+	uint64_t capacity() const { return capacity_; }
+
+	/// Tells if there is any memory to cache blocks
+	bool enabled() const { return capacity_ > 0; }
+
+	/// Calls copy with the data of the block if it is cached.
+	/// Returns false if the block is not cached.
+	bool get(const ChunkWithType &chunk, uint16_t block,
+	         const std::function<void(const uint8_t *)> &copy);
+
+	/// Caches SFSBLOCKSIZE bytes of data as the content of the block
+	void put(const ChunkWithType &chunk, uint16_t block, const uint8_t *data);
+
+	/// Caches the block like put, but only if its data matches crc, so that
+	/// a block damaged on disk is read from the disk again next time.
+	/// Returns false if the data is damaged.
+	bool putVerified(const ChunkWithType &chunk, uint16_t block,
+	                 const uint8_t *data, uint32_t crc);
+
+	/// Drops the block from the cache, e.g. after it was written
+	void erase(const ChunkWithType &chunk, uint16_t block);
+
+	/// Drops all the blocks of the chunk from the cache
+	void eraseChunk(const ChunkWithType &chunk);
+
+	/// Returns the number of reads served from the cache (hits) and not
+	/// found in the cache (misses) since the previous call
+	void stats(uint64_t *hits, uint64_t *misses) {
+		*hits = hits_.exchange(0);
+		*misses = misses_.exchange(0);
+	}
+
+private:
+	struct BlockKey {
+		ChunkWithType chunk;
+		uint16_t block;
+
+		bool operator==(const BlockKey &other) const {
+			return block == other.block &&
+			       KeyOperations()(chunk, other.chunk);
+		}
+	};
+
+	struct BlockKeyHash {
+		std::size_t operator()(const BlockKey &key) const {
+			return KeyOperations()(key.chunk) * SFSBLOCKSINCHUNK + key.block;
+		}
+	};
+
+	struct Entry {
+		BlockKey key;
+		uint32_t slot;
+		bool isProtected;
+	};
+
+	using EntryList = std::list<Entry>;
+	using AlignedBuffer =
+	    std::vector<uint8_t, AlignedAllocator<uint8_t, disk::kIoBlockSize>>;
+
+	struct Shard {
+		std::mutex mutex;
+		std::unique_ptr<AlignedBuffer> memory;
+		std::vector<uint32_t> freeSlots;
+		EntryList probation;
+		EntryList protectedEntries;
+		uint32_t protectedCapacity = 0;
+		std::unordered_map<BlockKey, EntryList::iterator, BlockKeyHash> index;
+		/// Number of cached blocks of each chunk having any
+		std::unordered_map<ChunkWithType, uint32_t, KeyOperations,
+		                   KeyOperations>
+		    blocksPerChunk;
+
+		uint8_t *slotData(uint32_t slot) {
+			return memory->data() + static_cast<uint64_t>(slot) * SFSBLOCKSIZE;
+		}
+		void remove(EntryList::iterator entry);
+	};
+
+	Shard &shardFor(const ChunkWithType &chunk) {
+		return shards_[KeyOperations()(chunk) % kShardCount];
+	}
+
+	std::array<Shard, kShardCount> shards_;
+	std::atomic<uint64_t> capacity_{0};
+	std::atomic<uint64_t> hits_{0};
+	std::atomic<uint64_t> misses_{0};
+};
+
+/// The cache shared by all the disks of this chunkserver
+inline BlockCache gBlockCache;
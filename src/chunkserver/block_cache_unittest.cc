@@ -0,0 +1,130 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "chunkserver/block_cache.h"
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "common/crc.h"
+#include "common/slice_traits.h"
+
+// Chunk ids which are equal modulo kShardCount share the same shard
+static ChunkWithType chunkInFirstShard(uint64_t n) {
+	return makeChunkKey(n * BlockCache::kShardCount,
+	                    slice_traits::standard::ChunkPartType());
+}
+
+static std::vector<uint8_t> blockFilledWith(uint8_t value) {
+	return std::vector<uint8_t>(SFSBLOCKSIZE, value);
+}
+
+static bool isCachedWith(BlockCache &cache, const ChunkWithType &chunk,
+                         uint16_t block, uint8_t value) {
+	bool matches = false;
+	bool found = cache.get(chunk, block, [&](const uint8_t *data) {
+		matches = data[0] == value && data[SFSBLOCKSIZE - 1] == value;
+	});
+	return found && matches;
+}
+
+TEST(BlockCacheTests, CachesAndInvalidatesBlocks) {
+	BlockCache cache;
+	cache.setCapacity(BlockCache::kShardCount * 4 * SFSBLOCKSIZE);
+	auto chunk = chunkInFirstShard(1);
+
+	EXPECT_FALSE(isCachedWith(cache, chunk, 0, 1));
+	cache.put(chunk, 0, blockFilledWith(1).data());
+	cache.put(chunk, 1, blockFilledWith(2).data());
+	EXPECT_TRUE(isCachedWith(cache, chunk, 0, 1));
+	EXPECT_TRUE(isCachedWith(cache, chunk, 1, 2));
+	uint64_t hits, misses;
+	cache.stats(&hits, &misses);
+	EXPECT_EQ(2U, hits);
+	EXPECT_EQ(1U, misses);
+	cache.stats(&hits, &misses);
+	EXPECT_EQ(0U, hits);
+	EXPECT_EQ(0U, misses);
+
+	cache.erase(chunk, 0);
+	EXPECT_FALSE(isCachedWith(cache, chunk, 0, 1));
+	EXPECT_TRUE(isCachedWith(cache, chunk, 1, 2));
+
+	cache.put(chunk, 2, blockFilledWith(3).data());
+	cache.eraseChunk(chunk);
+	EXPECT_FALSE(isCachedWith(cache, chunk, 1, 2));
+	EXPECT_FALSE(isCachedWith(cache, chunk, 2, 3));
+}
+
+TEST(BlockCacheTests, ScanDoesNotEvictHotBlocks) {
+	BlockCache cache;
+	// 5 slots in each shard, 4 of them for the protected segment
+	cache.setCapacity(BlockCache::kShardCount * 5 * SFSBLOCKSIZE);
+	auto hotChunk = chunkInFirstShard(1);
+	auto scannedChunk = chunkInFirstShard(2);
+
+	for (uint16_t block = 0; block < 4; ++block) {
+		cache.put(hotChunk, block, blockFilledWith(block).data());
+		EXPECT_TRUE(isCachedWith(cache, hotChunk, block, block));
+	}
+
+	for (uint16_t block = 0; block < 100; ++block) {
+		cache.put(scannedChunk, block, blockFilledWith(0xff).data());
+	}
+
+	for (uint16_t block = 0; block < 4; ++block) {
+		EXPECT_TRUE(isCachedWith(cache, hotChunk, block, block));
+	}
+	EXPECT_TRUE(isCachedWith(cache, scannedChunk, 99, 0xff));
+	EXPECT_FALSE(isCachedWith(cache, scannedChunk, 98, 0xff));
+}
+
+TEST(BlockCacheTests, DisabledWithoutCapacity) {
+	BlockCache cache;
+	auto chunk = chunkInFirstShard(1);
+
+	EXPECT_FALSE(cache.enabled());
+	cache.put(chunk, 0, blockFilledWith(1).data());
+	EXPECT_FALSE(isCachedWith(cache, chunk, 0, 1));
+
+	cache.setCapacity(BlockCache::kShardCount * SFSBLOCKSIZE);
+	EXPECT_EQ(BlockCache::kShardCount * SFSBLOCKSIZE, cache.capacity());
+	cache.put(chunk, 0, blockFilledWith(1).data());
+	EXPECT_TRUE(isCachedWith(cache, chunk, 0, 1));
+
+	cache.setCapacity(0);
+	EXPECT_FALSE(isCachedWith(cache, chunk, 0, 1));
+}
+
+TEST(BlockCacheTests, DamagedBlocksAreNotCached) {
+	BlockCache cache;
+	cache.setCapacity(BlockCache::kShardCount * 4 * SFSBLOCKSIZE);
+	auto chunk = chunkInFirstShard(1);
+
+	auto block = blockFilledWith(1);
+	uint32_t crc = mycrc32(0, block.data(), SFSBLOCKSIZE);
+	block[SFSBLOCKSIZE / 2] ^= 0x40;  // e.g. a bit flipped on the disk
+	EXPECT_FALSE(cache.putVerified(chunk, 0, block.data(), crc));
+	EXPECT_FALSE(isCachedWith(cache, chunk, 0, 1));
+
+	// the block read again from the disk is fine now
+	block[SFSBLOCKSIZE / 2] ^= 0x40;
+	EXPECT_TRUE(cache.putVerified(chunk, 0, block.data(), crc));
+	EXPECT_TRUE(isCachedWith(cache, chunk, 0, 1));
+}
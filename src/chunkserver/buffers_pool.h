@@ -20,12 +20,28 @@
 
 #include "common/platform.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <memory>
-#include <queue>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 /**
  * BuffersPool is a thread-safe pool of buffers.
  * It is used to avoid memory allocation/deallocation overhead.
+ *
+ * Buffers are grouped in power of two size classes, so that a buffer can serve
+ * any request of its class. Each thread keeps a small cache of buffers per
+ * class, used without locking. When a thread's cache is full, half of it
+ * spills to a global list, from which threads with an empty cache refill.
+ * This matters because buffers are usually taken by the job threads and
+ * returned by the network threads.
+ *
+ * T must be constructible from a capacity and provide reset(capacity), which
+ * prepares it for a request not larger than the capacity it was created with.
  */
 template<typename T>
 class BuffersPool {
@@ -48,21 +64,28 @@ public:
 	 * @return The existent buffer or a newly created one.
 	 */
 	std::shared_ptr<T> get(size_t capacity) {
-		if (buffers_.empty()) {
+		size_t sizeClass = sizeClassOf(capacity);
+		if (sizeClass >= kSizeClasses) {
+			misses_.fetch_add(1, std::memory_order_relaxed);
 			return std::make_shared<T>(capacity);
 		}
 
-		std::lock_guard lock(mutex_);
-		auto buffer = buffers_.front();
-
-		if (buffer->capacity() == capacity) {
-			buffers_.pop();
-			buffer->clear();
-
+		auto &local = localCache().buffers[sizeClass];
+		if (local.empty()) {
+			refill(sizeClass, local);
+		}
+		if (local.empty()) {
+			misses_.fetch_add(1, std::memory_order_relaxed);
+			auto buffer = std::make_shared<T>(sizeClassCapacity(sizeClass));
+			buffer->reset(capacity);
 			return buffer;
 		}
 
-		return std::make_shared<T>(capacity);
+		hits_.fetch_add(1, std::memory_order_relaxed);
+		auto buffer = std::move(local.back());
+		local.pop_back();
+		buffer->reset(capacity);
+		return buffer;
 	}
 
 	/**
@@ -70,19 +93,111 @@ public:
 	 * @param buffer The buffer to put back.
 	 */
 	void put(std::shared_ptr<T> &&buffer) {
-		std::lock_guard lock(mutex_);
+		// The capacity of the buffer is the one requested in get, so it maps
+		// to the class the buffer was created for
+		size_t sizeClass = sizeClassOf(buffer->capacity());
+		if (sizeClass >= kSizeClasses) {
+			return;
+		}
+		auto &local = localCache().buffers[sizeClass];
+		if (local.size() >= localLimit(sizeClass)) {
+			spill(sizeClass, local);
+		}
+		local.push_back(std::move(buffer));
+	}
 
-		if (buffers_.size() < kMaxSize) {
-			buffer->clear();
-			buffers_.push(std::move(buffer));
+	/**
+	 * Returns the number of requests served with a pooled buffer (hits) and
+	 * with a newly allocated one (misses) since the previous call.
+	 */
+	void stats(uint64_t *hits, uint64_t *misses) {
+		*hits = hits_.exchange(0);
+		*misses = misses_.exchange(0);
+	}
+
+	/// Returns the size class of buffers able to hold the given capacity.
+	static size_t sizeClassOf(size_t capacity) {
+		size_t sizeClass = 0;
+		while (sizeClass < kSizeClasses &&
+		       sizeClassCapacity(sizeClass) < capacity) {
+			++sizeClass;
 		}
+		return sizeClass;
+	}
+
+	/// Returns the capacity of buffers created for the given size class.
+	static constexpr size_t sizeClassCapacity(size_t sizeClass) {
+		return kMinClassCapacity << sizeClass;
 	}
 
 private:
-	/// Maximum number of buffers in the pool.
-	static constexpr size_t kMaxSize = 128;
-	/// Buffers pool (container).
-	std::queue<std::shared_ptr<T>> buffers_;
-	/// Mutex to protect the pool.
+	/// Capacity of buffers of the smallest size class.
+	static constexpr size_t kMinClassCapacity = 64 * 1024;
+	/// Number of size classes, larger buffers are not pooled.
+	static constexpr size_t kSizeClasses = 9;
+	/// Memory which each thread may cache per size class.
+	static constexpr size_t kLocalBytesPerClass = 2 * 1024 * 1024;
+	/// Memory which the global list may hold per size class.
+	static constexpr size_t kGlobalBytesPerClass = 32 * 1024 * 1024;
+
+	using BufferList = std::vector<std::shared_ptr<T>>;
+
+	struct LocalCache {
+		std::array<BufferList, kSizeClasses> buffers;
+	};
+
+	static size_t localLimit(size_t sizeClass) {
+		return std::max<size_t>(1, kLocalBytesPerClass / sizeClassCapacity(sizeClass));
+	}
+
+	static size_t globalLimit(size_t sizeClass) {
+		return std::max<size_t>(4, kGlobalBytesPerClass / sizeClassCapacity(sizeClass));
+	}
+
+	/// Returns the cache of this pool for the calling thread.
+	/// The cache is freed, not returned to the pool, when the thread exits.
+	/// Caches are found by id_ rather than by address, as a new pool may be
+	/// created at the address of a destroyed one.
+	LocalCache &localCache() {
+		thread_local std::unordered_map<uint64_t, LocalCache> caches;
+		return caches[id_];
+	}
+
+	/// Moves up to half of the local limit of buffers from the global list.
+	void refill(size_t sizeClass, BufferList &local) {
+		std::lock_guard lock(mutex_);
+		auto &global = global_[sizeClass];
+		size_t count = std::min(global.size(), (localLimit(sizeClass) + 1) / 2);
+		for (size_t i = 0; i < count; ++i) {
+			local.push_back(std::move(global.back()));
+			global.pop_back();
+		}
+	}
+
+	/// Moves half of the local buffers to the global list, dropping the ones
+	/// which do not fit there.
+	void spill(size_t sizeClass, BufferList &local) {
+		size_t count = (local.size() + 1) / 2;
+		std::lock_guard lock(mutex_);
+		auto &global = global_[sizeClass];
+		for (size_t i = 0; i < count; ++i) {
+			if (global.size() < globalLimit(sizeClass)) {
+				global.push_back(std::move(local.back()));
+			}
+			local.pop_back();
+		}
+	}
+
+	/// Source of the ids of the pools.
+	static inline std::atomic<uint64_t> nextId_{0};
+	/// Identifies the thread local caches of this pool.
+	const uint64_t id_ = nextId_.fetch_add(1, std::memory_order_relaxed);
+	/// Buffers spilled by the threads, per size class.
+	std::array<BufferList, kSizeClasses> global_;
+	/// Mutex to protect the global lists.
 	std::mutex mutex_;
+	/// Requests served with a pooled buffer.
+	std::atomic<uint64_t> hits_{0};
+	/// Requests which needed a new buffer.
+	std::atomic<uint64_t> misses_{0};
 };
@@ -0,0 +1,112 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "chunkserver/buffers_pool.h"
+
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "chunkserver/output_buffer.h"
+
+static constexpr size_t kBlockPacketSize = 64 * 1024 + 24;
+
+TEST(BuffersPoolTests, ReusesBuffersOfTheSameSizeClass) {
+	OutputBufferPool pool;
+	uint64_t hits, misses;
+
+	auto buffer = pool.get(kBlockPacketSize);
+	EXPECT_EQ(kBlockPacketSize, buffer->capacity());
+	const OutputBuffer *first = buffer.get();
+	pool.put(std::move(buffer));
+
+	// A smaller request of the same class gets the same buffer
+	buffer = pool.get(kBlockPacketSize + 1000);
+	EXPECT_EQ(first, buffer.get());
+	EXPECT_EQ(kBlockPacketSize + 1000, buffer->capacity());
+	EXPECT_EQ(0U, buffer->bytesInABuffer());
+	pool.put(std::move(buffer));
+
+	// A request of another class needs a new buffer
+	buffer = pool.get(4 * kBlockPacketSize);
+	EXPECT_NE(first, buffer.get());
+
+	pool.stats(&hits, &misses);
+	EXPECT_EQ(1U, hits);
+	EXPECT_EQ(2U, misses);
+	pool.stats(&hits, &misses);
+	EXPECT_EQ(0U, hits + misses);
+}
+
+TEST(BuffersPoolTests, ReusedBufferKeepsItsCapacity) {
+	OutputBufferPool pool;
+	std::vector<uint8_t> data(2 * kBlockPacketSize, 7);
+
+	auto buffer = pool.get(2 * kBlockPacketSize);
+	ASSERT_EQ(static_cast<ssize_t>(data.size()),
+	          buffer->copyIntoBuffer(data));
+	pool.put(std::move(buffer));
+
+	buffer = pool.get(kBlockPacketSize + 1);
+	ASSERT_EQ(static_cast<ssize_t>(kBlockPacketSize + 1),
+	          buffer->copyIntoBuffer(data.data(), kBlockPacketSize + 1));
+	EXPECT_EQ(kBlockPacketSize + 1, buffer->bytesInABuffer());
+	// The data ends at an aligned offset, as in a newly created buffer
+	EXPECT_EQ(0U, (buffer->lastBytes(0) - buffer->data()) % disk::kIoBlockSize);
+}
+
+TEST(BuffersPoolTests, BuffersMoveBetweenThreads) {
+	OutputBufferPool pool;
+	uint64_t hits, misses;
+	std::vector<std::shared_ptr<OutputBuffer>> buffers;
+
+	for (int i = 0; i < 64; ++i) {
+		buffers.push_back(pool.get(kBlockPacketSize));
+	}
+	// Buffers returned by one thread spill to the global list...
+	std::thread([&pool, &buffers]() {
+		for (auto &buffer : buffers) {
+			pool.put(std::move(buffer));
+		}
+	}).join();
+	pool.stats(&hits, &misses);
+	EXPECT_EQ(64U, misses);
+
+	// ...and are taken from there by another one
+	for (int i = 0; i < 8; ++i) {
+		buffers[i] = pool.get(kBlockPacketSize);
+	}
+	pool.stats(&hits, &misses);
+	EXPECT_EQ(8U, hits);
+	EXPECT_EQ(0U, misses);
+}
+
+TEST(BuffersPoolTests, DoesNotPoolHugeBuffers) {
+	OutputBufferPool pool;
+	uint64_t hits, misses;
+	size_t hugeCapacity = OutputBufferPool::sizeClassCapacity(8) + 1;
+
+	auto buffer = pool.get(hugeCapacity);
+	EXPECT_EQ(hugeCapacity, buffer->capacity());
+	pool.put(std::move(buffer));
+	buffer = pool.get(hugeCapacity);
+
+	pool.stats(&hits, &misses);
+	EXPECT_EQ(0U, hits);
+	EXPECT_EQ(2U, misses);
+}
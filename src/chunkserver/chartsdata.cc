@@ -32,9 +32,11 @@
 #include <unistd.h>
 
 #include "chunkserver-common/hdd_stats.h"
+#include "chunkserver/block_cache.h"
 #include "chunkserver/chunk_replicator.h"
 #include "chunkserver/masterconn.h"
 #include "chunkserver/network_stats.h"
+#include "chunkserver/output_buffer.h"
 #include "common/charts.h"
 #include "common/event_loop.h"
 
@@ -70,8 +72,19 @@
 #define CHARTS_TEST 27
 #define CHARTS_CHUNKIOJOBS 28
 #define CHARTS_CHUNKOPJOBS 29
-
-#define CHARTS_NUMBER 30
+#define CHARTS_BUFPOOLHIT 30
+#define CHARTS_BUFPOOLMISS 31
+#define CHARTS_FSYNCGROUPS 32
+#define CHARTS_FSYNCGROUPCHUNKS 33
+#define CHARTS_FSYNCGROUPTIME 34
+#define CHARTS_BLOCKCACHEHIT 35
+#define CHARTS_BLOCKCACHEMISS 36
+#define CHARTS_FASTTIERREAD 37
+#define CHARTS_SLOWTIERREAD 38
+#define CHARTS_CHUNKSPROMOTED 39
+#define CHARTS_CHUNKSDEMOTED 40
+
+#define CHARTS_NUMBER 41
 
 /* name , join mode , percent , scale , multiplier , divisor */
 #define STATDEFS { \
@@ -105,6 +118,17 @@
 	{"test"             ,CHARTS_MODE_ADD,0,CHARTS_SCALE_NONE ,   1, 1}, \
 	{"chunkiojobs"      ,CHARTS_MODE_MAX,0,CHARTS_SCALE_NONE ,   1, 1}, \
 	{"chunkopjobs"      ,CHARTS_MODE_MAX,0,CHARTS_SCALE_NONE ,   1, 1}, \
+	{"bufpoolhit"       ,CHARTS_MODE_ADD,0,CHARTS_SCALE_NONE ,   1, 1}, \
+	{"bufpoolmiss"      ,CHARTS_MODE_ADD,0,CHARTS_SCALE_NONE ,   1, 1}, \
+	{"fsyncgroups"      ,CHARTS_MODE_ADD,0,CHARTS_SCALE_NONE ,   1, 1}, \
+	{"fsyncgroupchunks" ,CHARTS_MODE_ADD,0,CHARTS_SCALE_NONE ,   1, 1}, \
+	{"fsyncgrouptime"   ,CHARTS_MODE_MAX,0,CHARTS_SCALE_MICRO,   1, 1}, \
+	{"blockcachehit"    ,CHARTS_MODE_ADD,0,CHARTS_SCALE_NONE ,   1, 1}, \
+	{"blockcachemiss"   ,CHARTS_MODE_ADD,0,CHARTS_SCALE_NONE ,   1, 1}, \
+	{"fasttierread"     ,CHARTS_MODE_ADD,0,CHARTS_SCALE_NONE ,   1, 1}, \
+	{"slowtierread"     ,CHARTS_MODE_ADD,0,CHARTS_SCALE_NONE ,   1, 1}, \
+	{"chunkspromoted"   ,CHARTS_MODE_ADD,0,CHARTS_SCALE_NONE ,   1, 1}, \
+	{"chunksdemoted"    ,CHARTS_MODE_ADD,0,CHARTS_SCALE_NONE ,   1, 1}, \
 	{NULL               ,0              ,0,0                 ,   0, 0}  \
 };
 
@@ -142,6 +166,9 @@ void chartsdata_refresh(void) {
 	uint32_t opsCreate, opsDelete, opsUpdateVersion, opsDuplicate, opsTruncate;
 	uint32_t opsDupTrunc, opsTest;
 	uint32_t maxChunkServerJobsCount, maxMasterJobsCount;
+	uint64_t bufferPoolHits, bufferPoolMisses;
+	uint64_t blockCacheHits, blockCacheMisses;
+	uint32_t fsyncGroups, fsyncGroupChunks;
 
 	// Timer runs only when the process is executing.
 	struct itimerval userTime;
@@ -229,6 +256,25 @@ void chartsdata_refresh(void) {
 	data[CHARTS_DUPTRUNC] = opsDupTrunc;
 	data[CHARTS_TEST] = opsTest;
 
+	getReadOutputBufferPool().stats(&bufferPoolHits, &bufferPoolMisses);
+	data[CHARTS_BUFPOOLHIT] = bufferPoolHits;
+	data[CHARTS_BUFPOOLMISS] = bufferPoolMisses;
+
+	HddStats::fsyncGroupStats(&fsyncGroups, &fsyncGroupChunks,
+	                          data + CHARTS_FSYNCGROUPTIME);
+	data[CHARTS_FSYNCGROUPS] = fsyncGroups;
+	data[CHARTS_FSYNCGROUPCHUNKS] = fsyncGroupChunks;
+
+	gBlockCache.stats(&blockCacheHits, &blockCacheMisses);
+	data[CHARTS_BLOCKCACHEHIT] = blockCacheHits;
+	data[CHARTS_BLOCKCACHEMISS] = blockCacheMisses;
+
+	HddStats::TierStats tierStats = HddStats::tierStats();
+	data[CHARTS_FASTTIERREAD] = tierStats.fastTierReads;
+	data[CHARTS_SLOWTIERREAD] = tierStats.slowTierReads;
+	data[CHARTS_CHUNKSPROMOTED] = tierStats.chunksPromoted;
+	data[CHARTS_CHUNKSDEMOTED] = tierStats.chunksDemoted;
+
 	charts_add(data, eventloop_time() - SECONDS_IN_ONE_MINUTE);
 }
 
@@ -83,6 +83,17 @@ void ChunkFileCreator::write(uint32_t offset, uint32_t size, uint32_t crc,
 	}
 }
 
+void ChunkFileCreator::writeBlocks(const ChunkBlockWrite *writes,
+                                   uint32_t count) {
+	assert(is_open_ && !is_commited_ && chunk_);
+	auto *crcData = gOpenChunks.getResource(chunk_->metaFD()).crcData();
+	int status =
+	    chunk_->owner()->writeChunkBlocks(chunk_, 0, writes, count, crcData);
+	if (status != SAUNAFS_STATUS_OK) {
+		throw Exception("failed to write chunk", status);
+	}
+}
+
 void ChunkFileCreator::commit() {
 	assert(is_open_ && !is_commited_);
 	int status = hddClose(chunk_);
@@ -38,6 +38,8 @@ public:
 
 	void create();
 	void write(uint32_t offset, uint32_t size, uint32_t crc, const uint8_t* buffer);
+	/// Writes consecutive full blocks with a single disk write if possible
+	void writeBlocks(const ChunkBlockWrite* writes, uint32_t count);
 	void commit();
 
 	uint64_t chunkId() const { return chunk_id_; }
@@ -23,9 +23,13 @@
 #include <unistd.h>
 #include <cassert>
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <initializer_list>
 #include <memory>
 #include <string>
+#include <thread>
 
 #include "chunkserver/g_limiters.h"
 #include "common/crc.h"
@@ -137,19 +141,97 @@ uint32_t ChunkReplicator::getChunkBlocks(uint64_t chunk_id, uint32_t chunk_versi
 	return SFSBLOCKSINCHUNK;
 }
 
+namespace {
+
+/// Blocks of a chunk read from the sources, waiting to be written
+struct ReplicationBatch {
+	int firstBlock;
+	int nrOfBlocks;
+	std::vector<uint8_t> buffer;
+};
+
+/// Bounded queue of batches between the thread reading them from the sources
+/// and the thread writing them to the disk. An error on either side stops both.
+class ReplicationBatchQueue {
+public:
+	explicit ReplicationBatchQueue(size_t capacity) : capacity_(capacity) {}
+
+	/// Waits for space in the queue. Returns false if the writer gave up.
+	bool push(ReplicationBatch &&batch) {
+		std::unique_lock lock(mutex_);
+		cond_.wait(lock, [this]() {
+			return cancelled_ || batches_.size() < capacity_;
+		});
+		if (cancelled_) {
+			return false;
+		}
+		batches_.push_back(std::move(batch));
+		cond_.notify_all();
+		return true;
+	}
+
+	/// Waits for the next batch. Returns false after the last one, rethrows
+	/// the error of the reader.
+	bool pop(ReplicationBatch &batch) {
+		std::unique_lock lock(mutex_);
+		cond_.wait(lock, [this]() {
+			return !batches_.empty() || finished_ || error_;
+		});
+		if (!batches_.empty()) {
+			batch = std::move(batches_.front());
+			batches_.pop_front();
+			cond_.notify_all();
+			return true;
+		}
+		if (error_) {
+			std::rethrow_exception(error_);
+		}
+		return false;
+	}
+
+	/// Called by the reader after the last batch
+	void finish(std::exception_ptr error = nullptr) {
+		std::lock_guard lock(mutex_);
+		finished_ = true;
+		error_ = error;
+		cond_.notify_all();
+	}
+
+	/// Called by the writer when it gives up
+	void cancel() {
+		std::lock_guard lock(mutex_);
+		cancelled_ = true;
+		batches_.clear();
+		cond_.notify_all();
+	}
+
+	bool cancelled() {
+		std::lock_guard lock(mutex_);
+		return cancelled_;
+	}
+
+private:
+	std::mutex mutex_;
+	std::condition_variable cond_;
+	std::deque<ReplicationBatch> batches_;
+	size_t capacity_;
+	bool finished_ = false;
+	bool cancelled_ = false;
+	std::exception_ptr error_;
+};
+
+}  // namespace
+
 void ChunkReplicator::replicate(ChunkFileCreator& fileCreator,
 		const std::vector<ChunkTypeWithAddress>& sources) {
 	// Get number of blocks to replicate
 	int blocks = getChunkBlocks(fileCreator.chunkId(), fileCreator.chunkVersion(), sources);
-	int batchSize = 50;
 	int data_part_count = slice_traits::getNumberOfDataParts(fileCreator.chunkType());
 	blocks = slice_traits::getNumberOfBlocks(fileCreator.chunkType(), blocks);
-	batchSize = data_part_count * ((batchSize + data_part_count - 1) / data_part_count);
+	int batchSize = data_part_count * ((kBlocksInBatch + data_part_count - 1) / data_part_count);
 
-	SliceRecoveryPlanner planner;
 	ReadPlanExecutor::ChunkTypeLocations locations;
 	SliceRecoveryPlanner::PartsContainer available_parts;
-	std::vector<uint8_t> buffer;
 
 	for (const auto& source : sources) {
 		available_parts.push_back(source.chunk_type);
@@ -161,37 +243,67 @@ void ChunkReplicator::replicate(ChunkFileCreator& fileCreator,
 	}
 
 	fileCreator.create();
-	static const SteadyDuration max_wait_time = std::chrono::milliseconds(total_timeout_ms_);
+	const SteadyDuration max_wait_time = std::chrono::milliseconds(total_timeout_ms_);
 	Timeout timeout{max_wait_time};
-	for (int firstBlock = 0; firstBlock < blocks; firstBlock += batchSize) {
-		int nrOfBlocks = std::min(blocks - firstBlock, batchSize);
 
-		planner.prepare(fileCreator.chunkType(), firstBlock, nrOfBlocks, available_parts);
-		if (!planner.isReadingPossible()) {
-			throw Exception("No copies to read from");
-		}
+	// Batches are read by another thread, so that reading the next ones from
+	// the sources overlaps with writing the current one to the disk
+	ReplicationBatchQueue queue(kBatchesReadAhead);
+	std::thread reader([&]() {
+		try {
+			SliceRecoveryPlanner planner;
+			for (int firstBlock = 0; firstBlock < blocks && !queue.cancelled();
+			     firstBlock += batchSize) {
+				int nrOfBlocks = std::min(blocks - firstBlock, batchSize);
+
+				planner.prepare(fileCreator.chunkType(), firstBlock, nrOfBlocks, available_parts);
+				if (!planner.isReadingPossible()) {
+					throw Exception("No copies to read from");
+				}
 
-		// Wait for limit to be assigned
-		uint8_t status = replicationBandwidthLimiter().wait(nrOfBlocks * SFSBLOCKSIZE, max_wait_time);
-		if (status != SAUNAFS_STATUS_OK) {
-			throw Exception("Replication limiting error", status);
+				// Wait for limit to be assigned
+				uint8_t status = replicationBandwidthLimiter().wait(nrOfBlocks * SFSBLOCKSIZE,
+						max_wait_time);
+				if (status != SAUNAFS_STATUS_OK) {
+					throw Exception("Replication limiting error", status);
+				}
+
+				// Build and execute the plan
+				ReplicationBatch batch{firstBlock, nrOfBlocks, {}};
+				ReadPlanExecutor executor(chunkserverStats_,
+						fileCreator.chunkId(), fileCreator.chunkVersion(),
+						planner.buildPlan());
+				executor.executePlan(batch.buffer, locations, connector_, timeout.remaining_ms(),
+						wave_timeout_ms_, timeout);
+
+				if (!queue.push(std::move(batch))) {
+					break;
+				}
+			}
+			queue.finish();
+		} catch (...) {
+			queue.finish(std::current_exception());
 		}
+	});
 
-		// Build and execute the plan
-		buffer.clear();
-		ReadPlanExecutor executor(chunkserverStats_,
-				fileCreator.chunkId(), fileCreator.chunkVersion(),
-				planner.buildPlan());
-		executor.executePlan(buffer, locations, connector_, timeout.remaining_ms(), wave_timeout_ms_, timeout);
-
-		for (int i = 0; i < nrOfBlocks; ++i) {
-			uint32_t offset = i * SFSBLOCKSIZE;
-			const uint8_t* dataBlock = buffer.data() + offset;
-			uint32_t crc = mycrc32(0, dataBlock, SFSBLOCKSIZE);
-			uint32_t offsetInChunk = offset + firstBlock * SFSBLOCKSIZE;
-			fileCreator.write(offsetInChunk, SFSBLOCKSIZE, crc, dataBlock);
+	try {
+		ReplicationBatch batch;
+		std::vector<ChunkBlockWrite> writes;
+		while (queue.pop(batch)) {
+			writes.clear();
+			for (int i = 0; i < batch.nrOfBlocks; ++i) {
+				const uint8_t* dataBlock = batch.buffer.data() + i * SFSBLOCKSIZE;
+				writes.push_back({static_cast<uint16_t>(batch.firstBlock + i), 0,
+						SFSBLOCKSIZE, mycrc32(0, dataBlock, SFSBLOCKSIZE), dataBlock});
+			}
+			fileCreator.writeBlocks(writes.data(), writes.size());
 		}
+	} catch (...) {
+		queue.cancel();
+		reader.join();
+		throw;
 	}
+	reader.join();
 
 	fileCreator.commit();
 	incStats();
@@ -37,6 +37,10 @@ public:
 	static constexpr unsigned kDefaultTotalTimeout_ms = 60 * 1000;
 	static constexpr unsigned kDefaultWaveTimeout_ms = 500;
 	static constexpr unsigned kDefaultConnectionTimeout_ms = 1000;
+	/// Number of blocks read from the sources with a single read plan
+	static constexpr int kBlocksInBatch = 50;
+	/// Number of batches read ahead of the one being written to the disk
+	static constexpr size_t kBatchesReadAhead = 2;
 
 	ChunkReplicator(ChunkConnector& connector);
 	void replicate(ChunkFileCreator& fileCreator, const std::vector<ChunkTypeWithAddress>& sources);
@@ -0,0 +1,81 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+
+#include "chunkserver/chunk_tiering.h"
+
+#include <algorithm>
+
+ChunkTiering::ChunkTiering(double maxFastUsage, double minPromoteHeat,
+                           uint32_t maxMoves)
+    : maxFastUsage_(maxFastUsage),
+      minPromoteHeat_(minPromoteHeat),
+      maxMoves_(maxMoves) {}
+
+std::vector<ChunkTiering::Move> ChunkTiering::plan(
+    std::vector<Candidate> fastChunks, std::vector<Candidate> slowChunks,
+    uint64_t fastUsedBytes, uint64_t fastTotalBytes) const {
+	std::vector<Move> moves;
+
+	std::sort(fastChunks.begin(), fastChunks.end(),
+	          [](const Candidate &lhs, const Candidate &rhs) {
+		          return lhs.heat < rhs.heat;
+	          });
+	std::sort(slowChunks.begin(), slowChunks.end(),
+	          [](const Candidate &lhs, const Candidate &rhs) {
+		          return lhs.heat > rhs.heat;
+	          });
+
+	// Bytes which can still be stored in the fast tier, negative if over limit
+	double room = static_cast<double>(fastTotalBytes) * maxFastUsage_ -
+	              static_cast<double>(fastUsedBytes);
+	size_t coldest = 0;
+
+	while (room < 0 && coldest < fastChunks.size() && moves.size() < maxMoves_) {
+		room += fastChunks[coldest].bytes;
+		moves.push_back({fastChunks[coldest++].chunk, false});
+	}
+
+	for (const auto &hot : slowChunks) {
+		if (hot.heat < minPromoteHeat_ || moves.size() >= maxMoves_) {
+			break;
+		}
+
+		// Make room by demoting chunks much colder than this one
+		double freed = room;
+		size_t demoted = coldest;
+		while (freed < hot.bytes && demoted < fastChunks.size() &&
+		       fastChunks[demoted].heat * kSwapHeatRatio < hot.heat) {
+			freed += fastChunks[demoted++].bytes;
+		}
+
+		if (freed < hot.bytes ||
+		    moves.size() + (demoted - coldest) + 1 > maxMoves_) {
+			break;
+		}
+
+		for (; coldest < demoted; ++coldest) {
+			moves.push_back({fastChunks[coldest].chunk, false});
+		}
+		moves.push_back({hot.chunk, true});
+		room = freed - hot.bytes;
+	}
+
+	return moves;
+}
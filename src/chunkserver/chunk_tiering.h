@@ -0,0 +1,73 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "protocol/chunks_with_type.h"
+
+/// Chooses which chunks should move between the fast and the slow disks of
+/// the chunkserver, so that the most accessed chunks live on the fast tier.
+///
+/// A round of planning does, in this order:
+///  * demote the coldest fast chunks while the fast tier is over its limit,
+///  * promote the hottest slow chunks while they fit in the fast tier,
+///  * swap a hot slow chunk with cold fast chunks when the slow one is
+///    kSwapHeatRatio times hotter, so that chunks do not bounce between tiers.
+/// The number of moves of a round is limited, the rest waits for the next one.
+class ChunkTiering {
+public:
+	/// A slow chunk must be this many times hotter than the fast chunks
+	/// demoted to make room for it
+	static constexpr double kSwapHeatRatio = 2.0;
+
+	/// A chunk stored in one of the tiers
+	struct Candidate {
+		ChunkWithType chunk;
+		uint64_t bytes;  ///< Space used by the chunk
+		double heat;     ///< See ChunkHeat
+	};
+
+	/// A chunk to be moved to the other tier
+	struct Move {
+		ChunkWithType chunk;
+		bool toFastTier;
+	};
+
+	/// \param maxFastUsage   Fraction of the fast tier which may be used.
+	/// \param minPromoteHeat Colder chunks are never promoted.
+	/// \param maxMoves       Limit of moves in a single round.
+	ChunkTiering(double maxFastUsage, double minPromoteHeat, uint32_t maxMoves);
+
+	/// Returns the moves to be done given the chunks of both tiers and the
+	/// space of the fast tier. The order of the moves matters: demotions free
+	/// the space needed by the promotions which follow them.
+	std::vector<Move> plan(std::vector<Candidate> fastChunks,
+	                       std::vector<Candidate> slowChunks,
+	                       uint64_t fastUsedBytes,
+	                       uint64_t fastTotalBytes) const;
+
+private:
+	double maxFastUsage_;
+	double minPromoteHeat_;
+	uint32_t maxMoves_;
+};
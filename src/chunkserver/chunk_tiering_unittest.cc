@@ -0,0 +1,106 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "chunkserver/chunk_tiering.h"
+
+#include <gtest/gtest.h>
+
+#include "chunkserver-common/chunk_heat.h"
+#include "common/slice_traits.h"
+
+static constexpr uint64_t kChunkBytes = 64 * 1024 * 1024;
+
+static ChunkTiering::Candidate candidate(uint64_t chunkId, double heat) {
+	return {ChunkWithType(chunkId, slice_traits::standard::ChunkPartType()),
+	        kChunkBytes, heat};
+}
+
+static std::vector<uint64_t> movedChunks(
+    const std::vector<ChunkTiering::Move> &moves, bool toFastTier) {
+	std::vector<uint64_t> result;
+	for (const auto &move : moves) {
+		if (move.toFastTier == toFastTier) {
+			result.push_back(move.chunk.id);
+		}
+	}
+	return result;
+}
+
+TEST(ChunkTieringTests, PromotesHotChunksWhileTheyFit) {
+	ChunkTiering tiering(0.5, 1.0, 100);
+
+	// Room for two chunks below 50% of the fast tier
+	auto moves = tiering.plan({candidate(1, 5.0)},
+	                          {candidate(2, 0.5), candidate(3, 10.0),
+	                           candidate(4, 20.0), candidate(5, 30.0)},
+	                          kChunkBytes, 6 * kChunkBytes);
+
+	EXPECT_EQ(std::vector<uint64_t>({5, 4}), movedChunks(moves, true));
+	EXPECT_TRUE(movedChunks(moves, false).empty());
+}
+
+TEST(ChunkTieringTests, DemotesColdChunksWhenOverLimit) {
+	ChunkTiering tiering(0.5, 1.0, 100);
+
+	auto moves = tiering.plan(
+	    {candidate(1, 3.0), candidate(2, 1.0), candidate(3, 2.0)}, {},
+	    3 * kChunkBytes, 4 * kChunkBytes);
+
+	EXPECT_EQ(std::vector<uint64_t>({2}), movedChunks(moves, false));
+}
+
+TEST(ChunkTieringTests, SwapsOnlyMuchHotterChunks) {
+	ChunkTiering tiering(1.0, 1.0, 100);
+
+	// The fast tier is full, chunk 11 is not hot enough to replace chunk 1
+	auto moves = tiering.plan({candidate(1, 4.0), candidate(2, 1.0)},
+	                          {candidate(10, 3.0), candidate(11, 6.0)},
+	                          2 * kChunkBytes, 2 * kChunkBytes);
+
+	ASSERT_EQ(2U, moves.size());
+	EXPECT_EQ(2U, moves[0].chunk.id);
+	EXPECT_FALSE(moves[0].toFastTier);
+	EXPECT_EQ(11U, moves[1].chunk.id);
+	EXPECT_TRUE(moves[1].toFastTier);
+}
+
+TEST(ChunkTieringTests, RespectsMoveLimit) {
+	ChunkTiering tiering(1.0, 1.0, 3);
+
+	auto moves = tiering.plan({candidate(1, 0.1), candidate(2, 0.1)},
+	                          {candidate(10, 5.0), candidate(11, 5.0)},
+	                          2 * kChunkBytes, 2 * kChunkBytes);
+
+	// The second swap would need a fourth move
+	EXPECT_EQ(std::vector<uint64_t>({1}), movedChunks(moves, false));
+	EXPECT_EQ(1U, movedChunks(moves, true).size());
+}
+
+TEST(ChunkTieringTests, HeatDecaysWithTime) {
+	ChunkHeat heat;
+	EXPECT_DOUBLE_EQ(0.0, heat.value(100));
+
+	heat.touch(100);
+	heat.touch(100);
+	EXPECT_DOUBLE_EQ(2.0, heat.value(100));
+	EXPECT_DOUBLE_EQ(1.0, heat.value(100 + ChunkHeat::kHalfLifeSeconds));
+
+	heat.touch(100 + 2 * ChunkHeat::kHalfLifeSeconds);
+	EXPECT_DOUBLE_EQ(1.5, heat.value(100 + 2 * ChunkHeat::kHalfLifeSeconds));
+}
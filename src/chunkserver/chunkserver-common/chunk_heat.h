@@ -0,0 +1,39 @@
+#pragma once
+
+#include "common/platform.h"
+
+#include <cmath>
+#include <cstdint>
+
+/// How often a chunk was accessed recently.
+///
+/// The heat is a counter of accesses which decays exponentially with time, so
+/// that an access made kHalfLifeSeconds ago weighs half as much as an access
+/// made now. Only the value and the time of its last update are stored.
+///
+/// The owner is responsible for the synchronization: the chunk heat is updated
+/// with the chunk locked and read with the chunk available.
+class ChunkHeat {
+public:
+	/// The time after which the weight of an access is halved
+	static constexpr uint32_t kHalfLifeSeconds = 3600;
+
+	/// Records an access of the given weight made at time `now` (in seconds)
+	void touch(uint32_t now, double weight = 1.0) {
+		value_ = static_cast<float>(value(now) + weight);
+		updateTime_ = now;
+	}
+
+	/// Returns the heat at time `now` (in seconds)
+	double value(uint32_t now) const {
+		if (value_ == 0 || now <= updateTime_) {
+			return value_;
+		}
+		return value_ * std::exp2(-static_cast<double>(now - updateTime_) /
+		                          kHalfLifeSeconds);
+	}
+
+private:
+	float value_ = 0;          ///< The heat at updateTime_
+	uint32_t updateTime_ = 0;  ///< The last time (in seconds) of an access
+};
@@ -28,6 +28,7 @@
 #include <cstdlib>
 #include <string>
 
+#include "chunkserver-common/chunk_heat.h"
 #include "chunkserver-common/disk_interface.h"
 #include "common/chunk_part_type.h"
 
@@ -230,6 +231,18 @@ public:
 	/// tested.
 	virtual void setIndexInDisk(size_t newIndexInDisk) = 0;
 
+	/// Returns the timestamp (in seconds) of the last successful test of the
+	/// Chunk's checksums, 0 if it was never tested.
+	virtual uint32_t lastTestTime() const = 0;
+	/// Sets the timestamp of the last successful test.
+	virtual void setLastTestTime(uint32_t newLastTestTime) = 0;
+
+	/// Returns how often the Chunk was accessed recently. Used to choose the
+	/// chunks to be kept on the fast tier disks.
+	virtual ChunkHeat &heat() = 0;
+	/// Returns how often the Chunk was accessed recently.
+	virtual const ChunkHeat &heat() const = 0;
+
 	/// Returns Chunk state, the state is used mainly for multithreading.
 	virtual ChunkState state() const = 0;
 	/// Sets the state of the Chunk.
@@ -131,6 +131,16 @@ void FDChunk::setIndexInDisk(size_t newIndexInDisk) {
 	indexInDisk_ = newIndexInDisk;
 }
 
+uint32_t FDChunk::lastTestTime() const { return lastTestTime_; }
+
+void FDChunk::setLastTestTime(uint32_t newLastTestTime) {
+	lastTestTime_ = newLastTestTime;
+}
+
+ChunkHeat &FDChunk::heat() { return heat_; }
+
+const ChunkHeat &FDChunk::heat() const { return heat_; }
+
 ChunkState FDChunk::state() const { return state_; }
 
 void FDChunk::setState(ChunkState newState) { state_ = newState; }
@@ -150,6 +150,16 @@ public:
 	/// Sets the index of the Chunk in the Disk.
 	void setIndexInDisk(size_t newIndexInDisk) override;
 
+	/// Returns the timestamp of the last successful test.
+	uint32_t lastTestTime() const override;
+	/// Sets the timestamp of the last successful test.
+	void setLastTestTime(uint32_t newLastTestTime) override;
+
+	/// Returns how often the Chunk was accessed recently.
+	ChunkHeat &heat() override;
+	/// Returns how often the Chunk was accessed recently.
+	const ChunkHeat &heat() const override;
+
 	/// Returns the state of the Chunk.
 	ChunkState state() const override;
 	/// Sets the state of the Chunk.
@@ -192,6 +202,8 @@ private:
 	uint16_t blocks_ = 0;       ///< Number of blocks in the chunk
 	uint16_t refCount_ = 0;     ///< Used to properly release the chunk
 	uint16_t blockExpectedToBeReadNext_ = 0;  ///< Read ahead helper
+	uint32_t lastTestTime_ = 0;  ///< Last successful test, 0 if never tested
+	ChunkHeat heat_;             ///< Recent accesses, for disk tiering
 	uint8_t validAttr_ = 0;   ///< Tells if the attributes were recently updated
 	uint8_t wasChanged_ = 0;  ///< Tells if it was changed from last flush
 	ChunkState state_;        ///< The state of the chunk
@@ -1,5 +1,7 @@
 #include "disk_chunks.h"
 
+#include <algorithm>
+
 #include "chunkserver-common/chunk_interface.h"
 #include "common/random.h"
 
@@ -41,12 +43,12 @@ IChunk *DiskChunks::getRandomChunk() const {
 	return chunks_[rnd_ranged(Index(0), chunks_.size() - 1)];
 }
 
-IChunk *DiskChunks::chunkToTest() const {
+IChunk *DiskChunks::chunkToTest() {
 	if (chunks_.empty())
 		return NO_CHUNKS_IN_COLLECTION;
 
 	if (firstUntestedChunk_ == chunks_.size())
-		firstUntestedChunk_ = 0; // Start a new chunk test loop.
+		sortByLastTestTime(); // Start a new chunk test loop.
 
 	return chunks_[firstUntestedChunk_];
 }
@@ -64,10 +66,26 @@ void DiskChunks::shuffle() {
 	firstUntestedChunk_ = 0;
 }
 
+void DiskChunks::sortByLastTestTime() {
+	std::stable_sort(chunks_.begin(), chunks_.end(),
+	                 [](const IChunk *lhs, const IChunk *rhs) {
+		                 return lhs->lastTestTime() < rhs->lastTestTime();
+	                 });
+	for (Index i = 0; i < chunks_.size(); ++i) {
+		chunks_[i]->setIndexInDisk(i);
+	}
+
+	firstUntestedChunk_ = 0;
+}
+
 size_t DiskChunks::size() const {
 	return chunks_.size();
 }
 
+size_t DiskChunks::testedCount() const {
+	return firstUntestedChunk_;
+}
+
 void DiskChunks::swap(Index lhsIndex, Index rhsIndex) {
 	IChunk* lhsChunk = chunks_[lhsIndex];
 	IChunk* rhsChunk = chunks_[rhsIndex];
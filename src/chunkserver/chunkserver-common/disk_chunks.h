@@ -61,8 +61,11 @@ public:
 
 	/// Returns the next chunk to be tested.
 	///
+	/// A new test loop starts with the chunks tested longest ago, see
+	/// `sortByLastTestTime`.
+	///
 	/// Returns NO_CHUNKS_IN_COLLECTION if the collection of chunks is empty.
-	IChunk* chunkToTest() const;
+	IChunk* chunkToTest();
 
 	/// Marks the given chunk as "tested".
 	void markAsTested(IChunk* chunk);
@@ -80,9 +83,18 @@ public:
 	/// This also marks all chunks as untested.
 	void shuffle();
 
+	/// Orders all chunks by their last test time, never tested chunks first.
+	///
+	/// The order of chunks with equal test times is preserved. This also marks
+	/// all chunks as untested.
+	void sortByLastTestTime();
+
 	/// Returns the number of chunks in the collection.
 	size_t size() const;
 
+	/// Returns the number of chunks already tested in the current test loop.
+	size_t testedCount() const;
+
 private:
 	/// Swaps the elements at the given indices.
 	///
@@ -107,5 +119,5 @@ private:
 	/// This can be equal to "chunks_.size()", which means that all chunks
 	/// are tested, When the next chunk is requested to be tested, a new test loop
 	/// should be started by changing this to "0" again.
-	mutable Index firstUntestedChunk_ = 0;
+	Index firstUntestedChunk_ = 0;
 };
@@ -10,6 +10,16 @@
 
 class IChunk;
 
+/// A single block write request, as received from a client or a previous
+/// chunkserver in the write chain.
+struct ChunkBlockWrite {
+	uint16_t blocknum;
+	uint32_t offsetInBlock;
+	uint32_t size;
+	uint32_t crc;
+	const uint8_t *buffer;
+};
+
 /// Represents a data disk in the Chunkserver context.
 ///
 /// Each Disk maps to a single line in the hdd.cfg file.
@@ -204,6 +214,14 @@ public:
 	                            uint32_t size, uint32_t crc, uint8_t *crcData,
 	                            const uint8_t *buffer) = 0;
 
+	/// Writes a run of complete, consecutive Chunk blocks
+	///
+	/// Every write must cover a whole block and blocknums must be consecutive.
+	/// \return SAUNAFS_STATUS_OK on success or specific SAUNAFS_ error code
+	virtual int writeChunkBlocks(IChunk *chunk, uint32_t version,
+	                             const ChunkBlockWrite *writes, uint32_t count,
+	                             uint8_t *crcData) = 0;
+
 	/// Writes the Chunk header into the device
 	///
 	/// Assumes that the thread local header buffer was filled with correct
@@ -281,6 +299,11 @@ public:
 	/// Setter for isMarkedForRemoval
 	virtual void setIsMarkedForRemoval(bool newIsMarkedForRemoval) = 0;
 
+	/// Returns true if the Disk belongs to the fast tier (see hdd.cfg)
+	virtual bool isFastTier() const = 0;
+	/// Setter for isFastTier
+	virtual void setIsFastTier(bool newIsFastTier) = 0;
+
 	/// Returns the scanning state of the Disk
 	virtual ScanState scanState() const = 0;
 	/// Setter for scanState
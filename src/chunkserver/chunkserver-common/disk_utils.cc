@@ -37,6 +37,12 @@ Configuration::Configuration(std::string hddCfgLine) {
 		hddCfgLine.erase(hddCfgLine.begin());
 	}
 
+	static const std::string fastTierToken = "fast:";
+	if (hddCfgLine.find(fastTierToken) == 0) {
+		isFastTier = true;
+		hddCfgLine.erase(0, fastTierToken.size());
+	}
+
 	static const std::string zonedToken = "zonefs:";
 	if (hddCfgLine.find(zonedToken) == 0) {
 		prefix = hddCfgLine.substr(0, zonedToken.size() - 1);
@@ -114,6 +114,10 @@ struct Configuration {
 	/// It is a zoned device, probably SMR.
 	bool isZoned = false;
 
+	/// Tells if the entry is prefixed with 'fast:' in the configuration file,
+	/// i.e. it belongs to the fast tier (e.g. NVMe) used for hot chunks.
+	bool isFastTier = false;
+
 	/// The hdd cfg line was parsed correctly or no need to parse
 	bool isValid = false;
 
@@ -1,5 +1,7 @@
 #include "disk_with_fd.h"
 
+#include <fcntl.h>
+#include <unistd.h>
 #include <bitset>
 #include <cstdio>
 
@@ -27,6 +29,7 @@ FDDisk::FDDisk(const disk::Configuration &configuration)
     : metaPath_(configuration.metaPath),
       dataPath_(configuration.dataPath),
       isMarkedForRemoval_(configuration.isMarkedForRemoval),
+      isFastTier_(configuration.isFastTier),
       isZonedDevice_(configuration.isZoned),
       leaveFreeSpace_(disk::gLeaveFree),
       carry_(random() / static_cast<double>(RAND_MAX)) {}
@@ -212,6 +215,10 @@ ssize_t FDDisk::writeCrc(IChunk *chunk, uint8_t *crcData) {
 }
 
 int FDDisk::fsyncChunk(IChunk *chunk) {
+	return fsyncGroup_.sync(chunk, gFsyncGroupWindowUs);
+}
+
+int FDDisk::fsyncSingleChunk(IChunk *chunk) {
 	const int metaResult = fsyncFD(chunk, true);
 	const int dataResult = fsyncFD(chunk, false);
 
@@ -222,6 +229,55 @@ int FDDisk::fsyncChunk(IChunk *chunk) {
 	return SAUNAFS_STATUS_OK;
 }
 
+void FDDisk::fsyncChunkGroup(const std::vector<IChunk *> &chunks,
+                             std::vector<int> &statuses) {
+#if defined(__linux__) && !defined(F_FULLFSYNC)
+	if (chunks.size() > 1) {
+		// Start the writeback of all files first, so that the device gets
+		// all the dirty pages at once instead of one file at a time
+		for (IChunk *chunk : chunks) {
+			sync_file_range(chunk->metaFD(), 0, 0, SYNC_FILE_RANGE_WRITE);
+			sync_file_range(chunk->dataFD(), 0, 0, SYNC_FILE_RANGE_WRITE);
+		}
+
+		// Then wait for each file separately, which mostly waits for the
+		// writeback already in flight. Unlike syncfs, this does not flush
+		// unrelated dirty data and gives every chunk the status of its files.
+		for (size_t i = 0; i < chunks.size(); ++i) {
+			for (int fd : {chunks[i]->metaFD(), chunks[i]->dataFD()}) {
+				if (fd >= 0 && ::fdatasync(fd) < 0) {
+					safs_silent_errlog(LOG_WARNING,
+					                   "fsyncChunkGroup: chunk:%016" PRIX64
+					                   " - fdatasync error",
+					                   chunks[i]->id());
+					statuses[i] = SAUNAFS_ERROR_IO;
+				}
+			}
+		}
+		return;
+	}
+#endif
+
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		statuses[i] = fsyncSingleChunk(chunks[i]);
+	}
+}
+
+int FDDisk::writeChunkBlocks(IChunk *chunk, uint32_t version,
+                             const ChunkBlockWrite *writes, uint32_t count,
+                             uint8_t *crcData) {
+	for (uint32_t i = 0; i < count; ++i) {
+		int status = writeChunkBlock(chunk, version, writes[i].blocknum,
+		                             writes[i].offsetInBlock, writes[i].size,
+		                             writes[i].crc, crcData, writes[i].buffer);
+		if (status != SAUNAFS_STATUS_OK) {
+			return status;
+		}
+	}
+
+	return SAUNAFS_STATUS_OK;
+}
+
 off64_t FDDisk::lseekMetadata(IChunk *chunk, off64_t offset, int whence) {
 	return ::lseek(chunk->metaFD(), offset, whence);
 }
@@ -390,6 +446,10 @@ void FDDisk::setIsMarkedForRemoval(bool newIsMarkedForRemoval) {
 	isMarkedForRemoval_ = newIsMarkedForRemoval;
 }
 
+bool FDDisk::isFastTier() const { return isFastTier_; }
+
+void FDDisk::setIsFastTier(bool newIsFastTier) { isFastTier_ = newIsFastTier; }
+
 bool FDDisk::wasRemovedFromConfig() const { return wasRemovedFromConfig_; }
 
 void FDDisk::setWasRemovedFromConfig(bool newWasRemovedFromConfig) {
@@ -3,9 +3,13 @@
 #include "common/platform.h"
 
 #include "chunkserver-common/disk_interface.h"
+#include "chunkserver-common/fsync_group.h"
 
 inline uint32_t gEmptyBlockCrc;
 
+/// Time in microseconds a Disk waits for more chunks to fsync together
+inline std::atomic<uint32_t> gFsyncGroupWindowUs{0};
+
 // forward declaration
 void initializeEmptyBlockCrcForDisks();
 
@@ -70,8 +74,17 @@ public:
 	ssize_t writeCrc(IChunk *chunk, uint8_t *crcData) override;
 
 	/// Synchronize the Chunk state with the storage device
+	///
+	/// Chunks of this Disk synced concurrently are grouped together, see
+	/// FsyncGroup and gFsyncGroupWindowUs.
 	int fsyncChunk(IChunk *chunk) override;
 
+	/// Writes the blocks one by one with writeChunkBlock, for Disks which
+	/// cannot write several blocks at once.
+	int writeChunkBlocks(IChunk *chunk, uint32_t version,
+	                     const ChunkBlockWrite *writes, uint32_t count,
+	                     uint8_t *crcData) override;
+
 	/// lseeks the metadata file descriptor
 	///
 	/// Should be possible for all Disk types if the metadata is stored in CMR
@@ -160,6 +173,11 @@ public:
 	/// Setter for isMarkedForRemoval_
 	void setIsMarkedForRemoval(bool newIsMarkedForRemoval) override;
 
+	/// Returns true if the Disk belongs to the fast tier (see hdd.cfg)
+	bool isFastTier() const override;
+	/// Setter for isFastTier_
+	void setIsFastTier(bool newIsFastTier) override;
+
 	/// Returns the scanning state of the Disk
 	ScanState scanState() const override;
 	/// Setter for scanState_
@@ -192,6 +210,13 @@ private:
 	/// Internal helper to sync both FDs (metadata and data)
 	int fsyncFD(IChunk *chunk, bool isForMetadata);
 
+	/// Syncs the metadata and data files of a single Chunk
+	int fsyncSingleChunk(IChunk *chunk);
+
+	/// Syncs a group of Chunks, starting the writeback of all their files at once
+	void fsyncChunkGroup(const std::vector<IChunk *> &chunks,
+	                     std::vector<int> &statuses);
+
 	std::string metaPath_;  ///< Metadata directory
 	std::string dataPath_;  ///< Data directory
 
@@ -206,6 +231,7 @@ private:
 	bool wasRemovedFromConfig_ = false;  ///< Tells if this Disk is missing in
 	                                     ///< the config file after reloading
 	bool isMarkedForRemoval_ = false;    ///< Marked with * in the hdd.cfg file
+	bool isFastTier_ = false;  ///< Marked with fast: in the hdd.cfg file
 	bool isReadOnly_ = false;  ///< A read-only file system was detected
 
 	/// Reserved for future usage. Tells if this Disk is zoned, probably SMR
@@ -252,4 +278,10 @@ private:
 	/// The collection is guarded by `gTestsMutex`, which should be locked
 	/// when the collection is accessed for reading or modifying.
 	DiskChunks chunks_;
+
+	/// Batches concurrent fsyncChunk calls
+	FsyncGroup fsyncGroup_{[this](const std::vector<IChunk *> &chunks,
+	                              std::vector<int> &statuses) {
+		fsyncChunkGroup(chunks, statuses);
+	}};
 };
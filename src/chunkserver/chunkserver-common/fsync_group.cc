@@ -0,0 +1,48 @@
+#include "fsync_group.h"
+
+#include <chrono>
+
+#include "common/saunafs_error_codes.h"
+
+FsyncGroup::FsyncGroup(BatchSyncFunction batchSync)
+    : batchSync_(std::move(batchSync)) {}
+
+int FsyncGroup::sync(IChunk *chunk, MicroSeconds window) {
+	std::unique_lock lock(mutex_);
+
+	if (!pending_) {
+		pending_ = std::make_shared<Group>();
+	}
+	auto group = pending_;
+	const size_t position = group->chunks.size();
+	group->chunks.push_back(chunk);
+
+	if (position > 0) {
+		cond_.wait(lock, [&group] { return group->done; });
+		return group->statuses[position];
+	}
+
+	// This thread leads the group
+	if (window > 0) {
+		auto deadline =
+		    std::chrono::steady_clock::now() + std::chrono::microseconds(window);
+		while (cond_.wait_until(lock, deadline) != std::cv_status::timeout) {
+		}
+	}
+	cond_.wait(lock, [this] { return !syncInProgress_; });
+	pending_.reset();
+	syncInProgress_ = true;
+	lock.unlock();
+
+	MicroSeconds startTime = getMicroSecsTime();
+	group->statuses.assign(group->chunks.size(), SAUNAFS_STATUS_OK);
+	batchSync_(group->chunks, group->statuses);
+	HddStats::fsyncBatch(group->chunks.size(), getMicroSecsTime() - startTime);
+
+	lock.lock();
+	syncInProgress_ = false;
+	group->done = true;
+	cond_.notify_all();
+
+	return group->statuses[0];
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "common/platform.h"
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "chunkserver-common/hdd_stats.h"
+
+class IChunk;
+
+/// Groups the fsync requests of a single Disk, so that chunks closed at about
+/// the same time are made durable together.
+///
+/// The first thread of a group becomes its leader: it waits for the given
+/// window and for the previous group to be synced, then syncs every chunk that
+/// joined meanwhile with a single call to the batch function. The other
+/// threads just wait for the leader and get the status of their own chunk.
+class FsyncGroup {
+public:
+	/// Syncs all chunks and sets the status of each of them in statuses
+	using BatchSyncFunction = std::function<void(
+	    const std::vector<IChunk *> &chunks, std::vector<int> &statuses)>;
+
+	explicit FsyncGroup(BatchSyncFunction batchSync);
+
+	FsyncGroup(const FsyncGroup &) = delete;
+	FsyncGroup &operator=(const FsyncGroup &) = delete;
+
+	/// Makes the chunk durable, possibly together with other chunks
+	///
+	/// Blocks until the group containing the chunk is synced, for at least
+	/// window microseconds when the calling thread leads the group.
+	int sync(IChunk *chunk, MicroSeconds window);
+
+private:
+	struct Group {
+		std::vector<IChunk *> chunks;
+		std::vector<int> statuses;
+		bool done = false;
+	};
+
+	BatchSyncFunction batchSync_;
+	std::mutex mutex_;
+	std::condition_variable cond_;
+	std::shared_ptr<Group> pending_;  ///< Group still accepting chunks
+	bool syncInProgress_ = false;     ///< A leader is running batchSync_
+};
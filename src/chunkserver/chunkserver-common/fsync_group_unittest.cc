@@ -0,0 +1,68 @@
+#include "common/platform.h"
+
+#include <gtest/gtest.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "chunkserver-common/fsync_group.h"
+#include "common/saunafs_error_codes.h"
+
+namespace {
+
+IChunk *fakeChunk(size_t index) {
+	static std::array<char, 64> chunks;
+	return reinterpret_cast<IChunk *>(&chunks.at(index));
+}
+
+}  // namespace
+
+TEST(FsyncGroupTests, SingleChunk) {
+	std::vector<size_t> groupSizes;
+	FsyncGroup group([&](const std::vector<IChunk *> &chunks,
+	                     std::vector<int> &statuses) {
+		groupSizes.push_back(chunks.size());
+		EXPECT_EQ(chunks.size(), statuses.size());
+	});
+
+	EXPECT_EQ(SAUNAFS_STATUS_OK, group.sync(fakeChunk(0), 0));
+	EXPECT_EQ(SAUNAFS_STATUS_OK, group.sync(fakeChunk(1), 0));
+	EXPECT_EQ((std::vector<size_t>{1, 1}), groupSizes);
+}
+
+TEST(FsyncGroupTests, ConcurrentChunksAreGrouped) {
+	constexpr size_t kThreads = 16;
+	std::atomic<size_t> groups{0};
+	std::atomic<size_t> syncedChunks{0};
+	FsyncGroup group([&](const std::vector<IChunk *> &chunks,
+	                     std::vector<int> &statuses) {
+		groups++;
+		syncedChunks += chunks.size();
+		for (size_t i = 0; i < chunks.size(); ++i) {
+			// Fail the chunks with odd indexes to check statuses are routed
+			auto index = reinterpret_cast<char *>(chunks[i]) -
+			             reinterpret_cast<char *>(fakeChunk(0));
+			statuses[i] = index % 2 ? SAUNAFS_ERROR_IO : SAUNAFS_STATUS_OK;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	});
+
+	std::vector<std::thread> threads;
+	std::array<int, kThreads> results{};
+	for (size_t i = 0; i < kThreads; ++i) {
+		threads.emplace_back([&, i] {
+			results[i] = group.sync(fakeChunk(i), 50000);
+		});
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+
+	EXPECT_EQ(kThreads, syncedChunks);
+	EXPECT_LT(groups, kThreads);
+	for (size_t i = 0; i < kThreads; ++i) {
+		EXPECT_EQ(i % 2 ? SAUNAFS_ERROR_IO : SAUNAFS_STATUS_OK, results[i]);
+	}
+}
@@ -104,6 +104,38 @@ void dataFSync(IDisk *disk, MicroSeconds fsyncTime) {
 	atomicMax<uint32_t>(diskStats.usecfsyncmax, fsyncTime);
 }
 
+void fsyncBatch(uint32_t batchSize, MicroSeconds fsyncTime) {
+	TRACETHIS();
+	gStatsFsyncGroups++;
+	gStatsFsyncGroupChunks += batchSize;
+	atomicMax<uint64_t>(gStatsFsyncGroupTimeMax, fsyncTime);
+}
+
+void fsyncGroupStats(uint32_t *groups, uint32_t *groupChunks,
+                     uint64_t *groupTimeMax) {
+	TRACETHIS();
+	*groups = gStatsFsyncGroups.exchange(0);
+	*groupChunks = gStatsFsyncGroupChunks.exchange(0);
+	*groupTimeMax = gStatsFsyncGroupTimeMax.exchange(0);
+}
+
+void tierRead(const IDisk *disk) {
+	(disk->isFastTier() ? gStatsFastTierReads : gStatsSlowTierReads)++;
+}
+
+void tierMove(bool toFastTier) {
+	(toFastTier ? gStatsChunksPromoted : gStatsChunksDemoted)++;
+}
+
+TierStats tierStats() {
+	TierStats result;
+	result.fastTierReads = gStatsFastTierReads.exchange(0);
+	result.slowTierReads = gStatsSlowTierReads.exchange(0);
+	result.chunksPromoted = gStatsChunksPromoted.exchange(0);
+	result.chunksDemoted = gStatsChunksDemoted.exchange(0);
+	return result;
+}
+
 } //namespace HddStats
 
 IOStatsUpdater::IOStatsUpdater(IDisk *disk, uint64_t dataSize,
@@ -38,6 +38,25 @@ inline std::atomic<uint32_t> gStatsOperationsDuplicate(0);
 inline std::atomic<uint32_t> gStatsOperationsTruncate(0);
 inline std::atomic<uint32_t> gStatsOperationsDupTrunc(0);
 
+/// Grouped fsyncs (see FsyncGroup): number of groups, chunks synced in them and
+/// the longest time of syncing a group
+inline std::atomic<uint32_t> gStatsFsyncGroups(0);
+inline std::atomic<uint32_t> gStatsFsyncGroupChunks(0);
+inline std::atomic<uint64_t> gStatsFsyncGroupTimeMax(0);
+
+/// Reads served by the disks of each tier and chunks moved between the tiers
+/// (see hdd.cfg 'fast:' disks).
+struct TierStats {
+	uint64_t fastTierReads = 0;
+	uint64_t slowTierReads = 0;
+	uint64_t chunksPromoted = 0;
+	uint64_t chunksDemoted = 0;
+};
+inline std::atomic<uint64_t> gStatsFastTierReads(0);
+inline std::atomic<uint64_t> gStatsSlowTierReads(0);
+inline std::atomic<uint64_t> gStatsChunksPromoted(0);
+inline std::atomic<uint64_t> gStatsChunksDemoted(0);
+
 struct statsReport {
 	statsReport(uint64_t *overBytesRead, uint64_t *overBytesWrite,
 	            uint32_t *overOpsRead, uint32_t *overOpsWrite,
@@ -87,6 +106,23 @@ void overheadRead(uint32_t size);
 void overheadWrite(uint32_t size);
 void dataFSync(IDisk *disk, MicroSeconds fsyncTime);
 
+/// Called once per group of chunks synced together
+void fsyncBatch(uint32_t batchSize, MicroSeconds fsyncTime);
+
+/// Returns the grouped fsync stats gathered since the previous call
+void fsyncGroupStats(uint32_t *groups, uint32_t *groupChunks,
+                     uint64_t *groupTimeMax);
+
+/// Called for every block read from a Disk
+void tierRead(const IDisk *disk);
+
+/// Called for every chunk moved to the other tier
+void tierMove(bool toFastTier);
+
+/// Only called from chartsdata_refresh every minute
+/// Returns the tier stats gathered since the previous call
+TierStats tierStats();
+
 } //namespace HddStats
 
 /// RAII scoped updater for timed IO operations, using a delegate function
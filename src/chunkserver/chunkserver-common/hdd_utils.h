@@ -14,7 +14,7 @@ inline std::atomic<uint32_t> gErrorCounter = 0;
 inline std::atomic_bool gHddSpaceChanged = false;
 
 inline std::thread gDisksThread, gDelayedThread, gTesterThread;
-inline std::thread gChunkTesterThread;
+inline std::thread gChunkTesterThread, gTieringThread;
 
 inline std::atomic_bool gTerminate = false;
 inline uint8_t gDiskActions = 0;  // no need for atomic; guarded by gDisksMutex
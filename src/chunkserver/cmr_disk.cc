@@ -1,17 +1,161 @@
 #include "cmr_disk.h"
 
 #include <sys/statvfs.h>
+#include <sys/uio.h>
+#include <climits>
+#include <vector>
 
 #include "chunkserver-common/chunk_interface.h"
 #include "chunkserver-common/global_shared_resources.h"
 #include "chunkserver-common/hdd_stats.h"
 #include "chunkserver-common/subfolder.h"
+#include "chunkserver/aligned_allocator.h"
 #include "chunkserver/cmr_chunk.h"
 #include "common/crc.h"
 #include "common/saunafs_error_codes.h"
 #include "devtools/TracePrinter.h"
 #include "devtools/request_log.h"
 
+namespace {
+
+/// Size of the bounce buffer used for unaligned direct I/O, enough for a
+/// whole block at any offset
+constexpr size_t kDirectIoBufferSize = SFSBLOCKSIZE + disk::kIoBlockSize;
+
+uint8_t *getDirectIoBuffer() {
+	static thread_local std::vector<uint8_t,
+	                                AlignedAllocator<uint8_t, disk::kIoBlockSize>>
+	    buffer(kDirectIoBufferSize);
+	return buffer.data();
+}
+
+inline uint64_t alignDown(uint64_t value) {
+	return value - value % disk::kIoBlockSize;
+}
+
+inline uint64_t alignUp(uint64_t value) {
+	return alignDown(value + disk::kIoBlockSize - 1);
+}
+
+inline bool isAlignedForDirectIo(const void *buffer, uint64_t size,
+                                 uint64_t offset) {
+	return reinterpret_cast<uintptr_t>(buffer) % disk::kIoBlockSize == 0 &&
+	       size % disk::kIoBlockSize == 0 && offset % disk::kIoBlockSize == 0;
+}
+
+/// Opens a data file, with O_DIRECT if requested and supported by the
+/// filesystem (e.g. tmpfs does not support it)
+int openDataFile(const std::string &filename, int flags) {
+#ifdef O_DIRECT
+	if (gUseDirectIO) {
+		int fd = ::open(filename.c_str(), flags | O_DIRECT,
+		                disk::kDefaultOpenMode);
+		if (fd >= 0 || errno != EINVAL) {
+			return fd;
+		}
+	}
+#endif
+	return ::open(filename.c_str(), flags, disk::kDefaultOpenMode);
+}
+
+/// pread which also works for O_DIRECT files when the buffer, size or offset
+/// are not aligned, by reading through an aligned buffer
+ssize_t directPread(int fd, uint8_t *buffer, size_t size, off_t offset) {
+	if (isAlignedForDirectIo(buffer, size, offset)) {
+		return ::pread(fd, buffer, size, offset);
+	}
+
+	uint8_t *alignedBuffer = getDirectIoBuffer();
+	size_t done = 0;
+
+	while (done < size) {
+		const uint64_t position = offset + done;
+		const uint64_t alignedPosition = alignDown(position);
+		const size_t skip = position - alignedPosition;
+		const size_t wanted =
+		    std::min<size_t>(size - done, kDirectIoBufferSize - skip);
+
+		ssize_t ret = ::pread(fd, alignedBuffer, alignUp(skip + wanted),
+		                      alignedPosition);
+		if (ret < 0) {
+			return done > 0 ? static_cast<ssize_t>(done) : ret;
+		}
+		if (static_cast<size_t>(ret) <= skip) {
+			break;  // End of file
+		}
+
+		const size_t got = std::min<size_t>(wanted, ret - skip);
+		memcpy(buffer + done, alignedBuffer + skip, got);
+		done += got;
+		if (got < wanted) {
+			break;  // End of file
+		}
+	}
+
+	return done;
+}
+
+/// pwrite which also works for O_DIRECT files when the buffer, size or offset
+/// are not aligned. The partially written pages are read first.
+ssize_t directPwrite(int fd, const uint8_t *buffer, size_t size,
+                     off_t offset) {
+	if (isAlignedForDirectIo(buffer, size, offset)) {
+		return ::pwrite(fd, buffer, size, offset);
+	}
+
+	uint8_t *alignedBuffer = getDirectIoBuffer();
+	size_t done = 0;
+
+	while (done < size) {
+		const uint64_t position = offset + done;
+		const uint64_t alignedPosition = alignDown(position);
+		const size_t skip = position - alignedPosition;
+		const size_t wanted =
+		    std::min<size_t>(size - done, kDirectIoBufferSize - skip);
+		const size_t alignedSize = alignUp(skip + wanted);
+		const size_t lastPage = alignedSize - disk::kIoBlockSize;
+		uint64_t endOfFile = 0;  // Only known if it is within the pages
+
+		auto readPage = [&](size_t pageOffset) {
+			ssize_t ret =
+			    ::pread(fd, alignedBuffer + pageOffset, disk::kIoBlockSize,
+			            alignedPosition + pageOffset);
+			if (ret < 0) {
+				return false;
+			}
+			if (static_cast<size_t>(ret) < disk::kIoBlockSize) {
+				memset(alignedBuffer + pageOffset + ret, 0,
+				       disk::kIoBlockSize - ret);
+				endOfFile = alignedPosition + pageOffset + ret;
+			}
+			return true;
+		};
+
+		if ((skip > 0 && !readPage(0)) ||
+		    ((skip + wanted) % disk::kIoBlockSize != 0 &&
+		     (lastPage > 0 || skip == 0) && !readPage(lastPage))) {
+			return done > 0 ? static_cast<ssize_t>(done) : -1;
+		}
+
+		memcpy(alignedBuffer + skip, buffer + done, wanted);
+		ssize_t ret = ::pwrite(fd, alignedBuffer, alignedSize, alignedPosition);
+		if (ret < static_cast<ssize_t>(skip + wanted)) {
+			return done > 0 ? static_cast<ssize_t>(done) : -1;
+		}
+		if (endOfFile > 0) {
+			// Do not leave the padding of the last page in the file
+			if (::ftruncate(fd, std::max(endOfFile, position + wanted)) < 0) {
+				return done > 0 ? static_cast<ssize_t>(done) : -1;
+			}
+		}
+		done += wanted;
+	}
+
+	return done;
+}
+
+}  // namespace
+
 CmrDisk::CmrDisk(const std::string &_metaPath, const std::string &_dataPath,
                  bool _isMarkedForRemoval, bool _isZonedDevice)
     : FDDisk(_metaPath, _dataPath, _isMarkedForRemoval, _isZonedDevice) {}
@@ -159,17 +303,16 @@ void CmrDisk::creat(IChunk *chunk) {
 	                        O_RDWR | O_TRUNC | O_CREAT,
 	                        disk::kDefaultOpenMode));
 
-	chunk->setDataFD(::open(chunk->dataFilename().c_str(),
-	                        O_RDWR | O_TRUNC | O_CREAT,
-	                        disk::kDefaultOpenMode));
+	chunk->setDataFD(
+	    openDataFile(chunk->dataFilename(), O_RDWR | O_TRUNC | O_CREAT));
 }
 
 void CmrDisk::open(IChunk *chunk) {
 	chunk->setMetaFD(::open(chunk->metaFilename().c_str(),
 	                        isReadOnly() ? O_RDONLY : O_RDWR));
 
-	chunk->setDataFD(::open(chunk->dataFilename().c_str(),
-	                        isReadOnly() ? O_RDONLY : O_RDWR));
+	chunk->setDataFD(openDataFile(chunk->dataFilename(),
+	                              isReadOnly() ? O_RDONLY : O_RDWR));
 }
 
 int CmrDisk::unlinkChunk(IChunk *chunk) {
@@ -192,11 +335,18 @@ int CmrDisk::ftruncateData(IChunk *chunk, uint64_t size) {
 
 ssize_t CmrDisk::preadData(IChunk *chunk, uint8_t *blockBuffer, uint64_t size,
                            uint64_t offset) {
+	if (gUseDirectIO) {
+		return directPread(chunk->dataFD(), blockBuffer, size, offset);
+	}
 	return ::pread(chunk->dataFD(), blockBuffer, size, offset);
 }
 
 void CmrDisk::prefetchChunkBlocks(IChunk &chunk, uint16_t firstBlock,
                                   uint32_t blockCount) {
+	if (gUseDirectIO) {
+		return;  // The page cache is not used
+	}
+
 	if (blockCount > 0) {
 		auto blockSize = SFSBLOCKSIZE;
 #ifdef SAUNAFS_HAVE_POSIX_FADVISE
@@ -221,8 +371,8 @@ int CmrDisk::readBlockAndCrc(IChunk *chunk, uint8_t *blockBuffer,
 	{
 		DiskReadStatsUpdater updater(chunk->owner(), SFSBLOCKSIZE);
 		const ssize_t bytesRead =
-		    ::pread(chunk->dataFD(), blockBuffer + kCrcSize, SFSBLOCKSIZE,
-		            chunk->getBlockOffset(blocknum));
+		    preadData(chunk, blockBuffer + kCrcSize, SFSBLOCKSIZE,
+		              chunk->getBlockOffset(blocknum));
 		if (bytesRead != SFSBLOCKSIZE) {
 			hddAddErrorAndPreserveErrno(chunk);
 			safs_silent_errlog(LOG_WARNING, "%s: file:%s - read error",
@@ -272,8 +422,10 @@ int CmrDisk::writePartialBlockAndCrc(IChunk *chunk, const uint8_t *buffer,
 	{
 		DiskWriteStatsUpdater updater(chunk->owner(), size);
 
-		auto ret = pwrite(chunk->dataFD(), buffer, size,
-		                  chunk->getBlockOffset(blockNum) + offsetInBlock);
+		const off_t offset = chunk->getBlockOffset(blockNum) + offsetInBlock;
+		auto ret = gUseDirectIO
+		               ? directPwrite(chunk->dataFD(), buffer, size, offset)
+		               : pwrite(chunk->dataFD(), buffer, size, offset);
 
 		if (ret != size) {
 			hddAddErrorAndPreserveErrno(chunk);
@@ -491,9 +643,109 @@ int CmrDisk::writeChunkBlock(IChunk *chunk, uint32_t version, uint16_t blocknum,
 	return SAUNAFS_STATUS_OK;
 }
 
+int CmrDisk::writeChunkBlocks(IChunk *chunk, uint32_t version,
+                              const ChunkBlockWrite *writes, uint32_t count,
+                              uint8_t *crcData) {
+	assert(chunk);
+	assert(count > 0);
+	LOG_AVG_TILL_END_OF_SCOPE0("writeChunkBlocks");
+	TRACETHIS2(chunk->chunkid, count);
+
+	if (chunk->version() != version && version > 0) {
+		return SAUNAFS_ERROR_WRONGVERSION;
+	}
+
+	const uint16_t firstBlock = writes[0].blocknum;
+	if (firstBlock + count > chunk->maxBlocksInFile()) {
+		return SAUNAFS_ERROR_BNUMTOOBIG;
+	}
+
+	std::vector<struct iovec> iov(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		assert(writes[i].blocknum == firstBlock + i);
+		if (writes[i].offsetInBlock != 0 || writes[i].size != SFSBLOCKSIZE) {
+			return SAUNAFS_ERROR_WRONGSIZE;
+		}
+		if (writes[i].crc != mycrc32(0, writes[i].buffer, SFSBLOCKSIZE)) {
+			return SAUNAFS_ERROR_CRC;
+		}
+		iov[i].iov_base = const_cast<uint8_t *>(writes[i].buffer);
+		iov[i].iov_len = SFSBLOCKSIZE;
+	}
+
+	chunk->setWasChanged(1U);
+
+	const uint16_t lastBlock = firstBlock + count - 1;
+	if (lastBlock >= chunk->blocks()) {
+		// Fill new blocks' CRCs with empty data
+		for (uint16_t i = chunk->blocks(); i < firstBlock; i++) {
+			memcpy(crcData + i * kCrcSize, &gEmptyBlockCrc, kCrcSize);
+		}
+		chunk->setBlocks(lastBlock + 1);
+	}
+
+	const off_t offset = chunk->getBlockOffset(firstBlock);
+	const ssize_t expected = static_cast<ssize_t>(count) * SFSBLOCKSIZE;
+	{
+		DiskWriteStatsUpdater updater(chunk->owner(), expected);
+
+		ssize_t written = 0;
+		// pwritev may write less than requested, e.g. on a signal
+		while (written < expected) {
+			uint32_t done = written / SFSBLOCKSIZE;
+			ssize_t ret;
+			if (gUseDirectIO) {
+				// The network buffers are not aligned for O_DIRECT
+				ret = directPwrite(
+				    chunk->dataFD(), writes[done].buffer + written % SFSBLOCKSIZE,
+				    SFSBLOCKSIZE - written % SFSBLOCKSIZE, offset + written);
+			} else {
+				iov[done].iov_base = const_cast<uint8_t *>(writes[done].buffer) +
+				                     written % SFSBLOCKSIZE;
+				iov[done].iov_len = SFSBLOCKSIZE - written % SFSBLOCKSIZE;
+				ret = pwritev(chunk->dataFD(), iov.data() + done,
+				              std::min<uint32_t>(count - done, IOV_MAX),
+				              offset + written);
+			}
+			if (ret <= 0) {
+				hddAddErrorAndPreserveErrno(chunk);
+				safs_silent_errlog(LOG_WARNING,
+				                   "writeChunkBlocks: file:%s - write error",
+				                   chunk->metaFilename().c_str());
+				hddReportDamagedChunk(chunk->id(), chunk->type());
+				updater.markWriteAsFailed();
+				return SAUNAFS_ERROR_IO;
+			}
+			written += ret;
+		}
+	}
+
+	for (uint32_t i = 0; i < count; ++i) {
+		punchHoles(chunk, writes[i].buffer,
+		           chunk->getBlockOffset(writes[i].blocknum), SFSBLOCKSIZE);
+		uint8_t *crcPointer = crcData + writes[i].blocknum * kCrcSize;
+		put32bit(&crcPointer, writes[i].crc);
+	}
+
+	return SAUNAFS_STATUS_OK;
+}
+
 int CmrDisk::writeChunkData(IChunk *chunk, uint8_t *blockBuffer,
                             int32_t blockSize, off64_t offset) {
 	(void)offset;  // Not needed for conventional disks
 
+	if (gUseDirectIO) {
+		off_t position = ::lseek(chunk->dataFD(), 0, SEEK_CUR);
+		if (position < 0) {
+			return -1;
+		}
+		ssize_t ret =
+		    directPwrite(chunk->dataFD(), blockBuffer, blockSize, position);
+		if (ret > 0) {
+			::lseek(chunk->dataFD(), position + ret, SEEK_SET);
+		}
+		return ret;
+	}
+
 	return ::write(chunk->dataFD(), blockBuffer, blockSize);
 }
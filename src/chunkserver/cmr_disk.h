@@ -2,8 +2,14 @@
 
 #include "common/platform.h"
 
+#include <atomic>
+
 #include "chunkserver-common/disk_with_fd.h"
 
+/// Tells if the data files of conventional disks are opened with O_DIRECT,
+/// so that chunk data bypasses the page cache (HDD_DIRECT_IO)
+inline std::atomic<bool> gUseDirectIO{false};
+
 class CmrDisk : public FDDisk {
 public:
 	/// Constructs a Disk with previous information from hdd.cfg and assigns
@@ -126,6 +132,12 @@ public:
 	                    uint32_t offsetInBlock, uint32_t size, uint32_t crc,
 	                    uint8_t *crcData, const uint8_t *buffer) override;
 
+	/// Writes a run of complete, consecutive Chunk blocks with a single
+	/// pwritev and updates their CRCs in crcData.
+	int writeChunkBlocks(IChunk *chunk, uint32_t version,
+	                     const ChunkBlockWrite *writes, uint32_t count,
+	                     uint8_t *crcData) override;
+
 	/// Writes to device custom blockSize from blockBuffer
 	int writeChunkData(IChunk *chunk, uint8_t *blockBuffer, int32_t blockSize,
 	                   off64_t offset) override;
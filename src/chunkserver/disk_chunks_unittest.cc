@@ -153,3 +153,34 @@ TEST_F(DiskChunksTest, CornerCases) {
 	ASSERT_EQ(nullptr, diskChunks.chunkToTest());
 	ASSERT_EQ(nullptr, diskChunks.getRandomChunk());
 }
+
+TEST_F(DiskChunksTest, NewLoopStartsWithChunksTestedLongestAgo) {
+	static const size_t kCount = 10;
+	DiskChunks diskChunks;
+	for (size_t index = 0; index < kCount; ++index) {
+		diskChunks.insert(chunks_[index]);
+	}
+
+	// Chunk 7 was never tested, the others were tested in reverse order
+	for (size_t index = 0; index < kCount; ++index) {
+		chunks_[index]->setLastTestTime(index == 7 ? 0 : 1000 - index);
+	}
+	diskChunks.sortByLastTestTime();
+
+	std::vector<uint64_t> testingSequence;
+	for (size_t i = 0; i < kCount; ++i) {
+		IChunk* chunk = diskChunks.chunkToTest();
+		ASSERT_EQ(i, diskChunks.testedCount());
+		diskChunks.markAsTested(chunk);
+		testingSequence.push_back(chunk->id());
+	}
+	EXPECT_EQ((std::vector<uint64_t>{7, 9, 8, 6, 5, 4, 3, 2, 1, 0}),
+	          testingSequence);
+	EXPECT_EQ(kCount, diskChunks.testedCount());
+
+	// Chunks tested in this loop go to the end of the next one
+	chunks_[9]->setLastTestTime(2000);
+	chunks_[7]->setLastTestTime(2001);
+	ASSERT_EQ(chunks_[8], diskChunks.chunkToTest());
+	EXPECT_EQ(0U, diskChunks.testedCount());
+}
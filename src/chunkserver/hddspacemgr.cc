@@ -61,6 +61,7 @@
 #include <mutex>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "chunkserver-common/chunk_interface.h"
@@ -69,11 +70,14 @@
 #include "chunkserver-common/hdd_stats.h"
 #include "chunkserver-common/hdd_utils.h"
 #include "chunkserver-common/subfolder.h"
+#include "chunkserver/block_cache.h"
 #include "chunkserver/chartsdata.h"
 #include "chunkserver/chunk_filename_parser.h"
+#include "chunkserver/chunk_tiering.h"
 #include "chunkserver/cmr_disk.h"
 #include "chunkserver/iostat.h"
 #include "chunkserver/plugin_manager.h"
+#include "chunkserver/scrub_controller.h"
 #include "common/cfg.h"
 #include "common/chunk_version_with_todel_flag.h"
 #include "common/crc.h"
@@ -97,6 +101,35 @@ constexpr int kLastErrorTime = 60;
 
 static std::atomic<unsigned> gHDDTestFreq_ms(10 * 1000);
 
+/// Value of HDD_TEST_SPEED from config, in bytes per second per disk. Each
+/// Disk is then tested by its own thread (see hddDiskTesterThread).
+/// When 0, one chunk is tested every gHDDTestFreq_ms instead.
+static std::atomic<double> gHDDTestSpeed(0.);
+
+/// Name of the file in the metadata directory of each disk, which keeps the
+/// timestamps of the last successful tests of its chunks between restarts
+static constexpr const char *kTestTimesFilename = ".chunk_test_times";
+static constexpr const char *kTestTimesHeader = "SFSCTT10";
+static constexpr uint32_t kTestTimesRecordSize = 8 + 2 + 4;
+static constexpr uint32_t kTestProgressReportPeriod_s = SECONDS_IN_ONE_HOUR;
+
+/// Value of HDD_TIERING_PERIOD from config, in seconds (0 disables tiering)
+static std::atomic<uint32_t> gHDDTieringPeriod_s(300);
+/// Value of HDD_FAST_TIER_MAX_USAGE from config, as a fraction
+static std::atomic<double> gHDDFastTierMaxUsage(0.9);
+/// Value of HDD_TIERING_MAX_MOVES from config, moves per tiering round
+static std::atomic<uint32_t> gHDDTieringMaxMoves(16);
+/// Colder chunks are not worth promoting: about a whole chunk read recently
+static constexpr double kTieringMinPromoteHeat = SFSBLOCKSINCHUNK;
+/// Suffix of the files being copied to another Disk by the tiering thread
+static constexpr const char *kTieringCopySuffix = ".tiering";
+static constexpr size_t kTieringCopyBufferSize = 1024 * 1024;
+
+/// Id of the chunk being copied by the tiering thread (0 if none) and whether
+/// it was written meanwhile, in which case the copy is thrown away
+static std::atomic<uint64_t> gTieringMovedChunkId(0);
+static std::atomic<bool> gTieringMovedChunkWritten(false);
+
 inline std::atomic_bool gCheckCrcWhenReading{true};
 
 /// Value of HDD_ADVISE_NO_CACHE from config
@@ -590,6 +623,11 @@ int hddGetLoadFactor() {
 	return gIoStat.getLoadFactor();
 }
 
+void hddGetDiskLoad(uint32_t *queueDepth, uint32_t *latencyUs) {
+	*queueDepth = gIoStat.getQueueDepth();
+	*latencyUs = gIoStat.getLatencyUs();
+}
+
 static inline int chunkWriteCrc(IChunk *chunk) {
 	TRACETHIS();
 	assert(chunk);
@@ -829,6 +867,14 @@ int hddReadCrcAndBlock(IChunk *chunk, uint16_t blockNumber,
 		    gOpenChunks.getResource(chunk->metaFD()).crcData() +
 		    blockNumber * kCrcSize;
 		outputBuffer->copyIntoBuffer(crcData, kCrcSize);
+
+		if (gBlockCache.get(chunkToKey(*chunk), blockNumber,
+		                    [outputBuffer](const uint8_t *data) {
+			                    outputBuffer->copyIntoBuffer(data, SFSBLOCKSIZE);
+		                    })) {
+			return SAUNAFS_STATUS_OK;
+		}
+
 		bytesRead = outputBuffer->copyIntoBuffer(chunk, SFSBLOCKSIZE, off);
 
 		if (bytesRead != toBeRead) {
@@ -840,6 +886,12 @@ int hddReadCrcAndBlock(IChunk *chunk, uint16_t blockNumber,
 			hddReportDamagedChunk(chunk->id(), chunk->type());
 			return SAUNAFS_ERROR_IO;
 		}
+
+		// a damaged block must not be served from the cache, which would
+		// hide that it was fixed on disk or that the read error was transient
+		gBlockCache.putVerified(chunkToKey(*chunk), blockNumber,
+		                        outputBuffer->lastBytes(SFSBLOCKSIZE),
+		                        get32bit(&crcData));
 	}
 
 	return SAUNAFS_STATUS_OK;
@@ -995,18 +1047,17 @@ int hddRead(uint64_t chunkId, uint32_t version, ChunkPartType chunkType,
 			status = hddCheckCrcForFullBlock(chunk, block, &tmp, true);
 
 			if (status == SAUNAFS_STATUS_OK) {  // CRC is OK or check disabled
-				uint8_t crcBuff[kCrcSize];
-				uint8_t *crcBuffPointer = crcBuff;
-				put32bit(&crcBuffPointer,
-				         mycrc32(0, tmp.data() + kCrcSize + offsetWithinBlock,
-				                 size));
-				outputBuffer->copyIntoBuffer(crcBuff, kCrcSize);
-				outputBuffer->copyIntoBuffer(
+				outputBuffer->copyIntoBufferWithCrc(
 				    tmp.data() + kCrcSize + offsetWithinBlock, size);
 			}
 		}
 	}
 
+	if (status == SAUNAFS_STATUS_OK) {
+		chunk->heat().touch(eventloop_time());
+		HddStats::tierRead(chunk->owner());
+	}
+
 	PRINTTHIS(status);
 	hddChunkRelease(chunk);
 	return status;
@@ -1024,19 +1075,54 @@ void hddRecomputeCrcIfBlockEmpty(uint8_t *block, uint8_t *crcBuffer) {
 	put32bit(&tmpPtr2, crc);
 }
 
-int hddChunkWriteBlock(uint64_t chunkId, uint32_t version,
-                       ChunkPartType chunkType, uint16_t blocknum,
-                       uint32_t offset, uint32_t size, uint32_t crc,
-                       const uint8_t *buffer) {
+int hddChunkWriteBlocks(uint64_t chunkId, uint32_t version,
+                        ChunkPartType chunkType, const ChunkBlockWrite *writes,
+                        uint32_t count) {
 	auto *chunk = hddChunkFindAndLock(chunkId, chunkType);
 
 	if (chunk == ChunkNotFound) {
 		return SAUNAFS_ERROR_NOCHUNK;
 	}
 
+	auto isFullBlock = [](const ChunkBlockWrite &write) {
+		return write.offsetInBlock == 0 && write.size == SFSBLOCKSIZE;
+	};
+
+	if (chunkId == gTieringMovedChunkId) {
+		gTieringMovedChunkWritten = true;
+	}
+	chunk->heat().touch(eventloop_time(), count);
+
 	auto *crcData = gOpenChunks.getResource(chunk->metaFD()).crcData();
-	int status = chunk->owner()->writeChunkBlock(
-	    chunk, version, blocknum, offset, size, crc, crcData, buffer);
+	int status = SAUNAFS_STATUS_OK;
+	uint32_t first = 0;
+
+	for (uint32_t i = 0; i < count; ++i) {
+		gBlockCache.erase(chunkToKey(*chunk), writes[i].blocknum);
+	}
+
+	while (first < count && status == SAUNAFS_STATUS_OK) {
+		uint32_t runLength = 1;
+		if (isFullBlock(writes[first])) {
+			while (first + runLength < count &&
+			       isFullBlock(writes[first + runLength]) &&
+			       writes[first + runLength].blocknum ==
+			           writes[first].blocknum + runLength) {
+				++runLength;
+			}
+		}
+
+		if (runLength > 1) {
+			status = chunk->owner()->writeChunkBlocks(
+			    chunk, version, writes + first, runLength, crcData);
+		} else {
+			const auto &write = writes[first];
+			status = chunk->owner()->writeChunkBlock(
+			    chunk, version, write.blocknum, write.offsetInBlock, write.size,
+			    write.crc, crcData, write.buffer);
+		}
+		first += runLength;
+	}
 	hddChunkRelease(chunk);
 
 	return status;
@@ -1070,6 +1156,8 @@ void hddDeleteChunkFromRegistry(IChunk *chunk) {
 	TRACETHIS();
 	assert(chunk);
 
+	gBlockCache.eraseChunk(chunkToKey(*chunk));
+
 	const std::lock_guard chunksMapLockGuard(gChunksMapMutex);
 
 	if (chunk->condVar()) {
@@ -1107,6 +1195,8 @@ IChunk *hddRecreateChunk(IDisk *disk, IChunk *chunk, uint64_t chunkId,
 
 	chunk = disk->instantiateNewConcreteChunk(chunkId, type);
 	passert(chunk);
+	// Blocks of a previous chunk with the same id must not be served
+	gBlockCache.eraseChunk(makeChunkKey(chunkId, type));
 
 	bool success = gChunksMap
 	                   .insert({makeChunkKey(chunkId, type),
@@ -1386,6 +1476,10 @@ static int hddInternalTestChunk(uint64_t chunkId, uint32_t version,
 		hddChunkRelease(chunk);
 		return status;
 	}
+	{
+		std::lock_guard testsLockGuard(gTestsMutex);
+		chunk->setLastTestTime(time(nullptr));
+	}
 	hddChunkRelease(chunk);
 	return SAUNAFS_STATUS_OK;
 }
@@ -1706,6 +1800,8 @@ static int hddInternalTruncate(uint64_t chunkId, ChunkPartType chunkType,
 	uint8_t *blockBuffer = getChunkBlockBuffer() + kCrcSize;
 	auto originalBlocks = chunk->blocks();
 
+	gBlockCache.eraseChunk(chunkToKey(*chunk));
+
 	if (chunk->renameChunkFile(newVersion) < 0) {
 		hddAddErrorAndPreserveErrno(chunk);
 		safs_silent_errlog(LOG_WARNING,
@@ -2504,6 +2600,328 @@ static int hddDefragmentChunk(uint64_t chunkId, ChunkPartType chunkType) {
 	return SAUNAFS_STATUS_OK;
 }
 
+/// Tells if the chunks of the Disk may be moved between the tiers
+static bool hddDiskIsTierable(const IDisk *disk) {
+	return disk != DiskNotFound && !disk->isZonedDevice() &&
+	       !disk->isDamaged() && !disk->isMarkedForDeletion() &&
+	       disk->totalSpace() > 0 &&
+	       disk->scanState() == IDisk::ScanState::kWorking;
+}
+
+/// Chooses the Disk of the given tier with most free space for a chunk of the
+/// given size, taking into account the space reserved for previous moves of
+/// the same round. Must be called with gDisksMutex locked.
+static IDisk *hddGetDiskForTieredChunk(
+    bool fastTier, uint64_t bytes,
+    std::unordered_map<const IDisk *, uint64_t> &reservedSpace) {
+	IDisk *bestDisk = DiskNotFound;
+	uint64_t maxAvailable = 0;
+
+	for (const auto &disk : gDisks) {
+		if (disk->isFastTier() != fastTier || !hddDiskIsTierable(disk.get()) ||
+		    !disk->isSelectableForNewChunk()) {
+			continue;
+		}
+
+		uint64_t reserved = reservedSpace[disk.get()];
+		if (disk->availableSpace() < reserved + bytes) {
+			continue;
+		}
+
+		if (disk->availableSpace() - reserved > maxAvailable) {
+			maxAvailable = disk->availableSpace() - reserved;
+			bestDisk = disk.get();
+		}
+	}
+
+	if (bestDisk != DiskNotFound) {
+		reservedSpace[bestDisk] += bytes;
+	}
+
+	return bestDisk;
+}
+
+/// Copies a chunk file and makes the copy durable
+static int hddCopyChunkFile(const std::string &from, const std::string &to) {
+	int fromFD = ::open(from.c_str(), O_RDONLY);
+	if (fromFD < 0) {
+		return SAUNAFS_ERROR_IO;
+	}
+
+	int toFD = ::open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+	                  disk::kDefaultOpenMode);
+	if (toFD < 0) {
+		int errmem = errno;
+		::close(fromFD);
+		errno = errmem;
+		return SAUNAFS_ERROR_IO;
+	}
+
+	std::vector<uint8_t> buffer(kTieringCopyBufferSize);
+	int status = SAUNAFS_STATUS_OK;
+
+	while (status == SAUNAFS_STATUS_OK) {
+		ssize_t bytesRead = ::read(fromFD, buffer.data(), buffer.size());
+		if (bytesRead <= 0) {
+			status = bytesRead == 0 ? SAUNAFS_STATUS_OK : SAUNAFS_ERROR_IO;
+			break;
+		}
+		if (::write(toFD, buffer.data(), bytesRead) != bytesRead) {
+			status = SAUNAFS_ERROR_IO;
+		}
+	}
+
+	if (status == SAUNAFS_STATUS_OK && ::fsync(toFD) < 0) {
+		status = SAUNAFS_ERROR_IO;
+	}
+
+	int errmem = errno;
+	::close(fromFD);
+	::close(toFD);
+	errno = errmem;
+
+	return status;
+}
+
+/// Moves the files of an idle chunk to a Disk of the other tier.
+///
+/// The files are copied without holding the chunk lock, so that the chunk can
+/// still be read meanwhile. The copy is only used if the chunk was neither
+/// written nor changed its version during the copy. The chunk object is kept,
+/// only its owner and filenames change, so the master is not involved.
+static int hddMoveChunk(const ChunkWithType &chunkWithType, IDisk *target) {
+	auto *chunk = hddChunkFindAndLock(chunkWithType.id, chunkWithType.type);
+
+	if (chunk == ChunkNotFound) {
+		return SAUNAFS_ERROR_NOCHUNK;
+	}
+
+	if (chunk->refCount() > 0 || chunk->owner() == target ||
+	    !hddDiskIsTierable(chunk->owner())) {
+		hddChunkRelease(chunk);
+		return SAUNAFS_ERROR_CHUNKBUSY;
+	}
+
+	const IDisk *source = chunk->owner();
+	const uint32_t version = chunk->version();
+	const std::string metaFilename = chunk->metaFilename();
+	const std::string dataFilename = chunk->dataFilename();
+
+	std::unique_ptr<IChunk> movedChunk(target->instantiateNewConcreteChunk(
+	    chunkWithType.id, chunkWithType.type));
+	movedChunk->updateFilenamesFromVersion(version);
+	const std::string newMetaFilename = movedChunk->metaFilename();
+	const std::string newDataFilename = movedChunk->dataFilename();
+	const std::string tmpMetaFilename = newMetaFilename + kTieringCopySuffix;
+	const std::string tmpDataFilename = newDataFilename + kTieringCopySuffix;
+
+	gTieringMovedChunkWritten = false;
+	gTieringMovedChunkId = chunkWithType.id;
+	hddChunkRelease(chunk);
+
+	int status = hddCopyChunkFile(dataFilename, tmpDataFilename);
+	if (status == SAUNAFS_STATUS_OK) {
+		status = hddCopyChunkFile(metaFilename, tmpMetaFilename);
+	}
+
+	chunk = hddChunkFindAndLock(chunkWithType.id, chunkWithType.type);
+	gTieringMovedChunkId = 0;
+
+	if (status == SAUNAFS_STATUS_OK &&
+	    (chunk == ChunkNotFound || chunk->owner() != source ||
+	     chunk->version() != version || chunk->refCount() > 0 ||
+	     gTieringMovedChunkWritten)) {
+		status = SAUNAFS_ERROR_CHUNKBUSY;
+	}
+
+	// Only the files renamed here may be removed on failure, the names on the
+	// target could belong to another copy of the chunk
+	bool dataRenamed = false;
+	bool metaRenamed = false;
+	if (status == SAUNAFS_STATUS_OK) {
+		dataRenamed =
+		    ::rename(tmpDataFilename.c_str(), newDataFilename.c_str()) == 0;
+		metaRenamed =
+		    dataRenamed &&
+		    ::rename(tmpMetaFilename.c_str(), newMetaFilename.c_str()) == 0;
+		if (!metaRenamed) {
+			status = SAUNAFS_ERROR_IO;
+		}
+	}
+
+	if (status == SAUNAFS_STATUS_OK) {
+		std::scoped_lock lock(gDisksMutex, gChunksMapMutex, gTestsMutex);
+
+		bool targetExists =
+		    std::any_of(gDisks.begin(), gDisks.end(), [target](auto &disk) {
+			    return disk.get() == target;
+		    });
+
+		// The source Disk may be removed from the config meanwhile
+		if (targetExists && !target->wasRemovedFromConfig() &&
+		    chunk->state() == ChunkState::Locked) {
+			// Cached descriptors still point to the old files
+			gOpenChunks.purge(chunk->metaFD());
+			chunk->setMetaFD(-1);
+			chunk->setDataFD(-1);
+
+			chunk->owner()->chunks().remove(chunk);
+			chunk->owner()->setNeedRefresh(true);
+			chunk->setOwner(target);
+			chunk->updateFilenamesFromVersion(version);
+			target->chunks().insert(chunk);
+			target->setNeedRefresh(true);
+		} else {
+			status = SAUNAFS_ERROR_NOTDONE;
+		}
+	}
+
+	if (status == SAUNAFS_STATUS_OK) {
+		::unlink(metaFilename.c_str());
+		::unlink(dataFilename.c_str());
+	} else {
+		::unlink(tmpMetaFilename.c_str());
+		::unlink(tmpDataFilename.c_str());
+		if (metaRenamed) {
+			::unlink(newMetaFilename.c_str());
+		}
+		if (dataRenamed) {
+			::unlink(newDataFilename.c_str());
+		}
+	}
+
+	if (chunk != ChunkNotFound) {
+		hddChunkRelease(chunk);
+	}
+
+	return status;
+}
+
+/// Moves the hottest chunks to the fast tier and the coldest ones out of it
+static void hddTieringRound() {
+	TRACETHIS();
+	std::vector<ChunkTiering::Candidate> fastChunks;
+	std::vector<ChunkTiering::Candidate> slowChunks;
+	uint64_t fastUsedBytes = 0;
+	uint64_t fastTotalBytes = 0;
+	bool hasSlowDisks = false;
+	uint32_t now = eventloop_time();
+
+	{
+		std::scoped_lock lock(gDisksMutex, gChunksMapMutex);
+
+		for (const auto &disk : gDisks) {
+			if (!hddDiskIsTierable(disk.get())) {
+				continue;
+			}
+			if (disk->isFastTier()) {
+				fastTotalBytes += disk->totalSpace();
+				fastUsedBytes += disk->totalSpace() - disk->availableSpace();
+			} else {
+				hasSlowDisks = true;
+			}
+		}
+
+		if (fastTotalBytes == 0 || !hasSlowDisks) {
+			return;
+		}
+
+		for (const auto &chunkEntry : gChunksMap) {
+			const IChunk *chunk = chunkEntry.second.get();
+			if (chunk->state() != ChunkState::Available ||
+			    !hddDiskIsTierable(chunk->owner())) {
+				continue;
+			}
+
+			ChunkTiering::Candidate candidate{
+			    chunkEntry.first,
+			    static_cast<uint64_t>(
+			        chunk->getFileSizeFromBlockCount(chunk->blocks())) +
+			        chunk->getHeaderSize(),
+			    chunk->heat().value(now)};
+
+			if (chunk->owner()->isFastTier()) {
+				fastChunks.push_back(candidate);
+			} else if (candidate.heat >= kTieringMinPromoteHeat) {
+				slowChunks.push_back(candidate);
+			}
+		}
+	}
+
+	ChunkTiering tiering(gHDDFastTierMaxUsage, kTieringMinPromoteHeat,
+	                     gHDDTieringMaxMoves);
+	std::unordered_map<ChunkWithType, uint64_t, KeyOperations, KeyOperations>
+	    chunkBytes;
+	for (const auto &candidate : fastChunks) {
+		chunkBytes[candidate.chunk] = candidate.bytes;
+	}
+	for (const auto &candidate : slowChunks) {
+		chunkBytes[candidate.chunk] = candidate.bytes;
+	}
+
+	auto moves = tiering.plan(std::move(fastChunks), std::move(slowChunks),
+	                          fastUsedBytes, fastTotalBytes);
+	std::unordered_map<const IDisk *, uint64_t> reservedSpace;
+	uint32_t promoted = 0;
+	uint32_t demoted = 0;
+
+	for (const auto &move : moves) {
+		if (gTerminate) {
+			break;
+		}
+
+		IDisk *target;
+		{
+			std::lock_guard disksLockGuard(gDisksMutex);
+			target = hddGetDiskForTieredChunk(
+			    move.toFastTier, chunkBytes[move.chunk], reservedSpace);
+		}
+
+		if (target == DiskNotFound) {
+			continue;
+		}
+
+		int status = hddMoveChunk(move.chunk, target);
+		if (status == SAUNAFS_STATUS_OK) {
+			HddStats::tierMove(move.toFastTier);
+			++(move.toFastTier ? promoted : demoted);
+		} else if (status == SAUNAFS_ERROR_IO) {
+			safs_silent_errlog(LOG_WARNING,
+			                   "hdd tiering: can't move chunk %016" PRIX64
+			                   " to %s",
+			                   move.chunk.id, target->getPaths().c_str());
+		}
+	}
+
+	// tier reads and moves are published as charts (see chartsdata.cc)
+	if (promoted > 0 || demoted > 0) {
+		safs_pretty_syslog(LOG_INFO,
+		                   "hdd tiering: %" PRIu32 " chunks promoted, %" PRIu32
+		                   " demoted, fast tier usage before the round %" PRIu64
+		                   "%%",
+		                   promoted, demoted,
+		                   fastUsedBytes * 100 / fastTotalBytes);
+	}
+}
+
+static void hddTieringThread() {
+	TRACETHIS();
+	uint32_t secondsSinceLastRound = 0;
+
+	while (!gTerminate) {
+		sleep(1);
+
+		uint32_t period = gHDDTieringPeriod_s;
+		if (period == 0 || ++secondsSinceLastRound < period ||
+		    hddScansInProgress()) {
+			continue;
+		}
+
+		secondsSinceLastRound = 0;
+		hddTieringRound();
+	}
+}
+
 static UniqueQueue<ChunkWithVersionAndType> gTestChunkQueue;
 
 static void hddTestChunkThread() {
@@ -2540,6 +2958,257 @@ void hddAddChunkToTestQueue(ChunkWithVersionAndType chunk) {
 	gTestChunkQueue.put(chunk);
 }
 
+/// Tells if the chunks of the Disk can be tested now
+static bool hddDiskIsTestable(const IDisk *disk) {
+	return !disk->isDamaged() && !disk->isMarkedForDeletion() &&
+	       !disk->wasRemovedFromConfig() &&
+	       disk->scanState() == IDisk::ScanState::kWorking;
+}
+
+/// Reads the last test times of the chunks of the Disk saved by
+/// hddSaveTestTimes. Chunks not found in the file are considered never tested.
+static void hddLoadTestTimes(IDisk *disk) {
+	std::string filename = disk->metaPath() + kTestTimesFilename;
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) {
+		return;
+	}
+
+	std::string header(strlen(kTestTimesHeader), '\0');
+	if (!file.read(header.data(), header.size()) || header != kTestTimesHeader) {
+		safs_pretty_syslog(LOG_WARNING, "%s: unknown file format, ignoring",
+		                   filename.c_str());
+		return;
+	}
+
+	std::scoped_lock lock(gChunksMapMutex, gTestsMutex);
+	std::array<uint8_t, kTestTimesRecordSize> record;
+	while (file.read(reinterpret_cast<char *>(record.data()), record.size())) {
+		const uint8_t *ptr = record.data();
+		uint64_t chunkId = get64bit(&ptr);
+		uint16_t chunkTypeId = get16bit(&ptr);
+		uint32_t lastTestTime = get32bit(&ptr);
+
+		auto it = gChunksMap.find(
+		    makeChunkKey(chunkId, ChunkPartType(chunkTypeId)));
+		if (it != gChunksMap.end() && it->second->owner() == disk) {
+			it->second->setLastTestTime(lastTestTime);
+		}
+	}
+}
+
+/// Saves the last test times of the chunks of all Disks, to prioritize the
+/// chunks not tested for the longest time after a restart
+static void hddSaveTestTimes() {
+	TRACETHIS();
+	std::unordered_map<IDisk *, std::vector<uint8_t>> records;
+
+	{
+		std::scoped_lock lock(gDisksMutex, gChunksMapMutex, gTestsMutex);
+		for (const auto &disk : gDisks) {
+			if (hddDiskIsTestable(disk.get())) {
+				records[disk.get()].reserve(disk->chunks().size() *
+				                            kTestTimesRecordSize);
+			}
+		}
+		for (const auto &[key, chunk] : gChunksMap) {
+			auto it = records.find(chunk->owner());
+			if (it == records.end() || chunk->lastTestTime() == 0) {
+				continue;
+			}
+			auto &buffer = it->second;
+			buffer.resize(buffer.size() + kTestTimesRecordSize);
+			uint8_t *ptr = buffer.data() + buffer.size() - kTestTimesRecordSize;
+			put64bit(&ptr, chunk->id());
+			put16bit(&ptr, chunk->type().getId());
+			put32bit(&ptr, chunk->lastTestTime());
+		}
+	}
+
+	for (const auto &[disk, buffer] : records) {
+		std::string filename = disk->metaPath() + kTestTimesFilename;
+		std::string tmpFilename = filename + ".tmp";
+		std::ofstream file(tmpFilename, std::ios::binary | std::ios::trunc);
+		file.write(kTestTimesHeader, strlen(kTestTimesHeader));
+		file.write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+		file.close();
+		if (!file || rename(tmpFilename.c_str(), filename.c_str()) < 0) {
+			safs_silent_errlog(LOG_WARNING, "%s: can't save chunk test times",
+			                   filename.c_str());
+			unlink(tmpFilename.c_str());
+		}
+	}
+}
+
+/// Pacing of chunk tests for each Disk when HDD_TEST_SPEED is set.
+/// Each entry is used by the tester thread of its Disk, under gTestsMutex.
+static std::unordered_map<const IDisk *, ScrubController> gScrubControllers;
+
+/// Tester thread of a single Disk, used when HDD_TEST_SPEED is set
+struct DiskTester {
+	std::thread thread;
+	std::atomic<bool> finished{false};
+};
+
+/// Tester threads of the Disks. Used only by the main tester thread.
+static std::unordered_map<const IDisk *, std::unique_ptr<DiskTester>>
+    gDiskTesters;
+
+/// Tests the next chunk of the Disk if its test budget allows it, or sleeps
+/// until it does. Returns false when the Disk should not be tested anymore.
+static bool hddTestDiskChunkWithinBudget(const IDisk *disk) {
+	uint64_t nowUs = getMicroSecsTime();
+	uint64_t sleepUs = 1000000;
+	ScrubController *controller = nullptr;
+	uint64_t chunkId = 0;
+	uint32_t version = 0;
+	ChunkPartType chunkType = slice_traits::standard::ChunkPartType();
+	uint64_t chunkBytes = 0;
+	bool isZonedDevice = false;
+
+	{
+		std::scoped_lock lock(gDisksMutex, gChunksMapMutex, gTestsMutex);
+
+		// The Disk may be gone after a reload, so it is only used if found
+		auto diskIt = std::find_if(
+		    gDisks.begin(), gDisks.end(),
+		    [disk](const auto &entry) { return entry.get() == disk; });
+		if (diskIt == gDisks.end() || !hddDiskIsTestable(disk) ||
+		    gHDDTestSpeed <= 0) {
+			return false;
+		}
+
+		controller = &gScrubControllers.try_emplace(disk, gHDDTestSpeed.load())
+		                  .first->second;
+		controller->setMaxRate(gHDDTestSpeed);
+		uint64_t delayUs = controller->delayUs(nowUs);
+		if (delayUs > 0) {
+			sleepUs = std::min(sleepUs, delayUs);
+		} else if (gDiskActions > 0) {
+			IChunk *chunk = (*diskIt)->chunks().chunkToTest();
+			if (chunk && chunk->state() == ChunkState::Available) {
+				chunkId = chunk->id();
+				version = chunk->version();
+				chunkType = chunk->type();
+				chunkBytes = static_cast<uint64_t>(chunk->blocks()) *
+				                 SFSBLOCKSIZE + chunk->getHeaderSize();
+				isZonedDevice = disk->isZonedDevice();
+			}
+		}
+	}
+
+	if (chunkId == 0) {
+		usleep(sleepUs);
+		return true;
+	}
+
+	uint64_t startUs = getMicroSecsTime();
+	if (hddInternalTestChunk(chunkId, version, chunkType) !=
+	    SAUNAFS_STATUS_OK) {
+		hddReportDamagedChunk(chunkId, chunkType);
+	} else if (isZonedDevice) {
+		if (hddDefragmentChunk(chunkId, chunkType) != SAUNAFS_STATUS_OK) {
+			hddReportDamagedChunk(chunkId, chunkType);
+		}
+	}
+	uint64_t endUs = getMicroSecsTime();
+
+	std::lock_guard testsLockGuard(gTestsMutex);
+	controller->testDone(chunkBytes, endUs > startUs ? endUs - startUs : 0,
+	                     endUs);
+	return true;
+}
+
+/// Tests the chunks of a single Disk within its budget, so that every Disk
+/// is tested at HDD_TEST_SPEED regardless of the number of Disks.
+static void hddDiskTesterThread(const IDisk *disk, DiskTester *tester) {
+	while (!gTerminate && hddTestDiskChunkWithinBudget(disk)) {
+	}
+
+	{
+		std::lock_guard testsLockGuard(gTestsMutex);
+		gScrubControllers.erase(disk);
+	}
+	tester->finished = true;
+}
+
+/// Joins the tester threads of Disks which should not be tested anymore and,
+/// when HDD_TEST_SPEED is set, starts them for Disks which have none.
+static void hddUpdateDiskTesters() {
+	for (auto it = gDiskTesters.begin(); it != gDiskTesters.end();) {
+		if (it->second->finished) {
+			it->second->thread.join();
+			it = gDiskTesters.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	if (gHDDTestSpeed <= 0 || gTerminate) {
+		return;
+	}
+
+	std::lock_guard disksLockGuard(gDisksMutex);
+	for (const auto &disk : gDisks) {
+		if (!hddDiskIsTestable(disk.get()) ||
+		    gDiskTesters.find(disk.get()) != gDiskTesters.end()) {
+			continue;
+		}
+		auto tester = std::make_unique<DiskTester>();
+		tester->thread =
+		    std::thread(hddDiskTesterThread, disk.get(), tester.get());
+		gDiskTesters.emplace(disk.get(), std::move(tester));
+	}
+}
+
+/// Logs the test progress of each Disk and saves the chunk test times,
+/// once every kTestProgressReportPeriod_s.
+static void hddReportTestProgress() {
+	static uint32_t lastReportTime = time(nullptr);
+
+	uint32_t now = time(nullptr);
+	if (now - lastReportTime < kTestProgressReportPeriod_s) {
+		return;
+	}
+	lastReportTime = now;
+
+	{
+		std::scoped_lock lock(gDisksMutex, gTestsMutex);
+		uint32_t testableDisks = 0;
+		for (const auto &disk : gDisks) {
+			testableDisks += hddDiskIsTestable(disk.get()) ? 1 : 0;
+		}
+
+		for (const auto &disk : gDisks) {
+			if (!hddDiskIsTestable(disk.get())) {
+				continue;
+			}
+			size_t total = disk->chunks().size();
+			size_t tested = std::min(disk->chunks().testedCount(), total);
+			uint64_t eta_s;
+			double rate = 0.;
+			auto it = gScrubControllers.find(disk.get());
+			if (gHDDTestSpeed > 0 && it != gScrubControllers.end()) {
+				eta_s = it->second.etaSeconds(total - tested);
+				rate = it->second.rate();
+			} else {
+				// Disks take turns, one chunk every HDD_TEST_FREQ
+				eta_s = static_cast<uint64_t>(total - tested) * testableDisks *
+				        gHDDTestFreq_ms / 1000;
+			}
+			safs_pretty_syslog(
+			    LOG_INFO,
+			    "hdd tester: %s: tested %zu of %zu chunks (%.1f%%), "
+			    "rate limit %.1f MiB/s, ETA %" PRIu64 "h%02" PRIu64 "m",
+			    disk->getPaths().c_str(), tested, total,
+			    total > 0 ? 100. * tested / total : 100., rate / (1024 * 1024),
+			    eta_s / 3600, (eta_s % 3600) / 60);
+		}
+	}
+
+	hddSaveTestTimes();
+}
+
 void hddTesterThread() {
 	TRACETHIS();
 	IChunk *chunk;
@@ -2553,6 +3222,14 @@ void hddTesterThread() {
 	auto previousDiskIt = disksIt;
 
 	while (!gTerminate) {
+		hddReportTestProgress();
+		hddUpdateDiskTesters();
+
+		if (gHDDTestSpeed > 0) {
+			sleep(1);
+			continue;
+		}
+
 		startMicroSecs = getMicroSecsTime();
 		chunkId = 0;
 		version = 0;
@@ -2636,15 +3313,27 @@ void hddTesterThread() {
 			}
 		}
 	}
+
+	// gTerminate is set, so the Disk tester threads are finishing
+	for (auto &[disk, tester] : gDiskTesters) {
+		tester->thread.join();
+	}
+	gDiskTesters.clear();
+
+	hddSaveTestTimes();
 }
 
 void hddDiskRandomizeChunksForTests(IDisk *disk) {
 	TRACETHIS();
 
+	hddLoadTestTimes(disk);
+
 	std::lock_guard testsLockGuard(gTestsMutex);
 	safs_pretty_syslog(LOG_NOTICE, "Randomizing chunks for disk: %s",
 	                   disk->getPaths().c_str());
 	disk->chunks().shuffle();
+	// Chunks never tested (or tested at the same time) stay in random order
+	disk->chunks().sortByLastTestTime();
 }
 
 /* initialization */
@@ -2711,6 +3400,42 @@ static inline void hddAddChunkFromDiskScan(IDisk *disk,
 }
 
 /// Scans the Disk for new Chunks in bulks of 1000 Chunks
+/// Tells if the file is a copy left behind by a tiering move interrupted by a
+/// crash or restart. Such copies are never referenced by any chunk.
+static bool hddIsTieringLeftover(const std::string &filename) {
+	const size_t suffixLength = std::strlen(kTieringCopySuffix);
+	return filename.size() > suffixLength &&
+	       filename.compare(filename.size() - suffixLength, suffixLength,
+	                        kTieringCopySuffix) == 0;
+}
+
+static void hddRemoveTieringLeftover(const std::string &path) {
+	if (::unlink(path.c_str()) == 0) {
+		safs_pretty_syslog(LOG_NOTICE,
+		                   "Removed %s left by an interrupted chunk move",
+		                   path.c_str());
+	} else {
+		safs_pretty_errlog(LOG_WARNING, "Can't remove %s", path.c_str());
+	}
+}
+
+/// Removes the leftovers of interrupted tiering moves from a data subfolder
+/// which is not scanned for chunks (i.e. kept apart from the metadata files).
+static void hddRemoveTieringLeftovers(const std::string &subfolderPath) {
+	DIR *dd = opendir(subfolderPath.c_str());
+	if (!dd) {
+		return;
+	}
+
+	while (struct dirent *dirEntry = readdir(dd)) {
+		if (hddIsTieringLeftover(dirEntry->d_name)) {
+			hddRemoveTieringLeftover(subfolderPath + dirEntry->d_name);
+		}
+	}
+
+	closedir(dd);
+}
+
 void hddDiskScan(IDisk *disk, uint32_t beginTime) {
 	std::unique_lock uniqueLock(gDisksMutex);
 	IDisk::ScanState scanState = disk->scanState();
@@ -2732,6 +3457,12 @@ void hddDiskScan(IDisk *disk, uint32_t beginTime) {
 	     ++subfolderNumber) {
 		std::string subfolderPath = disk->metaPath()
 		    + Subfolder::getSubfolderNameGivenNumber(subfolderNumber) + "/";
+		if (disk->dataPath() != disk->metaPath()) {
+			hddRemoveTieringLeftovers(
+			    disk->dataPath() +
+			    Subfolder::getSubfolderNameGivenNumber(subfolderNumber) + "/");
+		}
+
 		dd = opendir(subfolderPath.c_str());
 		if (!dd) {
 			continue;
@@ -2744,6 +3475,12 @@ void hddDiskScan(IDisk *disk, uint32_t beginTime) {
 			}
 
 			const std::string filename = dirEntry->d_name;
+
+			if (hddIsTieringLeftover(filename)) {
+				hddRemoveTieringLeftover(subfolderPath + filename);
+				continue;
+			}
+
 			ChunkFilenameParser filenameParser(filename);
 
 			if (filenameParser.parse() != ChunkFilenameParser::Status::OK) {
@@ -2888,6 +3625,7 @@ void hddTerminate(void) {
 		gTesterThread.join();
 		gDisksThread.join();
 		gDelayedThread.join();
+		gTieringThread.join();
 
 		try {
 			gChunkTesterThread.join();
@@ -3152,6 +3890,7 @@ int hddParseCfgLine(std::string hddCfgLine) {
 			disk->setWasRemovedFromConfig(false);
 			disk->setIsReadOnly(currentDisk->isReadOnly());
 			disk->setIsMarkedForRemoval(currentDisk->isMarkedForRemoval());
+			disk->setIsFastTier(currentDisk->isFastTier());
 			disksUniqueLock.unlock();
 
 			delete currentDisk; // Also deletes the lock files (smart pointer)
@@ -3250,15 +3989,48 @@ static void hddDisksReinit(void) {
 	}
 }
 
+/// Resizes the block cache if HDD_BLOCK_CACHE_SIZE changed
+static void hddConfigureBlockCache() {
+	char *cacheSizeStr = cfg_getstr("HDD_BLOCK_CACHE_SIZE", "0");
+	uint64_t cacheSize = 0;
+	if (hddSizeParse(cacheSizeStr, &cacheSize) < 0) {
+		safs_pretty_syslog(LOG_WARNING,
+		                   "hdd space manager: HDD_BLOCK_CACHE_SIZE parse "
+		                   "error - left unchanged");
+	} else if (cacheSize / SFSBLOCKSIZE !=
+	           gBlockCache.capacity() / SFSBLOCKSIZE) {
+		gBlockCache.setCapacity(cacheSize);
+		safs_pretty_syslog(LOG_INFO,
+		                   "hdd space manager: block cache size set to %" PRIu64
+		                   " MiB",
+		                   gBlockCache.capacity() / (1024 * 1024));
+	}
+	free(cacheSizeStr);
+}
+
+/// Reads the options of the tiering between fast and slow disks
+static void hddConfigureTiering() {
+	gHDDTieringPeriod_s = cfg_getuint32("HDD_TIERING_PERIOD", 300);
+	gHDDFastTierMaxUsage =
+	    cfg_ranged_get("HDD_FAST_TIER_MAX_USAGE", 90., 0., 100.) / 100.;
+	gHDDTieringMaxMoves = cfg_getuint32("HDD_TIERING_MAX_MOVES", 16);
+}
+
 void hddReload(void) {
 	TRACETHIS();
 
 	gAdviseNoCache = cfg_getuint32("HDD_ADVISE_NO_CACHE", 0);
 	gPerformFsync = cfg_getuint32("PERFORM_FSYNC", 1);
+	gFsyncGroupWindowUs =
+	    cfg_ranged_get("FSYNC_GROUP_WINDOW_US", 0., 0., 100000.);
 	gHDDTestFreq_ms =
 	    cfg_ranged_get("HDD_TEST_FREQ", 10., 0.001, 1000000.) * 1000;
+	gHDDTestSpeed =
+	    cfg_ranged_get("HDD_TEST_SPEED", 0., 0., 1000000.) * 1024 * 1024;
 	gCheckCrcWhenReading = cfg_getuint8("HDD_CHECK_CRC_WHEN_READING", 1) != 0U;
 	gPunchHolesInFiles = cfg_getuint32("HDD_PUNCH_HOLES", 0);
+	hddConfigureBlockCache();
+	hddConfigureTiering();
 
 	char *LeaveFreeStr = cfg_getstr("HDD_LEAVE_SPACE_DEFAULT",
 	                                disk::gLeaveSpaceDefaultDefaultStrValue);
@@ -3290,6 +4062,7 @@ int hddLateInit() {
 	gTesterThread = std::thread(hddTesterThread);
 	gDisksThread = std::thread(hddDisksThread);
 	gDelayedThread = std::thread(hddFreeResourcesThread);
+	gTieringThread = std::thread(hddTieringThread);
 
 	try {
 		gChunkTesterThread = std::thread(hddTestChunkThread);
@@ -3324,7 +4097,12 @@ int hddInit() {
 
 	initializeEmptyBlockCrcForDisks();
 
+	// Open chunks keep their flags, so it is only read at startup
+	gUseDirectIO = cfg_getuint8("HDD_DIRECT_IO", 0) != 0U;
+
 	gPerformFsync = cfg_getuint32("PERFORM_FSYNC", 1);
+	gFsyncGroupWindowUs =
+	    cfg_ranged_get("FSYNC_GROUP_WINDOW_US", 0., 0., 100000.);
 
 	uint64_t leaveSpaceDefaultDefaultValue = 0;
 	sassert(hddSizeParse(disk::gLeaveSpaceDefaultDefaultStrValue,
@@ -3369,9 +4147,13 @@ int hddInit() {
 	gAdviseNoCache = cfg_getuint32("HDD_ADVISE_NO_CACHE", 0);
 	gHDDTestFreq_ms =
 	    cfg_ranged_get("HDD_TEST_FREQ", 10., 0.001, 1000000.) * 1000;
+	gHDDTestSpeed =
+	    cfg_ranged_get("HDD_TEST_SPEED", 0., 0., 1000000.) * 1024 * 1024;
 	gCheckCrcWhenReading = cfg_getuint8("HDD_CHECK_CRC_WHEN_READING", 1) != 0U;
 
 	gPunchHolesInFiles = cfg_getuint32("HDD_PUNCH_HOLES", 0);
+	hddConfigureBlockCache();
+	hddConfigureTiering();
 
 	eventloop_reloadregister(hddReload);
 	eventloop_timeregister(TIMEMODE_RUN_LATE, SECONDS_IN_ONE_MINUTE, 0,
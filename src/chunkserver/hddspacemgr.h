@@ -55,6 +55,9 @@ void hddGetTotalSpace(uint64_t *usedSpace, uint64_t *totalSpace,
                       uint32_t *chunkCount, uint64_t *toDelUsedSpace,
                       uint64_t *toDelTotalSpace, uint32_t *toDelChunkCount);
 int hddGetLoadFactor();
+/// Reports the deepest I/O queue and the slowest mean I/O service time among
+/// the used disks, as sampled by the last hddGetLoadFactor() call.
+void hddGetDiskLoad(uint32_t *queueDepth, uint32_t *latencyUs);
 
 /* I/O operations */
 int hddOpen(IChunk *chunk);
@@ -68,10 +71,12 @@ int hddRead(uint64_t chunkId, uint32_t version, ChunkPartType chunkType,
             [[maybe_unused]] uint32_t maxBlocksToBeReadBehind,
             [[maybe_unused]] uint32_t blocksToBeReadAhead,
             OutputBuffer *outputBuffer);
-int hddChunkWriteBlock(uint64_t chunkId, uint32_t version,
-                       ChunkPartType chunkType, uint16_t blocknum,
-                       uint32_t offset, uint32_t size, uint32_t crc,
-                       const uint8_t *buffer);
+/// Writes a batch of blocks of the same chunk under a single chunk lock.
+/// Runs of consecutive full blocks are passed to the disk as one vectored
+/// write. Returns the status of the first failed write, if any.
+int hddChunkWriteBlocks(uint64_t chunkId, uint32_t version,
+                        ChunkPartType chunkType, const ChunkBlockWrite *writes,
+                        uint32_t count);
 
 /* chunk info */
 int hddChunkGetNumberOfBlocks(uint64_t chunkId, ChunkPartType chunkType,
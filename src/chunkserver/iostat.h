@@ -43,6 +43,8 @@ class IoStat {
 public:
 	void resetPaths(const std::vector<std::string> &) {}
 	uint8_t getLoadFactor() { return 0; }
+	uint32_t getQueueDepth() const { return 0; }
+	uint32_t getLatencyUs() const { return 0; }
 };
 
 #else
@@ -61,6 +63,8 @@ protected:
 	struct StatEntry {
 		unsigned ticks;
 		size_t size;
+		unsigned long ios;       // completed reads and writes
+		unsigned long io_ticks;  // milliseconds spent on completed reads and writes
 	};
 
 	typedef std::unordered_map<dev_t, StatEntry> StatsMap;
@@ -69,6 +73,8 @@ public:
 	void resetPaths(const std::vector<std::string> &paths) {
 		prev_timestamp_ = 0;
 		prev_load_factor_ = 0;
+		queue_depth_ = 0;
+		latency_us_ = 0;
 		for (auto &path : paths) {
 			struct stat st;
 			struct statfs stfs;
@@ -81,7 +87,7 @@ public:
 			if (ret < 0) {
 				continue;
 			}
-			stats_[st.st_dev] = {0, (size_t)stfs.f_blocks};
+			stats_[st.st_dev] = {0, (size_t)stfs.f_blocks, 0, 0};
 		}
 	}
 
@@ -106,6 +112,8 @@ public:
 
 		unsigned long long sum = 0;
 		size_t total_size = 0;
+		uint32_t queue_depth = 0;
+		uint64_t latency_us = 0;
 		while (fgets(line, sizeof(line), fp) != nullptr) {
 			// major minor name rio rmerge rsect ruse wio wmerge wsect wuse running use aveq
 			i = sscanf(line, "%u %u %s %lu %lu %lu %lu %lu %lu %lu %u %u %u %u",
@@ -119,6 +127,17 @@ public:
 				sum += (tot_ticks - entry.ticks) * entry.size;
 				total_size += entry.size;
 				entry.ticks = tot_ticks;
+
+				// The worst disk decides how long a new chunk would wait for its writes.
+				unsigned long ios = rd_ios + wr_ios;
+				unsigned long io_ticks = rd_ticks_or_wr_sec + wr_ticks;
+				if (ios > entry.ios && entry.ios > 0) {
+					latency_us = std::max<uint64_t>(latency_us,
+						(io_ticks - entry.io_ticks) * 1000ULL / (ios - entry.ios));
+				}
+				entry.ios = ios;
+				entry.io_ticks = io_ticks;
+				queue_depth = std::max(queue_depth, ios_pgr);
 			}
 		}
 
@@ -131,13 +150,29 @@ public:
 		// reading disk stats (better to overestimate a bit than underestimate).
 		prev_load_factor_ = std::min(sum / (divisor ? divisor : 1), 100ULL);
 		prev_timestamp_ = timestamp;
+		queue_depth_ = queue_depth;
+		latency_us_ = std::min<uint64_t>(latency_us, UINT32_MAX);
 		fclose(fp);
 		return prev_load_factor_;
 	}
 
+	/// Largest number of I/Os in flight on any of the used disks, as of the last
+	/// call to getLoadFactor().
+	uint32_t getQueueDepth() const {
+		return queue_depth_;
+	}
+
+	/// Largest mean service time (in microseconds) of the I/Os completed on any
+	/// of the used disks between the last two calls to getLoadFactor().
+	uint32_t getLatencyUs() const {
+		return latency_us_;
+	}
+
 protected:
 	unsigned long prev_timestamp_;
 	unsigned long prev_load_factor_;
+	uint32_t queue_depth_;
+	uint32_t latency_us_;
 	StatsMap stats_;
 };
 
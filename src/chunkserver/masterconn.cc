@@ -84,7 +84,8 @@ struct masterconn {
 	  bindip(),
 	  masterip(),
 	  masterport(),
-	  masteraddrvalid() {}
+	  masteraddrvalid(),
+	  statusVersion() {}
 
 	int mode;
 	int sock;
@@ -96,6 +97,9 @@ struct masterconn {
 	uint32_t masterip;
 	uint16_t masterport;
 	uint8_t masteraddrvalid;
+	/// Newest SAU_CSTOMA_STATUS version the master accepts, older masters
+	/// do not tell it and accept only the first one
+	PacketVersion statusVersion;
 };
 
 static const uint64_t kSendStatusDelay = 5;
@@ -430,6 +434,10 @@ void masterconn_replicate(const std::vector<uint8_t>& data) {
 
 }
 
+void masterconn_status_version(masterconn *eptr, const std::vector<uint8_t>& data) {
+	matocs::statusVersion::deserialize(data, eptr->statusVersion);
+}
+
 void masterconn_gotpacket(masterconn *eptr, PacketHeader header, const MessageBuffer& message) try {
 	switch (header.type) {
 		case ANTOAN_NOP:
@@ -462,6 +470,9 @@ void masterconn_gotpacket(masterconn *eptr, PacketHeader header, const MessageBu
 		case SAU_MATOCS_DUPTRUNC_CHUNK:
 			masterconn_duptrunc(eptr, message);
 			break;
+		case SAU_MATOCS_STATUS_VERSION:
+			masterconn_status_version(eptr, message);
+			break;
 //              case MATOCS_STRUCTURE_LOG:
 //                      masterconn_structure_log(eptr, message.data(), message.size());
 //                      break;
@@ -504,6 +515,7 @@ void masterconn_connected(masterconn *eptr) {
 	tcpnodelay(eptr->sock);
 	eptr->mode = CONNECTED;
 	eptr->inputPacket.reset();
+	eptr->statusVersion = cstoma::status::kLoadFactorOnly;
 
 	masterconn_sendregister(eptr);
 	eptr->lastread.reset();
@@ -693,14 +705,28 @@ void masterconn_desc(std::vector<pollfd> &pdesc) {
 
 void masterconn_send_status() {
 	static uint8_t prev_factor = 0;
+	static uint32_t prev_queue_depth = 0;
+	static uint32_t prev_latency_us = 0;
+	static PacketVersion prev_version = cstoma::status::kLoadFactorOnly;
 	masterconn *eptr = masterconnsingleton;
 
 	if (gEnableLoadFactor) {
 		uint8_t load_factor = hddGetLoadFactor();
-		if (eptr->mode == CONNECTED && load_factor != prev_factor) {
-			masterconn_create_attached_packet(eptr,
-				cstoma::status::build(load_factor));
+		uint32_t queue_depth, latency_us;
+		hddGetDiskLoad(&queue_depth, &latency_us);
+		if (eptr->mode == CONNECTED && (load_factor != prev_factor ||
+		    queue_depth != prev_queue_depth || latency_us != prev_latency_us ||
+		    eptr->statusVersion != prev_version)) {
+			if (eptr->statusVersion >= cstoma::status::kDiskMetrics) {
+				masterconn_create_attached_packet(eptr,
+					cstoma::status::build(load_factor, queue_depth, latency_us));
+			} else {
+				masterconn_create_attached_packet(eptr, cstoma::status::build(load_factor));
+			}
 			prev_factor = load_factor;
+			prev_queue_depth = queue_depth;
+			prev_latency_us = latency_us;
+			prev_version = eptr->statusVersion;
 		}
 	}
 }
@@ -868,7 +894,9 @@ int masterconn_init(void) {
 }
 
 int masterconn_init_threads(void) {
-	jpool = job_pool_new(10,BGJOBSCNT,&jobfd);
+	// More workers keep more chunks in flight while recovering lost parts
+	uint8_t workers = cfg_get_minmaxvalue<uint32_t>("NR_OF_MASTER_JOB_WORKERS", 10, 1, 255);
+	jpool = job_pool_new(workers,BGJOBSCNT,&jobfd);
 	if (jpool==NULL) {
 		return -1;
 	}
@@ -64,6 +64,9 @@
 #define CSSERV_TIMEOUT 10
 
 #define CONNECT_RETRIES 10
+
+// Maximum number of WRITE_DATA requests queued while a write job is running
+#define MAX_QUEUED_WRITES 16
 #define CONNECT_TIMEOUT(cnt) (((cnt)%2)?(300000*(1<<((cnt)>>1))):(200000*(1<<((cnt)>>1))))
 
 class MessageSerializer {
@@ -169,20 +172,23 @@ void worker_attach_packet(csserventry *eptr, void *packet) {
 	eptr->outputtail = &(outpacket->next);
 }
 
-void* worker_preserve_inputpacket(csserventry *eptr) {
+/// Takes the buffer of the input packet, so that it lives until a write job is
+/// done with it. A packet which is still being forwarded shares its buffer.
+std::shared_ptr<uint8_t> worker_preserve_inputpacket(csserventry *eptr) {
 	TRACETHIS();
-	void* ret;
-	ret = eptr->inputpacket.packet;
+	if (eptr->fwdpacket) {
+		return eptr->fwdpacket;
+	}
+	std::shared_ptr<uint8_t> ret(eptr->inputpacket.packet, free);
 	eptr->inputpacket.packet = NULL;
 	return ret;
 }
 
-void worker_delete_preserved(void *p) {
+void worker_delete_write_batch(WriteBatch &batch) {
 	TRACETHIS();
-	if (p) {
-		free(p);
-		p = NULL;
-	}
+	batch.blocks.clear();
+	batch.writeIds.clear();
+	batch.packets.clear();
 }
 
 void worker_create_attached_packet(csserventry *eptr, const std::vector<uint8_t>& packet) {
@@ -512,40 +518,71 @@ void worker_prefetch(csserventry *eptr, const uint8_t *data, PacketHeader::Type
 
 // bg writing
 
+void worker_write_finished(uint8_t status, void *e);
+
+/// Hands all queued WRITE_DATA requests to a single write job.
+void worker_submit_queued_writes(csserventry *eptr) {
+	TRACETHIS();
+	sassert(eptr->wjobid == 0 && eptr->wbatch.empty() && !eptr->wqueue.empty());
+	std::swap(eptr->wbatch, eptr->wqueue);
+	eptr->wjobwriteid = eptr->wbatch.writeIds.front();
+	eptr->wjobid = job_write(eptr->workerJobPool, worker_write_finished, eptr,
+			eptr->chunkid, eptr->version, eptr->chunkType,
+			eptr->wbatch.blocks.data(), eptr->wbatch.size());
+}
+
 void worker_write_finished(uint8_t status, void *e) {
 	TRACETHIS();
 	csserventry *eptr = (csserventry*) e;
 	eptr->wjobid = 0;
 	sassert(eptr->messageSerializer != NULL);
+	// The job opening the chunk (WRITE_INIT) has no blocks, its writeId is 0
+	std::vector<uint32_t> writeIds;
+	if (eptr->wbatch.empty()) {
+		writeIds.push_back(eptr->wjobwriteid);
+	} else {
+		writeIds = eptr->wbatch.writeIds;
+	}
 	if (status != SAUNAFS_STATUS_OK) {
-		std::vector<uint8_t> buffer;
-		eptr->messageSerializer->serializeCstoclWriteStatus(buffer,
-				eptr->chunkid, eptr->wjobwriteid, status);
-		worker_create_attached_packet(eptr, buffer);
+		for (uint32_t writeId : writeIds) {
+			std::vector<uint8_t> buffer;
+			eptr->messageSerializer->serializeCstoclWriteStatus(buffer,
+					eptr->chunkid, writeId, status);
+			worker_create_attached_packet(eptr, buffer);
+		}
+		worker_delete_write_batch(eptr->wbatch);
+		worker_delete_write_batch(eptr->wqueue);
 		eptr->state = WRITEFINISH;
 		return;
 	}
 	if (eptr->wjobwriteid == 0) {
 		eptr->chunkisopen = 1;
 	}
-	if (eptr->state == WRITELAST) {
-		std::vector<uint8_t> buffer;
-		eptr->messageSerializer->serializeCstoclWriteStatus(buffer,
-				eptr->chunkid, eptr->wjobwriteid, status);
-		worker_create_attached_packet(eptr, buffer);
-	} else {
-		if (eptr->partiallyCompletedWrites.count(eptr->wjobwriteid) > 0) {
+	for (uint32_t writeId : writeIds) {
+		if (eptr->state == WRITELAST) {
+			std::vector<uint8_t> buffer;
+			eptr->messageSerializer->serializeCstoclWriteStatus(buffer,
+					eptr->chunkid, writeId, status);
+			worker_create_attached_packet(eptr, buffer);
+		} else if (eptr->partiallyCompletedWrites.count(writeId) > 0) {
 			// found - it means that it was added by status_receive, ie. next chunkserver from
 			// a chain finished writing before our worker
-			sassert(eptr->messageSerializer != NULL);
 			std::vector<uint8_t> buffer;
 			eptr->messageSerializer->serializeCstoclWriteStatus(buffer,
-					eptr->chunkid, eptr->wjobwriteid, SAUNAFS_STATUS_OK);
+					eptr->chunkid, writeId, SAUNAFS_STATUS_OK);
 			worker_create_attached_packet(eptr, buffer);
-			eptr->partiallyCompletedWrites.erase(eptr->wjobwriteid);
+			eptr->partiallyCompletedWrites.erase(writeId);
 		} else {
 			// not found - so add it
-			eptr->partiallyCompletedWrites.insert(eptr->wjobwriteid);
+			eptr->partiallyCompletedWrites.insert(writeId);
+		}
+	}
+	worker_delete_write_batch(eptr->wbatch);
+	if (!eptr->wqueue.empty()) {
+		if (eptr->state == WRITELAST || eptr->state == WRITEFWD) {
+			worker_submit_queued_writes(eptr);
+		} else {
+			worker_delete_write_batch(eptr->wqueue);
 		}
 	}
 	worker_check_nextpacket(eptr);
@@ -694,14 +731,14 @@ void worker_write_data(csserventry *eptr,
 		eptr->state = WRITEFINISH;
 		return;
 	}
-	if (eptr->wpacket) {
-		worker_delete_preserved(eptr->wpacket);
+	// Requests arriving while the previous job is running are queued, so that
+	// consecutive blocks reach the disk as a single vectored write
+	eptr->wqueue.blocks.push_back({blocknum, offset, size, crc, dataToWrite});
+	eptr->wqueue.writeIds.push_back(writeId);
+	eptr->wqueue.packets.push_back(worker_preserve_inputpacket(eptr));
+	if (eptr->wjobid == 0) {
+		worker_submit_queued_writes(eptr);
 	}
-	eptr->wpacket = worker_preserve_inputpacket(eptr);
-	eptr->wjobwriteid = writeId;
-	eptr->wjobid = job_write(eptr->workerJobPool, worker_write_finished, eptr,
-			chunkId, eptr->version, eptr->chunkType,
-			blocknum, offset, size, crc, dataToWrite);
 }
 
 void worker_write_status(csserventry *eptr,
@@ -1084,27 +1121,80 @@ void worker_gotpacket(csserventry *eptr, uint32_t type, const uint8_t *data, uin
 	}
 }
 
-void worker_check_nextpacket(csserventry *eptr) {
-	TRACETHIS();
-	uint32_t type, size;
-	const uint8_t *ptr;
-	if (eptr->state == WRITEFWD) {
-		if (eptr->mode == DATA && eptr->inputpacket.bytesleft == 0 && eptr->fwdbytesleft == 0) {
-			ptr = eptr->hdrbuff;
-			type = get32bit(&ptr);
-			size = get32bit(&ptr);
+/// Tells if the fully received input packet may be processed now. While a write
+/// job is running only WRITE_DATA requests are accepted (and queued), up to
+/// MAX_QUEUED_WRITES of them; everything else waits for the job to finish.
+bool worker_can_process_inputpacket(csserventry *eptr) {
+	if (eptr->wjobid == 0) {
+		return true;
+	}
+	const uint8_t *ptr = eptr->hdrbuff;
+	uint32_t type = get32bit(&ptr);
+	return (type == CLTOCS_WRITE_DATA || type == SAU_CLTOCS_WRITE_DATA)
+			&& eptr->wqueue.size() < MAX_QUEUED_WRITES;
+}
 
+/// Processes the input packet received in WRITEFWD state. WRITE_DATA is given
+/// to the write job as soon as it is received, so that the disk write overlaps
+/// with sending the rest of the packet to the next chunkserver; both use the
+/// same buffer. Other packets wait until they are forwarded.
+void worker_forward_process_inputpacket(csserventry *eptr) {
+	TRACETHIS();
+	if (eptr->mode != DATA || eptr->inputpacket.bytesleft > 0) {
+		return;
+	}
+	if (eptr->fwdpacket) {
+		// Already processed, the next packet is read when forwarding finishes
+		if (eptr->fwdbytesleft == 0) {
+			eptr->fwdpacket.reset();
+			eptr->fwdstartptr = NULL;
 			eptr->mode = HEADER;
 			eptr->inputpacket.bytesleft = 8;
 			eptr->inputpacket.startptr = eptr->hdrbuff;
+		}
+		return;
+	}
+	if (!worker_can_process_inputpacket(eptr)) {
+		return;
+	}
+	PacketHeader header;
+	try {
+		deserializePacketHeader(eptr->hdrbuff, sizeof(eptr->hdrbuff), header);
+	} catch (IncorrectDeserializationException&) {
+		safs_pretty_syslog(LOG_WARNING, "(forward) Received malformed network packet");
+		eptr->state = CLOSE;
+		return;
+	}
+	uint8_t* packet = eptr->inputpacket.packet;
+	if (eptr->fwdbytesleft > 0) {
+		if (header.type != CLTOCS_WRITE_DATA && header.type != SAU_CLTOCS_WRITE_DATA) {
+			return;
+		}
+		eptr->fwdpacket.reset(packet, free);
+		eptr->inputpacket.packet = NULL;
+	} else {
+		eptr->mode = HEADER;
+		eptr->inputpacket.bytesleft = 8;
+		eptr->inputpacket.startptr = eptr->hdrbuff;
+		eptr->fwdstartptr = NULL;
+	}
 
-			worker_gotpacket(eptr, type, eptr->inputpacket.packet + 8, size);
+	worker_gotpacket(eptr, header.type, packet + PacketHeader::kSize, header.length);
+	if (eptr->inputpacket.packet) {
+		free(eptr->inputpacket.packet);
+	}
+	eptr->inputpacket.packet = NULL;
+}
 
-			if (eptr->inputpacket.packet) {
-				free(eptr->inputpacket.packet);
-			}
-			eptr->inputpacket.packet = NULL;
-		}
+void worker_check_nextpacket(csserventry *eptr) {
+	TRACETHIS();
+	uint32_t type, size;
+	const uint8_t *ptr;
+	if (!worker_can_process_inputpacket(eptr)) {
+		return;
+	}
+	if (eptr->state == WRITEFWD) {
+		worker_forward_process_inputpacket(eptr);
 	} else {
 		if (eptr->mode == DATA && eptr->inputpacket.bytesleft == 0) {
 			ptr = eptr->hdrbuff;
@@ -1335,34 +1425,15 @@ void worker_forward(csserventry *eptr) {
 			if (errno != EAGAIN) {
 				safs_silent_errlog(LOG_NOTICE, "(forward) write error");
 				worker_fwderror(eptr);
+				return;
 			}
-			return;
-		}
-		stats_bytesout += i;
-		eptr->fwdstartptr += i;
-		eptr->fwdbytesleft -= i;
-	}
-	if (eptr->inputpacket.bytesleft == 0 && eptr->fwdbytesleft == 0 && eptr->wjobid == 0) {
-		PacketHeader header;
-		try {
-			deserializePacketHeader(eptr->hdrbuff, sizeof(eptr->hdrbuff), header);
-		} catch (IncorrectDeserializationException&) {
-			safs_pretty_syslog(LOG_WARNING, "(forward) Received malformed network packet");
-			eptr->state = CLOSE;
-			return;
-		}
-		eptr->mode = HEADER;
-		eptr->inputpacket.bytesleft = 8;
-		eptr->inputpacket.startptr = eptr->hdrbuff;
-
-		uint8_t* packetData = eptr->inputpacket.packet + PacketHeader::kSize;
-		worker_gotpacket(eptr, header.type, packetData, header.length);
-		if (eptr->inputpacket.packet) {
-			free(eptr->inputpacket.packet);
+		} else {
+			stats_bytesout += i;
+			eptr->fwdstartptr += i;
+			eptr->fwdbytesleft -= i;
 		}
-		eptr->inputpacket.packet = NULL;
-		eptr->fwdstartptr = NULL;
 	}
+	worker_forward_process_inputpacket(eptr);
 }
 
 void worker_read(csserventry *eptr) {
@@ -1438,7 +1509,7 @@ void worker_read(csserventry *eptr) {
 				return;
 			}
 		}
-		if (eptr->wjobid == 0) {
+		if (worker_can_process_inputpacket(eptr)) {
 			ptr = eptr->hdrbuff;
 			type = get32bit(&ptr);
 			size = get32bit(&ptr);
@@ -1567,9 +1638,8 @@ void NetworkWorkerThread::terminate() {
 		if (entry.inputpacket.packet) {
 			free(entry.inputpacket.packet);
 		}
-		if (entry.wpacket) {
-			worker_delete_preserved(entry.wpacket);
-		}
+		worker_delete_write_batch(entry.wbatch);
+		worker_delete_write_batch(entry.wqueue);
 		if (entry.fwdinputpacket.packet) {
 			free(entry.fwdinputpacket.packet);
 		}
@@ -1770,9 +1840,8 @@ void NetworkWorkerThread::servePoll() {
 			if (eptr->rpacket) {
 				worker_delete_packet(eptr->rpacket);
 			}
-			if (eptr->wpacket) {
-				worker_delete_preserved(eptr->wpacket);
-			}
+			worker_delete_write_batch(eptr->wbatch);
+			worker_delete_write_batch(eptr->wqueue);
 			if (eptr->fwdsock >= 0) {
 				tcpclose(eptr->fwdsock);
 			}
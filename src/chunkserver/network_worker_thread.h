@@ -24,10 +24,12 @@
 #include <inttypes.h>
 #include <atomic>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <set>
 #include <vector>
 
+#include "chunkserver-common/disk_interface.h"
 #include "chunkserver/network_stats.h"
 #include "chunkserver/output_buffer.h"
 #include "common/chunk_part_type.h"
@@ -69,6 +71,17 @@ struct packetstruct {
 
 class MessageSerializer;
 
+/// WRITE_DATA requests of one connection which are written to disk by a single
+/// job. Packets holding the data are preserved until the job finishes.
+struct WriteBatch {
+	std::vector<ChunkBlockWrite> blocks;
+	std::vector<uint32_t> writeIds;
+	std::vector<std::shared_ptr<uint8_t>> packets;
+
+	bool empty() const { return blocks.empty(); }
+	size_t size() const { return blocks.size(); }
+};
+
 struct csserventry {
 	void* workerJobPool; // Job pool assigned to a given network worker thread
 
@@ -89,6 +102,7 @@ struct csserventry {
 	packetstruct inputpacket;
 	uint8_t *fwdstartptr; // used for forwarding inputpacket data
 	uint32_t fwdbytesleft; // used for forwarding inputpacket data
+	std::shared_ptr<uint8_t> fwdpacket; // inputpacket given to a write job, still being forwarded
 	packetstruct fwdinputpacket; // used for receiving status from fwdsocket
 	std::vector<uint8_t> fwdinitpacket; // used only for write initialization
 	packetstruct *outputhead, **outputtail;
@@ -99,6 +113,8 @@ struct csserventry {
 	std::set<uint32_t> partiallyCompletedWrites; // writeId's which:
 	// * have been completed by our worker, but need ack from the next chunkserver from the chain
 	// * have been acked by the next chunkserver from the chain, but are still being written by us
+	WriteBatch wbatch; // writes being done by the worker job wjobid
+	WriteBatch wqueue; // writes received while wjobid was busy, submitted as one job
 
 	/* read */
 	uint32_t rjobid;
@@ -108,9 +124,8 @@ struct csserventry {
 	uint32_t getBlocksJobId;
 	uint16_t getBlocksJobResult;
 
-	/* common for read and write but meaning is different !!! */
+	/* packet being sent by the read job */
 	void *rpacket;
-	void *wpacket;
 
 	uint8_t chunkisopen;
 	uint64_t chunkid; // R+W
@@ -147,7 +162,6 @@ struct csserventry {
 			  getBlocksJobId(0),
 			  getBlocksJobResult(0),
 			  rpacket(nullptr),
-			  wpacket(nullptr),
 			  chunkisopen(0),
 			  chunkid(0),
 			  version(0),
@@ -28,6 +28,7 @@
 #include <cstdint>
 
 #include "common/crc.h"
+#include "common/datapack.h"
 #include "common/massert.h"
 
 OutputBuffer::OutputBuffer(size_t internalBufferCapacity)
@@ -65,6 +66,14 @@ void OutputBuffer::clear() {
 	bufferUnflushedDataOneAfterLastIndex_ = padding_;
 }
 
+void OutputBuffer::reset(size_t capacity) {
+	eassert(capacity > 0 && getAlignedSize(capacity) <= buffer_.size());
+	internalBufferCapacity_ = capacity;
+	internalBufferCapacityAligned_ = getAlignedSize(capacity);
+	padding_ = internalBufferCapacityAligned_ - capacity;
+	clear();
+}
+
 ssize_t OutputBuffer::copyIntoBuffer(IChunk *chunk, size_t len, off_t offset) {
 	eassert(len + bufferUnflushedDataOneAfterLastIndex_ <=
 	        internalBufferCapacityAligned_);
@@ -98,3 +107,14 @@ ssize_t OutputBuffer::copyIntoBuffer(const void *mem, size_t len) {
 
 	return len;
 }
+
+ssize_t OutputBuffer::copyIntoBufferWithCrc(const void *mem, size_t len) {
+	eassert(bufferUnflushedDataOneAfterLastIndex_ + kCrcSize + len <=
+	        internalBufferCapacityAligned_);
+	uint8_t *crcPointer = &buffer_[bufferUnflushedDataOneAfterLastIndex_];
+	uint32_t crc = mycrc32_copy(0, crcPointer + kCrcSize, static_cast<const uint8_t *>(mem), len);
+	put32bit(&crcPointer, crc);
+	bufferUnflushedDataOneAfterLastIndex_ += kCrcSize + len;
+
+	return kCrcSize + len;
+}
@@ -46,6 +46,9 @@ public:
 
 	bool checkCRC(size_t bytes, uint32_t crc) const;
 
+	/// Appends CRC of the given data followed by the data itself, checksumming while copying.
+	ssize_t copyIntoBufferWithCrc(const void *mem, size_t len);
+
 	ssize_t copyIntoBuffer(const std::vector<uint8_t>& mem) {
 		return copyIntoBuffer(mem.data(), mem.size());
 	}
@@ -55,8 +58,17 @@ public:
 	size_t bytesInABuffer() const;
 	inline size_t capacity() const { return internalBufferCapacity_; }
 	inline const uint8_t *data() const { return buffer_.data(); }
+	/// Returns the last bytes appended to the buffer
+	inline const uint8_t *lastBytes(size_t bytes) const {
+		return &buffer_[bufferUnflushedDataOneAfterLastIndex_ - bytes];
+	}
 	void clear();
 
+	/// Prepares the buffer for a packet of the given capacity, which must not
+	/// exceed the capacity the buffer was created with. Used by BuffersPool to
+	/// serve requests of different sizes with the buffers of one size class.
+	void reset(size_t capacity);
+
 	static inline size_t getAlignedSize(size_t capacity) {
 		size_t remainder = capacity % disk::kIoBlockSize;
 
@@ -66,9 +78,9 @@ public:
 	}
 
 private:
-	const size_t internalBufferCapacity_;
-	const size_t internalBufferCapacityAligned_;
-	const size_t padding_;
+	size_t internalBufferCapacity_;
+	size_t internalBufferCapacityAligned_;
+	size_t padding_;
 	std::vector<uint8_t, AlignedAllocator<uint8_t, disk::kIoBlockSize>> buffer_;
 	size_t bufferUnflushedDataFirstIndex_;
 	size_t bufferUnflushedDataOneAfterLastIndex_;
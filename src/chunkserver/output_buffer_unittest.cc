@@ -24,6 +24,8 @@
 #include <gtest/gtest.h>
 
 #include "chunkserver/output_buffer.h"
+#include "common/crc.h"
+#include "common/datapack.h"
 #include "unittests/TemporaryDirectory.h"
 
 TEST(OutputBufferTests, outputBuffersTest) {
@@ -66,3 +68,19 @@ TEST(OutputBufferTests, outputBuffersTest) {
 	close(auxPipeFileDescriptors[0]);
 	close(auxPipeFileDescriptors[1]);
 }
+
+TEST(OutputBufferTests, copyIntoBufferWithCrcTest) {
+	OutputBuffer outputBuffer(2 * disk::kIoBlockSize);
+
+	std::vector<uint8_t> data(disk::kIoBlockSize + 3);
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = i * 13;
+	}
+	ASSERT_EQ(outputBuffer.copyIntoBufferWithCrc(data.data(), data.size()),
+	          (ssize_t)(kCrcSize + data.size()));
+	ASSERT_EQ(outputBuffer.bytesInABuffer(), kCrcSize + data.size());
+
+	const uint8_t *crcPointer = outputBuffer.data();
+	EXPECT_EQ(get32bit(&crcPointer), mycrc32(0, data.data(), data.size()));
+	EXPECT_TRUE(std::equal(data.begin(), data.end(), outputBuffer.data() + kCrcSize));
+}
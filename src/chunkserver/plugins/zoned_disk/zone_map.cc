@@ -0,0 +1,311 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+
+#include "zone_map.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+ZoneMap::ZoneMap(uint32_t reservedZones) : reservedZones_(reservedZones) {}
+
+void ZoneMap::addZone(uint32_t writePointer, uint32_t capacity) {
+	Zone zone;
+	zone.writePointer = writePointer;
+	zone.capacity = std::max(writePointer, capacity);
+	zone.maxCapacity = zone.capacity;
+	capacityBlocks_ += zone.maxCapacity;
+	zones_.push_back(std::move(zone));
+}
+
+uint32_t ZoneMap::writePointer(uint32_t zone) const {
+	return zones_[zone].writePointer;
+}
+
+uint32_t ZoneMap::room(uint32_t zone) const {
+	return zones_[zone].capacity - zones_[zone].writePointer;
+}
+
+uint32_t ZoneMap::emptyZones() const {
+	return std::count_if(zones_.begin(), zones_.end(), [](const Zone &zone) {
+		return zone.writePointer == 0 && !zone.isOpen;
+	});
+}
+
+std::optional<uint32_t> ZoneMap::openZone(bool forGarbageCollection) {
+	std::optional<uint32_t> partial;
+	std::optional<uint32_t> empty;
+
+	for (uint32_t i = 0; i < zones_.size(); ++i) {
+		const Zone &zone = zones_[i];
+		if (zone.isOpen || zone.writePointer >= zone.capacity) {
+			continue;
+		}
+		if (zone.writePointer == 0) {
+			empty = empty.value_or(i);
+		} else if (!partial ||
+		           zone.writePointer > zones_[*partial].writePointer) {
+			partial = i;
+		}
+	}
+
+	if (!partial && empty &&
+	    (forGarbageCollection || emptyZones() > reservedZones_)) {
+		partial = empty;
+	}
+	if (partial) {
+		zones_[*partial].isOpen = true;
+	}
+
+	return partial;
+}
+
+void ZoneMap::closeZone(uint32_t zone) { zones_[zone].isOpen = false; }
+
+void ZoneMap::advance(uint32_t zone, uint32_t blocks) {
+	assert(blocks <= room(zone));
+	zones_[zone].writePointer += blocks;
+}
+
+void ZoneMap::setFull(uint32_t zone) {
+	zones_[zone].capacity = zones_[zone].writePointer;
+}
+
+std::vector<uint32_t> ZoneMap::garbageZones() const {
+	std::vector<uint32_t> result;
+
+	for (uint32_t i = 0; i < zones_.size(); ++i) {
+		const Zone &zone = zones_[i];
+		if (!zone.isOpen && zone.writePointer > 0 &&
+		    zone.writePointer >= zone.capacity && zone.liveBlocks == 0) {
+			result.push_back(i);
+		}
+	}
+
+	return result;
+}
+
+std::optional<uint32_t> ZoneMap::collectionVictim() const {
+	std::optional<uint32_t> victim;
+
+	for (uint32_t i = 0; i < zones_.size(); ++i) {
+		const Zone &zone = zones_[i];
+		// Zones which are not full may still be appended to
+		if (zone.isOpen || zone.writePointer < zone.capacity ||
+		    zone.liveBlocks >= zone.writePointer) {
+			continue;
+		}
+		if (!victim || zone.liveBlocks < zones_[*victim].liveBlocks) {
+			victim = i;
+		}
+	}
+
+	return victim;
+}
+
+std::vector<ZoneMap::LiveBlock> ZoneMap::liveBlocks(uint32_t zone) const {
+	std::vector<LiveBlock> result;
+	result.reserve(zones_[zone].liveBlocks);
+
+	for (const auto &[key, count] : zones_[zone].owners) {
+		for (const auto &[firstBlock, extent] : chunks_.at(key).extents) {
+			if (zoneOf(extent.location) != zone) {
+				continue;
+			}
+			for (uint32_t i = 0; i < extent.count; ++i) {
+				result.push_back({key, static_cast<uint16_t>(firstBlock + i),
+				                  extent.location + i});
+			}
+		}
+	}
+
+	std::sort(result.begin(), result.end(),
+	          [](const LiveBlock &lhs, const LiveBlock &rhs) {
+		          return lhs.location < rhs.location;
+	          });
+
+	return result;
+}
+
+void ZoneMap::resetZone(uint32_t zone) {
+	assert(zones_[zone].liveBlocks == 0);
+	zones_[zone].writePointer = 0;
+	zones_[zone].capacity = zones_[zone].maxCapacity;
+}
+
+void ZoneMap::setChunk(const ChunkKey &chunk,
+                       const std::vector<Location> &locations) {
+	removeChunk(chunk);
+	chunks_[chunk].blocks = locations.size();
+
+	uint32_t block = 0;
+	while (block < locations.size()) {
+		uint32_t count = 1;
+		if (locations[block] != kHole) {
+			while (block + count < locations.size() &&
+			       locations[block + count] == locations[block] + count &&
+			       zoneOf(locations[block + count]) ==
+			           zoneOf(locations[block])) {
+				++count;
+			}
+			assign(chunk, block, count, locations[block]);
+		}
+		block += count;
+	}
+}
+
+bool ZoneMap::hasChunk(const ChunkKey &chunk) const {
+	return chunks_.count(chunk) > 0;
+}
+
+void ZoneMap::removeChunk(const ChunkKey &chunk) {
+	auto it = chunks_.find(chunk);
+	if (it == chunks_.end()) {
+		return;
+	}
+	unmap(chunk, it->second, 0, it->second.blocks);
+	chunks_.erase(it);
+}
+
+uint32_t ZoneMap::chunkBlocks(const ChunkKey &chunk) const {
+	auto it = chunks_.find(chunk);
+	return it == chunks_.end() ? 0 : it->second.blocks;
+}
+
+void ZoneMap::resizeChunk(const ChunkKey &chunk, uint32_t blocks) {
+	auto &extents = chunks_[chunk];
+	if (blocks < extents.blocks) {
+		unmap(chunk, extents, blocks, extents.blocks);
+	}
+	extents.blocks = blocks;
+}
+
+ZoneMap::Location ZoneMap::locate(const ChunkKey &chunk, uint16_t block,
+                                  uint32_t *runLength) const {
+	auto chunkIt = chunks_.find(chunk);
+	if (chunkIt == chunks_.end()) {
+		if (runLength != nullptr) {
+			*runLength = 1;
+		}
+		return kHole;
+	}
+
+	const auto &extents = chunkIt->second.extents;
+	auto next = extents.upper_bound(block);
+	if (next != extents.begin()) {
+		auto it = std::prev(next);
+		if (it->first + it->second.count > block) {
+			if (runLength != nullptr) {
+				*runLength = it->first + it->second.count - block;
+			}
+			return it->second.location + (block - it->first);
+		}
+	}
+
+	if (runLength != nullptr) {
+		uint32_t end = next == extents.end() ? chunkIt->second.blocks
+		                                     : next->first;
+		*runLength = std::max<uint32_t>(1, end > block ? end - block : 1);
+	}
+	return kHole;
+}
+
+void ZoneMap::assign(const ChunkKey &chunk, uint16_t firstBlock, uint32_t count,
+                     Location location) {
+	assert(count > 0 && location != kHole);
+	auto &extents = chunks_[chunk];
+	unmap(chunk, extents, firstBlock, firstBlock + count);
+	addLiveBlocks(chunk, location, count);
+	extents.blocks = std::max<uint32_t>(extents.blocks, firstBlock + count);
+
+	auto it = extents.extents.emplace(firstBlock, Extent{count, location}).first;
+
+	// Merge with the neighbours if they are stored right before or after
+	auto mergeWithNext = [&extents](auto extent) {
+		auto next = std::next(extent);
+		if (next != extents.extents.end() &&
+		    extent->first + extent->second.count == next->first &&
+		    extent->second.location + extent->second.count ==
+		        next->second.location &&
+		    zoneOf(extent->second.location) == zoneOf(next->second.location)) {
+			extent->second.count += next->second.count;
+			extents.extents.erase(next);
+		}
+	};
+
+	mergeWithNext(it);
+	if (it != extents.extents.begin()) {
+		mergeWithNext(std::prev(it));
+	}
+}
+
+bool ZoneMap::relocate(const ChunkKey &chunk, uint16_t block, Location from,
+                       Location to) {
+	if (locate(chunk, block) != from) {
+		return false;
+	}
+	assign(chunk, block, 1, to);
+	return true;
+}
+
+void ZoneMap::unmap(const ChunkKey &key, ChunkExtents &chunk, uint32_t begin,
+                    uint32_t end) {
+	auto &extents = chunk.extents;
+	auto it = extents.upper_bound(begin);
+	if (it != extents.begin() &&
+	    std::prev(it)->first + std::prev(it)->second.count > begin) {
+		--it;
+	}
+
+	while (it != extents.end() && it->first < end) {
+		const uint32_t first = it->first;
+		const Extent extent = it->second;
+		const uint32_t last = first + extent.count;
+		const uint32_t cutBegin = std::max(first, begin);
+		const uint32_t cutEnd = std::min(last, end);
+
+		addLiveBlocks(key, extent.location,
+		              -static_cast<int64_t>(cutEnd - cutBegin));
+		it = extents.erase(it);
+
+		// Keep the parts of the extent outside of [begin, end)
+		if (first < cutBegin) {
+			extents.emplace(first, Extent{cutBegin - first, extent.location});
+		}
+		if (cutEnd < last) {
+			extents.emplace(cutEnd, Extent{last - cutEnd,
+			                               extent.location + (cutEnd - first)});
+			break;
+		}
+	}
+}
+
+void ZoneMap::addLiveBlocks(const ChunkKey &key, Location location,
+                            int64_t count) {
+	Zone &zone = zones_[zoneOf(location)];
+	zone.liveBlocks += count;
+	liveBlocks_ += count;
+
+	auto &owned = zone.owners[key];
+	owned += count;
+	if (owned == 0) {
+		zone.owners.erase(key);
+	}
+}
@@ -0,0 +1,172 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "common/chunk_part_type.h"
+
+/**
+ * ZoneMap keeps track of where the blocks of the Chunks of a zoned Disk are.
+ *
+ * Zones can only be appended to, so every written block goes to the end of an
+ * open zone and a Chunk becomes a list of extents: runs of consecutive blocks
+ * stored one after another in a zone. The previous copy of a rewritten block
+ * becomes garbage, which is reclaimed by moving the live blocks of a mostly
+ * invalid zone to another one and resetting it.
+ *
+ * ZoneMap only does the bookkeeping, it does no I/O and is not thread-safe.
+ */
+class ZoneMap {
+public:
+	/// Location of a block: the zone plus one in the upper 32 bits and the
+	/// block within the zone in the lower ones, so that 0 means a hole.
+	using Location = uint64_t;
+	static constexpr Location kHole = 0;
+
+	using ChunkKey = std::pair<uint64_t, ChunkPartType>;
+
+	/// A live block of a zone, as seen by the garbage collector
+	struct LiveBlock {
+		ChunkKey chunk;
+		uint16_t block;
+		Location location;
+	};
+
+	/// Constructs an empty map, in which reservedZones empty zones are kept
+	/// for the garbage collector.
+	explicit ZoneMap(uint32_t reservedZones = 1);
+
+	static Location makeLocation(uint32_t zone, uint32_t offset) {
+		return (static_cast<Location>(zone) + 1) << 32 | offset;
+	}
+	static uint32_t zoneOf(Location location) { return (location >> 32) - 1; }
+	static uint32_t offsetOf(Location location) {
+		return static_cast<uint32_t>(location);
+	}
+
+	// Zones, with sizes in blocks
+
+	/// Adds the next zone, already written up to writePointer
+	void addZone(uint32_t writePointer, uint32_t capacity);
+	/// Returns the number of zones
+	uint32_t zoneCount() const { return zones_.size(); }
+	/// Returns the number of blocks written to the zone
+	uint32_t writePointer(uint32_t zone) const;
+	/// Returns the number of blocks which can still be appended to the zone
+	uint32_t room(uint32_t zone) const;
+	/// Returns the number of zones nothing was written to
+	uint32_t emptyZones() const;
+
+	/// Chooses a zone to append to and marks it as open.
+	///
+	/// Zones written in part are preferred over empty ones. Only the garbage
+	/// collector may take the reserved empty zones.
+	std::optional<uint32_t> openZone(bool forGarbageCollection);
+	/// Marks the zone as not open anymore
+	void closeZone(uint32_t zone);
+	/// Moves the write pointer of the zone after appending blocks to it
+	void advance(uint32_t zone, uint32_t blocks);
+	/// Marks the zone as full at its write pointer, e.g. when the device
+	/// refused an append
+	void setFull(uint32_t zone);
+
+	/// Returns the full zones without live blocks, ready to be reset
+	std::vector<uint32_t> garbageZones() const;
+	/// Returns the full zone with the fewest live blocks, if it has garbage
+	std::optional<uint32_t> collectionVictim() const;
+	/// Returns the live blocks of the zone, in the order they are stored
+	std::vector<LiveBlock> liveBlocks(uint32_t zone) const;
+	/// Marks the zone as empty after it was reset on the device
+	void resetZone(uint32_t zone);
+
+	/// Returns the number of blocks all the zones can hold
+	uint64_t capacityBlocks() const { return capacityBlocks_; }
+	/// Returns the number of live blocks in all the zones
+	uint64_t liveBlocksCount() const { return liveBlocks_; }
+
+	// Chunks
+
+	/// Adds the Chunk with the given block locations, replacing the previous
+	/// ones if it was already known
+	void setChunk(const ChunkKey &chunk, const std::vector<Location> &locations);
+	/// Tells if the Chunk is known
+	bool hasChunk(const ChunkKey &chunk) const;
+	/// Forgets the Chunk, its blocks become garbage
+	void removeChunk(const ChunkKey &chunk);
+	/// Returns the number of blocks of the Chunk, including holes
+	uint32_t chunkBlocks(const ChunkKey &chunk) const;
+	/// Truncates or extends (with holes) the Chunk to the number of blocks
+	void resizeChunk(const ChunkKey &chunk, uint32_t blocks);
+
+	/// Returns the location of the block, kHole if it was never written.
+	///
+	/// If runLength is given, it gets the number of blocks from this one which
+	/// are stored consecutively (or are holes), at least 1.
+	Location locate(const ChunkKey &chunk, uint16_t block,
+	                uint32_t *runLength = nullptr) const;
+	/// Maps count blocks of the Chunk from firstBlock to consecutive blocks of
+	/// a zone from location
+	void assign(const ChunkKey &chunk, uint16_t firstBlock, uint32_t count,
+	            Location location);
+	/// Maps a block moved by the garbage collector to its new location,
+	/// unless it was rewritten or removed in the meantime
+	bool relocate(const ChunkKey &chunk, uint16_t block, Location from,
+	              Location to);
+
+private:
+	struct Extent {
+		uint32_t count;     ///< Number of blocks
+		Location location;  ///< Location of the first block
+	};
+
+	struct ChunkExtents {
+		uint32_t blocks = 0;  ///< Number of blocks, including holes
+		std::map<uint32_t, Extent> extents;  ///< Extents by first block
+	};
+
+	struct Zone {
+		uint32_t writePointer = 0;  ///< Number of written blocks
+		uint32_t capacity = 0;      ///< Blocks which can be written
+		uint32_t maxCapacity = 0;   ///< Capacity after a reset
+		uint32_t liveBlocks = 0;    ///< Written blocks still in use
+		bool isOpen = false;        ///< Being appended to
+		/// Number of live blocks of each Chunk with blocks in this zone
+		std::map<ChunkKey, uint32_t> owners;
+	};
+
+	/// Forgets the blocks of the Chunk in [begin, end)
+	void unmap(const ChunkKey &key, ChunkExtents &chunk, uint32_t begin,
+	           uint32_t end);
+	/// Updates the live blocks of the zone of location after count blocks of
+	/// the Chunk were mapped (if count > 0) or unmapped (if count < 0) there
+	void addLiveBlocks(const ChunkKey &key, Location location, int64_t count);
+
+	std::vector<Zone> zones_;
+	std::map<ChunkKey, ChunkExtents> chunks_;
+	uint32_t reservedZones_;
+	uint64_t capacityBlocks_ = 0;
+	uint64_t liveBlocks_ = 0;
+};
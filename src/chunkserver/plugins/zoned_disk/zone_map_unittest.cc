@@ -0,0 +1,139 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "zone_map.h"
+
+#include <gtest/gtest.h>
+
+#include "common/slice_traits.h"
+
+static const ZoneMap::ChunkKey kChunk1{1, slice_traits::standard::ChunkPartType()};
+static const ZoneMap::ChunkKey kChunk2{2, slice_traits::standard::ChunkPartType()};
+
+static ZoneMap::Location at(uint32_t zone, uint32_t offset) {
+	return ZoneMap::makeLocation(zone, offset);
+}
+
+TEST(ZoneMapTests, LocatesAssignedBlocks) {
+	ZoneMap map;
+	map.addZone(0, 100);
+
+	map.assign(kChunk1, 2, 3, at(0, 10));
+	EXPECT_EQ(5U, map.chunkBlocks(kChunk1));
+	EXPECT_EQ(3U, map.liveBlocksCount());
+
+	uint32_t run = 0;
+	EXPECT_EQ(ZoneMap::kHole, map.locate(kChunk1, 0, &run));
+	EXPECT_EQ(2U, run);
+	EXPECT_EQ(at(0, 11), map.locate(kChunk1, 3, &run));
+	EXPECT_EQ(2U, run);
+
+	// Appending the next blocks right after extends the same extent
+	map.assign(kChunk1, 5, 2, at(0, 13));
+	EXPECT_EQ(at(0, 10), map.locate(kChunk1, 2, &run));
+	EXPECT_EQ(5U, run);
+}
+
+TEST(ZoneMapTests, RewrittenBlocksBecomeGarbage) {
+	ZoneMap map;
+	map.addZone(0, 4);
+	map.addZone(0, 4);
+
+	map.assign(kChunk1, 0, 4, at(0, 0));
+	map.advance(0, 4);
+	map.assign(kChunk1, 1, 2, at(1, 0));
+	map.advance(1, 2);
+
+	EXPECT_EQ(at(0, 0), map.locate(kChunk1, 0));
+	EXPECT_EQ(at(1, 1), map.locate(kChunk1, 2));
+	EXPECT_EQ(at(0, 3), map.locate(kChunk1, 3));
+	EXPECT_EQ(4U, map.liveBlocksCount());
+
+	ASSERT_EQ(0U, map.collectionVictim().value_or(-1));
+	auto live = map.liveBlocks(0);
+	ASSERT_EQ(2U, live.size());
+	EXPECT_EQ(0U, live[0].block);
+	EXPECT_EQ(3U, live[1].block);
+	EXPECT_EQ(at(0, 3), live[1].location);
+}
+
+TEST(ZoneMapTests, RelocatesOnlyUnchangedBlocks) {
+	ZoneMap map;
+	map.addZone(2, 2);
+	map.addZone(0, 4);
+
+	map.assign(kChunk1, 0, 1, at(0, 0));
+	map.assign(kChunk2, 0, 1, at(0, 1));
+	auto live = map.liveBlocks(0);
+	ASSERT_EQ(2U, live.size());
+
+	// Chunk 2 is rewritten while its block is being moved
+	map.assign(kChunk2, 0, 1, at(1, 0));
+	EXPECT_TRUE(map.relocate(kChunk1, 0, live[0].location, at(1, 1)));
+	EXPECT_FALSE(map.relocate(kChunk2, 0, live[1].location, at(1, 2)));
+
+	EXPECT_EQ(at(1, 1), map.locate(kChunk1, 0));
+	EXPECT_EQ(at(1, 0), map.locate(kChunk2, 0));
+	EXPECT_EQ(std::vector<uint32_t>({0}), map.garbageZones());
+
+	map.resetZone(0);
+	EXPECT_EQ(0U, map.writePointer(0));
+	EXPECT_EQ(2U, map.room(0));
+}
+
+TEST(ZoneMapTests, TruncationAndRemovalFreeBlocks) {
+	ZoneMap map;
+	map.addZone(8, 8);
+
+	map.setChunk(kChunk1, {at(0, 0), at(0, 1), ZoneMap::kHole, at(0, 2)});
+	map.setChunk(kChunk2, {at(0, 3), at(0, 4), at(0, 5)});
+	EXPECT_EQ(6U, map.liveBlocksCount());
+	EXPECT_EQ(4U, map.chunkBlocks(kChunk1));
+
+	map.resizeChunk(kChunk1, 1);
+	EXPECT_EQ(ZoneMap::kHole, map.locate(kChunk1, 1));
+	EXPECT_EQ(4U, map.liveBlocksCount());
+
+	map.resizeChunk(kChunk1, 3);
+	EXPECT_EQ(3U, map.chunkBlocks(kChunk1));
+	EXPECT_EQ(ZoneMap::kHole, map.locate(kChunk1, 2));
+
+	map.removeChunk(kChunk2);
+	EXPECT_FALSE(map.hasChunk(kChunk2));
+	EXPECT_EQ(1U, map.liveBlocksCount());
+	EXPECT_EQ(0U, map.collectionVictim().value_or(-1));
+}
+
+TEST(ZoneMapTests, KeepsReservedZonesForGarbageCollection) {
+	ZoneMap map(1);
+	map.addZone(3, 4);
+	map.addZone(0, 4);
+	map.addZone(0, 4);
+
+	// Partially written zones come first
+	EXPECT_EQ(0U, map.openZone(false).value_or(-1));
+	EXPECT_EQ(1U, map.openZone(false).value_or(-1));
+	EXPECT_FALSE(map.openZone(false));
+	EXPECT_EQ(2U, map.openZone(true).value_or(-1));
+
+	map.closeZone(0);
+	map.setFull(0);
+	EXPECT_EQ(0U, map.room(0));
+	EXPECT_FALSE(map.openZone(true));
+}
@@ -0,0 +1,87 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+
+#include "zoned_chunk.h"
+
+#include <sstream>
+
+#include "common/slice_traits.h"
+#include "zoned_disk.h"
+
+ZonedChunk::ZonedChunk(uint64_t chunkId, ChunkPartType type, ChunkState state)
+    : FDChunk(chunkId, type, state) {}
+
+std::string ZonedChunk::generateDataFilenameForVersion(
+    uint32_t _version) const {
+	std::string filename = generateMetadataFilenameForVersion(_version);
+	filename.replace(filename.size() - strlen(CHUNK_METADATA_FILE_EXTENSION),
+	                 std::string::npos, CHUNK_DATA_FILE_EXTENSION);
+	return filename;
+}
+
+int ZonedChunk::renameChunkFile(uint32_t new_version) {
+	// The Disk also needs the name of the extent file, for garbage collection
+	return static_cast<ZonedDisk *>(owner())->renameChunkFiles(this,
+	                                                           new_version);
+}
+
+uint8_t *ZonedChunk::getChunkHeaderBuffer() const {
+#ifdef SAUNAFS_HAVE_THREAD_LOCAL
+	static thread_local std::array<uint8_t, kMaxHeaderSize> hdrbuffer;
+	return hdrbuffer.data();
+#else  // SAUNAFS_HAVE_THREAD_LOCAL
+	uint8_t *hdrbuffer =
+	    static_cast<uint8_t *>(pthread_getspecific(hdrbufferkey));
+	if (hdrbuffer == NULL) {
+		hdrbuffer = static_cast<uint8_t *>(malloc(kMaxHeaderSize));
+		passert(hdrbuffer);
+		zassert(pthread_setspecific(hdrbufferkey, hdrbuffer));
+	}
+	return hdrbuffer;
+#endif  // SAUNAFS_HAVE_THREAD_LOCAL
+}
+
+size_t ZonedChunk::getHeaderSize() const {
+	const uint32_t requiredHeaderSize =
+	    kMaxSignatureBlockSize + kCrcSize * maxBlocksInFile();
+
+	if (slice_traits::isStandard(type())) {
+		return requiredHeaderSize;
+	}
+
+	return (requiredHeaderSize + kDiskBlockSize - 1) / kDiskBlockSize *
+	       kDiskBlockSize;
+}
+
+off_t ZonedChunk::getCrcOffset() const { return kMaxSignatureBlockSize; }
+
+void ZonedChunk::shrinkToBlocks(uint16_t newBlocks) { (void)newBlocks; }
+
+bool ZonedChunk::isDirty() { return false; }
+
+std::string ZonedChunk::toString() const {
+	std::stringstream result;
+
+	result << "{id: " << id() << ", version: " << version()
+	       << ", type: " << type().toString() << ", blocks: " << blocks()
+	       << ", extents: " << dataFilename() << "}";
+
+	return result.str();
+}
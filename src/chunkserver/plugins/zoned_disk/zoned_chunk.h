@@ -0,0 +1,72 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include "chunkserver-common/chunk_with_fd.h"
+
+/// Specialization of FDChunk for zoned disks (see ZonedDisk).
+///
+/// The blocks of a ZonedChunk live in the zones of the data device, so its
+/// "data file" is the extent file: a small file next to the metadata file
+/// which stores the location of each block.
+class ZonedChunk : public FDChunk {
+public:
+	explicit ZonedChunk(uint64_t chunkId, ChunkPartType type, ChunkState state);
+
+	// No need to copy or move them so far
+
+	ZonedChunk(const ZonedChunk &) = delete;
+	ZonedChunk(ZonedChunk &&) = delete;
+	ZonedChunk &operator=(const ZonedChunk &) = delete;
+	ZonedChunk &operator=(ZonedChunk &&) = delete;
+
+	~ZonedChunk() override = default;
+
+	/// Generates the name of the extent file for the given version. It is
+	/// placed in the metadata directory, e.g.:
+	/// /mnt/saunafs/meta/nvme0/chunks00/chunk_0000000000000001_00000001.dat
+	std::string generateDataFilenameForVersion(
+	    uint32_t _version) const override;
+
+	/// Renames metadata and extent files according to the new version.
+	int renameChunkFile(uint32_t new_version) override;
+
+	/// Returns a pointer to the buffer containing the Chunk header.
+	/// The returned pointer is assumed to be thread local.
+	uint8_t *getChunkHeaderBuffer() const override;
+
+	/// Returns the Chunk header size: the size of the signature and the CRC
+	/// blocks, rounded up to the disk block size.
+	size_t getHeaderSize() const override;
+
+	/// Returns the offset for the CRC, which is the size of the signature.
+	off_t getCrcOffset() const override;
+
+	/// Does nothing, the blocks are dropped by ZonedDisk::ftruncateData.
+	void shrinkToBlocks(uint16_t newBlocks) override;
+
+	/// Always false, the garbage collector of the Disk takes care of the
+	/// fragmentation of the zones.
+	bool isDirty() override;
+
+	/// String representation of ZonedChunk members, useful for debugging.
+	std::string toString() const override;
+};
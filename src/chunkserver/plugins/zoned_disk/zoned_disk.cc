@@ -0,0 +1,1261 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+
+#include "zoned_disk.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+
+#include "chunkserver-common/chunk_interface.h"
+#include "chunkserver-common/hdd_stats.h"
+#include "chunkserver-common/hdd_utils.h"
+#include "chunkserver-common/subfolder.h"
+#include "common/crc.h"
+#include "common/datapack.h"
+#include "common/saunafs_error_codes.h"
+#include "common/slogger.h"
+#include "zoned_chunk.h"
+
+namespace {
+
+/// Size of the location of one block in the extent files
+constexpr size_t kExtentEntrySize = sizeof(ZoneMap::Location);
+
+/// Time the garbage collector sleeps when there is nothing to do
+constexpr std::chrono::seconds kGarbageCollectionInterval{1};
+
+/// Time a write waits for the garbage collector when all the zones are full
+constexpr std::chrono::seconds kZoneWaitTimeout{5};
+
+/// Opens a zone file for appending. zonefs only accepts direct writes to
+/// sequential zones, but other file systems (e.g. tmpfs) may not support them.
+int openZoneForAppending(const std::string &filename) {
+#ifdef O_DIRECT
+	int fd = ::open(filename.c_str(), O_WRONLY | O_DIRECT);
+	if (fd >= 0 || errno != EINVAL) {
+		return fd;
+	}
+#endif
+	return ::open(filename.c_str(), O_WRONLY);
+}
+
+/// Counts the entries of a directory, 0 if it does not exist
+uint32_t countFiles(const std::string &path) {
+	cdirectory_t directory(::opendir(path.c_str()));
+	uint32_t count = 0;
+
+	if (!directory) {
+		return 0;
+	}
+	while (struct dirent *entry = ::readdir(directory.get())) {
+		if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+			++count;
+		}
+	}
+
+	return count;
+}
+
+/// Reads the block locations stored in an extent file
+bool readExtentFile(const std::string &filename, uint32_t maxBlocks,
+                    std::vector<ZoneMap::Location> &locations) {
+	FileDescriptor fd(::open(filename.c_str(), O_RDONLY));
+	struct stat extentStat {};
+
+	if (!fd.isOpened() || fstat(fd.get(), &extentStat) < 0 ||
+	    !S_ISREG(extentStat.st_mode) ||
+	    extentStat.st_size % kExtentEntrySize != 0 ||
+	    extentStat.st_size / kExtentEntrySize > maxBlocks) {
+		return false;
+	}
+
+	std::vector<uint8_t> buffer(extentStat.st_size);
+	if (::pread(fd.get(), buffer.data(), buffer.size(), 0) != extentStat.st_size) {
+		return false;
+	}
+
+	const uint8_t *source = buffer.data();
+	locations.resize(buffer.size() / kExtentEntrySize);
+	for (auto &location : locations) {
+		location = get64bit(&source);
+	}
+
+	return true;
+}
+
+}  // namespace
+
+ZonedDisk::Appender::Appender(bool _forGarbageCollection)
+    : forGarbageCollection(_forGarbageCollection),
+      buffer(kMaxAppendBlocks * SFSBLOCKSIZE) {}
+
+ZonedDisk::ZonedDisk(const disk::Configuration &configuration)
+    : FDDisk(configuration) {}
+
+ZonedDisk::~ZonedDisk() {
+	{
+		std::lock_guard gcLock(gcMutex_);
+		gcTerminate_ = true;
+	}
+	gcCond_.notify_all();
+
+	if (gcThread_.joinable()) {
+		gcThread_.join();
+	}
+
+	closeZone(writesAppender_);
+	closeZone(gcAppender_);
+}
+
+void ZonedDisk::createPathsAndSubfolders() {
+	bool ret = true;
+
+	constexpr int mode = 0755;
+
+	if (!isMarkedForDeletion()) {
+		ret &= (::mkdir(metaPath().c_str(), mode) == 0);
+
+		for (uint32_t i = 0; i < Subfolder::kNumberOfSubfolders; ++i) {
+			const auto subfolderName =
+			    Subfolder::getSubfolderNameGivenNumber(i);
+			ret &= (::mkdir((metaPath() + subfolderName).c_str(), mode) == 0);
+		}
+	}
+
+	if (ret) {
+		safs_pretty_syslog(LOG_INFO,
+		                   "Folders structures for disk %s "
+		                   "auto-generated succesfully",
+		                   getPaths().c_str());
+	}
+}
+
+void ZonedDisk::createLockFiles(bool isLockNeeded,
+                                std::vector<std::unique_ptr<IDisk>> &allDisks) {
+	createLockFile(isLockNeeded, metaPath() + ".lock", true, allDisks);
+}
+
+std::string ZonedDisk::zoneFilename(uint32_t zone) const {
+	return dataPath() + "seq/" + std::to_string(zone);
+}
+
+void ZonedDisk::loadZones() {
+	zonesLoaded_ = true;
+
+	const uint32_t sequentialZones = countFiles(dataPath() + "seq");
+	const uint32_t conventionalZones = countFiles(dataPath() + "cnv");
+	struct statvfs fsinfo {};
+
+	if (sequentialZones == 0 || statvfs(dataPath().c_str(), &fsinfo) < 0) {
+		safs_pretty_syslog(LOG_ERR,
+		                   "zoned disk %s: no zonefs sequential zones found",
+		                   getPaths().c_str());
+		setIsDamaged(true);
+		return;
+	}
+
+	// zonefs does not tell the capacity of the zones, but they are usually
+	// all the same. The capacity is corrected when a zone refuses an append.
+	const uint64_t totalBytes = static_cast<uint64_t>(fsinfo.f_frsize) *
+	                            static_cast<uint64_t>(fsinfo.f_blocks);
+	zoneCapacity_ =
+	    totalBytes / (sequentialZones + conventionalZones) / SFSBLOCKSIZE;
+
+	std::lock_guard lock(mutex_);
+
+	for (uint32_t zone = 0; zone < sequentialZones; ++zone) {
+		struct stat zoneStat {};
+		if (stat(zoneFilename(zone).c_str(), &zoneStat) < 0) {
+			safs_silent_errlog(LOG_WARNING, "zoned disk %s: can't stat zone %s",
+			                   getPaths().c_str(), zoneFilename(zone).c_str());
+			zoneMap_.addZone(0, 0);  // Never used
+			continue;
+		}
+
+		const uint32_t writePointer = zoneStat.st_size / SFSBLOCKSIZE;
+		// A partially written block (after a crash) can not be appended to
+		const bool isFull = zoneStat.st_size % SFSBLOCKSIZE != 0;
+		zoneMap_.addZone(writePointer, isFull ? writePointer : zoneCapacity_);
+	}
+
+	safs_pretty_syslog(LOG_NOTICE,
+	                   "zoned disk %s: %" PRIu32 " zones of %" PRIu64 " MiB",
+	                   getPaths().c_str(), sequentialZones,
+	                   static_cast<uint64_t>(zoneCapacity_) * SFSBLOCKSIZE >> 20);
+}
+
+void ZonedDisk::refreshDataDiskUsage() {
+	if (!zonesLoaded_) {
+		loadZones();
+	}
+
+	uint64_t capacityBlocks;
+	uint64_t liveBlocks;
+	{
+		std::lock_guard lock(mutex_);
+		capacityBlocks = zoneMap_.capacityBlocks();
+		liveBlocks = zoneMap_.liveBlocksCount();
+	}
+
+	// Garbage is available, the garbage collector reclaims it when needed
+	const uint64_t reservedBlocks =
+	    static_cast<uint64_t>(kReservedZones) * zoneCapacity_;
+	const uint64_t availableBlocks =
+	    capacityBlocks > liveBlocks + reservedBlocks
+	        ? capacityBlocks - liveBlocks - reservedBlocks
+	        : 0;
+
+	setTotalSpace(capacityBlocks * SFSBLOCKSIZE);
+	setAvailableSpace(availableBlocks * SFSBLOCKSIZE);
+
+	if (availableSpace() < leaveFreeSpace()) {
+		setAvailableSpace(0ULL);
+	} else {
+		setAvailableSpace(availableSpace() - leaveFreeSpace());
+	}
+}
+
+int ZonedDisk::updateChunkAttributes(IChunk *chunk, bool isFromScan) {
+	assert(chunk);
+
+	struct stat metaStat {};
+	if (stat(chunk->metaFilename().c_str(), &metaStat) < 0) {
+		return SAUNAFS_ERROR_NOCHUNK;
+	}
+	if ((metaStat.st_mode & S_IFMT) != S_IFREG) {
+		return SAUNAFS_ERROR_NOCHUNK;
+	}
+
+	const auto key = keyOf(chunk);
+
+	if (!isFromScan) {
+		std::lock_guard lock(mutex_);
+		if (zoneMap_.hasChunk(key)) {
+			chunk->setBlocks(zoneMap_.chunkBlocks(key));
+			chunk->setValidAttr(1);
+			return SAUNAFS_STATUS_OK;
+		}
+	}
+
+	std::vector<ZoneMap::Location> locations;
+	if (!readExtentFile(chunk->dataFilename(), chunk->maxBlocksInFile(),
+	                    locations)) {
+		return SAUNAFS_ERROR_NOCHUNK;
+	}
+
+	{
+		std::lock_guard lock(mutex_);
+
+		for (auto location : locations) {
+			if (location == ZoneMap::kHole) {
+				continue;
+			}
+			const uint32_t zone = ZoneMap::zoneOf(location);
+			if (zone >= zoneMap_.zoneCount() ||
+			    ZoneMap::offsetOf(location) >= zoneMap_.writePointer(zone)) {
+				safs_pretty_syslog(LOG_WARNING,
+				                   "zoned disk %s: file %s points to "
+				                   "unwritten blocks",
+				                   getPaths().c_str(),
+				                   chunk->dataFilename().c_str());
+				return SAUNAFS_ERROR_NOCHUNK;
+			}
+		}
+
+		zoneMap_.setChunk(key, locations);
+		extentFiles_[key] = chunk->dataFilename();
+	}
+
+	chunk->setBlocks(locations.size());
+	chunk->setValidAttr(1);
+
+	return SAUNAFS_STATUS_OK;
+}
+
+std::unique_ptr<ChunkSignature> ZonedDisk::createChunkSignature(IChunk *chunk) {
+	return std::make_unique<ChunkSignature>(
+	    ChunkSignature(chunk->id(), chunk->version(), chunk->type()));
+}
+
+std::unique_ptr<ChunkSignature> ZonedDisk::createChunkSignature() {
+	return std::make_unique<ChunkSignature>(ChunkSignature());
+}
+
+void ZonedDisk::serializeEmptyChunkSignature(uint8_t **destination,
+                                             uint64_t chunkId,
+                                             uint32_t chunkVersion,
+                                             ChunkPartType chunkType) {
+	serialize(destination, ChunkSignature(chunkId, chunkVersion, chunkType));
+}
+
+IChunk *ZonedDisk::instantiateNewConcreteChunk(uint64_t chunkId,
+                                               ChunkPartType type) {
+	auto *chunk = new ZonedChunk(chunkId, type, ChunkState::Locked);
+	chunk->setOwner(this);
+
+	return chunk;
+}
+
+void ZonedDisk::setChunkBlocks(IChunk *chunk, uint16_t originalBlocks,
+                               uint16_t newBlocks) {
+	(void)originalBlocks;
+	chunk->setBlocks(newBlocks);
+}
+
+int ZonedDisk::defragmentOrMoveChunk(IChunk *chunk, uint8_t *crcData) {
+	(void)chunk;
+	(void)crcData;
+	return SAUNAFS_STATUS_OK;
+}
+
+void ZonedDisk::updateAfterScan() {
+	if (!gcThread_.joinable()) {
+		gcThread_ = std::thread(&ZonedDisk::collectGarbage, this);
+	}
+}
+
+int ZonedDisk::renameChunkFiles(IChunk *chunk, uint32_t newVersion) {
+	const std::string newMetaFilename =
+	    chunk->generateMetadataFilenameForVersion(newVersion);
+	const std::string newDataFilename =
+	    chunk->generateDataFilenameForVersion(newVersion);
+
+	std::lock_guard lock(mutex_);
+
+	int status = rename(chunk->metaFilename().c_str(), newMetaFilename.c_str());
+	if (status < 0) {
+		return status;
+	}
+
+	status = rename(chunk->dataFilename().c_str(), newDataFilename.c_str());
+	if (status < 0) {
+		return status;
+	}
+
+	chunk->setVersion(newVersion);
+	chunk->setMetaFilename(newMetaFilename);
+	chunk->setDataFilename(newDataFilename);
+
+	auto it = extentFiles_.find(keyOf(chunk));
+	if (it != extentFiles_.end()) {
+		it->second = newDataFilename;
+	}
+
+	return 0;
+}
+
+void ZonedDisk::creat(IChunk *chunk) {
+	chunk->setMetaFD(::open(chunk->metaFilename().c_str(),
+	                        O_RDWR | O_TRUNC | O_CREAT,
+	                        disk::kDefaultOpenMode));
+
+	chunk->setDataFD(::open(chunk->dataFilename().c_str(),
+	                        O_RDWR | O_TRUNC | O_CREAT,
+	                        disk::kDefaultOpenMode));
+
+	std::lock_guard lock(mutex_);
+	zoneMap_.setChunk(keyOf(chunk), {});
+	extentFiles_[keyOf(chunk)] = chunk->dataFilename();
+}
+
+void ZonedDisk::open(IChunk *chunk) {
+	chunk->setMetaFD(::open(chunk->metaFilename().c_str(),
+	                        isReadOnly() ? O_RDONLY : O_RDWR));
+
+	chunk->setDataFD(::open(chunk->dataFilename().c_str(),
+	                        isReadOnly() ? O_RDONLY : O_RDWR));
+}
+
+int ZonedDisk::unlinkChunk(IChunk *chunk) {
+	int result = 0;
+
+	if (::unlink(chunk->metaFilename().c_str()) != 0) {
+		result = -1;
+	}
+
+	if (::unlink(chunk->dataFilename().c_str()) != 0) {
+		result = -1;
+	}
+
+	std::lock_guard lock(mutex_);
+	zoneMap_.removeChunk(keyOf(chunk));
+	extentFiles_.erase(keyOf(chunk));
+	unsyncedExtents_.erase(keyOf(chunk));
+
+	return result;
+}
+
+int ZonedDisk::fsyncChunk(IChunk *chunk) {
+	const int error = syncAppender(writesAppender_);
+
+	if (error != 0) {
+		errno = error;
+		hddAddErrorAndPreserveErrno(chunk);
+		safs_silent_errlog(LOG_WARNING, "fsyncChunk: disk %s - zone sync error",
+		                   getPaths().c_str());
+		errno = error;
+		return SAUNAFS_ERROR_IO;
+	}
+
+	return FDDisk::fsyncChunk(chunk);
+}
+
+int ZonedDisk::ftruncateData(IChunk *chunk, uint64_t size) {
+	const uint64_t blocks = (size + SFSBLOCKSIZE - 1) / SFSBLOCKSIZE;
+
+	if (blocks > chunk->maxBlocksInFile()) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	std::lock_guard lock(mutex_);
+	zoneMap_.resizeChunk(keyOf(chunk), blocks);
+	unsyncedExtents_.insert(keyOf(chunk));
+
+	return ::ftruncate(chunk->dataFD(), blocks * kExtentEntrySize);
+}
+
+ssize_t ZonedDisk::preadData(IChunk *chunk, uint8_t *blockBuffer,
+                             uint64_t size, uint64_t offset) {
+	const auto key = keyOf(chunk);
+	std::shared_lock resetLock(resetMutex_);
+	uint64_t done = 0;
+
+	while (done < size) {
+		const uint64_t position = offset + done;
+		const uint32_t block = position / SFSBLOCKSIZE;
+		const uint32_t offsetInBlock = position % SFSBLOCKSIZE;
+		uint32_t runLength = 1;
+		ZoneMap::Location location;
+
+		{
+			std::lock_guard lock(mutex_);
+			const uint32_t blocks = zoneMap_.chunkBlocks(key);
+			if (block >= blocks) {
+				break;  // End of the Chunk
+			}
+			location = zoneMap_.locate(key, block, &runLength);
+			runLength = std::min(runLength, blocks - block);
+		}
+
+		// Read the blocks stored consecutively at once
+		const uint64_t length = std::min<uint64_t>(
+		    size - done,
+		    static_cast<uint64_t>(runLength) * SFSBLOCKSIZE - offsetInBlock);
+
+		if (location == ZoneMap::kHole) {
+			memset(blockBuffer + done, 0, length);
+			done += length;
+			continue;
+		}
+
+		auto fd = zoneReadFd(ZoneMap::zoneOf(location));
+		ssize_t ret = -1;
+		if (fd) {
+			ret = ::pread(fd->get(), blockBuffer + done, length,
+			              static_cast<uint64_t>(ZoneMap::offsetOf(location)) *
+			                      SFSBLOCKSIZE +
+			                  offsetInBlock);
+		}
+		if (ret <= 0) {
+			if (ret == 0) {
+				errno = EIO;  // The zone is shorter than expected
+			}
+			return done > 0 ? static_cast<ssize_t>(done) : -1;
+		}
+		done += ret;
+	}
+
+	return done;
+}
+
+std::shared_ptr<FileDescriptor> ZonedDisk::zoneReadFd(uint32_t zone) {
+	std::lock_guard lock(readFdsMutex_);
+
+	auto it = readFds_.find(zone);
+	if (it != readFds_.end()) {
+		return it->second;
+	}
+
+	int fd = ::open(zoneFilename(zone).c_str(), O_RDONLY);
+	if (fd < 0) {
+		return nullptr;
+	}
+
+	if (readFds_.size() >= kMaxCachedReadFds) {
+		// Descriptors still in use are closed once released
+		readFds_.erase(readFds_.begin());
+	}
+
+	auto result = std::make_shared<FileDescriptor>(fd);
+	readFds_.emplace(zone, result);
+
+	return result;
+}
+
+void ZonedDisk::prefetchChunkBlocks(IChunk &chunk, uint16_t firstBlock,
+                                    uint32_t blockCount) {
+	(void)chunk;
+	(void)firstBlock;
+	(void)blockCount;
+}
+
+int ZonedDisk::readBlockAndCrc(IChunk *chunk, uint8_t *blockBuffer,
+                               uint8_t *crcData, uint16_t blocknum,
+                               const char *errorMsg) {
+	assert(chunk);
+
+	memcpy(blockBuffer, crcData + blocknum * kCrcSize, kCrcSize);
+
+	{
+		DiskReadStatsUpdater updater(chunk->owner(), SFSBLOCKSIZE);
+		const ssize_t bytesRead =
+		    preadData(chunk, blockBuffer + kCrcSize, SFSBLOCKSIZE,
+		              chunk->getBlockOffset(blocknum));
+		if (bytesRead != SFSBLOCKSIZE) {
+			hddAddErrorAndPreserveErrno(chunk);
+			safs_silent_errlog(LOG_WARNING, "%s: file:%s - read error",
+			                   errorMsg, chunk->metaFilename().c_str());
+			hddReportDamagedChunk(chunk->id(), chunk->type());
+			updater.markReadAsFailed();
+
+			return -SAUNAFS_ERROR_IO;
+		}
+	}
+
+	return SFSBLOCKSIZE;
+}
+
+int ZonedDisk::overwriteChunkVersion(IChunk *chunk, uint32_t newVersion) {
+	assert(chunk);
+
+	std::vector<uint8_t> buffer;
+	serialize(buffer, newVersion);
+	const ssize_t size = buffer.size();
+
+	{
+		DiskWriteStatsUpdater updater(chunk->owner(), size);
+
+		if (pwrite(chunk->metaFD(), buffer.data(), size,
+		           ChunkSignature::kVersionOffset) != size) {
+			updater.markWriteAsFailed();
+			return SAUNAFS_ERROR_IO;
+		}
+	}
+
+	HddStats::overheadWrite(size);
+
+	chunk->setVersion(newVersion);
+	chunk->updateFilenamesFromVersion(newVersion);
+
+	return SAUNAFS_STATUS_OK;
+}
+
+int ZonedDisk::writePartialBlockAndCrc(IChunk *chunk, const uint8_t *buffer,
+                                       uint32_t offsetInBlock, uint32_t size,
+                                       const uint8_t *crcBuff, uint8_t *crcData,
+                                       uint16_t blockNum, bool isNewBlock,
+                                       const char *errorMsg) {
+	const uint8_t *block = buffer;
+
+	if (offsetInBlock != 0 || size != SFSBLOCKSIZE) {
+		// Zones can not be overwritten, the whole block is appended again
+		uint8_t *dataInBuffer = getChunkBlockBuffer() + kCrcSize;
+
+		if (isNewBlock) {
+			memset(dataInBuffer, 0, SFSBLOCKSIZE);
+		} else if (preadData(chunk, dataInBuffer, SFSBLOCKSIZE,
+		                     chunk->getBlockOffset(blockNum)) != SFSBLOCKSIZE) {
+			hddAddErrorAndPreserveErrno(chunk);
+			safs_silent_errlog(LOG_WARNING, "%s: file:%s - read error",
+			                   errorMsg, chunk->metaFilename().c_str());
+			hddReportDamagedChunk(chunk->id(), chunk->type());
+			return -1;
+		}
+
+		memcpy(dataInBuffer + offsetInBlock, buffer, size);
+		block = dataInBuffer;
+	}
+
+	if (appendChunkBlocks(chunk, blockNum, &block, 1) != SAUNAFS_STATUS_OK) {
+		return -1;
+	}
+
+	memcpy(crcData + blockNum * kCrcSize, crcBuff, kCrcSize);
+
+	return size;
+}
+
+int ZonedDisk::writeChunkBlock(IChunk *chunk, uint32_t version,
+                               uint16_t blocknum, uint32_t offsetInBlock,
+                               uint32_t size, uint32_t crc, uint8_t *crcData,
+                               const uint8_t *buffer) {
+	assert(chunk);
+
+	if (chunk->version() != version && version > 0) {
+		return SAUNAFS_ERROR_WRONGVERSION;
+	}
+	if (blocknum >= chunk->maxBlocksInFile()) {
+		return SAUNAFS_ERROR_BNUMTOOBIG;
+	}
+	if (size > SFSBLOCKSIZE) {
+		return SAUNAFS_ERROR_WRONGSIZE;
+	}
+	if ((offsetInBlock >= SFSBLOCKSIZE) ||
+	    (offsetInBlock + size > SFSBLOCKSIZE)) {
+		return SAUNAFS_ERROR_WRONGOFFSET;
+	}
+	if (crc != mycrc32(0, buffer, size)) {
+		return SAUNAFS_ERROR_CRC;
+	}
+
+	chunk->setWasChanged(1U);
+
+	const uint16_t prevBlocks = chunk->blocks();
+	const uint8_t *block = buffer;
+	uint32_t blockCrc = crc;
+
+	if (offsetInBlock != 0 || size != SFSBLOCKSIZE) {
+		// Merge the new data with the current content of the block
+		uint8_t *crcAndBlockbuffer = getChunkBlockBuffer();
+		uint8_t *dataInBuffer = crcAndBlockbuffer + kCrcSize;  // Skip crc
+
+		if (blocknum < prevBlocks) {  // It is an existing block
+			if (readBlockAndCrc(chunk, crcAndBlockbuffer, crcData, blocknum,
+			                    "writeChunkBlock") < 0) {
+				return SAUNAFS_ERROR_IO;
+			}
+
+			const uint8_t *crcBuffPointer = crcAndBlockbuffer;
+			if (get32bit(&crcBuffPointer) !=
+			    mycrc32(0, dataInBuffer, SFSBLOCKSIZE)) {
+				errno = 0;
+				hddAddErrorAndPreserveErrno(chunk);
+				safs_pretty_syslog(LOG_WARNING,
+				                   "writeChunkBlock: file:%s - crc error",
+				                   chunk->metaFilename().c_str());
+				hddReportDamagedChunk(chunk->id(), chunk->type());
+				return SAUNAFS_ERROR_CRC;
+			}
+		} else {  // It is a new block at the end
+			memset(dataInBuffer, 0, SFSBLOCKSIZE);
+		}
+
+		memcpy(dataInBuffer + offsetInBlock, buffer, size);
+		block = dataInBuffer;
+		blockCrc = mycrc32(0, dataInBuffer, SFSBLOCKSIZE);
+	}
+
+	int status = appendChunkBlocks(chunk, blocknum, &block, 1);
+	if (status != SAUNAFS_STATUS_OK) {
+		return status;
+	}
+
+	if (blocknum >= prevBlocks) {
+		// Fill new blocks' CRCs with empty data
+		for (uint16_t i = prevBlocks; i < blocknum; i++) {
+			memcpy(crcData + i * kCrcSize, &gEmptyBlockCrc, kCrcSize);
+		}
+		chunk->setBlocks(blocknum + 1);
+	}
+
+	uint8_t *crcPointer = crcData + blocknum * kCrcSize;
+	put32bit(&crcPointer, blockCrc);
+
+	return SAUNAFS_STATUS_OK;
+}
+
+int ZonedDisk::writeChunkBlocks(IChunk *chunk, uint32_t version,
+                                const ChunkBlockWrite *writes, uint32_t count,
+                                uint8_t *crcData) {
+	assert(chunk);
+	assert(count > 0);
+
+	if (chunk->version() != version && version > 0) {
+		return SAUNAFS_ERROR_WRONGVERSION;
+	}
+
+	const uint16_t firstBlock = writes[0].blocknum;
+	if (firstBlock + count > chunk->maxBlocksInFile()) {
+		return SAUNAFS_ERROR_BNUMTOOBIG;
+	}
+
+	std::vector<const uint8_t *> blocks(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		assert(writes[i].blocknum == firstBlock + i);
+		if (writes[i].offsetInBlock != 0 || writes[i].size != SFSBLOCKSIZE) {
+			return SAUNAFS_ERROR_WRONGSIZE;
+		}
+		if (writes[i].crc != mycrc32(0, writes[i].buffer, SFSBLOCKSIZE)) {
+			return SAUNAFS_ERROR_CRC;
+		}
+		blocks[i] = writes[i].buffer;
+	}
+
+	chunk->setWasChanged(1U);
+
+	int status = appendChunkBlocks(chunk, firstBlock, blocks.data(), count);
+	if (status != SAUNAFS_STATUS_OK) {
+		return status;
+	}
+
+	const uint16_t lastBlock = firstBlock + count - 1;
+	if (lastBlock >= chunk->blocks()) {
+		// Fill new blocks' CRCs with empty data
+		for (uint16_t i = chunk->blocks(); i < firstBlock; i++) {
+			memcpy(crcData + i * kCrcSize, &gEmptyBlockCrc, kCrcSize);
+		}
+		chunk->setBlocks(lastBlock + 1);
+	}
+
+	for (uint32_t i = 0; i < count; ++i) {
+		uint8_t *crcPointer = crcData + writes[i].blocknum * kCrcSize;
+		put32bit(&crcPointer, writes[i].crc);
+	}
+
+	return SAUNAFS_STATUS_OK;
+}
+
+int ZonedDisk::writeChunkData(IChunk *chunk, uint8_t *blockBuffer,
+                              int32_t blockSize, off64_t offset) {
+	if (blockSize <= 0 || blockSize % SFSBLOCKSIZE != 0 ||
+	    offset % SFSBLOCKSIZE != 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	std::vector<const uint8_t *> blocks(blockSize / SFSBLOCKSIZE);
+	for (size_t i = 0; i < blocks.size(); ++i) {
+		blocks[i] = blockBuffer + i * SFSBLOCKSIZE;
+	}
+
+	if (appendChunkBlocks(chunk, offset / SFSBLOCKSIZE, blocks.data(),
+	                      blocks.size()) != SAUNAFS_STATUS_OK) {
+		return -1;
+	}
+
+	return blockSize;
+}
+
+int ZonedDisk::appendChunkBlocks(IChunk *chunk, uint16_t firstBlock,
+                                 const uint8_t *const *blocks, uint32_t count) {
+	AppendRequest request{blocks, count, {}};
+
+	{
+		DiskWriteStatsUpdater updater(chunk->owner(),
+		                              static_cast<uint64_t>(count) *
+		                                  SFSBLOCKSIZE);
+		const int error = append(writesAppender_, request);
+
+		if (error != 0) {
+			errno = error;
+			hddAddErrorAndPreserveErrno(chunk);
+			safs_silent_errlog(LOG_WARNING,
+			                   "appendChunkBlocks: file:%s - write error",
+			                   chunk->metaFilename().c_str());
+			updater.markWriteAsFailed();
+
+			if (error == ENOSPC) {
+				return SAUNAFS_ERROR_NOSPACE;
+			}
+			hddReportDamagedChunk(chunk->id(), chunk->type());
+			return SAUNAFS_ERROR_IO;
+		}
+	}
+
+	std::vector<uint8_t> entries(count * kExtentEntrySize);
+	uint8_t *entry = entries.data();
+	for (auto location : request.locations) {
+		put64bit(&entry, location);
+	}
+
+	const auto key = keyOf(chunk);
+	std::lock_guard lock(mutex_);
+
+	uint32_t first = 0;
+	while (first < count) {
+		// Blocks appended consecutively to the same zone form one extent
+		uint32_t runLength = 1;
+		while (first + runLength < count &&
+		       request.locations[first + runLength] ==
+		           request.locations[first] + runLength &&
+		       ZoneMap::zoneOf(request.locations[first + runLength]) ==
+		           ZoneMap::zoneOf(request.locations[first])) {
+			++runLength;
+		}
+		zoneMap_.assign(key, firstBlock + first, runLength,
+		                request.locations[first]);
+		first += runLength;
+	}
+	unsyncedExtents_.insert(key);
+
+	if (pwrite(chunk->dataFD(), entries.data(), entries.size(),
+	           static_cast<off_t>(firstBlock) * kExtentEntrySize) !=
+	    static_cast<ssize_t>(entries.size())) {
+		hddAddErrorAndPreserveErrno(chunk);
+		safs_silent_errlog(LOG_WARNING,
+		                   "appendChunkBlocks: file:%s - extent write error",
+		                   chunk->dataFilename().c_str());
+		hddReportDamagedChunk(chunk->id(), chunk->type());
+		return SAUNAFS_ERROR_IO;
+	}
+
+	HddStats::overheadWrite(entries.size());
+
+	return SAUNAFS_STATUS_OK;
+}
+
+int ZonedDisk::append(Appender &appender, AppendRequest &request) {
+	std::unique_lock lock(appender.mutex);
+
+	appender.queue.push_back(&request);
+	appender.cond.wait(
+	    lock, [&] { return request.done || !appender.isWriting; });
+	if (request.done) {
+		return request.error;
+	}
+
+	// Append the blocks of all the waiting writers at once
+	std::vector<AppendRequest *> requests;
+	requests.swap(appender.queue);
+	appender.isWriting = true;
+	lock.unlock();
+
+	appendRequests(appender, requests);
+
+	lock.lock();
+	appender.isWriting = false;
+	for (auto *appended : requests) {
+		appended->done = true;
+	}
+	lock.unlock();
+	appender.cond.notify_all();
+
+	return request.error;
+}
+
+void ZonedDisk::appendRequests(Appender &appender,
+                               const std::vector<AppendRequest *> &requests) {
+	// Each block to append, as its request and index in the request
+	std::vector<std::pair<AppendRequest *, uint32_t>> blocks;
+	for (auto *request : requests) {
+		request->locations.assign(request->count, ZoneMap::kHole);
+		for (uint32_t i = 0; i < request->count; ++i) {
+			blocks.emplace_back(request, i);
+		}
+	}
+
+	size_t done = 0;
+	while (done < blocks.size()) {
+		int error = openZone(appender);
+		if (error != 0) {
+			for (size_t i = done; i < blocks.size(); ++i) {
+				blocks[i].first->error = error;
+			}
+			return;
+		}
+
+		const auto zone = static_cast<uint32_t>(appender.zone);
+		uint32_t writePointer;
+		uint32_t room;
+		{
+			std::lock_guard lock(mutex_);
+			writePointer = zoneMap_.writePointer(zone);
+			room = zoneMap_.room(zone);
+		}
+
+		const uint32_t count = std::min<size_t>(
+		    {blocks.size() - done, room, kMaxAppendBlocks});
+		for (uint32_t i = 0; i < count; ++i) {
+			const auto &[request, index] = blocks[done + i];
+			memcpy(appender.buffer.data() + i * SFSBLOCKSIZE,
+			       request->blocks[index], SFSBLOCKSIZE);
+		}
+
+		const ssize_t ret =
+		    ::pwrite(appender.fd->get(), appender.buffer.data(),
+		             static_cast<size_t>(count) * SFSBLOCKSIZE,
+		             static_cast<off_t>(writePointer) * SFSBLOCKSIZE);
+		error = errno;
+		const uint32_t written = ret > 0 ? ret / SFSBLOCKSIZE : 0;
+
+		{
+			std::lock_guard lock(mutex_);
+			zoneMap_.advance(zone, written);
+			if (written < count) {
+				// Zone capacity reached (or write error), or a partially
+				// written block: this zone can not be appended to anymore
+				zoneMap_.setFull(zone);
+			}
+		}
+
+		for (uint32_t i = 0; i < written; ++i) {
+			const auto &[request, index] = blocks[done + i];
+			request->locations[index] =
+			    ZoneMap::makeLocation(zone, writePointer + i);
+		}
+		done += written;
+		appender.needsSync = true;
+
+		if (written == count && written < room) {
+			continue;
+		}
+
+		closeZone(appender);
+
+		if (ret < 0 && error != EFBIG && error != ENOSPC) {
+			safs_silent_errlog(LOG_WARNING, "zoned disk %s: zone %s - write error",
+			                   getPaths().c_str(), zoneFilename(zone).c_str());
+			for (size_t i = done; i < blocks.size(); ++i) {
+				blocks[i].first->error = error;
+			}
+			return;
+		}
+	}
+}
+
+int ZonedDisk::openZone(Appender &appender) {
+	if (appender.zone >= 0) {
+		return 0;
+	}
+
+	std::optional<uint32_t> zone;
+	{
+		std::unique_lock lock(mutex_);
+		zone = zoneMap_.openZone(appender.forGarbageCollection);
+
+		if (!zone && !appender.forGarbageCollection) {
+			// Give the garbage collector a chance to reset some zones
+			gcCond_.notify_one();
+			zonesCond_.wait_for(lock, kZoneWaitTimeout, [&] {
+				zone = zoneMap_.openZone(false);
+				return zone.has_value();
+			});
+		}
+	}
+
+	if (!zone) {
+		gcCond_.notify_one();
+		return ENOSPC;
+	}
+
+	int fd = openZoneForAppending(zoneFilename(*zone));
+	if (fd < 0) {
+		int error = errno;
+		safs_silent_errlog(LOG_WARNING, "zoned disk %s: can't open zone %s",
+		                   getPaths().c_str(), zoneFilename(*zone).c_str());
+		std::lock_guard lock(mutex_);
+		zoneMap_.setFull(*zone);  // Do not try it again
+		zoneMap_.closeZone(*zone);
+		return error;
+	}
+
+	std::lock_guard lock(appender.mutex);
+	appender.zone = *zone;
+	appender.fd = std::make_shared<FileDescriptor>(fd);
+
+	return 0;
+}
+
+void ZonedDisk::closeZone(Appender &appender) {
+	if (appender.zone < 0) {
+		return;
+	}
+
+	// Sync before closing, nobody knows about this zone afterwards
+	if (::fdatasync(appender.fd->get()) < 0) {
+		appender.syncError = errno;
+		safs_silent_errlog(LOG_WARNING, "zoned disk %s: zone %s - sync error",
+		                   getPaths().c_str(),
+		                   zoneFilename(appender.zone).c_str());
+	}
+
+	{
+		std::lock_guard lock(mutex_);
+		zoneMap_.closeZone(appender.zone);
+	}
+
+	std::lock_guard lock(appender.mutex);
+	appender.zone = -1;
+	appender.fd.reset();
+}
+
+int ZonedDisk::syncAppender(Appender &appender) {
+	const int error = appender.syncError.exchange(0);
+	if (error != 0) {
+		return error;
+	}
+
+	if (!appender.needsSync.exchange(false)) {
+		return 0;
+	}
+
+	std::shared_ptr<FileDescriptor> fd;
+	{
+		std::lock_guard lock(appender.mutex);
+		fd = appender.fd;
+	}
+
+	if (fd && ::fdatasync(fd->get()) < 0) {
+		appender.needsSync = true;
+		return errno;
+	}
+
+	return 0;
+}
+
+void ZonedDisk::collectGarbage() {
+	std::unique_lock gcLock(gcMutex_);
+
+	while (!gcTerminate_) {
+		gcLock.unlock();
+
+		std::vector<uint32_t> garbageZones;
+		std::optional<uint32_t> victim;
+		{
+			std::lock_guard lock(mutex_);
+			garbageZones = zoneMap_.garbageZones();
+
+			// Collect only when running out of empty zones, to move as few
+			// blocks as possible
+			const uint32_t minEmptyZones = std::max(
+			    kMinEmptyZones,
+			    zoneMap_.zoneCount() * kMinEmptyZonesPercent / 100);
+			if (zoneMap_.emptyZones() + garbageZones.size() < minEmptyZones) {
+				victim = zoneMap_.collectionVictim();
+			}
+		}
+
+		bool progress = false;
+		for (auto zone : garbageZones) {
+			progress |= resetZone(zone);
+		}
+		if (victim) {
+			progress |= relocateZone(*victim);
+		}
+
+		gcLock.lock();
+		if (!progress) {
+			gcCond_.wait_for(gcLock, kGarbageCollectionInterval);
+		}
+	}
+}
+
+bool ZonedDisk::relocateZone(uint32_t zone) {
+	std::vector<ZoneMap::LiveBlock> liveBlocks;
+	{
+		std::lock_guard lock(mutex_);
+		liveBlocks = zoneMap_.liveBlocks(zone);
+	}
+
+	auto fd = zoneReadFd(zone);
+	if (!fd) {
+		safs_silent_errlog(LOG_WARNING, "zoned disk %s: can't open zone %s",
+		                   getPaths().c_str(), zoneFilename(zone).c_str());
+		return false;
+	}
+
+	std::vector<uint8_t> buffer(kMaxAppendBlocks * SFSBLOCKSIZE);
+	std::vector<const uint8_t *> blocks;
+
+	for (size_t first = 0; first < liveBlocks.size();
+	     first += kMaxAppendBlocks) {
+		const uint32_t count =
+		    std::min<size_t>(kMaxAppendBlocks, liveBlocks.size() - first);
+
+		blocks.clear();
+		for (uint32_t i = 0; i < count; ++i) {
+			uint8_t *block = buffer.data() + i * SFSBLOCKSIZE;
+			if (::pread(fd->get(), block, SFSBLOCKSIZE,
+			            static_cast<off_t>(ZoneMap::offsetOf(
+			                liveBlocks[first + i].location)) *
+			                SFSBLOCKSIZE) != SFSBLOCKSIZE) {
+				safs_silent_errlog(LOG_WARNING,
+				                   "zoned disk %s: zone %s - read error",
+				                   getPaths().c_str(),
+				                   zoneFilename(zone).c_str());
+				return false;
+			}
+			blocks.push_back(block);
+		}
+		HddStats::overheadRead(static_cast<uint64_t>(count) * SFSBLOCKSIZE);
+
+		// The copies must be durable before the extent files point to them
+		AppendRequest request{blocks.data(), count, {}};
+		int error = append(gcAppender_, request);
+		if (error == 0) {
+			error = syncAppender(gcAppender_);
+		}
+		if (error != 0) {
+			errno = error;
+			safs_silent_errlog(LOG_WARNING,
+			                   "zoned disk %s: can't relocate zone %s",
+			                   getPaths().c_str(), zoneFilename(zone).c_str());
+			return false;
+		}
+		HddStats::overheadWrite(static_cast<uint64_t>(count) * SFSBLOCKSIZE);
+
+		// Blocks rewritten or removed meanwhile are not relocated, their new
+		// copies are garbage already
+		std::map<ChunkKey, int> extentFds;
+		bool failed = false;
+		{
+			std::lock_guard lock(mutex_);
+			for (uint32_t i = 0; i < count; ++i) {
+				const auto &liveBlock = liveBlocks[first + i];
+				if (!zoneMap_.relocate(liveBlock.chunk, liveBlock.block,
+				                       liveBlock.location,
+				                       request.locations[i])) {
+					continue;
+				}
+
+				auto it = extentFds.find(liveBlock.chunk);
+				if (it == extentFds.end()) {
+					it = extentFds
+					         .emplace(liveBlock.chunk,
+					                  ::open(extentFiles_[liveBlock.chunk]
+					                             .c_str(),
+					                         O_WRONLY))
+					         .first;
+				}
+
+				std::array<uint8_t, kExtentEntrySize> entry{};
+				uint8_t *entryPointer = entry.data();
+				put64bit(&entryPointer, request.locations[i]);
+				if (it->second < 0 ||
+				    ::pwrite(it->second, entry.data(), entry.size(),
+				             static_cast<off_t>(liveBlock.block) *
+				                 kExtentEntrySize) !=
+				        static_cast<ssize_t>(entry.size())) {
+					failed = true;
+				}
+			}
+		}
+
+		for (auto &[chunk, extentFd] : extentFds) {
+			if (extentFd >= 0) {
+				failed |= ::fsync(extentFd) < 0;
+				::close(extentFd);
+			}
+		}
+
+		if (failed) {
+			// The zone is not reset, the old copies are still valid
+			safs_silent_errlog(LOG_WARNING,
+			                   "zoned disk %s: can't update extent files",
+			                   getPaths().c_str());
+			return false;
+		}
+	}
+
+	return resetZone(zone);
+}
+
+bool ZonedDisk::syncExtentFiles() {
+	// The new copies must be durable before the extent files pointing to them
+	const int error = syncAppender(writesAppender_);
+	if (error != 0) {
+		// Keep it for the next fsyncChunk, which reports it to its writer
+		int expected = 0;
+		writesAppender_.syncError.compare_exchange_strong(expected, error);
+		errno = error;
+		safs_silent_errlog(LOG_WARNING, "zoned disk %s: zone sync error",
+		                   getPaths().c_str());
+		return false;
+	}
+
+	std::set<ChunkKey> chunks;
+	std::vector<std::string> filenames;
+	{
+		std::lock_guard lock(mutex_);
+		chunks.swap(unsyncedExtents_);
+		for (const auto &chunk : chunks) {
+			auto it = extentFiles_.find(chunk);
+			if (it != extentFiles_.end()) {
+				filenames.push_back(it->second);
+			}
+		}
+	}
+
+	bool failed = false;
+	for (const auto &filename : filenames) {
+		// A file renamed meanwhile is not found, it is synced the next time
+		FileDescriptor fd(::open(filename.c_str(), O_RDONLY));
+		if (!fd.isOpened() || ::fsync(fd.get()) < 0) {
+			safs_silent_errlog(LOG_WARNING,
+			                   "zoned disk %s: can't sync extent file %s",
+			                   getPaths().c_str(), filename.c_str());
+			failed = true;
+		}
+	}
+
+	if (failed) {
+		std::lock_guard lock(mutex_);
+		unsyncedExtents_.insert(chunks.begin(), chunks.end());
+		return false;
+	}
+
+	return true;
+}
+
+bool ZonedDisk::resetZone(uint32_t zone) {
+	{
+		std::lock_guard lock(mutex_);
+		if (!zoneMap_.liveBlocks(zone).empty()) {
+			return false;
+		}
+	}
+
+	// After a crash, the extent files must not point to the old copies of the
+	// blocks in the zone, they are lost once it is reset
+	if (!syncExtentFiles()) {
+		return false;
+	}
+
+	{
+		// Wait for the readers which may still use old locations in the zone
+		std::unique_lock resetLock(resetMutex_);
+		FileDescriptor fd(::open(zoneFilename(zone).c_str(), O_WRONLY));
+
+		// Truncating a sequential zone file of zonefs resets the zone
+		if (!fd.isOpened() || ::ftruncate(fd.get(), 0) < 0) {
+			safs_silent_errlog(LOG_WARNING,
+			                   "zoned disk %s: can't reset zone %s",
+			                   getPaths().c_str(), zoneFilename(zone).c_str());
+			return false;
+		}
+	}
+
+	{
+		std::lock_guard lock(mutex_);
+		zoneMap_.resetZone(zone);
+	}
+	zonesCond_.notify_all();
+	setNeedRefresh(true);
+
+	return true;
+}
@@ -0,0 +1,298 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <optional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "chunkserver-common/chunk_interface.h"
+#include "chunkserver-common/disk_with_fd.h"
+#include "chunkserver/aligned_allocator.h"
+#include "common/cwrap.h"
+#include "zone_map.h"
+
+/**
+ * ZonedDisk stores Chunks in a zoned device (SMR drive, ZNS SSD) mounted with
+ * zonefs, using a log-structured layout.
+ *
+ * The hdd.cfg line of a ZonedDisk looks like:
+ * zonefs:/mnt/saunafs/meta/nvme1 | /mnt/saunafs/data/smr1
+ * The metadata path is a conventional directory, preferably on a fast device,
+ * and the data path is the zonefs mount point, whose sequential zone files
+ * (seq/0, seq/1, ...) hold the blocks.
+ *
+ * Blocks are never written in place: they are appended to an open zone and the
+ * location of each block is kept in the extent file of the Chunk, in the
+ * metadata directory, and in memory (ZoneMap). Concurrent writes of all the
+ * Chunks are merged into a single sequential append. A garbage collection
+ * thread moves the live blocks out of zones holding mostly old copies of
+ * rewritten or deleted blocks and resets them, so that they can be reused.
+ */
+class ZonedDisk : public FDDisk {
+public:
+	/// Constructs a Disk from a Configuration object read from hdd.cfg and
+	/// assigns default values.
+	explicit ZonedDisk(const disk::Configuration &configuration);
+
+	// No need to copy or move them so far
+
+	ZonedDisk(const ZonedDisk &) = delete;
+	ZonedDisk(ZonedDisk &&) = delete;
+	ZonedDisk &operator=(const ZonedDisk &) = delete;
+	ZonedDisk &operator=(ZonedDisk &&) = delete;
+
+	/// Stops the garbage collection thread
+	~ZonedDisk() override;
+
+	/// Creates the metadata path and its subfolders. zonefs does not allow
+	/// creating anything in the data path.
+	void createPathsAndSubfolders() override;
+
+	/// Creates the lock file for the metadata directory
+	void createLockFiles(
+	    bool isLockNeeded,
+	    std::vector<std::unique_ptr<IDisk>> &allDisks) override;
+
+	/// Finds the zones on the first call and updates the disk usage
+	/// information, counting the garbage as available space.
+	///
+	/// No locks inside, should be locked by caller.
+	void refreshDataDiskUsage() override;
+
+	// Chunk operations
+
+	/// Reads the extent file of the Chunk (when scanning or if not known yet)
+	/// and updates the Chunk attributes
+	int updateChunkAttributes(IChunk *chunk, bool isFromScan) override;
+
+	std::unique_ptr<ChunkSignature> createChunkSignature(
+	    IChunk *chunk) override;
+
+	std::unique_ptr<ChunkSignature> createChunkSignature() override;
+
+	void serializeEmptyChunkSignature(uint8_t **destination, uint64_t chunkId,
+	                                  uint32_t chunkVersion,
+	                                  ChunkPartType chunkType) override;
+
+	/// Instantiates a new ZonedChunk. The ChunkState is CH_LOCKED by default.
+	IChunk *instantiateNewConcreteChunk(uint64_t chunkId,
+	                                    ChunkPartType type) override;
+
+	void setChunkBlocks(IChunk *chunk, uint16_t originalBlocks,
+	                    uint16_t newBlocks) override;
+
+	/// Nothing to do, the garbage collector compacts the zones
+	int defragmentOrMoveChunk(IChunk *chunk, uint8_t *crcData) override;
+
+	/// Starts the garbage collection, once the blocks in use are known
+	void updateAfterScan() override;
+
+	/// Renames the metadata and extent files of the Chunk for the new version
+	int renameChunkFiles(IChunk *chunk, uint32_t newVersion);
+
+	// IO
+
+	/// Creates the metadata and extent files for this Chunk and opens them
+	void creat(IChunk *chunk) override;
+
+	/// Opens the metadata and extent files for this Chunk
+	void open(IChunk *chunk) override;
+
+	/// Removes the Chunk files, its blocks become garbage
+	int unlinkChunk(IChunk *chunk) override;
+
+	/// Syncs the open zones, then the metadata and extent files
+	int fsyncChunk(IChunk *chunk) override;
+
+	/// Truncates (or extends with holes) the Chunk to the block containing
+	/// size
+	int ftruncateData(IChunk *chunk, uint64_t size) override;
+
+	/// Reads from the zones holding the requested blocks, offset is the offset
+	/// in the Chunk data. Holes are read as zeros.
+	ssize_t preadData(IChunk *chunk, uint8_t *blockBuffer, uint64_t size,
+	                  uint64_t offset) override;
+
+	/// Does nothing, zoned Disks are not read ahead
+	void prefetchChunkBlocks(IChunk &chunk, uint16_t firstBlock,
+	                         uint32_t blockCount) override;
+
+	/// Reads the CRC and the data for exactly one block
+	int readBlockAndCrc(IChunk *chunk, uint8_t *blockBuffer, uint8_t *crcData,
+	                    uint16_t blocknum, const char *errorMsg) override;
+
+	/// Overwrites the Chunk version in the metadata file and in memory
+	int overwriteChunkVersion(IChunk *chunk, uint32_t newVersion) override;
+
+	/// Appends the block with the given part replaced, and updates its CRC
+	int writePartialBlockAndCrc(IChunk *chunk, const uint8_t *buffer,
+	                            uint32_t offsetInBlock, uint32_t size,
+	                            const uint8_t *crcBuff, uint8_t *crcData,
+	                            uint16_t blockNum, bool isNewBlock,
+	                            const char *errorMsg) override;
+
+	/// Writes a Chunk block, a partial one is merged with the current content
+	/// first
+	int writeChunkBlock(IChunk *chunk, uint32_t version, uint16_t blocknum,
+	                    uint32_t offsetInBlock, uint32_t size, uint32_t crc,
+	                    uint8_t *crcData, const uint8_t *buffer) override;
+
+	/// Appends a run of complete, consecutive Chunk blocks at once
+	int writeChunkBlocks(IChunk *chunk, uint32_t version,
+	                     const ChunkBlockWrite *writes, uint32_t count,
+	                     uint8_t *crcData) override;
+
+	/// Writes complete blocks at the block aligned offset
+	int writeChunkData(IChunk *chunk, uint8_t *blockBuffer, int32_t blockSize,
+	                   off64_t offset) override;
+
+private:
+	/// Blocks appended at once, also the size of the batches of the garbage
+	/// collector
+	static constexpr uint32_t kMaxAppendBlocks = 64;
+	/// Empty zones which only the garbage collector may use
+	static constexpr uint32_t kReservedZones = 1;
+	/// The garbage collector runs while fewer zones are empty, unless the
+	/// given percentage of zones is more
+	static constexpr uint32_t kMinEmptyZones = 4;
+	static constexpr uint32_t kMinEmptyZonesPercent = 2;
+	/// Read descriptors of zone files kept open
+	static constexpr size_t kMaxCachedReadFds = 256;
+
+	/// Blocks to be appended by one writer, see append
+	struct AppendRequest {
+		const uint8_t *const *blocks;  ///< Pointers to the blocks to append
+		uint32_t count;                ///< Number of blocks
+		/// Where each block was appended
+		std::vector<ZoneMap::Location> locations;
+		int error = 0;      ///< errno of the failed append, 0 on success
+		bool done = false;  ///< Set once appended (or failed)
+	};
+
+	/// Appends to one open zone, merging the requests of concurrent writers.
+	struct Appender {
+		explicit Appender(bool forGarbageCollection);
+
+		const bool forGarbageCollection;
+		std::mutex mutex;  ///< Protects the queue and isWriting
+		std::condition_variable cond;
+		std::vector<AppendRequest *> queue;  ///< Waiting for the next append
+		bool isWriting = false;  ///< A writer is appending the queued requests
+
+		// Only used by the writer which is appending
+
+		int64_t zone = -1;  ///< The open zone, -1 if none
+		/// Write descriptor of the open zone, shared with fsyncChunk
+		std::shared_ptr<FileDescriptor> fd;
+		/// Blocks being appended, aligned for direct I/O
+		std::vector<uint8_t, AlignedAllocator<uint8_t, disk::kIoBlockSize>>
+		    buffer;
+		std::atomic<bool> needsSync{false};  ///< Appended since last sync
+		/// errno of a failed sync when closing a zone, reported by syncAppender
+		std::atomic<int> syncError{0};
+	};
+
+	using ChunkKey = ZoneMap::ChunkKey;
+
+	static ChunkKey keyOf(const IChunk *chunk) {
+		return {chunk->id(), chunk->type()};
+	}
+
+	/// Returns the name of the file of the zone
+	std::string zoneFilename(uint32_t zone) const;
+	/// Finds the zone files and their write pointers
+	void loadZones();
+	/// Returns a read descriptor of the zone file, from a small cache
+	std::shared_ptr<FileDescriptor> zoneReadFd(uint32_t zone);
+
+	/// Appends the blocks, returns errno on failure
+	int append(Appender &appender, AppendRequest &request);
+	/// Appends the blocks of the requests to the open zone, opening a new
+	/// zone when it gets full
+	void appendRequests(Appender &appender,
+	                    const std::vector<AppendRequest *> &requests);
+	/// Opens a zone to append to if there is no open one, waiting a bit for
+	/// the garbage collector if all are full. Returns errno on failure.
+	int openZone(Appender &appender);
+	/// Syncs and closes the open zone
+	void closeZone(Appender &appender);
+	/// Makes the appended blocks durable
+	int syncAppender(Appender &appender);
+
+	/// Appends the blocks of the Chunk from firstBlock and records their new
+	/// locations in memory and in the extent file
+	int appendChunkBlocks(IChunk *chunk, uint16_t firstBlock,
+	                      const uint8_t *const *blocks, uint32_t count);
+
+	/// Body of the garbage collection thread
+	void collectGarbage();
+	/// Moves the live blocks of the zone to another one and resets it.
+	/// Returns false if it failed.
+	bool relocateZone(uint32_t zone);
+	/// Makes the extent files changed since the last call durable, with the
+	/// blocks they point to. Returns false if it failed.
+	bool syncExtentFiles();
+	/// Empties the zone on the device and in memory
+	bool resetZone(uint32_t zone);
+
+	/// Blocks, extents and zones. Protected by mutex_.
+	ZoneMap zoneMap_{kReservedZones};
+	/// Extent filename of each known Chunk, needed to persist relocations.
+	/// Protected by mutex_.
+	std::map<ChunkKey, std::string> extentFiles_;
+	/// Chunks whose extent file was written but not synced, the old copies
+	/// of their blocks must be kept until it is. Protected by mutex_.
+	std::set<ChunkKey> unsyncedExtents_;
+	/// Protects zoneMap_, extentFiles_ and unsyncedExtents_. It is also held
+	/// while updating the extent files, so that they are written in the order
+	/// of the changes.
+	std::mutex mutex_;
+	/// Notified when a zone is reset, with mutex_
+	std::condition_variable zonesCond_;
+
+	/// Held shared while reading from zones and exclusively to reset a zone,
+	/// so that no one reads a block from its old location once it is reused
+	std::shared_mutex resetMutex_;
+
+	Appender writesAppender_{false};  ///< Appends the Chunk writes
+	Appender gcAppender_{true};       ///< Appends the relocated blocks
+
+	/// Read descriptors of zone files, by zone
+	std::unordered_map<uint32_t, std::shared_ptr<FileDescriptor>> readFds_;
+	std::mutex readFdsMutex_;  ///< Protects readFds_
+
+	bool zonesLoaded_ = false;   ///< Tells if loadZones was called
+	uint32_t zoneCapacity_ = 0;  ///< Estimated capacity of a zone, in blocks
+
+	std::thread gcThread_;            ///< Runs collectGarbage
+	std::mutex gcMutex_;              ///< Protects gcTerminate_
+	std::condition_variable gcCond_;  ///< Wakes up the garbage collector
+	bool gcTerminate_ = false;        ///< Tells the garbage collector to stop
+};
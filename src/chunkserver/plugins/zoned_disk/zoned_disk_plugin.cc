@@ -0,0 +1,39 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+
+#include "zoned_disk_plugin.h"
+
+#include <boost/make_shared.hpp>
+
+#include "zoned_disk.h"
+
+std::string ZonedDiskPlugin::name() { return "ZonedDiskPlugin"; }
+
+std::string ZonedDiskPlugin::prefix() { return "zonefs"; }
+
+IDisk *ZonedDiskPlugin::createDisk(const disk::Configuration &configuration) {
+	return new ZonedDisk(configuration);
+}
+
+boost::shared_ptr<DiskPlugin> ZonedDiskPlugin::create() {
+	return boost::make_shared<ZonedDiskPlugin>();
+}
+
+BOOST_DLL_ALIAS(ZonedDiskPlugin::create, createPlugin)
@@ -0,0 +1,37 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include "chunkserver-common/disk_plugin.h"
+
+/// Creates the Disks of the hdd.cfg lines starting with 'zonefs:' (see
+/// ZonedDisk).
+class BOOST_SYMBOL_VISIBLE ZonedDiskPlugin : public DiskPlugin {
+public:
+	std::string name() override;
+
+	std::string prefix() override;
+
+	IDisk *createDisk(const disk::Configuration &configuration) override;
+
+	/// Entry point of the plugin, exported as 'createPlugin'
+	static boost::shared_ptr<DiskPlugin> create();
+};
@@ -0,0 +1,254 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "zoned_disk.h"
+
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "chunkserver-common/chunk_interface.h"
+#include "chunkserver-common/disk_utils.h"
+#include "common/crc.h"
+#include "common/saunafs_error_codes.h"
+#include "common/slice_traits.h"
+#include "protocol/SFSCommunication.h"
+#include "unittests/TemporaryDirectory.h"
+
+/// Zone files are regular files in a temporary directory. zonefs refuses
+/// appends beyond the capacity of a zone, which is simulated by limiting the
+/// size of the files written by the process.
+class ZonedDiskTests : public testing::Test {
+protected:
+	static constexpr uint32_t kZones = 6;
+	static constexpr uint32_t kZoneBlocks = 4;
+
+	void SetUp() override {
+		temp_ = std::make_unique<TemporaryDirectory>("/tmp", "zoned_disk");
+		metaPath_ = temp_->name() + "/meta/";
+		dataPath_ = temp_->name() + "/data/";
+		ASSERT_EQ(0, ::mkdir(dataPath_.c_str(), 0755));
+		ASSERT_EQ(0, ::mkdir((dataPath_ + "seq").c_str(), 0755));
+		for (uint32_t zone = 0; zone < kZones; ++zone) {
+			std::ofstream(zoneFilename(zone));
+		}
+
+		ASSERT_EQ(0, getrlimit(RLIMIT_FSIZE, &fileSizeLimit_));
+		struct rlimit zoneLimit = fileSizeLimit_;
+		zoneLimit.rlim_cur = kZoneBlocks * SFSBLOCKSIZE;
+		ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &zoneLimit));
+		// Writes beyond the limit fail with EFBIG instead
+		signal(SIGXFSZ, SIG_IGN);
+	}
+
+	void TearDown() override {
+		setrlimit(RLIMIT_FSIZE, &fileSizeLimit_);
+		signal(SIGXFSZ, SIG_DFL);
+	}
+
+	std::string zoneFilename(uint32_t zone) const {
+		return dataPath_ + "seq/" + std::to_string(zone);
+	}
+
+	off_t zoneSize(uint32_t zone) const {
+		struct stat zoneStat {};
+		return ::stat(zoneFilename(zone).c_str(), &zoneStat) == 0
+		           ? zoneStat.st_size
+		           : -1;
+	}
+
+	/// Waits until the garbage collector resets the zones
+	bool waitForReset(const std::vector<uint32_t> &zones) const {
+		for (int i = 0; i < 500; ++i) {
+			bool reset = true;
+			for (auto zone : zones) {
+				reset &= zoneSize(zone) == 0;
+			}
+			if (reset) {
+				return true;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		}
+		return false;
+	}
+
+	std::unique_ptr<ZonedDisk> createDisk() const {
+		auto disk = std::make_unique<ZonedDisk>(
+		    disk::Configuration(metaPath_, dataPath_, false, true));
+		disk->createPathsAndSubfolders();
+		disk->refreshDataDiskUsage();
+		return disk;
+	}
+
+	static std::unique_ptr<IChunk> createChunk(ZonedDisk &disk,
+	                                           uint64_t chunkId) {
+		std::unique_ptr<IChunk> chunk(disk.instantiateNewConcreteChunk(
+		    chunkId, slice_traits::standard::ChunkPartType()));
+		chunk->setVersion(1);
+		chunk->updateFilenamesFromVersion(1);
+		disk.creat(chunk.get());
+		return chunk;
+	}
+
+	/// Loads a Chunk written before, as when scanning the disk
+	static std::unique_ptr<IChunk> loadChunk(ZonedDisk &disk,
+	                                         uint64_t chunkId) {
+		std::unique_ptr<IChunk> chunk(disk.instantiateNewConcreteChunk(
+		    chunkId, slice_traits::standard::ChunkPartType()));
+		chunk->setVersion(1);
+		chunk->updateFilenamesFromVersion(1);
+		EXPECT_EQ(SAUNAFS_STATUS_OK,
+		          disk.updateChunkAttributes(chunk.get(), true));
+		return chunk;
+	}
+
+	static std::vector<uint8_t> block(uint8_t value) {
+		return std::vector<uint8_t>(SFSBLOCKSIZE, value);
+	}
+
+	void writeBlock(ZonedDisk &disk, IChunk *chunk, uint16_t blockNumber,
+	                uint8_t value) {
+		const auto data = block(value);
+		crcData_.resize(chunk->getCrcBlockSize());
+		ASSERT_EQ(SAUNAFS_STATUS_OK,
+		          disk.writeChunkBlock(chunk, 0, blockNumber, 0, SFSBLOCKSIZE,
+		                               mycrc32(0, data.data(), SFSBLOCKSIZE),
+		                               crcData_.data(), data.data()));
+	}
+
+	static std::vector<uint8_t> readBlock(ZonedDisk &disk, IChunk *chunk,
+	                                      uint16_t blockNumber) {
+		std::vector<uint8_t> data(SFSBLOCKSIZE);
+		EXPECT_EQ(SFSBLOCKSIZE,
+		          disk.preadData(chunk, data.data(), SFSBLOCKSIZE,
+		                         chunk->getBlockOffset(blockNumber)));
+		return data;
+	}
+
+	std::unique_ptr<TemporaryDirectory> temp_;
+	std::string metaPath_;
+	std::string dataPath_;
+	struct rlimit fileSizeLimit_ {};
+	std::vector<uint8_t> crcData_;
+};
+
+TEST_F(ZonedDiskTests, AppendsBlocksToZones) {
+	auto disk = createDisk();
+	auto chunk = createChunk(*disk, 1);
+
+	for (uint16_t i = 0; i < kZoneBlocks + 2; ++i) {
+		writeBlock(*disk, chunk.get(), i, i + 1);
+	}
+	writeBlock(*disk, chunk.get(), 1, 0xAA);
+
+	// The zone refusing an append is closed and the next one is used
+	EXPECT_EQ(off_t{kZoneBlocks * SFSBLOCKSIZE}, zoneSize(0));
+	EXPECT_EQ(off_t{3 * SFSBLOCKSIZE}, zoneSize(1));
+	EXPECT_EQ(kZoneBlocks + 2, chunk->blocks());
+	EXPECT_EQ(block(1), readBlock(*disk, chunk.get(), 0));
+	EXPECT_EQ(block(0xAA), readBlock(*disk, chunk.get(), 1));
+	EXPECT_EQ(block(kZoneBlocks + 2), readBlock(*disk, chunk.get(), 5));
+
+	ASSERT_EQ(SAUNAFS_STATUS_OK, disk->fsyncChunk(chunk.get()));
+	chunk.reset();
+	disk.reset();
+
+	// The extent file points to the last copy of each block
+	disk = createDisk();
+	chunk = loadChunk(*disk, 1);
+	EXPECT_EQ(kZoneBlocks + 2, chunk->blocks());
+	EXPECT_EQ(block(1), readBlock(*disk, chunk.get(), 0));
+	EXPECT_EQ(block(0xAA), readBlock(*disk, chunk.get(), 1));
+}
+
+TEST_F(ZonedDiskTests, ResetsGarbageZones) {
+	auto disk = createDisk();
+	auto chunk = createChunk(*disk, 1);
+
+	for (uint16_t i = 0; i < kZoneBlocks; ++i) {
+		writeBlock(*disk, chunk.get(), i, 1);
+	}
+	// All the blocks of zone 0 are rewritten
+	for (uint16_t i = 0; i < kZoneBlocks; ++i) {
+		writeBlock(*disk, chunk.get(), i, 2);
+	}
+
+	disk->updateAfterScan();
+	ASSERT_TRUE(waitForReset({0}));
+	for (uint16_t i = 0; i < kZoneBlocks; ++i) {
+		EXPECT_EQ(block(2), readBlock(*disk, chunk.get(), i));
+	}
+
+	// A crash at this point must not lose the rewritten blocks
+	chunk.reset();
+	disk.reset();
+	disk = createDisk();
+	chunk = loadChunk(*disk, 1);
+	for (uint16_t i = 0; i < kZoneBlocks; ++i) {
+		EXPECT_EQ(block(2), readBlock(*disk, chunk.get(), i));
+	}
+}
+
+TEST_F(ZonedDiskTests, RelocatesLiveBlocks) {
+	auto disk = createDisk();
+	auto chunk1 = createChunk(*disk, 1);
+	auto chunk2 = createChunk(*disk, 2);
+
+	// Zones 0 and 1 hold one Chunk each, then half of each is rewritten to
+	// zone 2, which leaves too few empty zones
+	for (uint16_t i = 0; i < kZoneBlocks; ++i) {
+		writeBlock(*disk, chunk1.get(), i, 0x10 + i);
+	}
+	for (uint16_t i = 0; i < kZoneBlocks; ++i) {
+		writeBlock(*disk, chunk2.get(), i, 0x20 + i);
+	}
+	for (uint16_t i = 0; i < kZoneBlocks / 2; ++i) {
+		writeBlock(*disk, chunk1.get(), i, 0x30 + i);
+		writeBlock(*disk, chunk2.get(), i, 0x40 + i);
+	}
+
+	disk->updateAfterScan();
+	ASSERT_TRUE(waitForReset({0, 1}));
+
+	auto expected = [](uint16_t chunk, uint16_t i) {
+		return block(i < kZoneBlocks / 2 ? 0x10 * (chunk + 2) + i
+		                                 : 0x10 * chunk + i);
+	};
+	for (uint16_t i = 0; i < kZoneBlocks; ++i) {
+		EXPECT_EQ(expected(1, i), readBlock(*disk, chunk1.get(), i));
+		EXPECT_EQ(expected(2, i), readBlock(*disk, chunk2.get(), i));
+	}
+
+	chunk1.reset();
+	chunk2.reset();
+	disk.reset();
+	disk = createDisk();
+	chunk1 = loadChunk(*disk, 1);
+	chunk2 = loadChunk(*disk, 2);
+	for (uint16_t i = 0; i < kZoneBlocks; ++i) {
+		EXPECT_EQ(expected(1, i), readBlock(*disk, chunk1.get(), i));
+		EXPECT_EQ(expected(2, i), readBlock(*disk, chunk2.get(), i));
+	}
+}
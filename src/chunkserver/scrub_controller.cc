@@ -0,0 +1,71 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "chunkserver/scrub_controller.h"
+
+#include <algorithm>
+
+ScrubController::ScrubController(double maxBytesPerSecond)
+    : maxRate_(maxBytesPerSecond), rate_(maxBytesPerSecond) {}
+
+void ScrubController::setMaxRate(double maxBytesPerSecond) {
+	maxRate_ = maxBytesPerSecond;
+	rate_ = std::min(std::max(rate_, maxRate_ / kMinRateDivisor), maxRate_);
+}
+
+uint64_t ScrubController::delayUs(uint64_t nowUs) const {
+	return nextTestUs_ > nowUs ? nextTestUs_ - nowUs : 0;
+}
+
+void ScrubController::testDone(uint64_t bytes, uint64_t durationUs,
+                               uint64_t nowUs) {
+	testedBytes_ += bytes;
+	testedChunks_++;
+
+	if (durationUs > 0) {
+		double usPerByte =
+		    static_cast<double>(durationUs) / (bytes + kTestOverheadBytes);
+		if (baselineUsPerByte_ == 0. || usPerByte < baselineUsPerByte_) {
+			baselineUsPerByte_ = usPerByte;
+		} else {
+			baselineUsPerByte_ *= kBaselineDecay;
+		}
+
+		if (usPerByte > kBackoffRatio * baselineUsPerByte_) {
+			rate_ = std::max(rate_ / 2., maxRate_ / kMinRateDivisor);
+		} else {
+			rate_ = std::min(rate_ + maxRate_ / kRateIncreaseDivisor, maxRate_);
+		}
+	}
+
+	if (rate_ > 0.) {
+		// The time spent on the test counts towards the budget
+		uint64_t start = nowUs > durationUs ? nowUs - durationUs : 0;
+		nextTestUs_ = std::max(nextTestUs_, start) +
+		              static_cast<uint64_t>(bytes * 1e6 / rate_);
+	}
+}
+
+uint64_t ScrubController::etaSeconds(uint64_t chunks) const {
+	if (testedChunks_ == 0 || rate_ <= 0.) {
+		return 0;
+	}
+	double averageChunkBytes = static_cast<double>(testedBytes_) / testedChunks_;
+	return static_cast<uint64_t>(chunks * averageChunkBytes / rate_);
+}
@@ -0,0 +1,76 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <cstdint>
+
+/// Paces the background testing (scrubbing) of the chunks of a single disk.
+///
+/// Chunks are tested at most at the configured byte rate. The rate is cut in
+/// half whenever testing a chunk takes much longer per byte than the fastest
+/// test seen recently, which happens when foreground I/O competes for the
+/// disk, and then grows back slowly (AIMD).
+class ScrubController {
+public:
+	/// A test slower than kBackoffRatio times the baseline triggers a backoff
+	static constexpr double kBackoffRatio = 2.0;
+	/// The rate never drops below maxRate / kMinRateDivisor
+	static constexpr double kMinRateDivisor = 64.0;
+	/// Every fast enough test adds maxRate / kRateIncreaseDivisor to the rate
+	static constexpr double kRateIncreaseDivisor = 16.0;
+	/// The baseline slowly forgets the fastest test, to follow disk changes
+	static constexpr double kBaselineDecay = 1.001;
+	/// Fixed cost of testing any chunk (opening, seeking), in bytes, so that
+	/// small chunks do not look slow compared to big ones
+	static constexpr double kTestOverheadBytes = 1024. * 1024.;
+
+	explicit ScrubController(double maxBytesPerSecond = 0.);
+
+	/// Changes the rate limit, e.g. after reloading the configuration
+	void setMaxRate(double maxBytesPerSecond);
+
+	/// Returns how many microseconds have to pass until the next test
+	uint64_t delayUs(uint64_t nowUs) const;
+
+	/// Records a test of a chunk of the given size, which took durationUs
+	void testDone(uint64_t bytes, uint64_t durationUs, uint64_t nowUs);
+
+	/// Returns the current rate limit in bytes per second
+	double rate() const { return rate_; }
+
+	/// Returns the estimated number of seconds needed to test the given
+	/// number of chunks at the current rate
+	uint64_t etaSeconds(uint64_t chunks) const;
+
+	/// Returns the number of bytes tested so far
+	uint64_t testedBytes() const { return testedBytes_; }
+
+	/// Returns the number of chunks tested so far
+	uint64_t testedChunks() const { return testedChunks_; }
+
+private:
+	double maxRate_;  ///< Configured limit in bytes per second
+	double rate_;     ///< Current limit in bytes per second
+	double baselineUsPerByte_ = 0.;  ///< The fastest recent test
+	uint64_t nextTestUs_ = 0;        ///< When the next test may start
+	uint64_t testedBytes_ = 0;
+	uint64_t testedChunks_ = 0;
+};
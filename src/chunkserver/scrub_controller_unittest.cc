@@ -0,0 +1,77 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "chunkserver/scrub_controller.h"
+
+#include <gtest/gtest.h>
+
+static constexpr uint64_t kMiB = 1024 * 1024;
+
+TEST(ScrubControllerTests, RespectsRate) {
+	ScrubController controller(10 * kMiB);
+	EXPECT_EQ(0U, controller.delayUs(0));
+
+	// 10 MiB took 100ms, so the next test may start 1s after the first one
+	controller.testDone(10 * kMiB, 100000, 100000);
+	EXPECT_EQ(900000U, controller.delayUs(100000));
+	EXPECT_EQ(0U, controller.delayUs(1000000));
+	EXPECT_EQ(1U, controller.testedChunks());
+	EXPECT_EQ(10 * kMiB, controller.testedBytes());
+}
+
+TEST(ScrubControllerTests, BacksOffWhenTestsSlowDown) {
+	ScrubController controller(64 * kMiB);
+	uint64_t now = 0;
+
+	for (int i = 0; i < 4; ++i) {
+		now += 10000;
+		controller.testDone(kMiB, 10000, now);
+	}
+	EXPECT_DOUBLE_EQ(64. * kMiB, controller.rate());
+
+	// Foreground load makes tests five times slower
+	now += 50000;
+	controller.testDone(kMiB, 50000, now);
+	EXPECT_DOUBLE_EQ(32. * kMiB, controller.rate());
+	now += 50000;
+	controller.testDone(kMiB, 50000, now);
+	EXPECT_DOUBLE_EQ(16. * kMiB, controller.rate());
+
+	for (int i = 0; i < 100; ++i) {
+		now += 50000;
+		controller.testDone(kMiB, 50000, now);
+	}
+	EXPECT_DOUBLE_EQ(1. * kMiB, controller.rate());
+
+	// The load is gone, the rate grows back to the limit
+	for (int i = 0; i < 16; ++i) {
+		now += 10000;
+		controller.testDone(kMiB, 10000, now);
+	}
+	EXPECT_DOUBLE_EQ(64. * kMiB, controller.rate());
+}
+
+TEST(ScrubControllerTests, EstimatesRemainingTime) {
+	ScrubController controller(kMiB);
+	EXPECT_EQ(0U, controller.etaSeconds(100));
+
+	controller.testDone(2 * kMiB, 1000, 1000);
+	controller.testDone(4 * kMiB, 1000, 2000);
+	EXPECT_EQ(300U, controller.etaSeconds(100));
+}
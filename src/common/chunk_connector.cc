@@ -32,7 +32,8 @@ static int64_t timeoutTime(int64_t rtt, uint8_t tryCounter) {
 	return rtt * (1 << (tryCounter / 2)) * 3 / (tryCounter % 2 == 0 ? 3 : 2);
 }
 
-ChunkConnector::ChunkConnector(uint32_t sourceIp) : roundTripTime_ms_(20), sourceIp_(sourceIp) {
+ChunkConnector::ChunkConnector(uint32_t sourceIp)
+		: roundTripTime_ms_(20), sourceIp_(sourceIp), stats_(nullptr) {
 }
 
 int ChunkConnector::startUsingConnection(const NetworkAddress& server,
@@ -40,6 +41,7 @@ int ChunkConnector::startUsingConnection(const NetworkAddress& server,
 	int fd = -1;
 	int retries = 0;
 	int err = ETIMEDOUT;  // we want to return ETIMEDOUT on timeout.expired()
+	Timer connectTimer;
 	while (!timeout.expired()) {
 		fd = tcpsocket();
 		if (fd < 0) {
@@ -70,9 +72,15 @@ int ChunkConnector::startUsingConnection(const NetworkAddress& server,
 		retries++;
 	}
 	if (fd < 0) {
+		if (stats_) {
+			stats_->markDefective(server);
+		}
 		throw ChunkserverConnectionException(
 				"Connection error: " + std::string(strerr(err)), server);
 	}
+	if (stats_) {
+		stats_->registerConnectTime(server, connectTimer.elapsed_us());
+	}
 	if (tcpnodelay(fd) < 0) {
 		safs_pretty_syslog(LOG_WARNING, "can't set TCP_NODELAY: %s", strerr(tcpgetlasterror()));
 	}
@@ -101,3 +109,18 @@ int ChunkConnectorUsingPool::startUsingConnection(const NetworkAddress& server,
 void ChunkConnectorUsingPool::endUsingConnection(int fd, const NetworkAddress& server) const {
 	connectionPool_.putConnection(fd, server, kConnectionPoolTimeout_s);
 }
+
+void ChunkConnectorUsingPool::prewarmConnections(uint32_t connectTimeout_ms) const {
+	for (const auto& serverAndCount : connectionPool_.serversToPrewarm()) {
+		const NetworkAddress& server = serverAndCount.first;
+		try {
+			for (unsigned i = 0; i < serverAndCount.second; ++i) {
+				Timeout timeout{std::chrono::milliseconds(connectTimeout_ms)};
+				int fd = ChunkConnector::startUsingConnection(server, timeout);
+				connectionPool_.putConnection(fd, server, kConnectionPoolTimeout_s);
+			}
+		} catch (ChunkserverConnectionException&) {
+			// the server will be tried again during the next prewarming
+		}
+	}
+}
@@ -21,6 +21,7 @@
 
 #include "common/platform.h"
 
+#include "common/chunkserver_stats.h"
 #include "common/connection_pool.h"
 #include "common/sockets.h"
 #include "common/time_utils.h"
@@ -42,12 +43,19 @@ public:
 		sourceIp_ = sourceIp;
 	}
 
+	/// Statistics to be fed with connection times and failures (none by default).
+	void setChunkserverStats(ChunkserverStats* stats) {
+		stats_ = stats;
+	}
+
 private:
 	/// Time after which SYN packet will be considered lost during the first retry of tcptoconnect.
 	uint32_t roundTripTime_ms_;
 
 	/// IP address to bind to when connecting chunkservers.
 	uint32_t sourceIp_;
+
+	ChunkserverStats* stats_;
 };
 
 class Connection {
@@ -102,6 +110,12 @@ public:
 	virtual int startUsingConnection(const NetworkAddress& server, const Timeout& timeout) const;
 	virtual void endUsingConnection(int fd, const NetworkAddress& server) const;
 
+	/**
+	 * Opens connections missing in the pool to chunkservers in use.
+	 * Servers which can't be connected within the timeout are skipped.
+	 */
+	void prewarmConnections(uint32_t connectTimeout_ms) const;
+
 private:
 	ConnectionPool& connectionPool_;
 };
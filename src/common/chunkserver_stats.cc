@@ -26,9 +26,10 @@
 // ChunkserverEntry implementation
 
 constexpr int ChunkserverStats::ChunkserverEntry::defectiveTimeout_ms;
+constexpr uint32_t ChunkserverStats::ChunkserverEntry::slowConnectTime_us;
 
 ChunkserverStats::ChunkserverEntry::ChunkserverEntry(): pendingReads_(0), pendingWrites_(0),
-		defects_(0), defectiveTimeout_(std::chrono::milliseconds(defectiveTimeout_ms)) {
+		defects_(0), connectTime_us_(0), defectiveTimeout_(std::chrono::milliseconds(defectiveTimeout_ms)) {
 }
 
 // ChunkserverStats implementation
@@ -73,12 +74,27 @@ void ChunkserverStats::markDefective(const NetworkAddress& address) {
 	chunkserver.defectiveTimeout_.reset();
 }
 
+void ChunkserverStats::registerConnectTime(const NetworkAddress& address,
+		uint32_t connectTime_us) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	ChunkserverEntry &chunkserver = chunkserverEntries_[address];
+	if (chunkserver.connectTime_us_ == 0) {
+		chunkserver.connectTime_us_ = connectTime_us;
+	} else {
+		// exponential moving average with weight 1/8 for the new sample
+		chunkserver.connectTime_us_ = (7 * uint64_t(chunkserver.connectTime_us_)
+				+ connectTime_us) / 8;
+	}
+}
+
 float ChunkserverStats::ChunkserverEntry::score() const {
+	// servers which connect within the same slot are considered equally good,
+	// so that the pending operation count can still decide between them
+	float score = 1. / (1 + connectTime_us_ / slowConnectTime_us);
 	if (defects_ > 0 && !defectiveTimeout_.expired()) {
-		return 1. / (defects_ + 1);
-	} else {
-		return 1;
+		score /= (defects_ + 1);
 	}
+	return score;
 }
 
 // ChunkserverStatsProxy implementation
@@ -35,7 +35,9 @@
 // these operations with the global ChunkserverStats instance.
 //
 // If there is a choice between multiple chunkservers capable of performing some operation, the
-// chunkserver with lowest pending operation count should be chosen.
+// chunkserver with the highest score and then the lowest pending operation count should be
+// chosen. The score is lowered for chunkservers marked as defective and for chunkservers which
+// take long to connect to.
 //
 // Code that determines a chunkserver to be defective should call markDefective(). Others should
 // prefer to use chunkservers not marked as defective, if possible. The defective flag is cleared
@@ -65,12 +67,20 @@ public:
 
 		float score() const;
 
+		/// Moving average of the time of establishing a connection (0 if not known yet).
+		uint32_t connectTime_us() const {
+			return connectTime_us_;
+		}
+
 	private:
 		static constexpr int defectiveTimeout_ms = 2000;
+		/// Each started period of this length in the average connect time lowers the score.
+		static constexpr uint32_t slowConnectTime_us = 5000;
 
 		uint32_t pendingReads_;
 		uint32_t pendingWrites_;
 		uint32_t defects_;
+		uint32_t connectTime_us_;
 		Timeout defectiveTimeout_;
 
 		friend class ChunkserverStats;
@@ -89,6 +99,9 @@ public:
 	void markDefective(const NetworkAddress& address);
 	void markWorking(const NetworkAddress& address);
 
+	// updates the moving average of time needed to connect to the chunkserver
+	void registerConnectTime(const NetworkAddress& address, uint32_t connectTime_us);
+
 private:
 	std::mutex mutex_;
 	std::unordered_map<NetworkAddress, ChunkserverEntry> chunkserverEntries_;
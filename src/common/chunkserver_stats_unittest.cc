@@ -139,3 +139,31 @@ TEST(ChunkserverStatsTests, AllPendingDefectiveLonger) {
 	EXPECT_EQ(stats.getStatisticsFor(server1).score(), 1.);
 	EXPECT_LT(stats.getStatisticsFor(server2).score(), 1.);
 }
+
+TEST(ChunkserverStatsTests, ConnectTime) {
+	ChunkserverStats stats;
+	NetworkAddress server(1111, 11);
+
+	EXPECT_EQ(0u, stats.getStatisticsFor(server).connectTime_us());
+	stats.registerConnectTime(server, 800);
+	EXPECT_EQ(800u, stats.getStatisticsFor(server).connectTime_us());
+	stats.registerConnectTime(server, 1600);
+	EXPECT_EQ(900u, stats.getStatisticsFor(server).connectTime_us());
+}
+
+TEST(ChunkserverStatsTests, SlowConnectLowersScore) {
+	ChunkserverStats stats;
+	NetworkAddress fastServer(1111, 11);
+	NetworkAddress slowServer(2222, 22);
+
+	stats.registerConnectTime(fastServer, 300);
+	EXPECT_EQ(stats.getStatisticsFor(fastServer).score(), 1.);
+	stats.registerConnectTime(slowServer, 50000);
+	EXPECT_LT(stats.getStatisticsFor(slowServer).score(),
+			stats.getStatisticsFor(fastServer).score());
+
+	// a defect still counts on top of a slow connection
+	float slowScore = stats.getStatisticsFor(slowServer).score();
+	stats.markDefective(slowServer);
+	EXPECT_LT(stats.getStatisticsFor(slowServer).score(), slowScore);
+}
@@ -20,31 +20,43 @@
 #include "common/platform.h"
 #include "common/connection_pool.h"
 
+#include <functional>
+
 #include "common/massert.h"
 #include "common/sockets.h"
 
+ConnectionPool::Shard& ConnectionPool::shardFor(const NetworkAddress& address) {
+	return shards_[std::hash<NetworkAddress>()(address) % kShardCount];
+}
+
+bool ConnectionPool::isHealthy(int fd) {
+	// An idle connection must not have anything to read. If it has, the peer either
+	// closed it, reset it or sent data nobody is going to read.
+	return tcptopoll(fd, POLLIN, 0) == 0;
+}
+
 void ConnectionPool::putConnection(int fd, const NetworkAddress& address, int timeout) {
 	sassert(fd > 0);
 	sassert(timeout > 0);
-	std::unique_lock<std::mutex> lock(mutex_);
-	connections_[address].push_back(Connection(fd, timeout));
+	Shard& shard = shardFor(address);
+	std::unique_lock<std::mutex> lock(shard.mutex);
+	shard.servers[address].connections.push_back(Connection(fd, timeout));
 }
 
 int ConnectionPool::getConnection(const NetworkAddress& address) {
+	Shard& shard = shardFor(address);
 	while (true) {
-		std::unique_lock<std::mutex> lock(mutex_);
-		auto connectionsIterator = connections_.find(address);
-		if (connectionsIterator == connections_.end()) {
-			return -1;
-		}
-		std::list<Connection>& openConnections = connectionsIterator->second;
+		std::unique_lock<std::mutex> lock(shard.mutex);
+		Server& server = shard.servers[address];
+		server.lastRequest.reset();
+		std::list<Connection>& openConnections = server.connections;
 		if (openConnections.empty()) {
 			return -1;
 		}
 		Connection connection = openConnections.front();
 		openConnections.pop_front();
 		lock.unlock();
-		if (connection.isValid()) {
+		if (connection.isValid() && isHealthy(connection.fd())) {
 			return connection.fd();
 		} else {
 			tcpclose(connection.fd());
@@ -53,32 +65,48 @@ int ConnectionPool::getConnection(const NetworkAddress& address) {
 }
 
 void ConnectionPool::cleanup() {
-	std::unique_lock<std::mutex> lock(mutex_);
 	std::vector<int> descriptorsToClose;
-	ConnectionsContainer::iterator keyAndConnectionListIt = connections_.begin();
-	while (keyAndConnectionListIt != connections_.end()) {
-		std::list<Connection>& connectionList = keyAndConnectionListIt->second;
-		std::list<Connection>::iterator connectionIt = connectionList.begin();
-		while (connectionIt != connectionList.end()) {
-			if (!connectionIt->isValid()) {
-				descriptorsToClose.push_back(connectionIt->fd());
-				std::list<Connection>::iterator it = connectionIt;
-				++connectionIt;
-				connectionList.erase(it);
+	for (Shard& shard : shards_) {
+		std::unique_lock<std::mutex> lock(shard.mutex);
+		ServersContainer::iterator serverIt = shard.servers.begin();
+		while (serverIt != shard.servers.end()) {
+			std::list<Connection>& connectionList = serverIt->second.connections;
+			std::list<Connection>::iterator connectionIt = connectionList.begin();
+			while (connectionIt != connectionList.end()) {
+				if (!connectionIt->isValid() || !isHealthy(connectionIt->fd())) {
+					descriptorsToClose.push_back(connectionIt->fd());
+					connectionIt = connectionList.erase(connectionIt);
+				} else {
+					++connectionIt;
+				}
+			}
+			if (connectionList.empty() && !serverIt->second.inUse()) {
+				serverIt = shard.servers.erase(serverIt);
 			} else {
-				++connectionIt;
+				++serverIt;
 			}
 		}
-		if (connectionList.empty()) {
-			ConnectionsContainer::iterator it = keyAndConnectionListIt;
-			++keyAndConnectionListIt;
-			connections_.erase(it);
-		} else {
-			++keyAndConnectionListIt;
-		}
 	}
-	lock.unlock();
 	for (int fd : descriptorsToClose) {
 		tcpclose(fd);
 	}
 }
+
+std::vector<std::pair<NetworkAddress, unsigned>> ConnectionPool::serversToPrewarm() {
+	std::vector<std::pair<NetworkAddress, unsigned>> result;
+	unsigned prewarmedConnections = prewarmedConnections_;
+	if (prewarmedConnections == 0) {
+		return result;
+	}
+	for (Shard& shard : shards_) {
+		std::unique_lock<std::mutex> lock(shard.mutex);
+		for (const auto& addressAndServer : shard.servers) {
+			const Server& server = addressAndServer.second;
+			if (server.inUse() && server.connections.size() < prewarmedConnections) {
+				result.emplace_back(addressAndServer.first,
+						prewarmedConnections - server.connections.size());
+			}
+		}
+	}
+	return result;
+}
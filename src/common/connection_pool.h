@@ -21,16 +21,35 @@
 
 #include "common/platform.h"
 
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <list>
 #include <map>
 #include <mutex>
+#include <utility>
+#include <vector>
 
 #include "common/network_address.h"
 #include "common/time_utils.h"
 
+/**
+ * Pool of idle connections to chunkservers.
+ *
+ * Servers are spread over independently locked shards, so threads talking to
+ * different chunkservers don't contend on a single lock. Idle connections are
+ * checked before they are handed out and by cleanup(): a connection which
+ * became readable while idle (the peer closed it or sent something unexpected)
+ * is closed instead of being reused.
+ *
+ * The pool can also be asked to keep a number of prewarmed connections to each
+ * recently used server, see serversToPrewarm().
+ */
 class ConnectionPool {
 public:
+	static constexpr unsigned kShardCount = 16;
+	/// Servers asked for a connection within this period are considered in use.
+	static constexpr int kServerInUsePeriod_ms = 10000;
 
 	/**
 	 * Returns descriptor if connection found in the pool, -1 otherwise
@@ -44,10 +63,24 @@ public:
 	void putConnection(int fd, const NetworkAddress& address, int timeout);
 
 	/**
-	 * Removes timed out connections from the pool
+	 * Removes timed out and broken connections from the pool
 	 */
 	void cleanup();
 
+	/**
+	 * Sets the number of idle connections which should be kept open to each
+	 * server in use (0 disables prewarming).
+	 */
+	void setPrewarmedConnections(unsigned count) {
+		prewarmedConnections_ = count;
+	}
+
+	/**
+	 * Returns servers in use which have fewer idle connections than requested by
+	 * setPrewarmedConnections(), with the number of missing connections.
+	 */
+	std::vector<std::pair<NetworkAddress, unsigned>> serversToPrewarm();
+
 private:
 	class Connection {
 	public:
@@ -69,8 +102,27 @@ private:
 		Timeout validUntil_;
 	};
 
-	typedef std::map<NetworkAddress, std::list<Connection>> ConnectionsContainer;
+	struct Server {
+		std::list<Connection> connections;
+		Timer lastRequest;
+
+		bool inUse() const {
+			return lastRequest.elapsed_ms() < kServerInUsePeriod_ms;
+		}
+	};
+
+	typedef std::map<NetworkAddress, Server> ServersContainer;
+
+	struct Shard {
+		std::mutex mutex;
+		ServersContainer servers;
+	};
+
+	/// Returns false for connections which can't be reused.
+	static bool isHealthy(int fd);
+
+	Shard& shardFor(const NetworkAddress& address);
 
-	std::mutex mutex_;
-	ConnectionsContainer connections_;
+	std::array<Shard, kShardCount> shards_;
+	std::atomic<unsigned> prewarmedConnections_{0};
 };
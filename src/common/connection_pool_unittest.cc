@@ -0,0 +1,111 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "common/connection_pool.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+class ConnectionPoolTests : public testing::Test {
+protected:
+	void TearDown() override {
+		for (int fd : peers_) {
+			close(fd);
+		}
+	}
+
+	/// Returns one end of a new connected socket pair, the other one is kept.
+	int connection() {
+		int fds[2];
+		EXPECT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+		peers_.push_back(fds[1]);
+		return fds[0];
+	}
+
+	std::vector<int> peers_;
+};
+
+TEST_F(ConnectionPoolTests, PutAndGet) {
+	ConnectionPool pool;
+	NetworkAddress server1(1111, 11);
+	NetworkAddress server2(2222, 22);
+
+	int fd = connection();
+	pool.putConnection(fd, server1, 10);
+	EXPECT_EQ(-1, pool.getConnection(server2));
+	EXPECT_EQ(fd, pool.getConnection(server1));
+	EXPECT_EQ(-1, pool.getConnection(server1));
+	close(fd);
+}
+
+TEST_F(ConnectionPoolTests, ClosedConnectionIsNotReused) {
+	ConnectionPool pool;
+	NetworkAddress server(1111, 11);
+
+	int broken = connection();
+	int working = connection();
+	pool.putConnection(broken, server, 10);
+	pool.putConnection(working, server, 10);
+	close(peers_.front());
+	peers_.erase(peers_.begin());
+
+	EXPECT_EQ(working, pool.getConnection(server));
+	EXPECT_EQ(-1, pool.getConnection(server));
+	close(working);
+}
+
+TEST_F(ConnectionPoolTests, CleanupRemovesClosedConnections) {
+	ConnectionPool pool;
+	NetworkAddress server(1111, 11);
+
+	pool.setPrewarmedConnections(1);
+	pool.getConnection(server);
+	pool.putConnection(connection(), server, 10);
+	EXPECT_TRUE(pool.serversToPrewarm().empty());
+
+	close(peers_.front());
+	peers_.clear();
+	pool.cleanup();
+	EXPECT_EQ(1u, pool.serversToPrewarm().size());
+	EXPECT_EQ(-1, pool.getConnection(server));
+}
+
+TEST_F(ConnectionPoolTests, ServersToPrewarm) {
+	ConnectionPool pool;
+	NetworkAddress server1(1111, 11);
+	NetworkAddress server2(2222, 22);
+
+	EXPECT_TRUE(pool.serversToPrewarm().empty());
+	pool.getConnection(server1);
+	EXPECT_TRUE(pool.serversToPrewarm().empty());
+
+	pool.setPrewarmedConnections(2);
+	auto servers = pool.serversToPrewarm();
+	ASSERT_EQ(1u, servers.size());
+	EXPECT_EQ(server1, servers[0].first);
+	EXPECT_EQ(2u, servers[0].second);
+
+	pool.putConnection(connection(), server1, 10);
+	pool.putConnection(connection(), server2, 10);
+	pool.putConnection(connection(), server2, 10);
+	servers = pool.serversToPrewarm();
+	ASSERT_EQ(1u, servers.size());
+	EXPECT_EQ(1u, servers[0].second);
+}
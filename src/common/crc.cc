@@ -23,6 +23,7 @@
 
 #include <inttypes.h>
 #include <stdlib.h>
+#include <algorithm>
 #include <cstring>
 
 #include "protocol/SFSCommunication.h"
@@ -35,6 +36,11 @@ uint32_t mycrc32(uint32_t, const uint8_t*, uint32_t) {
 	return FAKE_CRC;
 }
 
+uint32_t mycrc32_copy(uint32_t, uint8_t *dst, const uint8_t *src, uint32_t leng) {
+	memcpy(dst, src, leng);
+	return FAKE_CRC;
+}
+
 uint32_t mycrc32_combine(uint32_t, uint32_t, uint32_t) {
 	return FAKE_CRC;
 }
@@ -53,7 +59,7 @@ void mycrc32_init(void) {
 
 static crcutil::GenericCrc<uint64_t, uint64_t, uint64_t, 4> gCrc(CRC_POLY, 32, true);
 
-uint32_t mycrc32(uint32_t crc, const uint8_t *block, uint32_t leng) {
+static uint32_t mycrc32_generic(uint32_t crc, const uint8_t *block, uint32_t leng) {
 	return gCrc.CrcDefault(block, leng, crc);
 }
 
@@ -112,7 +118,7 @@ void crc_generate_main_tables(void) {
 	}
 }
 
-uint32_t mycrc32(uint32_t crc,const uint8_t *block,uint32_t leng) {
+static uint32_t mycrc32_generic(uint32_t crc,const uint8_t *block,uint32_t leng) {
 	const uint32_t *block4;
 #ifdef WORDS_BIGENDIAN
 #define CRC_REORDER crc=(BYTEREV(crc))^0xFFFFFFFF
@@ -232,6 +238,216 @@ void mycrc32_init(void) {
 
 #endif // HAVE_CRCUTIL
 
+/*
+ * Carry-less multiplication folding, see Intel's "Fast CRC Computation for Generic Polynomials
+ * Using PCLMULQDQ Instruction". Folding constants are bit-reflected x^(D+32) mod P and
+ * x^(D-32) mod P (shifted left by one) for a folding distance of D bits.
+ */
+#if defined(SAUNAFS_HAVE_CPU_CHECK) && defined(__x86_64__) && \
+	(__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#include <immintrin.h>
+
+#define SAUNAFS_HAVE_CRC_CLMUL
+
+alignas(16) static const uint64_t kFold2048[] = {0x011542778a, 0x01322d1430};
+alignas(16) static const uint64_t kFold512[] = {0x0154442bd4, 0x01c6e41596};
+alignas(16) static const uint64_t kFold128[] = {0x01751997d0, 0x00ccaa009e};
+alignas(16) static const uint64_t kFold64[] = {0x0163cd6124, 0x0000000000};
+alignas(16) static const uint64_t kBarrett[] = {0x01db710641, 0x01f7011641};
+
+template <bool kCopy>
+__attribute__((target("sse4.1,pclmul")))
+static inline __m128i crc_clmul_load(const uint8_t *src, uint8_t *dst) {
+	__m128i x = _mm_loadu_si128((const __m128i *)src);
+	if (kCopy) {
+		_mm_storeu_si128((__m128i *)dst, x);
+	}
+	return x;
+}
+
+__attribute__((target("sse4.1,pclmul")))
+static inline __m128i crc_clmul_fold(__m128i x, __m128i k, __m128i data) {
+	__m128i lo = _mm_clmulepi64_si128(x, k, 0x00);
+	__m128i hi = _mm_clmulepi64_si128(x, k, 0x11);
+	return _mm_xor_si128(_mm_xor_si128(hi, lo), data);
+}
+
+/*
+ * Folds the remaining data into four 128-bit accumulators (64 bytes per iteration), then into
+ * one, and reduces it to the 32-bit (non-inverted) CRC. 'leng' has to be a multiple of 16.
+ */
+template <bool kCopy>
+__attribute__((target("sse4.1,pclmul")))
+static uint32_t crc_clmul_finish(__m128i x1, __m128i x2, __m128i x3, __m128i x4,
+		const uint8_t *block, uint8_t *dst, uint32_t leng) {
+	__m128i k = _mm_load_si128((const __m128i *)kFold512);
+	while (leng >= 64) {
+		x1 = crc_clmul_fold(x1, k, crc_clmul_load<kCopy>(block, dst));
+		x2 = crc_clmul_fold(x2, k, crc_clmul_load<kCopy>(block + 16, dst + 16));
+		x3 = crc_clmul_fold(x3, k, crc_clmul_load<kCopy>(block + 32, dst + 32));
+		x4 = crc_clmul_fold(x4, k, crc_clmul_load<kCopy>(block + 48, dst + 48));
+		block += 64;
+		dst += 64;
+		leng -= 64;
+	}
+
+	k = _mm_load_si128((const __m128i *)kFold128);
+	x1 = crc_clmul_fold(x1, k, x2);
+	x1 = crc_clmul_fold(x1, k, x3);
+	x1 = crc_clmul_fold(x1, k, x4);
+	while (leng >= 16) {
+		x1 = crc_clmul_fold(x1, k, crc_clmul_load<kCopy>(block, dst));
+		block += 16;
+		dst += 16;
+		leng -= 16;
+	}
+
+	// 128 -> 64 bits
+	__m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+	x2 = _mm_clmulepi64_si128(x1, k, 0x10);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+	k = _mm_loadl_epi64((const __m128i *)kFold64);
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	// Barrett reduction 64 -> 32 bits
+	k = _mm_load_si128((const __m128i *)kBarrett);
+	x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k, 0x10);
+	x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask32), k, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+	return _mm_extract_epi32(x1, 1);
+}
+
+/// Requires leng >= 64 and a multiple of 16; crc is not inverted.
+template <bool kCopy>
+__attribute__((target("sse4.1,pclmul")))
+static uint32_t crc_clmul_sse(uint32_t crc, const uint8_t *block, uint8_t *dst, uint32_t leng) {
+	__m128i x1 = crc_clmul_load<kCopy>(block, dst);
+	__m128i x2 = crc_clmul_load<kCopy>(block + 16, dst + 16);
+	__m128i x3 = crc_clmul_load<kCopy>(block + 32, dst + 32);
+	__m128i x4 = crc_clmul_load<kCopy>(block + 48, dst + 48);
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+	return crc_clmul_finish<kCopy>(x1, x2, x3, x4, block + 64, dst + 64, leng - 64);
+}
+
+#if __GNUC__ >= 8
+#define SAUNAFS_HAVE_CRC_VPCLMUL
+
+template <bool kCopy>
+__attribute__((target("avx512f,vpclmulqdq")))
+static inline __m512i crc_vpclmul_load(const uint8_t *src, uint8_t *dst) {
+	__m512i x = _mm512_loadu_si512(src);
+	if (kCopy) {
+		_mm512_storeu_si512(dst, x);
+	}
+	return x;
+}
+
+__attribute__((target("avx512f,vpclmulqdq")))
+static inline __m512i crc_vpclmul_fold(__m512i x, __m512i k, __m512i data) {
+	__m512i lo = _mm512_clmulepi64_epi128(x, k, 0x00);
+	__m512i hi = _mm512_clmulepi64_epi128(x, k, 0x11);
+	return _mm512_ternarylogic_epi64(hi, lo, data, 0x96);
+}
+
+/// Same as crc_clmul_sse, but folds 256 bytes per iteration; requires leng >= 256.
+template <bool kCopy>
+__attribute__((target("avx512f,vpclmulqdq,sse4.1,pclmul")))
+static uint32_t crc_clmul_avx512(uint32_t crc, const uint8_t *block, uint8_t *dst,
+		uint32_t leng) {
+	__m512i x1 = crc_vpclmul_load<kCopy>(block, dst);
+	__m512i x2 = crc_vpclmul_load<kCopy>(block + 64, dst + 64);
+	__m512i x3 = crc_vpclmul_load<kCopy>(block + 128, dst + 128);
+	__m512i x4 = crc_vpclmul_load<kCopy>(block + 192, dst + 192);
+	x1 = _mm512_xor_si512(x1, _mm512_inserti32x4(_mm512_setzero_si512(), _mm_cvtsi32_si128(crc), 0));
+	block += 256;
+	dst += 256;
+	leng -= 256;
+
+	__m512i k = _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_load_si128((const __m128i *)kFold2048));
+	while (leng >= 256) {
+		x1 = crc_vpclmul_fold(x1, k, crc_vpclmul_load<kCopy>(block, dst));
+		x2 = crc_vpclmul_fold(x2, k, crc_vpclmul_load<kCopy>(block + 64, dst + 64));
+		x3 = crc_vpclmul_fold(x3, k, crc_vpclmul_load<kCopy>(block + 128, dst + 128));
+		x4 = crc_vpclmul_fold(x4, k, crc_vpclmul_load<kCopy>(block + 192, dst + 192));
+		block += 256;
+		dst += 256;
+		leng -= 256;
+	}
+
+	k = _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_load_si128((const __m128i *)kFold512));
+	x1 = crc_vpclmul_fold(x1, k, x2);
+	x1 = crc_vpclmul_fold(x1, k, x3);
+	x1 = crc_vpclmul_fold(x1, k, x4);
+	return crc_clmul_finish<kCopy>(
+			_mm512_maskz_extracti32x4_epi32(0xF, x1, 0), _mm512_maskz_extracti32x4_epi32(0xF, x1, 1),
+			_mm512_maskz_extracti32x4_epi32(0xF, x1, 2), _mm512_maskz_extracti32x4_epi32(0xF, x1, 3),
+			block, dst, leng);
+}
+#endif // __GNUC__ >= 8
+
+typedef uint32_t (*crc_clmul_function_type)(uint32_t, const uint8_t *, uint8_t *, uint32_t);
+
+struct CrcClmulKernel {
+	crc_clmul_function_type crc;
+	crc_clmul_function_type copy;
+	uint32_t min_length;
+};
+
+static CrcClmulKernel crc_get_clmul_kernel() {
+	__builtin_cpu_init();
+#ifdef SAUNAFS_HAVE_CRC_VPCLMUL
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("vpclmulqdq")) {
+		return {crc_clmul_avx512<false>, crc_clmul_avx512<true>, 256};
+	}
+#endif
+	if (__builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("pclmul")) {
+		return {crc_clmul_sse<false>, crc_clmul_sse<true>, 64};
+	}
+	return {nullptr, nullptr, 0};
+}
+
+static const CrcClmulKernel gCrcClmulKernel = crc_get_clmul_kernel();
+
+#endif // SAUNAFS_HAVE_CRC_CLMUL
+
+uint32_t mycrc32(uint32_t crc, const uint8_t *block, uint32_t leng) {
+#ifdef SAUNAFS_HAVE_CRC_CLMUL
+	if (gCrcClmulKernel.crc != nullptr && leng >= gCrcClmulKernel.min_length) {
+		uint32_t bulk = leng & ~15U;
+		// dst is not written to when not copying
+		crc = ~gCrcClmulKernel.crc(~crc, block, const_cast<uint8_t *>(block), bulk);
+		block += bulk;
+		leng -= bulk;
+	}
+#endif
+	return mycrc32_generic(crc, block, leng);
+}
+
+uint32_t mycrc32_copy(uint32_t crc, uint8_t *dst, const uint8_t *src, uint32_t leng) {
+#ifdef SAUNAFS_HAVE_CRC_CLMUL
+	if (gCrcClmulKernel.copy != nullptr && leng >= gCrcClmulKernel.min_length) {
+		uint32_t bulk = leng & ~15U;
+		crc = ~gCrcClmulKernel.copy(~crc, src, dst, bulk);
+		src += bulk;
+		dst += bulk;
+		leng -= bulk;
+	}
+#endif
+	// Copy in pieces that fit in L1 cache, so that checksumming reads the copied data from it
+	constexpr uint32_t kPieceSize = 4096;
+	while (leng > 0) {
+		uint32_t piece = std::min(leng, kPieceSize);
+		memcpy(dst, src, piece);
+		crc = mycrc32_generic(crc, dst, piece);
+		src += piece;
+		dst += piece;
+		leng -= piece;
+	}
+	return crc;
+}
+
 #endif // ENABLE_CRC
 
 void recompute_crc_if_block_empty(uint8_t* block, uint32_t& crc) {
@@ -25,6 +25,8 @@
 #include <inttypes.h>
 
 uint32_t mycrc32(uint32_t crc,const uint8_t *block,uint32_t leng);
+/// Copies leng bytes from src to dst and returns mycrc32(crc, src, leng), reading src only once.
+uint32_t mycrc32_copy(uint32_t crc, uint8_t *dst, const uint8_t *src, uint32_t leng);
 uint32_t mycrc32_combine(uint32_t crc1, uint32_t crc2, uint32_t leng2);
 #define mycrc32_zeroblock(crc,zeros) mycrc32_combine((crc)^0xFFFFFFFF,0xFFFFFFFF,(zeros))
 #define mycrc32_zeroexpanded(crc,block,leng,zeros) mycrc32_zeroblock(mycrc32((crc),(block),(leng)),(zeros))
@@ -21,9 +21,12 @@
 #include "common/platform.h"
 #include "common/crc.h"
 
+#include <algorithm>
+#include <cstring>
 #include <string>
 #include <gtest/gtest.h>
 
+#include "common/time_utils.h"
 #include "protocol/SFSCommunication.h"
 
 TEST(CrcTests, MyCrc32) {
@@ -63,3 +66,90 @@ TEST(CrcTests, MyCrc32Combine) {
 		}
 	}
 }
+
+static uint32_t bitwiseCrc32(uint32_t crc, const uint8_t *block, uint32_t leng) {
+	crc = ~crc;
+	while (leng--) {
+		crc ^= *block++;
+		for (int bit = 0; bit < 8; ++bit) {
+			crc = (crc >> 1) ^ ((crc & 1) ? CRC_POLY : 0);
+		}
+	}
+	return ~crc;
+}
+
+TEST(CrcTests, MyCrc32AllLengthsAndAlignments) {
+	std::vector<uint8_t> data(SFSBLOCKSIZE + 64);
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = (i * 7919) >> 3;
+	}
+	std::vector<uint32_t> lengths;
+	for (uint32_t length = 0; length <= 1100; ++length) {
+		lengths.push_back(length);
+	}
+	lengths.push_back(SFSBLOCKSIZE - 1);
+	lengths.push_back(SFSBLOCKSIZE);
+	for (uint32_t offset : {0, 1, 3, 8, 15, 33}) {
+		for (uint32_t length : lengths) {
+			SCOPED_TRACE("offset=" + std::to_string(offset) + " length=" + std::to_string(length));
+			uint32_t expected = bitwiseCrc32(0x12345678, data.data() + offset, length);
+			ASSERT_EQ(expected, mycrc32(0x12345678, data.data() + offset, length));
+
+			std::vector<uint8_t> copy(length + 1, 0xAB);
+			ASSERT_EQ(expected, mycrc32_copy(0x12345678, copy.data() + 1, data.data() + offset,
+			                                 length));
+			ASSERT_TRUE(std::equal(copy.begin() + 1, copy.end(), data.begin() + offset));
+			ASSERT_EQ(0xAB, copy[0]);
+		}
+	}
+}
+
+// Run explicitly with --gtest_also_run_disabled_tests, the speeds are recorded
+// as properties of the test in the XML report (--gtest_output=xml)
+TEST(CrcTests, DISABLED_MyCrc32Benchmark) {
+	constexpr int kBlocks = 256;
+	constexpr int kRepeatCount = 20;
+	std::vector<uint8_t> source(kBlocks * SFSBLOCKSIZE), destination(source.size());
+	for (size_t i = 0; i < source.size(); ++i) {
+		source[i] = i * 31;
+	}
+	auto report = [](const char *name, Timer &time) {
+		int64_t speed = (int64_t)kBlocks * SFSBLOCKSIZE * kRepeatCount / time.elapsed_us();
+		::testing::Test::RecordProperty(name, std::to_string(speed) + "MB/s");
+	};
+
+	uint64_t crcSum = 0;
+	Timer time;
+	for (int i = 0; i < kRepeatCount; ++i) {
+		for (int block = 0; block < kBlocks; ++block) {
+			crcSum += mycrc32(0, source.data() + block * SFSBLOCKSIZE, SFSBLOCKSIZE);
+		}
+	}
+	report("mycrc32", time);
+
+	uint64_t memcpyCrcSum = 0;
+	time.reset();
+	for (int i = 0; i < kRepeatCount; ++i) {
+		for (int block = 0; block < kBlocks; ++block) {
+			memcpy(destination.data() + block * SFSBLOCKSIZE, source.data() + block * SFSBLOCKSIZE,
+			       SFSBLOCKSIZE);
+			memcpyCrcSum += mycrc32(0, destination.data() + block * SFSBLOCKSIZE, SFSBLOCKSIZE);
+		}
+	}
+	report("memcpy + mycrc32", time);
+
+	uint64_t copyCrcSum = 0;
+	std::fill(destination.begin(), destination.end(), 0);
+	time.reset();
+	for (int i = 0; i < kRepeatCount; ++i) {
+		for (int block = 0; block < kBlocks; ++block) {
+			copyCrcSum += mycrc32_copy(0, destination.data() + block * SFSBLOCKSIZE,
+			                           source.data() + block * SFSBLOCKSIZE, SFSBLOCKSIZE);
+		}
+	}
+	report("mycrc32_copy", time);
+
+	EXPECT_EQ(crcSum, memcpyCrcSum);
+	EXPECT_EQ(crcSum, copyCrcSum);
+	EXPECT_EQ(source, destination);
+}
@@ -27,3 +27,11 @@
 SAUNAFS_DEFINE_SERIALIZABLE_CLASS(JobInfo,
 		uint64_t, id,
 		std::string, description);
+
+/// Progress of a job, reported by masters which support listTasks::kWithProgress.
+SAUNAFS_DEFINE_SERIALIZABLE_CLASS(JobProgressInfo,
+		uint64_t, id,
+		std::string, description,
+		uint64_t, processed_entries,
+		uint64_t, queued_tasks,
+		uint32_t, running_time);
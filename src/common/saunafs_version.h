@@ -47,3 +47,5 @@ constexpr uint32_t kFirstECVersion = saunafsVersion(3, 9, 5);
 constexpr uint32_t kACL11Version = saunafsVersion(3, 11, 0);
 constexpr uint32_t kRichACLVersion = saunafsVersion(3, 12, 0);
 constexpr uint32_t kEC2Version = saunafsVersion(3, 13, 0);
+constexpr uint32_t kFuseBatchVersion = saunafsVersion(4, 1, 0);
+constexpr uint32_t kDiskLoadStatusVersion = saunafsVersion(4, 1, 0);
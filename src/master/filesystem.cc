@@ -32,8 +32,10 @@
 #include "master/goal_config_loader.h"
 #include "master/filesystem_checksum_updater.h"
 #include "master/filesystem_metadata.h"
+#include "master/filesystem_node.h"
 #include "master/filesystem_operations.h"
 #include "master/filesystem_periodic.h"
+#include "master/filesystem_quota.h"
 #include "master/filesystem_snapshot.h"
 #include "master/filesystem_store.h"
 #include "master/matoclserv.h"
@@ -373,6 +375,8 @@ int fs_init(bool doLoad) {
 		fs_loadall();
 	}
 	eventloop_reloadregister(fs_reload);
+	eventloop_eachloopregister(fsnodes_propagate_stats);
+	eventloop_eachloopregister(fsnodes_quota_flush_usage);
 	metadataserver::registerFunctionCalledOnPromotion(fs_become_master);
 	auto metadataDumpPeriod = cfg_getint32("METADATA_DUMP_PERIOD_SECONDS", 3600);
 	if (metadataDumpPeriod > 0) {  /// 0 means disabled periodic metadata dumps
@@ -146,7 +146,7 @@ uint8_t fs_getgoal(const FsContext &context,uint32_t inode,uint8_t gmode,GoalSta
 uint8_t fs_gettrashtime_prepare(const FsContext &context, uint32_t inode, uint8_t gmode, TrashtimeMap &fileTrashtimes, TrashtimeMap &dirTrashtimes);
 uint8_t fs_geteattr(const FsContext &context,uint32_t inode,uint8_t gmode,uint32_t feattrtab[16],uint32_t deattrtab[16]);
 uint8_t fs_listxattr_leng(const FsContext &context,uint32_t inode,uint8_t opened,void **xanode,uint32_t *xasize);
-uint8_t fs_getxattr(const FsContext &context,uint32_t inode,uint8_t opened,uint8_t anleng,const uint8_t *attrname,uint32_t *avleng,uint8_t **attrvalue);
+uint8_t fs_getxattr(const FsContext &context,uint32_t inode,uint8_t opened,uint8_t anleng,const uint8_t *attrname,uint32_t *avleng,const uint8_t **attrvalue);
 uint8_t fs_setxattr(const FsContext &context,uint32_t inode,uint8_t opened,uint8_t anleng,const uint8_t *attrname,uint32_t avleng,const uint8_t *attrvalue,uint8_t mode);
 uint8_t fs_quota_get_all(const FsContext &context, std::vector<QuotaEntry> &results);
 uint8_t fs_quota_get(const FsContext &context, const std::vector<QuotaOwner> &owners,
@@ -248,6 +248,10 @@ const Goal& fs_get_goal_definition(uint8_t goalId);
 
 /// Return info about currently executed tasks
 std::vector<JobInfo> fs_get_current_tasks_info();
+
+/// Return progress of currently executed tasks
+std::vector<JobProgressInfo> fs_get_current_tasks_progress(uint32_t ts);
+
 // Disable saving metadata on exit
 void fs_disable_metadata_dump_on_exit();
 
@@ -128,6 +128,10 @@ uint64_t fs_checksum(ChecksumMode mode) {
 	hashCombine(checksum, gMetadata->xattrChecksum);
 	hashCombine(checksum, gMetadata->quota_checksum);
 	hashCombine(checksum, chunk_checksum(mode));
+	// not combined when empty, so that the checksum is the same as in older versions
+	if (!gMetadata->lazy_snapshots.empty()) {
+		hashCombine(checksum, gMetadata->lazy_snapshots.checksum());
+	}
 	return checksum;
 }
 
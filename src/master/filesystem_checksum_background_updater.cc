@@ -85,13 +85,13 @@ bool ChecksumBackgroundUpdater::isNodeIncluded(FSNode *node) {
 	return ret;
 }
 
-bool ChecksumBackgroundUpdater::isXattrIncluded(xattr_data_entry *xde) {
+bool ChecksumBackgroundUpdater::isXattrIncluded(uint32_t inode) {
 	auto ret = false;
 	if (step_ > ChecksumRecalculatingStep::kXattrs) {
 		ret = true;
 	}
 	if (step_ == ChecksumRecalculatingStep::kXattrs &&
-	    xattr_data_hash_fn(xde->inode, xde->anleng, xde->attrname) < position_) {
+	    XattrStorage::shardOf(inode) < position_) {
 		ret = true;
 	}
 	if (ret) {
@@ -77,8 +77,8 @@ public:
 	// is node already included in the background checksum?
 	bool isNodeIncluded(FSNode *node);
 
-	// is xattr already included in the background checksum?
-	bool isXattrIncluded(xattr_data_entry *xde);
+	// are xattrs of the inode already included in the background checksum?
+	bool isXattrIncluded(uint32_t inode);
 
 	void setSpeedLimit(uint32_t value);
 
@@ -165,15 +165,17 @@ void fs_dumpfree() {
 }
 
 void xattr_dump() {
-	uint32_t i;
-	xattr_data_entry *xa;
-
-	for (i = 0; i < XATTR_DATA_HASH_SIZE; i++) {
-		for (xa = gMetadata->xattr_data_hash[i]; xa; xa = xa->next) {
-			printf("X|i:%10" PRIu32 "|n:%s|v:%s\n", xa->inode,
-			       fsnodes_escape_name(std::string((char*)xa->attrname, xa->anleng)).c_str(),
-			       fsnodes_escape_name(std::string((char*)xa->attrvalue, xa->avleng)).c_str());
-		}
+	for (uint32_t shard = 0; shard < XattrStorage::kShardCount; shard++) {
+		gMetadata->xattrs.forEachInode(shard, [](const XattrStorage::InodeEntry &entry) {
+			gMetadata->xattrs.forEachAttribute(entry, [&](const uint8_t *attrname,
+			                                              uint8_t anleng,
+			                                              const uint8_t *attrvalue,
+			                                              uint32_t avleng) {
+				printf("X|i:%10" PRIu32 "|n:%s|v:%s\n", entry.inode,
+				       fsnodes_escape_name(std::string((char*)attrname, anleng)).c_str(),
+				       fsnodes_escape_name(std::string((char*)attrvalue, avleng)).c_str());
+			});
+		});
 	}
 }
 
@@ -29,6 +29,7 @@
 #include "master/acl_storage.h"
 #include "master/chunks.h"
 #include "master/id_pool_detainer.h"
+#include "master/lazy_snapshot_map.h"
 #include "master/filesystem_checksum_background_updater.h"
 #include "master/filesystem_freenode.h"
 #include "master/filesystem_node_types.h"
@@ -43,8 +44,7 @@
  */
 struct FilesystemMetadata {
 public:
-	xattr_inode_entry *xattr_inode_hash[XATTR_INODE_HASH_SIZE];
-	xattr_data_entry *xattr_data_hash[XATTR_DATA_HASH_SIZE];
+	XattrStorage xattrs;
 	IdPoolDetainer<uint32_t, uint32_t> inode_pool;
 	AclStorage acl_storage;
 	TrashPathContainer trash;
@@ -54,6 +54,9 @@ public:
 	TaskManager task_manager;
 	FileLocks flock_locks;
 	FileLocks posix_locks;
+	LazySnapshotMap lazy_snapshots;
+	LazySnapshotCharges lazy_snapshot_charges;
+	DirStatsDeltas dirstats_deltas;
 
 	uint32_t maxnodeid;
 	uint32_t nextsessionid;
@@ -73,8 +76,7 @@ public:
 	uint64_t quota_checksum;
 
 	FilesystemMetadata()
-	    : xattr_inode_hash{},
-	      xattr_data_hash{},
+	    : xattrs{},
 	      inode_pool{SFS_INODE_REUSE_DELAY, 12,
 	                 MAX_REGULAR_INODE, MAX_REGULAR_INODE,
 	                 32 * 8 * 1024, 8 * 1024, 10},
@@ -85,6 +87,9 @@ public:
 	      task_manager{},
 	      flock_locks{},
 	      posix_locks{},
+	      lazy_snapshots{},
+	      lazy_snapshot_charges{},
+	      dirstats_deltas{},
 	      maxnodeid{},
 	      nextsessionid{},
 	      nodes{},
@@ -102,16 +107,6 @@ public:
 	}
 
 	~FilesystemMetadata() {
-		// Free memory allocated in xattr_inode_hash hashmap
-		for (uint32_t i = 0; i < XATTR_INODE_HASH_SIZE; ++i) {
-			freeListConnectedUsingNext(xattr_inode_hash[i]);
-		}
-
-		// Free memory allocated in xattr_data_hash hashmap
-		for (uint32_t i = 0; i < XATTR_DATA_HASH_SIZE; ++i) {
-			deleteListConnectedUsingNext(xattr_data_hash[i]);
-		}
-
 		// Free memory allocated in nodehash hashmap
 		for (uint32_t i = 0; i < NODEHASHSIZE; ++i) {
 			FSNode *node = nodehash[i];
@@ -122,29 +117,6 @@ public:
 			}
 		}
 	}
-
-private:
-	// Frees a C-style list with elements connected using e->next pointer and allocated using
-	// malloc
-	template <typename T>
-	void freeListConnectedUsingNext(T *&list) {
-		while (list != nullptr) {
-			T *next = list->next;
-			free(list);
-			list = next;
-		}
-	}
-
-	// Frees a C-style list with elements connected using e->next pointer and allocated using
-	// new
-	template <typename T>
-	void deleteListConnectedUsingNext(T *&list) {
-		while (list != nullptr) {
-			T *next = list->next;
-			delete list;
-			list = next;
-		}
-	}
 };
 
 extern FilesystemMetadata *gMetadata;
@@ -37,6 +37,7 @@
 #include "master/filesystem_operations.h"
 #include "master/filesystem_periodic.h"
 #include "master/filesystem_quota.h"
+#include "master/filesystem_snapshot.h"
 #include "master/fs_context.h"
 
 #ifndef NDEBUG
@@ -259,10 +260,37 @@ bool fsnodes_isancestor_or_node_reserved_or_trash(FSNodeDirectory *ancestor, FSN
 
 // stats
 
+static inline void fsnodes_stats_add(statsrecord *dst, const statsrecord *sr) {
+	dst->inodes += sr->inodes;
+	dst->dirs += sr->dirs;
+	dst->files += sr->files;
+	dst->chunks += sr->chunks;
+	dst->length += sr->length;
+	dst->size += sr->size;
+	dst->realsize += sr->realsize;
+}
+
+static inline void fsnodes_stats_sub(statsrecord *dst, const statsrecord *sr) {
+	dst->inodes -= sr->inodes;
+	dst->dirs -= sr->dirs;
+	dst->files -= sr->files;
+	dst->chunks -= sr->chunks;
+	dst->length -= sr->length;
+	dst->size -= sr->size;
+	dst->realsize -= sr->realsize;
+}
+
 void fsnodes_get_stats(FSNode *node, statsrecord *sr) {
 	switch (node->type) {
 	case FSNode::kDirectory:
 		*sr = static_cast<FSNodeDirectory*>(node)->stats;
+		{
+			// changes not propagated yet are added to the parents by fsnodes_propagate_stats
+			auto it = gMetadata->dirstats_deltas.find(node->id);
+			if (it != gMetadata->dirstats_deltas.end()) {
+				fsnodes_stats_sub(sr, &it->second);
+			}
+		}
 		sr->inodes++;
 		sr->dirs++;
 		break;
@@ -314,41 +342,50 @@ FSNodeDirectory *fsnodes_get_first_parent(FSNode *node) {
 	return parent;
 }
 
+/*! \brief Subtract statistics of a removed child from \a parent.
+ *
+ * Only \a parent is updated immediately. Ancestors are updated by fsnodes_propagate_stats,
+ * so the cost of a change does not depend on the depth of the tree.
+ */
 static inline void fsnodes_sub_stats(FSNodeDirectory *parent, statsrecord *sr) {
-	statsrecord *psr;
 	if (parent) {
-		psr = &parent->stats;
-		psr->inodes -= sr->inodes;
-		psr->dirs -= sr->dirs;
-		psr->files -= sr->files;
-		psr->chunks -= sr->chunks;
-		psr->length -= sr->length;
-		psr->size -= sr->size;
-		psr->realsize -= sr->realsize;
+		fsnodes_stats_sub(&parent->stats, sr);
 		if (parent != gMetadata->root) {
-			for (auto inode : parent->parent) {
-				FSNodeDirectory *node = fsnodes_id_to_node_verify<FSNodeDirectory>(inode);
-				fsnodes_sub_stats(node, sr);
-			}
+			fsnodes_stats_sub(&gMetadata->dirstats_deltas[parent->id], sr);
 		}
 	}
 }
 
+/*! \brief Add statistics of a new or changed child to \a parent.
+ *
+ * See fsnodes_sub_stats.
+ */
 void fsnodes_add_stats(FSNodeDirectory *parent, statsrecord *sr) {
-	statsrecord *psr;
 	if (parent) {
-		psr = &parent->stats;
-		psr->inodes += sr->inodes;
-		psr->dirs += sr->dirs;
-		psr->files += sr->files;
-		psr->chunks += sr->chunks;
-		psr->length += sr->length;
-		psr->size += sr->size;
-		psr->realsize += sr->realsize;
+		fsnodes_stats_add(&parent->stats, sr);
 		if (parent != gMetadata->root) {
-			for (auto inode : parent->parent) {
-				FSNodeDirectory *node = fsnodes_id_to_node_verify<FSNodeDirectory>(inode);
-				fsnodes_add_stats(node, sr);
+			fsnodes_stats_add(&gMetadata->dirstats_deltas[parent->id], sr);
+		}
+	}
+}
+
+void fsnodes_propagate_stats() {
+	if (!gMetadata) {
+		return;
+	}
+	// Each round moves pending changes one level up. Changes of siblings are merged in
+	// their common parent, so each directory is updated at most once per round.
+	while (!gMetadata->dirstats_deltas.empty()) {
+		DirStatsDeltas deltas;
+		deltas.swap(gMetadata->dirstats_deltas);
+		for (auto &entry : deltas) {
+			FSNode *node = fsnodes_id_to_node(entry.first);
+			if (!node || node->type != FSNode::kDirectory) {
+				continue;
+			}
+			for (auto inode : node->parent) {
+				fsnodes_add_stats(fsnodes_id_to_node_verify<FSNodeDirectory>(inode),
+				                  &entry.second);
 			}
 		}
 	}
@@ -477,6 +514,7 @@ void fsnodes_fill_attr(const FsContext &context, FSNode *node, FSNode *parent, A
 
 void fsnodes_remove_edge(uint32_t ts, FSNodeDirectory *parent, const HString &name, FSNode *node) {
 	assert(parent);
+	fsnodes_lazy_snapshot_before_change(ts, parent);
 
 	auto dir_it = parent->find(name);
 	assert(dir_it != parent->end());
@@ -508,6 +546,7 @@ void fsnodes_remove_edge(uint32_t ts, FSNodeDirectory *parent, const HString &na
 }
 
 void fsnodes_link(uint32_t ts, FSNodeDirectory *parent, FSNode *child, const HString &name) {
+	fsnodes_lazy_snapshot_before_change(ts, parent);
 	parent->entries.insert({hstorage::Handle(name), child});
 	parent->entries_hash ^= name.hash();
 
@@ -1072,6 +1111,7 @@ uint8_t fsnodes_appendchunks(uint32_t ts, FSNodeFile *dst, FSNodeFile *src) {
 	if (src->chunks.empty()) {
 		return SAUNAFS_STATUS_OK;
 	}
+	fsnodes_lazy_snapshot_before_change(ts, dst);
 
 	uint32_t src_chunks = src->chunkCount();
 	uint32_t dst_chunks = dst->chunkCount();
@@ -1228,11 +1268,15 @@ static inline void fsnodes_remove_node(uint32_t ts, FSNode *toremove) {
 		removeFromChecksum(gChecksumBackgroundUpdater.fsNodesChecksum, toremove->checksum);
 	}
 	removeFromChecksum(gMetadata->fsNodesChecksum, toremove->checksum);
+	if (!gMetadata->lazy_snapshots.empty()) {
+		fsnodes_lazy_snapshot_remove_node(toremove);
+	}
 	// and free
 	gMetadata->nodes--;
 	gMetadata->acl_storage.erase(toremove->id);
 	if (toremove->type == FSNode::kDirectory) {
 		gMetadata->dirnodes--;
+		gMetadata->dirstats_deltas.erase(toremove->id);
 	}
 	if (toremove->type == FSNode::kFile || toremove->type == FSNode::kTrash ||
 	    toremove->type == FSNode::kReserved) {
@@ -1531,6 +1575,7 @@ void fsnodes_setgoal_recursive(FSNode *node, uint32_t ts, uint32_t uid, uint8_t
 
 	if (node->type == FSNode::kFile || node->type == FSNode::kDirectory || node->type == FSNode::kTrash ||
 	    node->type == FSNode::kReserved) {
+		fsnodes_lazy_snapshot_before_change(ts, node);
 		if ((node->mode & (EATTR_NOOWNER << 12)) == 0 && uid != 0 && node->uid != uid) {
 			(*nsinodes)++;
 		} else {
@@ -1564,6 +1609,7 @@ void fsnodes_settrashtime_recursive(FSNode *node, uint32_t ts, uint32_t uid, uin
 
 	if (node->type == FSNode::kFile || node->type == FSNode::kDirectory || node->type == FSNode::kTrash ||
 	    node->type == FSNode::kReserved) {
+		fsnodes_lazy_snapshot_before_change(ts, node);
 		if ((node->mode & (EATTR_NOOWNER << 12)) == 0 && uid != 0 && node->uid != uid) {
 			(*nsinodes)++;
 		} else {
@@ -1616,6 +1662,7 @@ void fsnodes_seteattr_recursive(FSNode *node, uint32_t ts, uint32_t uid, uint8_t
 				uint32_t *nsinodes) {
 	uint8_t neweattr, seattr;
 
+	fsnodes_lazy_snapshot_before_change(ts, node);
 	if ((node->mode & (EATTR_NOOWNER << 12)) == 0 && uid != 0 && node->uid != uid) {
 		(*nsinodes)++;
 	} else {
@@ -1659,6 +1706,7 @@ void fsnodes_seteattr_recursive(FSNode *node, uint32_t ts, uint32_t uid, uint8_t
 }
 
 uint8_t fsnodes_deleteacl(FSNode *p, AclType type, uint32_t ts) {
+	fsnodes_lazy_snapshot_before_change(ts, p);
 	if (type == AclType::kRichACL) {
 		gMetadata->acl_storage.erase(p->id);
 	} else if (type == AclType::kDefault) {
@@ -1712,6 +1760,7 @@ uint8_t fsnodes_setacl(FSNode *p, const RichACL &acl, uint32_t ts) {
 	if (!acl.checkInheritFlags(p->type == FSNode::kDirectory)) {
 		return SAUNAFS_ERROR_ENOTSUP;
 	}
+	fsnodes_lazy_snapshot_before_change(ts, p);
 
 	uint16_t mode = p->mode;
 	if (RichACL::equivMode(acl, mode, p->type == FSNode::kDirectory)) {
@@ -1742,6 +1791,7 @@ uint8_t fsnodes_setacl(FSNode *p, AclType type, const AccessControlList &acl, ui
 	if (type == AclType::kDefault && p->type != FSNode::kDirectory) {
 		return SAUNAFS_ERROR_ENOTSUP;
 	}
+	fsnodes_lazy_snapshot_before_change(ts, p);
 
 	const RichACL *node_acl = gMetadata->acl_storage.get(p->id);
 	RichACL new_acl;
@@ -1908,6 +1958,10 @@ uint8_t fsnodes_get_node_for_operation(const FsContext &context, ExpectedNodeTyp
 	    !fsnodes_access(context, p, modemask)) {
 		return SAUNAFS_ERROR_EACCES;
 	}
+	if (modemask & MODE_MASK_W) {
+		// entries of a directory are looked up before they are changed
+		fsnodes_lazy_snapshot_materialize(context.ts(), p);
+	}
 	*ret = p;
 	if (ret_rn) {
 		*ret_rn = rn;
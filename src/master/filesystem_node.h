@@ -181,6 +181,11 @@ void fsnodes_checkfile(FSNodeFile *p, uint32_t chunkcount[CHUNK_MATRIX_SIZE]);
 
 bool fsnodes_has_tape_goal(FSNode *node);
 void fsnodes_add_sub_stats(FSNodeDirectory *parent, statsrecord *newsr, statsrecord *prevsr);
+/*! \brief Propagate pending directory statistics changes to all ancestors.
+ *
+ * Called once per main loop iteration and before directory statistics are reported.
+ */
+void fsnodes_propagate_stats();
 
 void fsnodes_getgoal_recursive(FSNode *node, uint8_t gmode, GoalStatistics &fgtab,
 		GoalStatistics &dgtab);
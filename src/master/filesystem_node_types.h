@@ -75,6 +75,12 @@ struct statsrecord {
 	uint64_t realsize;
 };
 
+/// Changes of directory statistics not yet added to the ancestors of the directory.
+typedef std::unordered_map<uint32_t, statsrecord> DirStatsDeltas;
+
+/// Statistics of the source entries charged to lazy copies which were not materialized yet.
+typedef std::unordered_map<uint32_t, statsrecord> LazySnapshotCharges;
+
 /*! \brief Node containing common meta data for each file system object (file or directory).
  *
  * Node size = 64B
@@ -34,6 +34,7 @@
 #include "master/filesystem_checksum_updater.h"
 #include "master/filesystem_node.h"
 #include "master/filesystem_quota.h"
+#include "master/filesystem_snapshot.h"
 #include "master/fs_context.h"
 #include "master/locks.h"
 #include "master/matocsserv.h"
@@ -43,13 +44,14 @@
 #include "master/task_manager.h"
 #include "protocol/matocl.h"
 
-std::array<uint32_t, FsStats::Size> gFsStatsArray = {{}};
+std::array<std::atomic<uint32_t>, FsStats::Size> gFsStatsArray = {};
 
 static const char kAclXattrs[] = "system.richacl";
 
 void fs_retrieve_stats(std::array<uint32_t, FsStats::Size> &output_stats) {
-	output_stats = gFsStatsArray;
-	gFsStatsArray.fill(0);
+	for (size_t i = 0; i < gFsStatsArray.size(); ++i) {
+		output_stats[i] = gFsStatsArray[i].exchange(0);
+	}
 }
 
 static const int kInitialTaskBatchSize = 1000;
@@ -462,6 +464,7 @@ uint8_t fs_whole_path_lookup(const FsContext &context, uint32_t parent, const st
 		auto delim_it = std::find(current_it, path.end(), '/');
 		if (current_it != delim_it) {
 			HString hstr(current_it, delim_it);
+			fs_lazy_snapshot_prepare(context, parent);
 			status = fs_lookup(context, parent, hstr, &tmp_inode, attr);
 			if (status != SAUNAFS_STATUS_OK) {
 				return status;
@@ -521,6 +524,7 @@ uint8_t fs_try_setlength(const FsContext &context, uint32_t inode, uint8_t opene
 	if (status != SAUNAFS_STATUS_OK) {
 		return status;
 	}
+	fsnodes_lazy_snapshot_before_change(ts, p);
 
 	FSNodeFile *node_file = static_cast<FSNodeFile*>(p);
 
@@ -635,6 +639,7 @@ uint8_t fs_do_setlength(const FsContext &context, uint32_t inode, uint64_t lengt
 		return status;
 	}
 
+	fsnodes_lazy_snapshot_before_change(ts, p);
 	fsnodes_setlength(static_cast<FSNodeFile*>(p), length);
 	fs_changelog(ts, "LENGTH(%" PRIu32 ",%" PRIu64 ")", inode, static_cast<FSNodeFile*>(p)->length);
 	p->mtime = ts;
@@ -665,6 +670,8 @@ uint8_t fs_setattr(const FsContext &context, uint32_t inode, uint8_t setmask, ui
 		return status;
 	}
 
+	fsnodes_lazy_snapshot_before_change(ts, p);
+
 	if (context.uid() != 0 && (context.sesflags() & SESFLAG_MAPALL) && (setmask & (SET_UID_FLAG | SET_GID_FLAG))) {
 		return SAUNAFS_ERROR_EPERM;
 	}
@@ -1142,6 +1149,7 @@ uint8_t fs_rmdir(const FsContext &context, uint32_t parent, const HString &name)
 	if (child->type != FSNode::kDirectory) {
 		return SAUNAFS_ERROR_ENOTDIR;
 	}
+	fsnodes_lazy_snapshot_materialize(ts, child);
 	if (!static_cast<FSNodeDirectory*>(child)->entries.empty()) {
 		return SAUNAFS_ERROR_ENOTEMPTY;
 	}
@@ -1233,6 +1241,7 @@ uint8_t fs_rename(const FsContext &context, uint32_t parent_src, const HString &
 	}
 
 	if (de_child) {
+		fsnodes_lazy_snapshot_materialize(context.ts(), de_child);
 		if (de_child->type == FSNode::kDirectory && !static_cast<FSNodeDirectory*>(de_child)->entries.empty()) {
 			return SAUNAFS_ERROR_ENOTEMPTY;
 		}
@@ -1664,6 +1673,10 @@ uint8_t fs_readdir_size(const FsContext &context, uint32_t inode, uint8_t flags,
 		return status;
 	}
 
+	// a lazy snapshot gets its own entries, like the access time, when it is listed
+	uint32_t ts = eventloop_time();
+	ChecksumUpdater cu(ts);
+	fsnodes_lazy_snapshot_materialize(ts, p);
 	*dnode = p;
 	*dbuffsize = fsnodes_getdirsize(static_cast<FSNodeDirectory*>(p), flags & GETDIR_FLAG_WITHATTR);
 	return SAUNAFS_STATUS_OK;
@@ -1698,6 +1711,7 @@ uint8_t fs_readdir(const FsContext &context, uint32_t inode, uint64_t first_entr
 	uint32_t ts = eventloop_time();
 	ChecksumUpdater cu(ts);
 
+	fsnodes_lazy_snapshot_materialize(ts, dir);
 	fs_update_atime(dir, ts);
 
 	using legacy::fsnodes_getdir;
@@ -1917,6 +1931,7 @@ uint8_t fs_writechunk(const FsContext &context, uint32_t inode, uint32_t indx, b
 	if (indx > MAX_INDEX) {
 		return SAUNAFS_ERROR_INDEXTOOBIG;
 	}
+	fsnodes_lazy_snapshot_before_change(context.ts(), p);
 #ifndef METARESTORE
 	if (gMagicAutoFileRepair && context.isPersonalityMaster()) {
 		fs_auto_repair_if_needed(p, indx);
@@ -2013,6 +2028,7 @@ uint8_t fs_writeend(uint32_t inode, uint64_t length, uint64_t chunkid, uint32_t
 			return SAUNAFS_ERROR_EPERM;
 		}
 		if (length > p->length) {
+			fsnodes_lazy_snapshot_before_change(ts, p);
 			fsnodes_setlength(p, length);
 			p->mtime = ts;
 			fsnodes_update_ctime(p, ts);
@@ -2060,6 +2076,7 @@ uint8_t fs_repair(const FsContext &context, uint32_t inode,
 		return status;
 	}
 
+	fsnodes_lazy_snapshot_before_change(ts, p);
 	FSNodeFile *node_file = static_cast<FSNodeFile*>(p);
 	fsnodes_get_stats(p, &psr);
 	for (indx = 0; indx < node_file->chunks.size(); indx++) {
@@ -2551,6 +2568,7 @@ uint8_t fs_setxattr(const FsContext &context, uint32_t inode, uint8_t opened,
 	if (mode > XATTR_SMODE_REMOVE) {
 		return SAUNAFS_ERROR_EINVAL;
 	}
+	fsnodes_lazy_snapshot_before_change(ts, p);
 	status = xattr_setattr(p->id, anleng, attrname, avleng, attrvalue, mode);
 	if (status != SAUNAFS_STATUS_OK) {
 		return status;
@@ -2566,7 +2584,7 @@ uint8_t fs_setxattr(const FsContext &context, uint32_t inode, uint8_t opened,
 
 uint8_t fs_getxattr(const FsContext &context, uint32_t inode, uint8_t opened,
 		uint8_t anleng, const uint8_t *attrname,
-		uint32_t *avleng, uint8_t **attrvalue) {
+		uint32_t *avleng, const uint8_t **attrvalue) {
 	FSNode *p;
 
 	uint8_t status = verify_session(context, OperationMode::kReadOnly, SessionType::kNotMeta);
@@ -2815,6 +2833,7 @@ uint8_t fs_get_dir_stats(const FsContext &context, uint32_t inode, uint32_t *ino
 		return status;
 	}
 
+	fsnodes_propagate_stats();
 	fsnodes_get_stats(p, &sr);
 	*inodes = sr.inodes;
 	*dirs = sr.dirs;
@@ -2884,6 +2903,10 @@ std::vector<JobInfo> fs_get_current_tasks_info() {
 	return gMetadata->task_manager.getCurrentJobsInfo();
 }
 
+std::vector<JobProgressInfo> fs_get_current_tasks_progress(uint32_t ts) {
+	return gMetadata->task_manager.getCurrentJobsProgress(ts);
+}
+
 uint8_t fs_cancel_job(uint32_t job_id) {
 	if (gMetadata->task_manager.cancelJob(job_id)) {
 		return SAUNAFS_STATUS_OK;
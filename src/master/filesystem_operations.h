@@ -22,6 +22,8 @@
 
 #include "common/platform.h"
 
+#include <array>
+#include <atomic>
 #include <map>
 
 #include "common/goal.h"
@@ -55,7 +57,8 @@ enum {
 };
 }
 
-extern std::array<uint32_t, FsStats::Size> gFsStatsArray;
+// atomic, as read-only operations can be executed by many threads at once
+extern std::array<std::atomic<uint32_t>, FsStats::Size> gFsStatsArray;
 
 void fs_retrieve_stats(std::array<uint32_t, FsStats::Size> &output_stats);
 
@@ -37,7 +37,9 @@
 #include "master/filesystem_metadata.h"
 #include "master/filesystem_node.h"
 #include "master/filesystem_operations.h"
+#include "master/hstorage_init.h"
 #include "master/matoclserv.h"
+#include "master/metadata_reader_pool.h"
 
 #define MSGBUFFSIZE 1000000
 #define ERRORS_LOG_MAX 500
@@ -61,6 +63,9 @@ static uint32_t fsinfo_unavailtrashfiles = 0;
 static uint32_t fsinfo_unavailreservedfiles = 0;
 
 static int gTasksBatchSize = 1000;
+static constexpr uint32_t kMaxTaskPlannerThreads = 64;
+/// Threads listing directories for recursive operations before each batch of tasks.
+static MetadataReaderPool gTaskPlannerPool;
 
 static int gFileTestLoopTime = 300;
 static int gFileTestLoopIndex = 0;
@@ -86,6 +91,12 @@ void fs_background_task_manager_work() {
 	if (gMetadata->task_manager.workAvailable()) {
 		uint32_t ts = eventloop_time();
 		ChecksumUpdater cu(ts);
+		if (gTaskPlannerPool.threadCount() > 0) {
+			for (TaskManager::Task *task : gMetadata->task_manager.startPlanning()) {
+				gTaskPlannerPool.add([task]() { task->plan(gTasksBatchSize); }, []() {});
+			}
+			gTaskPlannerPool.run();
+		}
 		gMetadata->task_manager.processJobs(ts, gTasksBatchSize);
 		if (gMetadata->task_manager.workAvailable()) {
 			eventloop_make_next_poll_nonblocking();
@@ -289,21 +300,19 @@ void fs_background_checksum_recalculation_a_bit() {
 		}
 		break;
 	case ChecksumRecalculatingStep::kXattrs:
-		// Xattrs are in a hashtable, therefore they can be recalculated in multiple steps.
-		while (gChecksumBackgroundUpdater.getPosition() < XATTR_DATA_HASH_SIZE) {
-			for (xattr_data_entry *xde =
-			             gMetadata->xattr_data_hash[gChecksumBackgroundUpdater
-			                                                .getPosition()];
-			     xde; xde = xde->next) {
-				xattr_checksum_add_to_background(xde);
+		// Xattrs are split into shards, therefore they can be recalculated in multiple steps.
+		while (gChecksumBackgroundUpdater.getPosition() < (int32_t)XattrStorage::kShardCount) {
+			gMetadata->xattrs.forEachInode(gChecksumBackgroundUpdater.getPosition(),
+			                               [&](XattrStorage::InodeEntry &entry) {
+				xattr_checksum_add_to_background(entry);
 				++recalculated;
-			}
+			});
 			gChecksumBackgroundUpdater.incPosition();
 			if (recalculated >= gChecksumBackgroundUpdater.getSpeedLimit()) {
 				break;
 			}
 		}
-		if (gChecksumBackgroundUpdater.getPosition() == XATTR_DATA_HASH_SIZE) {
+		if (gChecksumBackgroundUpdater.getPosition() == (int32_t)XattrStorage::kShardCount) {
 			gChecksumBackgroundUpdater.incStep();
 		}
 		break;
@@ -593,6 +602,13 @@ uint8_t fs_apply_emptyreserved_deprecated(uint32_t /*ts*/,uint32_t /*freeinodes*
 #ifndef METARESTORE
 void fs_read_periodic_config_file() {
 	gFileTestLoopTime = cfg_get_minmaxvalue<uint32_t>("FILE_TEST_LOOP_MIN_TIME", 3600, FILETESTSMINLOOPTIME, FILETESTSMAXLOOPTIME);
+	uint32_t plannerThreads = cfg_get_maxvalue("TASK_PLANNER_THREADS", 0U, kMaxTaskPlannerThreads);
+	if (plannerThreads > 0 && !hstorage_supports_concurrent_reads()) {
+		safs_pretty_syslog(LOG_WARNING, "TASK_PLANNER_THREADS is not supported with "
+				"USE_BDB_FOR_NAME_STORAGE - planning recursive operations in the main thread");
+		plannerThreads = 0;
+	}
+	gTaskPlannerPool.setThreadCount(plannerThreads);
 }
 
 void fs_periodic_master_init() {
@@ -68,6 +68,9 @@ uint8_t fs_quota_get_all(const FsContext &context, std::vector<QuotaEntry> &resu
 	}
 	results = gMetadata->quota_database.getEntriesWithStats();
 
+	// usage of directories is read from their statistics, which have to include all descendants
+	fsnodes_propagate_stats();
+
 	for (auto &entry : results) {
 		if (entry.entryKey.owner.ownerType != QuotaOwnerType::kInode ||
 		    entry.entryKey.rigor != QuotaRigor::kUsed) {
@@ -126,6 +129,9 @@ uint8_t fs_quota_get(const FsContext &context,
 		}
 		auto result = gMetadata->quota_database.get(owner.ownerType, owner.ownerId);
 		if (result) {
+			if (owner.ownerType == QuotaOwnerType::kInode) {
+				fsnodes_propagate_stats();
+			}
 			for (auto rigor : {QuotaRigor::kSoft, QuotaRigor::kHard, QuotaRigor::kUsed}) {
 				if (owner.ownerType == QuotaOwnerType::kInode && rigor == QuotaRigor::kUsed) {
 					node = fsnodes_id_to_node<FSNodeDirectory>(owner.ownerId);
@@ -384,10 +390,17 @@ bool fsnodes_quota_exceeded_ug(FSNode *node,
 
 bool fsnodes_quota_exceeded_dir(FSNode *node,
 		const std::initializer_list<std::pair<QuotaResource, int64_t>> &resource_list) {
-	if (!node) {
+	// Without directory quotas there is no need to walk the tree.
+	if (!node || !gMetadata->quota_database.hasHardLimits(QuotaOwnerType::kInode)) {
 		return false;
 	}
 
+	// Ancestors are checked against their own statistics, so changes made deeper in the
+	// tree since the last loop have to reach them first. Otherwise a burst of changes could
+	// overrun a hard limit, and metarestore, which checks quota when replaying CLONE,
+	// could disagree with the master.
+	fsnodes_propagate_stats();
+
 	if (fsnodes_test_dir_quota_noparents(node, resource_list)) {
 		return true;
 	}
@@ -415,6 +428,13 @@ bool fsnodes_quota_exceeded_dir(FSNode *node,
 
 bool fsnodes_quota_exceeded_dir(FSNodeDirectory *node, FSNodeDirectory* prev_node,
 		const std::initializer_list<std::pair<QuotaResource, int64_t>> &resource_list) {
+	if (!gMetadata->quota_database.hasHardLimits(QuotaOwnerType::kInode)) {
+		return false;
+	}
+
+	// see fsnodes_quota_exceeded_dir above
+	fsnodes_propagate_stats();
+
 	// Because nodes are directories fsnodes_find_common_ancestor
 	// is guaranteed to work properly.
 	FSNode *common = fsnodes_find_common_ancestor(prev_node, node);
@@ -463,6 +483,13 @@ void fsnodes_quota_update(FSNode *node,
 	}
 }
 
+void fsnodes_quota_flush_usage() {
+	if (!gMetadata) {
+		return;
+	}
+	gMetadata->quota_database.flushUsage();
+}
+
 void fsnodes_quota_remove(QuotaOwnerType owner_type, uint32_t owner_id) {
 	gMetadata->quota_database.remove(owner_type, owner_id);
 	gMetadata->quota_checksum = gMetadata->quota_database.checksum();
@@ -76,6 +76,12 @@ bool fsnodes_quota_exceeded(FSNode *node,
 void fsnodes_quota_update(FSNode *node,
 	const std::initializer_list<std::pair<QuotaResource, int64_t>> &resource_list);
 
+/*! \brief Apply usage changes coalesced by fsnodes_quota_update.
+ *
+ * Called once per main loop iteration.
+ */
+void fsnodes_quota_flush_usage();
+
 /*! \brief Remove quota.
  * \param owner_type Owner type (user, group, inode(directory)).
  * \param owner_id Owner id.
@@ -21,18 +21,278 @@
 
 #include "common/cfg.h"
 #include "common/main.h"
+#include "master/filesystem_snapshot.h"
 #include "master/filesystem_checksum_updater.h"
 #include "master/filesystem_metadata.h"
+#include "master/filesystem_operations.h"
 #include "master/filesystem_quota.h"
 #include "master/snapshot_task.h"
 #include "master/task_manager.h"
 
+#ifndef METARESTORE
+#include "master/personality.h"
+#endif
+
 static uint32_t gInitialSnapshotTaskBatch;
 static uint32_t gSnapshotTaskBatchLimit;
+static bool gLazySnapshots;
+static uint32_t gLazySnapshotHooksDisabled = 0;
 
 void fs_read_snapshot_config_file() {
 	gInitialSnapshotTaskBatch = cfg_getuint32("SNAPSHOT_INITIAL_BATCH_SIZE", 1000);
 	gSnapshotTaskBatchLimit = cfg_getuint32("SNAPSHOT_INITIAL_BATCH_SIZE_LIMIT", 10000);
+	gLazySnapshots = cfg_getuint8("LAZY_SNAPSHOTS", 0);
+}
+
+LazySnapshotHooksDisabler::LazySnapshotHooksDisabler() {
+	gLazySnapshotHooksDisabled++;
+}
+
+LazySnapshotHooksDisabler::~LazySnapshotHooksDisabler() {
+	gLazySnapshotHooksDisabled--;
+}
+
+/*
+ * Lazy snapshots are materialized only by the master, which logs every step.
+ * Shadows, metarestore and the master replaying changelogs only repeat these steps.
+ */
+static bool fsnodes_lazy_snapshot_hooks_active() {
+#ifdef METARESTORE
+	return false;
+#else
+	return !gMetadata->lazy_snapshots.empty() && gLazySnapshotHooksDisabled == 0 &&
+	       metadataserver::isMaster();
+#endif
+}
+
+/*
+ * Charges statistics and quota usage of the source entries to a lazy copy, as if they
+ * were already copied, so that directory statistics and quotas do not depend on how much
+ * of the copy is materialized. Quota usage is charged to the owner of the copy until
+ * the entries are copied with their own owners.
+ */
+static void fsnodes_lazy_snapshot_charge(FSNodeDirectory *copy, const statsrecord &charge) {
+	statsrecord sr = charge;
+	gMetadata->lazy_snapshot_charges[copy->id] = charge;
+	fsnodes_add_stats(copy, &sr);
+	fsnodes_quota_update(copy, {{QuotaResource::kInodes, charge.inodes},
+	                            {QuotaResource::kSize, (int64_t)charge.size}});
+}
+
+/*
+ * Takes back the charge of a lazy copy whose entries are about to be copied, or which is
+ * no longer a lazy copy.
+ */
+static void fsnodes_lazy_snapshot_uncharge(FSNodeDirectory *copy) {
+	auto it = gMetadata->lazy_snapshot_charges.find(copy->id);
+	if (it == gMetadata->lazy_snapshot_charges.end()) {
+		return;
+	}
+	statsrecord charge = it->second;
+	statsrecord none{};
+	gMetadata->lazy_snapshot_charges.erase(it);
+	fsnodes_add_sub_stats(copy, &none, &charge);
+	fsnodes_quota_update(copy, {{QuotaResource::kInodes, -(int64_t)charge.inodes},
+	                            {QuotaResource::kSize, -(int64_t)charge.size}});
+}
+
+/* Statistics of the entries of a directory, without the directory itself. */
+static statsrecord fsnodes_lazy_snapshot_entries_stats(FSNodeDirectory *dir) {
+	statsrecord sr;
+	// changes deeper in the tree have to be included, whenever they were made
+	fsnodes_propagate_stats();
+	fsnodes_get_stats(dir, &sr);
+	sr.inodes--;
+	sr.dirs--;
+	return sr;
+}
+
+static void fsnodes_lazy_snapshot_mark(FSNodeDirectory *copy, FSNodeDirectory *source) {
+	fsnodes_lazy_snapshot_uncharge(copy);
+	gMetadata->lazy_snapshots.add(copy->id, source->id);
+	fsnodes_lazy_snapshot_charge(copy, fsnodes_lazy_snapshot_entries_stats(source));
+}
+
+static void fsnodes_lazy_snapshot_unmark(FSNodeDirectory *copy) {
+	fsnodes_lazy_snapshot_uncharge(copy);
+	gMetadata->lazy_snapshots.remove(copy->id);
+}
+
+void fsnodes_lazy_snapshot_restore(FSNodeDirectory *copy, FSNodeDirectory *source,
+		const statsrecord &charge) {
+	fsnodes_lazy_snapshot_uncharge(copy);
+	gMetadata->lazy_snapshots.add(copy->id, source->id);
+	fsnodes_lazy_snapshot_charge(copy, charge);
+}
+
+void fsnodes_lazy_snapshot_remove_node(FSNode *node) {
+	auto it = gMetadata->lazy_snapshot_charges.find(node->id);
+	if (it != gMetadata->lazy_snapshot_charges.end()) {
+		// statistics were already subtracted from the parents, together with the node
+		fsnodes_quota_update(node, {{QuotaResource::kInodes, -(int64_t)it->second.inodes},
+		                            {QuotaResource::kSize, -(int64_t)it->second.size}});
+		gMetadata->lazy_snapshot_charges.erase(it);
+	}
+	// copies of a removed source stay empty
+	for (uint32_t copy_id : gMetadata->lazy_snapshots.copiesOf(node->id)) {
+		FSNodeDirectory *copy = fsnodes_id_to_node<FSNodeDirectory>(copy_id);
+		if (copy) {
+			fsnodes_lazy_snapshot_uncharge(copy);
+		}
+	}
+	gMetadata->lazy_snapshots.removeNode(node->id);
+}
+
+/*
+ * Fills a lazy copy with copies of the entries of its source. Subdirectories become
+ * lazy copies themselves, so the cost is proportional to the size of one directory.
+ * Hooks have to be disabled by the caller.
+ */
+static void fsnodes_lazy_snapshot_copy_entries(uint32_t ts, FSNodeDirectory *dir) {
+	uint32_t source_id = gMetadata->lazy_snapshots.sourceOf(dir->id);
+	if (source_id == 0) {
+		return;
+	}
+	fsnodes_lazy_snapshot_unmark(dir);
+	fs_changelog(ts, "LAZYCLONE(%" PRIu32 ",0)", dir->id);
+
+	FSNode *source_node = fsnodes_id_to_node(source_id);
+	if (!source_node || source_node->type != FSNode::kDirectory) {
+		return;
+	}
+	FSNodeDirectory *source = static_cast<FSNodeDirectory *>(source_node);
+	// a lazy copy of a lazy copy
+	fsnodes_lazy_snapshot_copy_entries(ts, source);
+
+	SnapshotTask::SubtaskContainer entries;
+	entries.reserve(source->entries.size());
+	for (const auto &entry : source->entries) {
+		entries.emplace_back(entry.second->id, (HString)entry.first);
+	}
+	for (const auto &entry : entries) {
+		// quota was checked when the snapshot was created
+		SnapshotTask task({entry}, 0, dir->id, 0, 0, 0, true, false, false);
+		int status = task.cloneNode(ts);
+		if (status != SAUNAFS_STATUS_OK) {
+			safs_pretty_syslog(LOG_ERR,
+			                   "lazy snapshot: can't copy inode %" PRIu32 " to inode %" PRIu32
+			                   ": %s", entry.first, dir->id, saunafs_error_string(status));
+			continue;
+		}
+		FSNode *copy = fsnodes_lookup(dir, entry.second);
+		FSNode *copy_source = fsnodes_id_to_node(entry.first);
+		if (copy && copy->type == FSNode::kDirectory && copy_source &&
+		    copy_source->type == FSNode::kDirectory) {
+			fsnodes_lazy_snapshot_mark(static_cast<FSNodeDirectory *>(copy),
+			                           static_cast<FSNodeDirectory *>(copy_source));
+			fs_changelog(ts, "LAZYCLONE(%" PRIu32 ",%" PRIu32 ")", copy->id, entry.first);
+		}
+	}
+}
+
+/*
+ * Materializes lazy copies of the node and of all its ancestors, starting from the root,
+ * so that the copies keep the current content of the node.
+ */
+static void fsnodes_lazy_snapshot_copy_dependents(uint32_t ts, FSNode *node) {
+	std::vector<uint32_t> parents(node->parent.begin(), node->parent.end());
+	for (uint32_t parent_id : parents) {
+		FSNode *parent = fsnodes_id_to_node(parent_id);
+		if (parent) {
+			fsnodes_lazy_snapshot_copy_dependents(ts, parent);
+		}
+	}
+	if (node->type != FSNode::kDirectory || !gMetadata->lazy_snapshots.hasCopies(node->id)) {
+		return;
+	}
+	for (uint32_t copy_id : gMetadata->lazy_snapshots.copiesOf(node->id)) {
+		FSNode *copy = fsnodes_id_to_node(copy_id);
+		if (copy && copy->type == FSNode::kDirectory) {
+			fsnodes_lazy_snapshot_copy_entries(ts, static_cast<FSNodeDirectory *>(copy));
+		}
+	}
+}
+
+void fsnodes_lazy_snapshot_before_change(uint32_t ts, FSNode *node) {
+	if (!fsnodes_lazy_snapshot_hooks_active()) {
+		return;
+	}
+	LazySnapshotHooksDisabler disabler;
+	fsnodes_lazy_snapshot_copy_dependents(ts, node);
+	if (node->type == FSNode::kDirectory) {
+		fsnodes_lazy_snapshot_copy_entries(ts, static_cast<FSNodeDirectory *>(node));
+	}
+}
+
+void fsnodes_lazy_snapshot_materialize(uint32_t ts, FSNode *node) {
+	if (node->type != FSNode::kDirectory || !fsnodes_lazy_snapshot_hooks_active() ||
+	    gMetadata->lazy_snapshots.sourceOf(node->id) == 0) {
+		return;
+	}
+	LazySnapshotHooksDisabler disabler;
+	fsnodes_lazy_snapshot_copy_entries(ts, static_cast<FSNodeDirectory *>(node));
+}
+
+void fs_lazy_snapshot_prepare(const FsContext &context, uint32_t inode) {
+	if (!fsnodes_lazy_snapshot_hooks_active()) {
+		return;
+	}
+	FSNode *node;
+	if (fsnodes_get_node_for_operation(context, ExpectedNodeType::kDirectory, MODE_MASK_EMPTY,
+	                                   inode, &node) == SAUNAFS_STATUS_OK) {
+		fsnodes_lazy_snapshot_materialize(context.ts(), node);
+	}
+}
+
+uint8_t fs_apply_lazy_clone(uint32_t ts, uint32_t inode_dst, uint32_t inode_src) {
+	(void)ts;
+	FSNodeDirectory *dst = fsnodes_id_to_node<FSNodeDirectory>(inode_dst);
+	if (!dst || dst->type != FSNode::kDirectory) {
+		return SAUNAFS_ERROR_ENOENT;
+	}
+	if (inode_src == 0) {
+		if (gMetadata->lazy_snapshots.sourceOf(inode_dst) == 0) {
+			return SAUNAFS_ERROR_EINVAL;
+		}
+		fsnodes_lazy_snapshot_unmark(dst);
+	} else {
+		FSNodeDirectory *src = fsnodes_id_to_node<FSNodeDirectory>(inode_src);
+		if (!src || src->type != FSNode::kDirectory) {
+			return SAUNAFS_ERROR_ENOENT;
+		}
+		// charged in the same order as by the master, so the statistics are the same
+		fsnodes_lazy_snapshot_mark(dst, src);
+	}
+	gMetadata->metaversion++;
+	return SAUNAFS_STATUS_OK;
+}
+
+/*
+ * Creates a lazy snapshot: only the directory itself is cloned, its entries are copied
+ * on the first modification of either the source or the snapshot. Quota limits are
+ * checked for the whole subtree here, as the entries are copied without checking them.
+ */
+static uint8_t fsnodes_lazy_snapshot(uint32_t ts, FSNodeDirectory *src_node,
+		FSNodeDirectory *dst_parent, const HString &name_dst) {
+	statsrecord sr;
+	fsnodes_get_stats(src_node, &sr);
+	if (fsnodes_quota_exceeded_ug(src_node, {{QuotaResource::kInodes, sr.inodes},
+	                                         {QuotaResource::kSize, (int64_t)sr.size}}) ||
+	    fsnodes_quota_exceeded_dir(dst_parent, {{QuotaResource::kInodes, sr.inodes},
+	                                            {QuotaResource::kSize, (int64_t)sr.size}})) {
+		return SAUNAFS_ERROR_QUOTA;
+	}
+	SnapshotTask task({{src_node->id, name_dst}}, src_node->id, dst_parent->id, 0, 0, 0,
+	                  true, false);
+	uint8_t status = task.cloneNode(ts);
+	if (status != SAUNAFS_STATUS_OK) {
+		return status;
+	}
+	FSNode *dst_node = fsnodes_lookup(dst_parent, name_dst);
+	assert(dst_node && dst_node->type == FSNode::kDirectory);
+	fsnodes_lazy_snapshot_mark(static_cast<FSNodeDirectory *>(dst_node), src_node);
+	fs_changelog(ts, "LAZYCLONE(%" PRIu32 ",%" PRIu32 ")", dst_node->id, src_node->id);
+	return SAUNAFS_STATUS_OK;
 }
 
 uint8_t fs_snapshot(const FsContext &context, uint32_t inode_src, uint32_t parent_dst,
@@ -64,6 +324,12 @@ uint8_t fs_snapshot(const FsContext &context, uint32_t inode_src, uint32_t paren
 
 	assert(context.isPersonalityMaster());
 
+	if (gLazySnapshots && src_node->type == FSNode::kDirectory &&
+	    fsnodes_lookup(static_cast<FSNodeDirectory *>(dst_parent_node), name_dst) == nullptr) {
+		return fsnodes_lazy_snapshot(context.ts(), static_cast<FSNodeDirectory *>(src_node),
+		                             static_cast<FSNodeDirectory *>(dst_parent_node), name_dst);
+	}
+
 	auto task = new SnapshotTask({{src_node->id, name_dst}}, src_node->id,
 	                                   static_cast<FSNodeDirectory *>(dst_parent_node)->id,
 	                                   0, can_overwrite, ignore_missing_src, true, true);
@@ -90,8 +356,11 @@ uint8_t fs_snapshot(const FsContext &context, uint32_t inode_src, uint32_t paren
 uint8_t fs_clone_node(const FsContext &context, uint32_t inode_src, uint32_t parent_dst,
 			uint32_t inode_dst, const HString &name_dst, uint8_t can_overwrite) {
 
+	// entries of lazy snapshots are copied without checking quota limits, like on the master
+	bool check_quota = (can_overwrite & kCloneWithoutQuotaCheck) == 0;
+	can_overwrite &= ~kCloneWithoutQuotaCheck;
 	SnapshotTask task({{inode_src, name_dst}}, 0, parent_dst, inode_dst, can_overwrite,
-			  0, false, false);
+			  0, false, false, check_quota);
 
 	return task.cloneNode(context.ts());
 }
@@ -52,3 +52,52 @@ uint8_t fs_snapshot(const FsContext &context, uint32_t inode_src, uint32_t paren
 uint8_t fs_clone_node(const FsContext &context, uint32_t inode_src, uint32_t parent_dst,
 		uint32_t inode_dst, const HString &name_dst,
 		uint8_t can_overwrite);
+
+/*! \brief Disables materialization of lazy snapshots in its scope.
+ *
+ * Used while replaying changelogs, which contain every materialization done by the master.
+ */
+class LazySnapshotHooksDisabler {
+public:
+	LazySnapshotHooksDisabler();
+	~LazySnapshotHooksDisabler();
+
+	LazySnapshotHooksDisabler(const LazySnapshotHooksDisabler &) = delete;
+	LazySnapshotHooksDisabler &operator=(const LazySnapshotHooksDisabler &) = delete;
+};
+
+/*! \brief Materialize lazy snapshots which share entries with a node before it is modified.
+ *
+ * Lazy copies of the node and of its ancestors get their own entries and, if the node
+ * itself is a lazy copy, it is filled with entries of its source.
+ *
+ * \param ts current time stamp.
+ * \param node node to be modified.
+ */
+void fsnodes_lazy_snapshot_before_change(uint32_t ts, FSNode *node);
+
+/*! \brief Fill a lazy copy with entries of its source, before the entries are used.
+ *
+ * Does nothing for other nodes.
+ */
+void fsnodes_lazy_snapshot_materialize(uint32_t ts, FSNode *node);
+
+/*! \brief Fill a lazy copy with entries of its source before its entries are looked up.
+ *
+ * Used by lookups, which need the inodes of the copy. Requests served by metadata reader
+ * threads call it on the main thread, before the request is added to the batch.
+ */
+void fs_lazy_snapshot_prepare(const FsContext &context, uint32_t inode);
+
+/*! \brief Mark a directory loaded from the metadata file as a lazy copy.
+ *
+ * \param charge statistics of the source entries charged to the copy when it was marked.
+ */
+void fsnodes_lazy_snapshot_restore(FSNodeDirectory *copy, FSNodeDirectory *source,
+		const statsrecord &charge);
+
+/*! \brief Forget lazy copies of a removed node and the charge of the node itself. */
+void fsnodes_lazy_snapshot_remove_node(FSNode *node);
+
+/*! \brief Mark (or unmark if inode_src is 0) a directory as a lazy copy. */
+uint8_t fs_apply_lazy_clone(uint32_t ts, uint32_t inode_dst, uint32_t inode_src);
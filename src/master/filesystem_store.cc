@@ -29,6 +29,7 @@
 #include "common/event_loop.h"
 #include "common/setup.h"
 #include "common/saunafs_version.h"
+#include "common/serialization_macros.h"
 #include "common/metadata.h"
 #include "common/rotate_files.h"
 #include "common/setup.h"
@@ -42,6 +43,7 @@
 #include "master/filesystem_operations.h"
 #include "master/filesystem_checksum.h"
 #include "master/filesystem_quota.h"
+#include "master/filesystem_snapshot.h"
 #include "master/filesystem_store_acl.h"
 #include "master/locks.h"
 #include "master/matoclserv.h"
@@ -59,31 +61,33 @@ char const MetadataStructureReadErrorMsg[] = "error reading metadata (structure)
 void xattr_store(FILE *fd) {
 	uint8_t hdrbuff[4 + 1 + 4];
 	uint8_t *ptr;
-	uint32_t i;
-	xattr_data_entry *xa;
-
-	for (i = 0; i < XATTR_DATA_HASH_SIZE; i++) {
-		for (xa = gMetadata->xattr_data_hash[i]; xa; xa = xa->next) {
-			ptr = hdrbuff;
-			put32bit(&ptr, xa->inode);
-			put8bit(&ptr, xa->anleng);
-			put32bit(&ptr, xa->avleng);
-			if (fwrite(hdrbuff, 1, 4 + 1 + 4, fd) != (size_t)(4 + 1 + 4)) {
-				safs_pretty_syslog(LOG_NOTICE, "fwrite error");
-				return;
-			}
-			if (fwrite(xa->attrname, 1, xa->anleng, fd) != (size_t)(xa->anleng)) {
-				safs_pretty_syslog(LOG_NOTICE, "fwrite error");
-				return;
-			}
-			if (xa->avleng > 0) {
-				if (fwrite(xa->attrvalue, 1, xa->avleng, fd) !=
-				    (size_t)(xa->avleng)) {
-					safs_pretty_syslog(LOG_NOTICE, "fwrite error");
+	bool error = false;
+
+	// Attributes are stored one by one, in the format used before they were packed per inode
+	for (uint32_t shard = 0; shard < XattrStorage::kShardCount && !error; shard++) {
+		gMetadata->xattrs.forEachInode(shard, [&](const XattrStorage::InodeEntry &entry) {
+			gMetadata->xattrs.forEachAttribute(entry, [&](const uint8_t *attrname,
+			                                              uint8_t anleng,
+			                                              const uint8_t *attrvalue,
+			                                              uint32_t avleng) {
+				if (error) {
 					return;
 				}
-			}
-		}
+				ptr = hdrbuff;
+				put32bit(&ptr, entry.inode);
+				put8bit(&ptr, anleng);
+				put32bit(&ptr, avleng);
+				if (fwrite(hdrbuff, 1, 4 + 1 + 4, fd) != (size_t)(4 + 1 + 4) ||
+				    fwrite(attrname, 1, anleng, fd) != (size_t)(anleng) ||
+				    (avleng > 0 && fwrite(attrvalue, 1, avleng, fd) != (size_t)(avleng))) {
+					safs_pretty_syslog(LOG_NOTICE, "fwrite error");
+					error = true;
+				}
+			});
+		});
+	}
+	if (error) {
+		return;
 	}
 	memset(hdrbuff, 0, 4 + 1 + 4);
 	if (fwrite(hdrbuff, 1, 4 + 1 + 4, fd) != (size_t)(4 + 1 + 4)) {
@@ -98,9 +102,8 @@ int xattr_load(FILE *fd, int ignoreflag) {
 	uint32_t inode;
 	uint8_t anleng;
 	uint32_t avleng;
-	xattr_data_entry *xa;
-	xattr_inode_entry *ih;
-	uint32_t hash, ihash;
+	uint8_t attrname[256];
+	std::vector<uint8_t> attrvalue;
 
 	while (1) {
 		if (fread(hdrbuff, 1, 4 + 1 + 4, fd) != 4 + 1 + 4) {
@@ -133,12 +136,8 @@ int xattr_load(FILE *fd, int ignoreflag) {
 			}
 		}
 
-		ihash = xattr_inode_hash_fn(inode);
-		for (ih = gMetadata->xattr_inode_hash[ihash]; ih && ih->inode != inode;
-			ih = ih->next) {
-		}
-
-		if (ih && ih->anleng + anleng + 1 > SFS_XATTR_LIST_MAX) {
+		const XattrStorage::InodeEntry *entry = gMetadata->xattrs.find(inode);
+		if (entry && entry->anleng + anleng + 1 > SFS_XATTR_LIST_MAX) {
 			safs_pretty_syslog(LOG_ERR, "loading xattr: name list too long");
 			if (ignoreflag) {
 				fseek(fd, anleng + avleng, SEEK_CUR);
@@ -148,61 +147,13 @@ int xattr_load(FILE *fd, int ignoreflag) {
 			}
 		}
 
-		xa = new xattr_data_entry;
-		xa->inode = inode;
-		xa->attrname = (uint8_t *)malloc(anleng);
-		passert(xa->attrname);
-		if (fread(xa->attrname, 1, anleng, fd) != (size_t)anleng) {
-			int err = errno;
-			delete xa;
-			errno = err;
+		attrvalue.resize(avleng);
+		if (fread(attrname, 1, anleng, fd) != (size_t)anleng ||
+		    (avleng > 0 && fread(attrvalue.data(), 1, avleng, fd) != (size_t)avleng)) {
 			safs_pretty_errlog(LOG_ERR, "loading xattr: read error");
 			return -1;
 		}
-		xa->anleng = anleng;
-		if (avleng > 0) {
-			xa->attrvalue = (uint8_t *)malloc(avleng);
-			passert(xa->attrvalue);
-			if (fread(xa->attrvalue, 1, avleng, fd) != (size_t)avleng) {
-				int err = errno;
-				delete xa;
-				errno = err;
-				safs_pretty_errlog(LOG_ERR, "loading xattr: read error");
-				return -1;
-			}
-		} else {
-			xa->attrvalue = NULL;
-		}
-		xa->avleng = avleng;
-		hash = xattr_data_hash_fn(inode, xa->anleng, xa->attrname);
-		xa->next = gMetadata->xattr_data_hash[hash];
-		if (xa->next) {
-			xa->next->prev = &(xa->next);
-		}
-		xa->prev = gMetadata->xattr_data_hash + hash;
-		gMetadata->xattr_data_hash[hash] = xa;
-
-		if (ih) {
-			xa->nextinode = ih->data_head;
-			if (xa->nextinode) {
-				xa->nextinode->previnode = &(xa->nextinode);
-			}
-			xa->previnode = &(ih->data_head);
-			ih->data_head = xa;
-			ih->anleng += anleng + 1U;
-			ih->avleng += avleng;
-		} else {
-			ih = (xattr_inode_entry *)malloc(sizeof(xattr_inode_entry));
-			passert(ih);
-			ih->inode = inode;
-			xa->nextinode = NULL;
-			xa->previnode = &(ih->data_head);
-			ih->data_head = xa;
-			ih->anleng = anleng + 1U;
-			ih->avleng = avleng;
-			ih->next = gMetadata->xattr_inode_hash[ihash];
-			gMetadata->xattr_inode_hash[ihash] = ih;
-		}
+		gMetadata->xattrs.set(inode, anleng, attrname, avleng, attrvalue.data());
 	}
 }
 
@@ -728,6 +679,33 @@ static void fs_storelocks(FILE *fd) {
 	gMetadata->posix_locks.store(fd);
 }
 
+/// Lazy copy in the metadata file, with statistics of the source entries charged to it
+SAUNAFS_DEFINE_SERIALIZABLE_CLASS(StoredLazySnapshot,
+	uint32_t, copy_inode,
+	uint32_t, source_inode,
+	uint32_t, inodes,
+	uint32_t, dirs,
+	uint32_t, files,
+	uint32_t, chunks,
+	uint64_t, length,
+	uint64_t, size,
+	uint64_t, realsize);
+
+static void fs_store_lazy_snapshots(FILE *fd) {
+	// charges are stored as they were made, sources may have been lazy copies at that time
+	std::vector<StoredLazySnapshot> stored;
+	for (const auto &entry : gMetadata->lazy_snapshots.entries()) {
+		statsrecord charge{};
+		auto it = gMetadata->lazy_snapshot_charges.find(entry.first);
+		if (it != gMetadata->lazy_snapshot_charges.end()) {
+			charge = it->second;
+		}
+		stored.emplace_back(entry.first, entry.second, charge.inodes, charge.dirs, charge.files,
+		                    charge.chunks, charge.length, charge.size, charge.realsize);
+	}
+	fs_store_generic(fd, stored);
+}
+
 int fs_lostnode(FSNode *p) {
 	uint8_t artname[40];
 	uint32_t i, l;
@@ -794,6 +772,7 @@ int fs_loadedges(FILE *fd, int ignoreflag) {
 			return -1;
 		}
 	} while (s == 0);
+	fsnodes_propagate_stats();
 	return 0;
 }
 
@@ -816,6 +795,37 @@ static int fs_loadquotas(FILE *fd, int ignoreflag) {
 	return 0;
 }
 
+static int fs_load_lazy_snapshots(FILE *fd, int ignoreflag) {
+	try {
+		std::vector<StoredLazySnapshot> entries;
+		fs_load_generic(fd, entries);
+		for (const auto &entry : entries) {
+			FSNode *copy = fsnodes_id_to_node(entry.copy_inode);
+			FSNode *source = fsnodes_id_to_node(entry.source_inode);
+			if (!copy || !source || copy->type != FSNode::kDirectory ||
+			    source->type != FSNode::kDirectory) {
+				safs_pretty_syslog(LOG_ERR,
+				                   "loading lazy snapshots: directory %" PRIu32
+				                   " or %" PRIu32 " not found", entry.copy_inode, entry.source_inode);
+				if (!ignoreflag) {
+					return -1;
+				}
+				continue;
+			}
+			statsrecord charge{entry.inodes, entry.dirs, entry.files, entry.chunks,
+			                   entry.length, entry.size, entry.realsize};
+			fsnodes_lazy_snapshot_restore(static_cast<FSNodeDirectory *>(copy),
+			                              static_cast<FSNodeDirectory *>(source), charge);
+		}
+	} catch (Exception &ex) {
+		safs_pretty_syslog(LOG_ERR, "loading lazy snapshots: %s", ex.what());
+		if (!ignoreflag || ex.status() != SAUNAFS_STATUS_OK) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
 static int fs_loadlocks(FILE *fd, int ignoreflag) {
 	try {
 		gMetadata->flock_locks.load(fd);
@@ -981,6 +991,13 @@ void fs_store(FILE *fd, uint8_t fver) {
 		if (process_section("FLCK 1.0", hdr, ptr, offbegin, offend, fd) != SAUNAFS_STATUS_OK) {
 			return;
 		}
+		// stored only when needed, so that older versions can still read the file
+		if (!gMetadata->lazy_snapshots.empty()) {
+			fs_store_lazy_snapshots(fd);
+			if (process_section("LSNP 1.0", hdr, ptr, offbegin, offend, fd) != SAUNAFS_STATUS_OK) {
+				return;
+			}
+		}
 	}
 	chunk_store(fd);
 	if (fver >= kMetadataVersionWithSections) {
@@ -1185,6 +1202,16 @@ int fs_load(FILE *fd, int ignoreflag, uint8_t fver) {
 				if (fs_loadlocks(fd, ignoreflag) < 0) {
 #ifndef METARESTORE
 					safs_pretty_syslog(LOG_ERR, "error reading metadata (chunks)");
+#endif
+					return -1;
+				}
+			} else if (memcmp(hdr, "LSNP 1.0", 8) == 0) {
+				safs_pretty_syslog_attempt(LOG_INFO,
+				                           "loading lazy snapshots from the metadata file");
+				fflush(stderr);
+				if (fs_load_lazy_snapshots(fd, ignoreflag) < 0) {
+#ifndef METARESTORE
+					safs_pretty_syslog(LOG_ERR, "error reading lazy snapshots");
 #endif
 					return -1;
 				}
@@ -24,90 +24,61 @@
 #include "master/filesystem_checksum.h"
 #include "master/filesystem_xattr.h"
 
-static uint64_t xattr_checksum(const xattr_data_entry *xde) {
-	if (!xde) {
-		return 0;
-	}
+static uint64_t xattr_checksum(uint32_t inode, uint8_t anleng, const uint8_t *attrname,
+		uint32_t avleng, const uint8_t *attrvalue) {
 	uint64_t seed = 645819511511147ULL;
-	hashCombine(seed, xde->inode, ByteArray(xde->attrname, xde->anleng),
-	            ByteArray(xde->attrvalue, xde->avleng));
+	hashCombine(seed, inode, ByteArray(attrname, anleng), ByteArray(attrvalue, avleng));
 	return seed;
 }
 
-static void xattr_update_checksum(xattr_data_entry *xde) {
-	if (!xde) {
-		return;
-	}
-	if (gChecksumBackgroundUpdater.isXattrIncluded(xde)) {
-		removeFromChecksum(gChecksumBackgroundUpdater.xattrChecksum, xde->checksum);
-	}
-	removeFromChecksum(gMetadata->xattrChecksum, xde->checksum);
-	xde->checksum = xattr_checksum(xde);
-	if (gChecksumBackgroundUpdater.isXattrIncluded(xde)) {
-		addToChecksum(gChecksumBackgroundUpdater.xattrChecksum, xde->checksum);
-	}
-	addToChecksum(gMetadata->xattrChecksum, xde->checksum);
+/// Checksum of all attributes of an inode (they are combined like checksums of entries).
+static uint64_t xattr_checksum(const XattrStorage::InodeEntry &entry) {
+	uint64_t checksum = 0;
+	gMetadata->xattrs.forEachAttribute(entry, [&](const uint8_t *attrname, uint8_t anleng,
+	                                              const uint8_t *attrvalue, uint32_t avleng) {
+		addToChecksum(checksum, xattr_checksum(entry.inode, anleng, attrname, avleng, attrvalue));
+	});
+	return checksum;
 }
 
-static inline void xattr_removeentry(xattr_data_entry *xa) {
-	*(xa->previnode) = xa->nextinode;
-	if (xa->nextinode) {
-		xa->nextinode->previnode = xa->previnode;
-	}
-	*(xa->prev) = xa->next;
-	if (xa->next) {
-		xa->next->prev = xa->prev;
+/// Replace \a previous checksum of attributes of an inode with \a current one.
+static void xattr_update_checksum(uint32_t inode, uint64_t previous, uint64_t current) {
+	if (gChecksumBackgroundUpdater.isXattrIncluded(inode)) {
+		removeFromChecksum(gChecksumBackgroundUpdater.xattrChecksum, previous);
+		addToChecksum(gChecksumBackgroundUpdater.xattrChecksum, current);
 	}
-	if (gChecksumBackgroundUpdater.isXattrIncluded(xa)) {
-		removeFromChecksum(gChecksumBackgroundUpdater.xattrChecksum, xa->checksum);
-	}
-	removeFromChecksum(gMetadata->xattrChecksum, xa->checksum);
-	delete xa;
+	removeFromChecksum(gMetadata->xattrChecksum, previous);
+	addToChecksum(gMetadata->xattrChecksum, current);
 }
 
-void xattr_checksum_add_to_background(xattr_data_entry *xde) {
-	if (!xde) {
-		return;
-	}
-	removeFromChecksum(gMetadata->xattrChecksum, xde->checksum);
-	xde->checksum = xattr_checksum(xde);
-	addToChecksum(gMetadata->xattrChecksum, xde->checksum);
-	addToChecksum(gChecksumBackgroundUpdater.xattrChecksum, xde->checksum);
+void xattr_checksum_add_to_background(XattrStorage::InodeEntry &entry) {
+	removeFromChecksum(gMetadata->xattrChecksum, entry.checksum);
+	entry.checksum = xattr_checksum(entry);
+	addToChecksum(gMetadata->xattrChecksum, entry.checksum);
+	addToChecksum(gChecksumBackgroundUpdater.xattrChecksum, entry.checksum);
 }
 
 void xattr_recalculate_checksum() {
 	gMetadata->xattrChecksum = XATTRCHECKSUMSEED;
-	for (int i = 0; i < XATTR_DATA_HASH_SIZE; ++i) {
-		for (xattr_data_entry *xde = gMetadata->xattr_data_hash[i]; xde; xde = xde->next) {
-			xde->checksum = xattr_checksum(xde);
-			addToChecksum(gMetadata->xattrChecksum, xde->checksum);
-		}
+	for (uint32_t shard = 0; shard < XattrStorage::kShardCount; ++shard) {
+		gMetadata->xattrs.forEachInode(shard, [](XattrStorage::InodeEntry &entry) {
+			entry.checksum = xattr_checksum(entry);
+			addToChecksum(gMetadata->xattrChecksum, entry.checksum);
+		});
 	}
 }
 
 void xattr_removeinode(uint32_t inode) {
-	xattr_inode_entry *ih, **ihp;
-
-	ihp = &(gMetadata->xattr_inode_hash[xattr_inode_hash_fn(inode)]);
-	while ((ih = *ihp)) {
-		if (ih->inode == inode) {
-			while (ih->data_head) {
-				xattr_removeentry(ih->data_head);
-			}
-			*ihp = ih->next;
-			free(ih);
-		} else {
-			ihp = &(ih->next);
-		}
+	const XattrStorage::InodeEntry *entry = gMetadata->xattrs.find(inode);
+	if (!entry) {
+		return;
 	}
+	xattr_update_checksum(inode, entry->checksum, 0);
+	gMetadata->xattrs.removeInode(inode);
 }
 
 uint8_t xattr_setattr(uint32_t inode, uint8_t anleng, const uint8_t *attrname, uint32_t avleng,
 			const uint8_t *attrvalue, uint8_t mode) {
-	xattr_inode_entry *ih;
-	xattr_data_entry *xa;
-	uint32_t hash, ihash;
-
 	if (avleng > SFS_XATTR_SIZE_MAX) {
 		return SAUNAFS_ERROR_ERANGE;
 	}
@@ -119,158 +90,77 @@ uint8_t xattr_setattr(uint32_t inode, uint8_t anleng, const uint8_t *attrname, u
 		return SAUNAFS_ERROR_EINVAL;
 	}
 
-	ihash = xattr_inode_hash_fn(inode);
-	for (ih = gMetadata->xattr_inode_hash[ihash]; ih && ih->inode != inode; ih = ih->next) {
-	}
+	XattrStorage &xattrs = gMetadata->xattrs;
+	XattrStorage::InodeEntry *entry = xattrs.find(inode);
+	uint64_t previous = entry ? entry->checksum : 0;
+	uint64_t current = previous;
+	const uint8_t *oldvalue;
+	uint32_t oldleng;
 
-	hash = xattr_data_hash_fn(inode, anleng, attrname);
-	for (xa = gMetadata->xattr_data_hash[hash]; xa; xa = xa->next) {
-		if (xa->inode == inode && xa->anleng == anleng &&
-		    memcmp(xa->attrname, attrname, anleng) == 0) {
-			passert(ih);
-			if (mode == XATTR_SMODE_CREATE_ONLY) {  // create only
-				return SAUNAFS_ERROR_EEXIST;
-			}
-			if (mode == XATTR_SMODE_REMOVE) {  // remove
-				ih->anleng -= anleng + 1U;
-				ih->avleng -= xa->avleng;
-				xattr_removeentry(xa);
-				if (ih->data_head == NULL) {
-					if (ih->anleng != 0 || ih->avleng != 0) {
-						safs_pretty_syslog(LOG_WARNING,
-						       "xattr non zero lengths on remove "
-						       "(inode:%" PRIu32 ",anleng:%" PRIu32
-						       ",avleng:%" PRIu32 ")",
-						       ih->inode, ih->anleng, ih->avleng);
-					}
-					xattr_removeinode(inode);
-				}
-				return SAUNAFS_STATUS_OK;
-			}
-			ih->avleng -= xa->avleng;
-			if (xa->attrvalue) {
-				free(xa->attrvalue);
-			}
-			if (avleng > 0) {
-				xa->attrvalue = (uint8_t *)malloc(avleng);
-				passert(xa->attrvalue);
-				memcpy(xa->attrvalue, attrvalue, avleng);
-			} else {
-				xa->attrvalue = NULL;
+	if (xattrs.get(inode, anleng, attrname, &oldvalue, &oldleng)) {
+		if (mode == XATTR_SMODE_CREATE_ONLY) {  // create only
+			return SAUNAFS_ERROR_EEXIST;
+		}
+		removeFromChecksum(current, xattr_checksum(inode, anleng, attrname, oldleng, oldvalue));
+		if (mode == XATTR_SMODE_REMOVE) {  // remove
+			xattrs.remove(inode, anleng, attrname);
+			entry = xattrs.find(inode);
+			if (entry) {
+				entry->checksum = current;
 			}
-			xa->avleng = avleng;
-			ih->avleng += avleng;
-			xattr_update_checksum(xa);
+			xattr_update_checksum(inode, previous, entry ? current : 0);
 			return SAUNAFS_STATUS_OK;
 		}
-	}
-
-	if (mode == XATTR_SMODE_REPLACE_ONLY || mode == XATTR_SMODE_REMOVE) {
-		return SAUNAFS_ERROR_ENOATTR;
-	}
-
-	if (ih && ih->anleng + anleng + 1 > SFS_XATTR_LIST_MAX) {
-		return SAUNAFS_ERROR_ERANGE;
-	}
-
-	xa = new xattr_data_entry;
-	xa->inode = inode;
-	xa->attrname = (uint8_t *)malloc(anleng);
-	passert(xa->attrname);
-	memcpy(xa->attrname, attrname, anleng);
-	xa->anleng = anleng;
-	if (avleng > 0) {
-		xa->attrvalue = (uint8_t *)malloc(avleng);
-		passert(xa->attrvalue);
-		memcpy(xa->attrvalue, attrvalue, avleng);
 	} else {
-		xa->attrvalue = NULL;
-	}
-	xa->avleng = avleng;
-	xa->next = gMetadata->xattr_data_hash[hash];
-	if (xa->next) {
-		xa->next->prev = &(xa->next);
-	}
-	xa->prev = gMetadata->xattr_data_hash + hash;
-	gMetadata->xattr_data_hash[hash] = xa;
-
-	if (ih) {
-		xa->nextinode = ih->data_head;
-		if (xa->nextinode) {
-			xa->nextinode->previnode = &(xa->nextinode);
+		if (mode == XATTR_SMODE_REPLACE_ONLY || mode == XATTR_SMODE_REMOVE) {
+			return SAUNAFS_ERROR_ENOATTR;
+		}
+		if (entry && entry->anleng + anleng + 1 > SFS_XATTR_LIST_MAX) {
+			return SAUNAFS_ERROR_ERANGE;
 		}
-		xa->previnode = &(ih->data_head);
-		ih->data_head = xa;
-		ih->anleng += anleng + 1U;
-		ih->avleng += avleng;
-	} else {
-		ih = (xattr_inode_entry *)malloc(sizeof(xattr_inode_entry));
-		passert(ih);
-		ih->inode = inode;
-		xa->nextinode = NULL;
-		xa->previnode = &(ih->data_head);
-		ih->data_head = xa;
-		ih->anleng = anleng + 1U;
-		ih->avleng = avleng;
-		ih->next = gMetadata->xattr_inode_hash[ihash];
-		gMetadata->xattr_inode_hash[ihash] = ih;
 	}
-	xa->checksum = 0;
-	xattr_update_checksum(xa);
+
+	xattrs.set(inode, anleng, attrname, avleng, attrvalue);
+	addToChecksum(current, xattr_checksum(inode, anleng, attrname, avleng, attrvalue));
+	xattrs.find(inode)->checksum = current;
+	xattr_update_checksum(inode, previous, current);
 	return SAUNAFS_STATUS_OK;
 }
 
 uint8_t xattr_getattr(uint32_t inode, uint8_t anleng, const uint8_t *attrname, uint32_t *avleng,
-			uint8_t **attrvalue) {
-	xattr_data_entry *xa;
-
-	for (xa = gMetadata->xattr_data_hash[xattr_data_hash_fn(inode, anleng, attrname)]; xa;
-	     xa = xa->next) {
-		if (xa->inode == inode && xa->anleng == anleng &&
-		    memcmp(xa->attrname, attrname, anleng) == 0) {
-			if (xa->avleng > SFS_XATTR_SIZE_MAX) {
-				return SAUNAFS_ERROR_ERANGE;
-			}
-			*attrvalue = xa->attrvalue;
-			*avleng = xa->avleng;
-			return SAUNAFS_STATUS_OK;
-		}
+			const uint8_t **attrvalue) {
+	if (!gMetadata->xattrs.get(inode, anleng, attrname, attrvalue, avleng)) {
+		return SAUNAFS_ERROR_ENOATTR;
 	}
-	return SAUNAFS_ERROR_ENOATTR;
+	if (*avleng > SFS_XATTR_SIZE_MAX) {
+		return SAUNAFS_ERROR_ERANGE;
+	}
+	return SAUNAFS_STATUS_OK;
 }
 
 uint8_t xattr_listattr_leng(uint32_t inode, void **xanode, uint32_t *xasize) {
-	xattr_inode_entry *ih;
-	xattr_data_entry *xa;
-
-	for (ih = gMetadata->xattr_inode_hash[xattr_inode_hash_fn(inode)]; ih; ih = ih->next) {
-		if (ih->inode == inode) {
-			*xanode = ih;
-			for (xa = ih->data_head; xa; xa = xa->nextinode) {
-				*xasize += xa->anleng + 1U;
-			}
-			if (*xasize > SFS_XATTR_LIST_MAX) {
-				return SAUNAFS_ERROR_ERANGE;
-			}
-			return SAUNAFS_STATUS_OK;
+	const XattrStorage::InodeEntry *entry = gMetadata->xattrs.find(inode);
+	*xanode = (void *)entry;
+	if (entry) {
+		*xasize += entry->anleng;
+		if (*xasize > SFS_XATTR_LIST_MAX) {
+			return SAUNAFS_ERROR_ERANGE;
 		}
 	}
-	*xanode = NULL;
 	return SAUNAFS_STATUS_OK;
 }
 
 void xattr_listattr_data(void *xanode, uint8_t *xabuff) {
-	xattr_inode_entry *ih = (xattr_inode_entry *)xanode;
-	xattr_data_entry *xa;
+	const XattrStorage::InodeEntry *entry = (const XattrStorage::InodeEntry *)xanode;
 	uint32_t l;
 
 	l = 0;
-	if (ih) {
-		for (xa = ih->data_head; xa; xa = xa->nextinode) {
-			memcpy(xabuff + l, xa->attrname, xa->anleng);
-			l += xa->anleng;
+	if (entry) {
+		gMetadata->xattrs.forEachAttribute(*entry, [&](const uint8_t *attrname, uint8_t anleng,
+		                                               const uint8_t *, uint32_t) {
+			memcpy(xabuff + l, attrname, anleng);
+			l += anleng;
 			xabuff[l++] = 0;
-		}
+		});
 	}
 }
-
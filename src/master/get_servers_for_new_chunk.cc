@@ -107,48 +107,63 @@ void GetServersForNewChunk::sortAvoidingSameIp() {
 	servers_ = std::move(new_order);
 }
 
+template <typename Predicate>
+int GetServersForNewChunk::pickLessLoaded(Predicate matches) const {
+	int first = -1;
+	for (int i = 0; i < (int)servers_.size(); ++i) {
+		if (!matches(servers_[i])) {
+			continue;
+		}
+		if (first < 0) {
+			first = i;
+			continue;
+		}
+		return servers_[i].expectedWait() < servers_[first].expectedWait() ? i : first;
+	}
+	return first;
+}
+
 std::vector<matocsserventry *> GetServersForNewChunk::chooseServersForLabels(
 	ChunkCreationHistory &history, const Goal::Slice::ConstPartProxy &labels, uint32_t min_version,
 	std::vector<matocsserventry *> &used) {
 	std::vector<matocsserventry *> result;
 
+	auto is_available = [&](const ChunkserverChunkCounter &server) {
+		return server.version >= min_version &&
+		       std::find(used.begin(), used.end(), server.server) == used.end();
+	};
+	auto use = [&](int index) {
+		result.push_back(servers_[index].server);
+		used.push_back(servers_[index].server);
+	};
+
 	// TODO(Haze): It should be optimized also for large number of servers.
 
 	// Choose servers for non-wildcard labels
 	for (const auto &label_and_count : labels) {
-		int copies_to_be_created = label_and_count.second;
 		if (label_and_count.first == MediaLabel::kWildcard) {
 			break;
 		}
-		for (const auto &server : servers_) {
-			if (copies_to_be_created == 0) {
+		for (int copies = label_and_count.second; copies > 0; --copies) {
+			int index = pickLessLoaded([&](const ChunkserverChunkCounter &server) {
+				return server.label == label_and_count.first && is_available(server);
+			});
+			if (index < 0) {
 				break;
 			}
-			if (server.version < min_version ||
-			    std::find(used.begin(), used.end(), server.server) != used.end()) {
-				continue;
-			}
-			if (server.label == label_and_count.first) {
-				result.push_back(server.server);
-				used.push_back(server.server);
-				--copies_to_be_created;
-			}
+			use(index);
 		}
 	}
 
 	int expected_copies = Goal::Slice::countLabels(labels);
 
 	// Add any servers to have the desired number of copies
-	for (const auto &server : servers_) {
-		if ((int)result.size() >= expected_copies) {
+	while ((int)result.size() < expected_copies) {
+		int index = pickLessLoaded(is_available);
+		if (index < 0) {
 			break;
 		}
-		if (server.version < min_version ||
-		    std::find(used.begin(), used.end(), server.server) != used.end()) {
-			continue;
-		}
-		result.push_back(server.server);
-		used.push_back(server.server);
+		use(index);
 	}
 
 	// Update the history
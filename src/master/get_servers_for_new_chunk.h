@@ -39,17 +39,27 @@ struct ChunkserverChunkCounter {
 	      weight(),
 	      version(),
 	      chunks_created(),
-	      load_factor() {
+	      load_factor(),
+	      queue_depth(),
+	      latency_us() {
 	}
 
 	ChunkserverChunkCounter(matocsserventry *server, MediaLabel label, int64_t weight,
-	                        uint32_t version, uint8_t load_factor)
+	                        uint32_t version, uint8_t load_factor, uint32_t queue_depth = 0,
+	                        uint32_t latency_us = 0)
 	    : server(server),
 	      label(std::move(label)),
 	      weight(weight),
 	      version(version),
 	      chunks_created(0),
-	      load_factor(load_factor) {
+	      load_factor(load_factor),
+	      queue_depth(queue_depth),
+	      latency_us(latency_us) {
+	}
+
+	/// Expected time (in microseconds) a new chunk would wait for the server's busiest disk.
+	uint64_t expectedWait() const {
+		return uint64_t(latency_us) * (uint64_t(queue_depth) + 1);
 	}
 
 	matocsserventry *server;
@@ -62,6 +72,8 @@ struct ChunkserverChunkCounter {
 	/// their labels or weights).
 	int64_t chunks_created;
 	uint8_t load_factor;
+	uint32_t queue_depth;
+	uint32_t latency_us;
 };
 
 typedef std::vector<ChunkserverChunkCounter> ChunkCreationHistory;
@@ -80,10 +92,15 @@ public:
 	 * \param label server's label.
 	 * \param weight server priority used in search.
 	 * \param version chunk server version.
+	 * \param load_factor percentage of time server's disks were busy.
+	 * \param queue_depth deepest I/O queue among server's disks.
+	 * \param latency_us slowest mean I/O service time among server's disks.
 	 */
 	void addServer(matocsserventry *server, const MediaLabel &label, int64_t weight,
-	               uint32_t version, uint8_t load_factor) {
-		servers_.emplace_back(server, label, weight, version, load_factor);
+	               uint32_t version, uint8_t load_factor, uint32_t queue_depth = 0,
+	               uint32_t latency_us = 0) {
+		servers_.emplace_back(server, label, weight, version, load_factor, queue_depth,
+		                      latency_us);
 	}
 
 	/*! \brief Prepare data for subsequent calls to chooseServersForLabels.
@@ -107,6 +124,17 @@ public:
 protected:
 	void sortAvoidingSameIp();
 
+	/*! \brief Picks the next server satisfying the predicate.
+	 *
+	 * Takes the first two matching servers in the prepared order and returns the one
+	 * with the shorter expected disk wait (power of two choices), so that momentarily
+	 * overloaded servers are skipped without departing far from the usage based order.
+	 *
+	 * \return index of the chosen server in servers_, or -1 if no server matches.
+	 */
+	template <typename Predicate>
+	int pickLessLoaded(Predicate matches) const;
+
 private:
 	std::vector<ChunkserverChunkCounter> servers_;
 };
@@ -458,3 +458,87 @@ TEST_F(GetServersForNewChunkTests, ChunkDistribution) {
 			{"A", 2}, {"B", 2}, {"B", 2}, {"C", 2}
 	});
 }
+
+TEST_F(GetServersForNewChunkTests, LoadAwareChoiceKeepsLabels) {
+	// servers: A(overloaded) B B
+	//    goal: A _
+	ChunkCreationHistory history;
+	Goal::Slice::Labels labels = {{MediaLabel::kWildcard, 1}, {MediaLabel("A"), 1}};
+	for (int i = 0; i < kTestAccuracy; ++i) {
+		std::vector<matocsserventry *> used;
+		GetServersForNewChunk getter;
+		getter.addServer(reinterpret_cast<matocsserventry *>(1), MediaLabel("A"), 1, 0, 0, 500,
+		                 100000);
+		getter.addServer(reinterpret_cast<matocsserventry *>(2), MediaLabel("B"), 1, 0, 0, 0, 100);
+		getter.addServer(reinterpret_cast<matocsserventry *>(3), MediaLabel("B"), 1, 0, 0, 0, 100);
+		getter.prepareData(history);
+		auto result = getter.chooseServersForLabels(history, createProxy(labels), 0, used);
+		ASSERT_EQ(2U, result.size());
+		ASSERT_EQ(1, std::count(result.begin(), result.end(),
+		                        reinterpret_cast<matocsserventry *>(1)));
+	}
+}
+
+TEST_F(GetServersForNewChunkTests, LoadAwarePlacementSkew) {
+	// Simulates chunk creation on servers of equal weight whose disks differ in speed.
+	// Every round each server completes a number of writes proportional to its speed and
+	// reports its queue depth to the placement algorithm, like a chunkserver would.
+	struct SimulatedServer {
+		uint32_t latency_us;
+		uint32_t writes_per_round;
+		uint32_t queue_depth;
+		int chunks;
+		uint32_t max_queue_depth;
+	};
+	std::vector<SimulatedServer> servers = {
+		{1000, 4, 0, 0, 0}, {1000, 4, 0, 0, 0}, {1000, 4, 0, 0, 0}, {4000, 1, 0, 0, 0},
+	};
+
+	constexpr int kRounds = 10000;
+	constexpr int kChunksPerRound = 6;
+	ChunkCreationHistory history;
+	Goal::Slice::Labels labels = {{MediaLabel::kWildcard, 2}};
+	for (int round = 0; round < kRounds; ++round) {
+		for (int chunk = 0; chunk < kChunksPerRound; ++chunk) {
+			GetServersForNewChunk getter;
+			for (size_t s = 0; s < servers.size(); ++s) {
+				getter.addServer(reinterpret_cast<matocsserventry *>(s + 1), MediaLabel::kWildcard,
+				                 1, 0, 0, servers[s].queue_depth, servers[s].latency_us);
+			}
+			getter.prepareData(history);
+			std::vector<matocsserventry *> used;
+			auto result = getter.chooseServersForLabels(history, createProxy(labels), 0, used);
+			ASSERT_EQ(2U, result.size());
+			for (matocsserventry *ptr : result) {
+				auto &server = servers[reinterpret_cast<intptr_t>(ptr) - 1];
+				++server.chunks;
+				++server.queue_depth;
+			}
+		}
+		for (auto &server : servers) {
+			server.max_queue_depth = std::max(server.max_queue_depth, server.queue_depth);
+			server.queue_depth -= std::min(server.queue_depth, server.writes_per_round);
+		}
+	}
+
+	int min_chunks = 2 * kRounds * kChunksPerRound, max_chunks = 0;
+	for (const auto &server : servers) {
+		min_chunks = std::min(min_chunks, server.chunks);
+		max_chunks = std::max(max_chunks, server.chunks);
+	}
+	double skew = double(max_chunks) / std::max(min_chunks, 1);
+	RecordProperty("PlacementSkew", ::testing::PrintToString(skew));
+
+	// Chunks are spread according to the speed of the servers: the fast ones get more, but
+	// not more than the ratio of the speeds (4), which would starve the slow one.
+	EXPECT_GE(skew, 2.0);
+	EXPECT_LE(skew, 4.0);
+
+	// The slow server gets fewer chunks, but is not starved, and no queue grows unbounded.
+	for (size_t s = 0; s + 1 < servers.size(); ++s) {
+		EXPECT_GT(servers[s].chunks, servers.back().chunks);
+		EXPECT_LE(servers[s].max_queue_depth, 16U);
+	}
+	EXPECT_GT(servers.back().chunks, 0);
+	EXPECT_LE(servers.back().max_queue_depth, 16U);
+}
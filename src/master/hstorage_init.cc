@@ -22,12 +22,16 @@
 
 #include "common/cfg.h"
 #include "common/event_loop.h"
+#include "master/hstring_arenastorage.h"
 #include "master/hstring_memstorage.h"
 #ifdef SAUNAFS_HAVE_DB
   #include "master/hstring_bdbstorage.h"
 #endif
 
 static int gUseBDBStorage;
+static int gUseArenaStorage;
+static uint32_t gDedupTableSize;
+static bool gConcurrentReads;
 static std::string gBDBStoragePath;
 static uint64_t gBDBStorageCacheSize;
 
@@ -48,27 +52,64 @@ void hstorage_reload() {
 	if (cache_size != gBDBStorageCacheSize) {
 		safs_pretty_syslog(LOG_ERR, "Changing BDB_NAME_STORAGE_CACHE_SIZE requires restart.");
 	}
+
+	if (cfg_getuint8("USE_ARENA_FOR_NAME_STORAGE", 0) != gUseArenaStorage) {
+		safs_pretty_syslog(LOG_ERR, "Changing USE_ARENA_FOR_NAME_STORAGE requires restart.");
+	}
+
+	if (cfg_getuint32("NAME_STORAGE_DEDUP_TABLE_SIZE",
+	                  hstorage::ArenaStorage::kDefaultDedupTableSize) != gDedupTableSize) {
+		safs_pretty_syslog(LOG_ERR, "Changing NAME_STORAGE_DEDUP_TABLE_SIZE requires restart.");
+	}
+}
+
+/// Number of arena blocks which may be compacted in one second (each one is 1MiB).
+static constexpr uint32_t kArenaBlocksCompactedPerSecond = 16;
+
+static void hstorage_compact() {
+	auto &storage = static_cast<hstorage::ArenaStorage &>(hstorage::Storage::instance());
+	storage.compact(kArenaBlocksCompactedPerSecond);
 }
 
 void hstorage_term(void) {
 	hstorage::Storage::reset();
 }
 
+bool hstorage_supports_concurrent_reads() {
+	// the Berkeley DB handle is not opened in a thread-safe mode
+	return gConcurrentReads;
+}
+
 int hstorage_init() {
 	gUseBDBStorage = cfg_getuint8("USE_BDB_FOR_NAME_STORAGE", 0);
 	gBDBStoragePath = cfg_getstring("DATA_PATH", DATA_PATH);
 	gBDBStorageCacheSize = cfg_getuint32("BDB_NAME_STORAGE_CACHE_SIZE", 10);
+	gUseArenaStorage = cfg_getuint8("USE_ARENA_FOR_NAME_STORAGE", 0);
+	gDedupTableSize = cfg_getuint32("NAME_STORAGE_DEDUP_TABLE_SIZE",
+	                                hstorage::ArenaStorage::kDefaultDedupTableSize);
+
+	if (gUseBDBStorage && gUseArenaStorage) {
+		safs_pretty_syslog(LOG_ERR, "USE_BDB_FOR_NAME_STORAGE and USE_ARENA_FOR_NAME_STORAGE "
+		                            "are mutually exclusive, using Berkeley DB.");
+	}
 
 	if (gUseBDBStorage) {
 #ifdef SAUNAFS_HAVE_DB
 		hstorage::Storage::reset(new hstorage::BDBStorage(gBDBStoragePath + "/name_storage.db",
 		                                                  gBDBStorageCacheSize * 1024 * 1024, 1));
+		gConcurrentReads = false;
 #else
 		safs_pretty_syslog(LOG_ERR, "Berkeley DB was not enabled during compilation. Falling back to default name storage.");
 		hstorage::Storage::reset(new hstorage::MemStorage());
+		gConcurrentReads = true;
 #endif
+	} else if (gUseArenaStorage) {
+		hstorage::Storage::reset(new hstorage::ArenaStorage(gDedupTableSize));
+		gConcurrentReads = true;
+		eventloop_timeregister(TIMEMODE_RUN_LATE, 1, 0, hstorage_compact);
 	} else {
 		hstorage::Storage::reset(new hstorage::MemStorage());
+		gConcurrentReads = true;
 	}
 
 	eventloop_reloadregister(hstorage_reload);
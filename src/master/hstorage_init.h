@@ -23,3 +23,6 @@
 #include "common/platform.h"
 
 int hstorage_init();
+
+/// Returns true if names can be read by many threads at once.
+bool hstorage_supports_concurrent_reads();
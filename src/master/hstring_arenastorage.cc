@@ -0,0 +1,285 @@
+/*
+   Copyright 2023 Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "master/hstring_arenastorage.h"
+
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <new>
+
+using namespace hstorage;
+
+/*
+ * Record of a string in a block:
+ *   id:32 length:varint data:length
+ * The id of an unbound record is set to kNoId, so compaction can skip it.
+ */
+static constexpr uint32_t kMaxLengthSize = 5;
+/// Strings with longer records get a block of their own.
+static constexpr uint32_t kMaxSharedRecordSize = ArenaStorage::kBlockSize / 4;
+
+static uint32_t putLength(uint8_t *destination, uint32_t length) {
+	uint32_t size = 0;
+	while (length >= 0x80) {
+		destination[size++] = (length & 0x7F) | 0x80;
+		length >>= 7;
+	}
+	destination[size++] = length;
+	return size;
+}
+
+static uint32_t getLength(const uint8_t *source, uint32_t &length) {
+	uint32_t size = 0;
+	length = 0;
+	for (unsigned shift = 0;; shift += 7) {
+		uint8_t byte = source[size++];
+		length |= static_cast<uint32_t>(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) {
+			return size;
+		}
+	}
+}
+
+static uint32_t stringHash(std::string_view str) {
+	// the same as HString::hash()
+	return std::hash<std::string_view>()(str);
+}
+
+ArenaStorage::ArenaStorage(uint32_t dedupTableSize)
+		: currentBlock_(kNoBlock),
+		  dedupTable_(dedupTableSize, kNoId),
+		  dedupHits_(0) {
+}
+
+std::string_view ArenaStorage::view(uint32_t id) const {
+	uint64_t location = ids_[id] & kLocationMask;
+	const uint8_t *record = blocks_[location / kBlockSize].data.get() + location % kBlockSize;
+	uint32_t length;
+	const uint8_t *data = record + sizeof(uint32_t);
+	data += getLength(data, length);
+	return std::string_view(reinterpret_cast<const char *>(data), length);
+}
+
+bool ArenaStorage::compare(const Handle &handle, const HString &str) {
+	if (hash(handle) == static_cast<HashType>(str.hash())) {
+		return view(handle) == str;
+	}
+	return false;
+}
+
+::std::string ArenaStorage::get(const Handle &handle) {
+	return ::std::string(view(handle));
+}
+
+void ArenaStorage::copy(Handle &handle, const Handle &other) {
+	uint32_t id = idOf(other);
+	if ((ids_[id] >> kLocationBits) < kMaxReferences) {
+		ids_[id] += static_cast<uint64_t>(1) << kLocationBits;
+	} else {
+		id = store(view(id));
+	}
+	handle.data() = encode(id, hash(other));
+}
+
+void ArenaStorage::bind(Handle &handle, const HString &str) {
+	uint32_t *slot = dedupTable_.empty() ? nullptr : &dedupSlot(str.hash());
+	if (slot && *slot != kNoId && (ids_[*slot] >> kLocationBits) < kMaxReferences
+	    && view(*slot) == str) {
+		ids_[*slot] += static_cast<uint64_t>(1) << kLocationBits;
+		dedupHits_++;
+		handle.data() = encode(*slot, str.hash());
+		return;
+	}
+	uint32_t id = store(str);
+	if (slot) {
+		*slot = id;
+	}
+	handle.data() = encode(id, str.hash());
+}
+
+void ArenaStorage::unbind(Handle &handle) {
+	// handles used only as search keys (without an id) are not bound to anything
+	if ((handle.data() & Handle::kMask) == 0) {
+		return;
+	}
+	uint32_t id = idOf(handle);
+	assert(id < ids_.size() && (ids_[id] >> kLocationBits) > 0);
+	ids_[id] -= static_cast<uint64_t>(1) << kLocationBits;
+	if ((ids_[id] >> kLocationBits) == 0) {
+		release(id);
+	}
+}
+
+::std::string ArenaStorage::name() const {
+	return kName;
+}
+
+/*
+ * Stores a new copy of the string with reference count 1.
+ */
+uint32_t ArenaStorage::store(std::string_view str) {
+	uint32_t id;
+	if (!freeIds_.empty()) {
+		id = freeIds_.back();
+		freeIds_.pop_back();
+	} else {
+		if (ids_.size() >= kNoId) {
+			throw std::bad_alloc();
+		}
+		id = ids_.size();
+		ids_.push_back(0);
+	}
+
+	uint8_t header[sizeof(uint32_t) + kMaxLengthSize];
+	memcpy(header, &id, sizeof(id));
+	uint32_t headerSize = sizeof(id) + putLength(header + sizeof(id), str.size());
+	uint32_t recordSize = headerSize + str.size();
+
+	uint64_t location;
+	if (recordSize > kMaxSharedRecordSize) {
+		uint32_t block = newBlock(recordSize);
+		location = static_cast<uint64_t>(block) * kBlockSize;
+		blocks_[block].used = recordSize;
+	} else {
+		location = append(nullptr, recordSize);
+	}
+	uint8_t *record = blocks_[location / kBlockSize].data.get() + location % kBlockSize;
+	memcpy(record, header, headerSize);
+	memcpy(record + headerSize, str.data(), str.size());
+	ids_[id] = location | (static_cast<uint64_t>(1) << kLocationBits);
+	return id;
+}
+
+/*
+ * Reserves space for a record in the current block (starting a new one if needed)
+ * and copies the record there if it is given.
+ */
+uint64_t ArenaStorage::append(const uint8_t *record, uint32_t size) {
+	if (currentBlock_ == kNoBlock || blocks_[currentBlock_].used + size > kBlockSize) {
+		if (currentBlock_ != kNoBlock) {
+			Block &previous = blocks_[currentBlock_];
+			previous.unused += kBlockSize - previous.used;
+			previous.used = kBlockSize;
+		}
+		currentBlock_ = newBlock(kBlockSize);
+	}
+	Block &block = blocks_[currentBlock_];
+	uint32_t offset = block.used;
+	block.used += size;
+	if (record) {
+		memcpy(block.data.get() + offset, record, size);
+	}
+	return static_cast<uint64_t>(currentBlock_) * kBlockSize + offset;
+}
+
+void ArenaStorage::release(uint32_t id) {
+	uint64_t location = ids_[id] & kLocationMask;
+	uint32_t blockIndex = location / kBlockSize;
+	Block &block = blocks_[blockIndex];
+	uint8_t *record = block.data.get() + location % kBlockSize;
+
+	std::string_view str = view(id);
+	if (!dedupTable_.empty() && dedupSlot(stringHash(str)) == id) {
+		dedupSlot(stringHash(str)) = kNoId;
+	}
+	uint32_t recordSize = (str.data() - reinterpret_cast<const char *>(record)) + str.size();
+	memcpy(record, &kNoId, sizeof(kNoId));
+	block.unused += recordSize;
+	ids_[id] = 0;
+	freeIds_.push_back(id);
+
+	if (block.unused == block.used && blockIndex != currentBlock_) {
+		freeBlock(blockIndex);
+	}
+}
+
+uint32_t ArenaStorage::newBlock(uint32_t size) {
+	uint32_t index;
+	if (!freeBlocks_.empty()) {
+		index = freeBlocks_.back();
+		freeBlocks_.pop_back();
+	} else {
+		if (static_cast<uint64_t>(blocks_.size() + 1) * kBlockSize > kLocationMask) {
+			throw std::bad_alloc();
+		}
+		index = blocks_.size();
+		blocks_.emplace_back();
+	}
+	Block &block = blocks_[index];
+	block.data.reset(new uint8_t[size]);
+	block.size = size;
+	block.used = 0;
+	block.unused = 0;
+	return index;
+}
+
+void ArenaStorage::freeBlock(uint32_t index) {
+	blocks_[index] = Block();
+	freeBlocks_.push_back(index);
+}
+
+void ArenaStorage::compactBlock(uint32_t index) {
+	// the block's memory stays in place until it is freed, even if blocks_ grows
+	const uint8_t *data = blocks_[index].data.get();
+	uint32_t used = blocks_[index].used;
+	uint32_t offset = 0;
+	while (offset < used && blocks_[index].unused < used) {
+		uint32_t id, length;
+		memcpy(&id, data + offset, sizeof(id));
+		uint32_t recordSize = sizeof(id) + getLength(data + offset + sizeof(id), length) + length;
+		if (id != kNoId) {
+			uint64_t location = append(data + offset, recordSize);
+			ids_[id] = (ids_[id] & ~kLocationMask) | location;
+			blocks_[index].unused += recordSize;
+		}
+		offset += recordSize;
+	}
+	freeBlock(index);
+}
+
+uint32_t ArenaStorage::compact(uint32_t maxBlocks) {
+	uint32_t compacted = 0;
+	for (uint32_t index = 0; index < blocks_.size() && compacted < maxBlocks; ++index) {
+		const Block &block = blocks_[index];
+		if (!block.data || index == currentBlock_ || block.size != kBlockSize) {
+			continue;
+		}
+		if (static_cast<uint64_t>(block.unused) * 100
+		    > static_cast<uint64_t>(block.size) * kCompactionThresholdPercent) {
+			compactBlock(index);
+			compacted++;
+		}
+	}
+	return compacted;
+}
+
+ArenaStorage::Stats ArenaStorage::stats() const {
+	Stats stats;
+	stats.strings = ids_.size() - freeIds_.size();
+	for (const Block &block : blocks_) {
+		if (block.data) {
+			stats.blocks++;
+			stats.allocatedBytes += block.size;
+			stats.unusedBytes += block.unused;
+		}
+	}
+	stats.dedupHits = dedupHits_;
+	return stats;
+}
@@ -0,0 +1,138 @@
+/*
+   Copyright 2023 Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "master/hstring_storage.h"
+
+namespace hstorage {
+
+/*! \brief Arena-backed storage for hstring
+ *
+ * Strings are appended to large memory blocks instead of being allocated one by one,
+ * which saves a malloc header and fragmentation per name. Data stored in handle is
+ * 16 bits of string's hash + (id of the string + 1). The id indexes a table holding
+ * the current location of the string and its reference count, so strings can be moved
+ * between blocks without changing their handles (handles are keys of directory entries).
+ *
+ * Frequent names (e.g. "index.html") are deduplicated: a direct-mapped table remembers
+ * recently bound strings by their hash and binding an equal string only increments the
+ * reference count of the stored one. Space of unbound strings is reclaimed by compact().
+ *
+ * Binding and unbinding are not thread-safe. compare() and get() may be called
+ * concurrently as long as no other method is called at the same time.
+ */
+class ArenaStorage : public Storage {
+public:
+	typedef Handle::HashType HashType;
+	typedef Handle::ValueType ValueType;
+
+	struct Stats {
+		uint64_t strings = 0;         ///< number of stored strings
+		uint64_t blocks = 0;          ///< number of allocated blocks
+		uint64_t allocatedBytes = 0;  ///< memory allocated for blocks
+		uint64_t unusedBytes = 0;     ///< space of unbound strings, not compacted yet
+		uint64_t dedupHits = 0;       ///< bindings which reused a stored string
+	};
+
+	static constexpr uint32_t kBlockSize = 1 << 20;
+	/// Blocks with more unused space than this are compacted.
+	static constexpr uint32_t kCompactionThresholdPercent = 50;
+	static constexpr uint32_t kDefaultDedupTableSize = 1 << 16;
+
+	/// A dedup table of size 0 disables deduplication.
+	explicit ArenaStorage(uint32_t dedupTableSize = kDefaultDedupTableSize);
+
+	bool compare(const Handle &handle, const HString &str) override;
+	::std::string get(const Handle &handle) override;
+	void copy(Handle &handle, const Handle &other) override;
+	void bind(Handle &handle, const HString &str) override;
+	void unbind(Handle &handle) override;
+	::std::string name() const override;
+
+	/*!
+	 * \brief Moves strings out of fragmented blocks and frees these blocks.
+	 *
+	 * \param maxBlocks maximal number of blocks to compact
+	 * \return number of compacted blocks
+	 */
+	uint32_t compact(uint32_t maxBlocks);
+
+	Stats stats() const;
+
+	static HashType hash(const Handle &handle) {
+		return handle.hash();
+	}
+
+private:
+	struct Block {
+		std::unique_ptr<uint8_t[]> data;
+		uint32_t size = 0;
+		uint32_t used = 0;    ///< bytes taken by records (live or not)
+		uint32_t unused = 0;  ///< bytes of unbound records and of the wasted tail
+	};
+
+	std::string_view view(uint32_t id) const;
+	std::string_view view(const Handle &handle) const {
+		return view(idOf(handle));
+	}
+
+	uint32_t store(std::string_view str);
+	uint64_t append(const uint8_t *record, uint32_t size);
+	void release(uint32_t id);
+	uint32_t newBlock(uint32_t size);
+	void freeBlock(uint32_t block);
+	void compactBlock(uint32_t block);
+
+	uint32_t &dedupSlot(uint32_t strHash) {
+		return dedupTable_[strHash % dedupTable_.size()];
+	}
+
+	static uint32_t idOf(const Handle &handle) {
+		return (handle.data() & Handle::kMask) - 1;
+	}
+
+	static ValueType encode(uint32_t id, HashType hash) {
+		return (static_cast<ValueType>(id) + 1) | (static_cast<ValueType>(hash) << Handle::kHashShift);
+	}
+
+	static constexpr const char *kName = "ArenaStorage";
+	static constexpr uint32_t kNoId = UINT32_MAX;
+	static constexpr uint32_t kNoBlock = UINT32_MAX;
+
+	/// Entry of the id table: location of the string (40 bits) + reference count (24 bits).
+	static constexpr unsigned kLocationBits = 40;
+	static constexpr uint64_t kLocationMask = (static_cast<uint64_t>(1) << kLocationBits) - 1;
+	static constexpr uint32_t kMaxReferences = (1 << (64 - kLocationBits)) - 1;
+
+	std::vector<Block> blocks_;
+	std::vector<uint32_t> freeBlocks_;
+	uint32_t currentBlock_;
+	std::vector<uint64_t> ids_;
+	std::vector<uint32_t> freeIds_;
+	std::vector<uint32_t> dedupTable_;
+	uint64_t dedupHits_;
+};
+
+} // namespace hstorage
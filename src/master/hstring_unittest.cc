@@ -4,6 +4,7 @@
 #include "master/hstring_bdbstorage.h"
 #endif
 
+#include "master/hstring_arenastorage.h"
 #include "master/hstring_memstorage.h"
 
 #include <functional>
@@ -90,6 +91,94 @@ TEST(HStringTest, MemCopy) {
 	EXPECT_TRUE(h2 == h4.get());
 }
 
+/*
+ * ArenaStorage tests
+ */
+TEST(HStringTest, ArenaComparison) {
+	Storage::reset(new ArenaStorage());
+	HString str1("Good morning");
+	HString str2("Good evening");
+	Handle handle(str1);
+
+	EXPECT_TRUE(str1 == handle);
+	EXPECT_TRUE(handle == str1);
+	EXPECT_FALSE(str2 == handle);
+	EXPECT_TRUE(str2 < handle);
+	EXPECT_TRUE(handle > str2);
+	EXPECT_EQ(handle.hash(), static_cast<Handle::HashType>(str1.hash()));
+}
+
+TEST(HStringTest, ArenaGetAndCopy) {
+	Storage::reset(new ArenaStorage());
+	HString strs[]{HString("Good morning"), HString(), HString(std::string(300000, 'x'))};
+	for (auto &str : strs) {
+		Handle handle(str);
+		Handle copy(handle);
+		EXPECT_TRUE(str == handle.get());
+		EXPECT_TRUE(str == copy.get());
+	}
+	EXPECT_EQ(0U, static_cast<ArenaStorage &>(Storage::instance()).stats().strings);
+}
+
+TEST(HStringTest, ArenaDeduplication) {
+	ArenaStorage *storage = new ArenaStorage();
+	Storage::reset(storage);
+	{
+		std::vector<Handle> handles;
+		for (int i = 0; i < 100; ++i) {
+			handles.emplace_back(HString("index.html"));
+			handles.emplace_back(HString("file_" + std::to_string(i)));
+		}
+		EXPECT_EQ(101U, storage->stats().strings);
+		EXPECT_EQ(99U, storage->stats().dedupHits);
+		EXPECT_TRUE(handles[0].data() == handles[2].data());
+		EXPECT_TRUE(handles[198] == HString("index.html"));
+	}
+	EXPECT_EQ(0U, storage->stats().strings);
+
+	storage = new ArenaStorage(0);
+	Storage::reset(storage);
+	Handle h1("index.html");
+	Handle h2("index.html");
+	EXPECT_EQ(2U, storage->stats().strings);
+}
+
+TEST(HStringTest, ArenaCompaction) {
+	ArenaStorage *storage = new ArenaStorage(0);
+	Storage::reset(storage);
+	std::vector<Handle> handles;
+	std::vector<Handle::ValueType> values;
+	for (int i = 0; i < 200000; ++i) {
+		handles.emplace_back(HString("some_file_name_" + std::to_string(i)));
+		values.push_back(handles.back().data());
+	}
+	uint64_t blocks = storage->stats().blocks;
+	ASSERT_GT(blocks, 2U);
+	const Handle empty;
+	for (int i = 0; i < 200000; ++i) {
+		if (i % 4 != 0) {
+			handles[i] = empty;
+		}
+	}
+	EXPECT_GT(storage->compact(1000), 0U);
+	EXPECT_LT(storage->stats().blocks, blocks);
+	EXPECT_LT(storage->stats().unusedBytes, storage->stats().allocatedBytes / 2);
+	for (int i = 0; i < 200000; i += 4) {
+		// handles (used as keys of directory entries) do not change
+		EXPECT_EQ(values[i], handles[i].data());
+		EXPECT_TRUE(handles[i] == HString("some_file_name_" + std::to_string(i)));
+	}
+}
+
+TEST(HStringTest, ArenaSearchKeyIsNotBound) {
+	Storage::reset(new ArenaStorage());
+	Handle handle("Good morning");
+	{
+		Handle key(handle.data() & ~Handle::kMask);
+	}
+	EXPECT_TRUE(handle == HString("Good morning"));
+}
+
 /*
  * BDBStorage tests
  */
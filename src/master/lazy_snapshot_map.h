@@ -0,0 +1,141 @@
+/*
+   Copyright 2023 Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common/hashfn.h"
+
+/*! \brief Directories which are lazy (copy-on-write) snapshots of other directories.
+ *
+ * A lazy copy is a directory which has its own node and attributes, but whose entries
+ * are still shared with its source directory. Entries are copied (materialized) only when
+ * either the copy or the source is about to be modified. Both directions are indexed,
+ * so checking a node in either role costs a single hash lookup.
+ *
+ * The map is a part of the metadata, so it keeps a checksum of its entries, which is
+ * updated on every change.
+ */
+class LazySnapshotMap {
+public:
+	typedef std::pair<uint32_t, uint32_t> Entry;  ///< (copy, source)
+
+	LazySnapshotMap() : checksum_(0) {
+	}
+
+	bool empty() const {
+		return sources_.empty();
+	}
+
+	size_t size() const {
+		return sources_.size();
+	}
+
+	/// Marks directory \a copy as a lazy copy of directory \a source.
+	void add(uint32_t copy, uint32_t source) {
+		remove(copy);
+		sources_.emplace(copy, source);
+		copies_.emplace(source, copy);
+		checksum_ ^= entryChecksum(copy, source);
+	}
+
+	/// Returns the source of a lazy copy or 0 if the directory is not a lazy copy.
+	uint32_t sourceOf(uint32_t copy) const {
+		auto it = sources_.find(copy);
+		return it == sources_.end() ? 0 : it->second;
+	}
+
+	bool hasCopies(uint32_t source) const {
+		return copies_.count(source) > 0;
+	}
+
+	/// Returns lazy copies of the directory, in a deterministic order.
+	std::vector<uint32_t> copiesOf(uint32_t source) const {
+		std::vector<uint32_t> result;
+		auto range = copies_.equal_range(source);
+		for (auto it = range.first; it != range.second; ++it) {
+			result.push_back(it->second);
+		}
+		std::sort(result.begin(), result.end());
+		return result;
+	}
+
+	/// Forgets that the directory is a lazy copy.
+	void remove(uint32_t copy) {
+		auto it = sources_.find(copy);
+		if (it == sources_.end()) {
+			return;
+		}
+		auto range = copies_.equal_range(it->second);
+		for (auto copy_it = range.first; copy_it != range.second; ++copy_it) {
+			if (copy_it->second == copy) {
+				copies_.erase(copy_it);
+				break;
+			}
+		}
+		checksum_ ^= entryChecksum(copy, it->second);
+		sources_.erase(it);
+	}
+
+	/// Removes all entries referring to a node which no longer exists.
+	void removeNode(uint32_t id) {
+		remove(id);
+		auto range = copies_.equal_range(id);
+		for (auto it = range.first; it != range.second; ++it) {
+			checksum_ ^= entryChecksum(it->second, id);
+			sources_.erase(it->second);
+		}
+		copies_.erase(range.first, range.second);
+	}
+
+	/// Returns all entries sorted by the copy, e.g. for storing them in the metadata file.
+	std::vector<Entry> entries() const {
+		std::vector<Entry> result(sources_.begin(), sources_.end());
+		std::sort(result.begin(), result.end());
+		return result;
+	}
+
+	void clear() {
+		sources_.clear();
+		copies_.clear();
+		checksum_ = 0;
+	}
+
+	/// Returns a checksum of all entries, independent of the order they were added in.
+	uint64_t checksum() const {
+		return checksum_;
+	}
+
+private:
+	static uint64_t entryChecksum(uint32_t copy, uint32_t source) {
+		uint64_t seed = 0x6c617a79;  // arbitrary number
+		hashCombine(seed, copy, source);
+		return seed;
+	}
+
+	std::unordered_map<uint32_t, uint32_t> sources_;       ///< copy -> source
+	std::unordered_multimap<uint32_t, uint32_t> copies_;   ///< source -> copies
+	uint64_t checksum_;                                    ///< xor of checksums of entries
+};
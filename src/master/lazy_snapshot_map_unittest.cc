@@ -0,0 +1,100 @@
+/*
+   Copyright 2023 Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "master/lazy_snapshot_map.h"
+
+#include <gtest/gtest.h>
+
+TEST(LazySnapshotMapTests, AddAndRemove) {
+	LazySnapshotMap map;
+	EXPECT_TRUE(map.empty());
+
+	map.add(10, 2);
+	map.add(11, 2);
+	map.add(12, 3);
+	EXPECT_EQ(3U, map.size());
+	EXPECT_EQ(2U, map.sourceOf(10));
+	EXPECT_EQ(0U, map.sourceOf(2));
+	EXPECT_TRUE(map.hasCopies(2));
+	EXPECT_FALSE(map.hasCopies(10));
+	EXPECT_EQ(std::vector<uint32_t>({10, 11}), map.copiesOf(2));
+
+	map.remove(10);
+	EXPECT_EQ(0U, map.sourceOf(10));
+	EXPECT_EQ(std::vector<uint32_t>({11}), map.copiesOf(2));
+
+	// changing the source of a copy
+	map.add(11, 3);
+	EXPECT_FALSE(map.hasCopies(2));
+	EXPECT_EQ(std::vector<uint32_t>({11, 12}), map.copiesOf(3));
+}
+
+TEST(LazySnapshotMapTests, RemoveNode) {
+	LazySnapshotMap map;
+	map.add(10, 2);
+	map.add(11, 2);
+	map.add(2, 1);
+
+	map.removeNode(2);
+	EXPECT_TRUE(map.empty());
+	EXPECT_FALSE(map.hasCopies(1));
+	EXPECT_EQ(0U, map.sourceOf(10));
+	EXPECT_EQ(0U, map.sourceOf(11));
+}
+
+TEST(LazySnapshotMapTests, Entries) {
+	LazySnapshotMap map;
+	map.add(30, 3);
+	map.add(10, 1);
+	map.add(20, 1);
+	std::vector<LazySnapshotMap::Entry> expected{{10, 1}, {20, 1}, {30, 3}};
+	EXPECT_EQ(expected, map.entries());
+
+	map.clear();
+	EXPECT_TRUE(map.empty());
+	EXPECT_TRUE(map.entries().empty());
+}
+
+TEST(LazySnapshotMapTests, Checksum) {
+	LazySnapshotMap map;
+	EXPECT_EQ(0U, map.checksum());
+
+	map.add(10, 1);
+	map.add(20, 2);
+	uint64_t checksum = map.checksum();
+	EXPECT_NE(0U, checksum);
+
+	LazySnapshotMap other;
+	other.add(20, 2);
+	other.add(10, 1);
+	EXPECT_EQ(checksum, other.checksum());
+
+	other.add(10, 2);
+	EXPECT_NE(checksum, other.checksum());
+	other.add(10, 1);
+	EXPECT_EQ(checksum, other.checksum());
+
+	map.add(30, 10);
+	map.removeNode(10);
+	other.remove(10);
+	EXPECT_EQ(other.checksum(), map.checksum());
+
+	map.clear();
+	EXPECT_EQ(0U, map.checksum());
+}
@@ -175,6 +175,121 @@ void LockRanges::clear() {
 	data_.clear();
 }
 
+PendingLocks::const_iterator &PendingLocks::const_iterator::operator++() {
+	const Node *node = stack_.back();
+	stack_.pop_back();
+	pushLeft(node->right.get());
+	return *this;
+}
+
+void PendingLocks::const_iterator::pushLeft(const Node *node) {
+	for (; node; node = node->left.get()) {
+		stack_.push_back(node);
+	}
+}
+
+void PendingLocks::update(Node *node) {
+	node->max_end = node->lock.end;
+	if (node->left) {
+		node->max_end = std::max(node->max_end, node->left->max_end);
+	}
+	if (node->right) {
+		node->max_end = std::max(node->max_end, node->right->max_end);
+	}
+}
+
+void PendingLocks::split(NodePtr node, const Key &key, NodePtr &less, NodePtr &greater_equal) {
+	if (!node) {
+		less.reset();
+		greater_equal.reset();
+		return;
+	}
+	if (node->key() < key) {
+		split(std::move(node->right), key, node->right, greater_equal);
+		update(node.get());
+		less = std::move(node);
+	} else {
+		split(std::move(node->left), key, less, node->left);
+		update(node.get());
+		greater_equal = std::move(node);
+	}
+}
+
+PendingLocks::NodePtr PendingLocks::merge(NodePtr less, NodePtr greater) {
+	if (!less) {
+		return greater;
+	}
+	if (!greater) {
+		return less;
+	}
+	if (less->priority > greater->priority) {
+		less->right = merge(std::move(less->right), std::move(greater));
+		update(less.get());
+		return less;
+	}
+	greater->left = merge(std::move(less), std::move(greater->left));
+	update(greater.get());
+	return greater;
+}
+
+void PendingLocks::insert(const LockRange &lock, int64_t order) {
+	// xorshift, priorities only need to be spread evenly
+	seed_ ^= seed_ << 13;
+	seed_ ^= seed_ >> 17;
+	seed_ ^= seed_ << 5;
+	NodePtr node(new Node(lock, order, seed_));
+	NodePtr less, greater_equal;
+	split(std::move(root_), node->key(), less, greater_equal);
+	root_ = merge(merge(std::move(less), std::move(node)), std::move(greater_equal));
+	++size_;
+}
+
+void PendingLocks::insert(const LockRange &lock) {
+	insert(lock, --min_order_);
+}
+
+void PendingLocks::pushBack(const LockRange &lock) {
+	insert(lock, ++max_order_);
+}
+
+PendingLocks::NodePtr PendingLocks::erase(const Key &key) {
+	NodePtr less, greater_equal, equal, greater;
+	split(std::move(root_), key, less, greater_equal);
+	split(std::move(greater_equal), Key{key.start, key.end, key.order + 1}, equal, greater);
+	root_ = merge(std::move(less), std::move(greater));
+	if (equal) {
+		--size_;
+	}
+	return equal;
+}
+
+void PendingLocks::collect(const Node *node, uint64_t start, uint64_t end,
+		std::vector<Key> &keys) {
+	// Nothing in the subtree ends after start
+	if (!node || node->max_end <= start) {
+		return;
+	}
+	collect(node->left.get(), start, end, keys);
+	// Neither this node nor nodes from its right subtree begin before end
+	if (node->lock.start >= end) {
+		return;
+	}
+	if (node->lock.end > start) {
+		keys.push_back(node->key());
+	}
+	collect(node->right.get(), start, end, keys);
+}
+
+void PendingLocks::extract(uint64_t start, uint64_t end, compact_vector<LockRange> &result) {
+	std::vector<Key> keys;
+	collect(root_.get(), start, end, keys);
+	for (const Key &key : keys) {
+		NodePtr node = erase(key);
+		assert(node);
+		result.push_back(std::move(node->lock));
+	}
+}
+
 bool FileLocks::sharedLock(uint32_t inode, uint64_t start, uint64_t end, Owner owner,
 		bool nonblocking) {
 	return apply(inode, Lock{Lock::Type::kShared, start, end, owner}, nonblocking);
@@ -226,9 +341,7 @@ bool FileLocks::apply(uint32_t inode, Lock lock, bool nonblocking) {
 }
 
 void FileLocks::enqueue(uint32_t inode, Lock lock) {
-	LockQueue &queue = pending_locks_[inode];
-
-	queue.insert(std::lower_bound(queue.begin(), queue.end(), lock), lock);
+	pending_locks_[inode].insert(lock);
 }
 
 void FileLocks::gatherCandidates(uint32_t inode, uint64_t start, uint64_t end, LockQueue &result) {
@@ -236,19 +349,12 @@ void FileLocks::gatherCandidates(uint32_t inode, uint64_t start, uint64_t end, L
 	if (it == pending_locks_.end()) {
 		return;
 	}
-	LockQueue &queue = it->second;
+	PendingLocks &queue = it->second;
 
-	auto first = ::std::lower_bound(queue.begin(), queue.end(), start,
-			[](const Lock &lock, uint64_t offset) {return lock.start < offset;});
-	auto last = ::std::upper_bound(queue.begin(), queue.end(), end,
-			[](uint64_t offset, const Lock &lock) {return offset < lock.start;});
-
-	if (first != queue.begin()) {
-		first--;
+	queue.extract(start, end, result);
+	if (queue.empty()) {
+		pending_locks_.erase(it);
 	}
-
-	std::move(first, last, std::back_inserter(result));
-	queue.erase(first, last);
 }
 
 void FileLocks::clear() {
@@ -429,7 +535,7 @@ void store(FILE *file, const Container &data) {
 
 void FileLocks::load(FILE *file) {
 	::load(file, [this](uint32_t inode, Lock &lock) { active_locks_[inode].insert(lock); });
-	::load(file, [this](uint32_t inode, Lock &lock) { pending_locks_[inode].push_back(lock); });
+	::load(file, [this](uint32_t inode, Lock &lock) { pending_locks_[inode].pushBack(lock); });
 }
 
 void FileLocks::store(FILE *file) {
@@ -25,7 +25,10 @@
 #include "common/compact_vector.h"
 #include "protocol/lock_info.h"
 
+#include <memory>
+#include <tuple>
 #include <unordered_map>
+#include <vector>
 
 /*! \brief Representation of half-open interval [a, b) with it's type and owner */
 struct LockRange {
@@ -214,13 +217,163 @@ inline bool operator==(const LockRange &range, const LockRange &other) {
 	return range.start == other.start && range.end == other.end && range.owners == other.owners;
 }
 
+/*! \brief Queue of pending locks of a single inode.
+ *
+ * Locks are kept in an interval tree (a treap ordered by start and end of ranges, where
+ * each node knows the maximal end of ranges in its subtree). This allows to find locks
+ * overlapping a given range in O(log n + k) time, so unlocking a small range wakes up only
+ * locks which might be waiting for it.
+ *
+ * Locks with equal ranges are ordered by an additional sequence number. A newly enqueued
+ * lock is placed before existing locks with the same range.
+ */
+class PendingLocks {
+private:
+	struct Node;
+
+public:
+	class const_iterator {
+	public:
+		const_iterator() : stack_() {}
+
+		const LockRange &operator*() const {
+			return stack_.back()->lock;
+		}
+
+		const LockRange *operator->() const {
+			return &stack_.back()->lock;
+		}
+
+		const_iterator &operator++();
+
+		bool operator==(const const_iterator &other) const {
+			return stack_ == other.stack_;
+		}
+
+		bool operator!=(const const_iterator &other) const {
+			return !(*this == other);
+		}
+
+	private:
+		friend class PendingLocks;
+
+		void pushLeft(const Node *node);
+
+		std::vector<const Node *> stack_;
+	};
+
+	PendingLocks() : root_(), size_(0), min_order_(0), max_order_(0), seed_(0x9E3779B9U) {}
+
+	/*! \brief Enqueues a lock before pending locks with the same range */
+	void insert(const LockRange &lock);
+
+	/*! \brief Enqueues a lock after pending locks with the same range */
+	void pushBack(const LockRange &lock);
+
+	/*! \brief Moves locks overlapping range [start, end) to \param result, ordered by range */
+	void extract(uint64_t start, uint64_t end, compact_vector<LockRange> &result);
+
+	/*! \brief Removes locks using unary predicate applied to lock */
+	template<typename UnaryPredicate>
+	void removeIf(UnaryPredicate pred);
+
+	size_t size() const {
+		return size_;
+	}
+
+	bool empty() const {
+		return size_ == 0;
+	}
+
+	const_iterator begin() const {
+		const_iterator it;
+		it.pushLeft(root_.get());
+		return it;
+	}
+
+	const_iterator end() const {
+		return const_iterator();
+	}
+
+	void clear() {
+		root_.reset();
+		size_ = 0;
+	}
+
+private:
+	struct Key {
+		uint64_t start;
+		uint64_t end;
+		int64_t order;
+
+		bool operator<(const Key &other) const {
+			return std::tie(start, end, order) < std::tie(other.start, other.end, other.order);
+		}
+	};
+
+	struct Node {
+		Node(const LockRange &lock, int64_t order, uint32_t priority)
+			: lock(lock), order(order), priority(priority), max_end(lock.end),
+			  left(), right() {}
+
+		Key key() const {
+			return Key{lock.start, lock.end, order};
+		}
+
+		LockRange lock;
+		int64_t order;     /*!< orders locks with equal ranges */
+		uint32_t priority; /*!< heap priority of the treap */
+		uint64_t max_end;  /*!< maximal end of ranges in the subtree */
+		std::unique_ptr<Node> left, right;
+	};
+
+	typedef std::unique_ptr<Node> NodePtr;
+
+	static void update(Node *node);
+	static void split(NodePtr node, const Key &key, NodePtr &less, NodePtr &greater_equal);
+	static NodePtr merge(NodePtr less, NodePtr greater);
+	static void collect(const Node *node, uint64_t start, uint64_t end, std::vector<Key> &keys);
+	template<typename UnaryPredicate>
+	static void collectIf(const Node *node, UnaryPredicate &pred, std::vector<Key> &keys);
+
+	void insert(const LockRange &lock, int64_t order);
+	NodePtr erase(const Key &key);
+
+	NodePtr root_;
+	size_t size_;
+	int64_t min_order_;
+	int64_t max_order_;
+	uint32_t seed_;
+};
+
+template<typename UnaryPredicate>
+void PendingLocks::collectIf(const Node *node, UnaryPredicate &pred, std::vector<Key> &keys) {
+	if (!node) {
+		return;
+	}
+	collectIf(node->left.get(), pred, keys);
+	if (pred(node->lock)) {
+		keys.push_back(node->key());
+	}
+	collectIf(node->right.get(), pred, keys);
+}
+
+template<typename UnaryPredicate>
+void PendingLocks::removeIf(UnaryPredicate pred) {
+	std::vector<Key> keys;
+	collectIf(root_.get(), pred, keys);
+	for (const Key &key : keys) {
+		erase(key);
+	}
+}
+
 class FileLocks {
 public:
 	typedef LockRange::Owner Owner;
 	typedef LockRange Lock;
 	/*! \brief Set of all applied locks */
 	typedef LockRanges Locks;
-	/*! \brief Queue of all pending locks */
+	/*! \brief List of pending locks */
 	typedef compact_vector<Lock> LockQueue;
 
 	FileLocks() : active_locks_(), pending_locks_() {
@@ -281,8 +434,8 @@ public:
 	 * \param inode inode number
 	 * \param start beginning of regarded range
 	 * \param end end of regarded range
-	 * \return a list of locks from pending queue that might be available
-	 * after removing a lock from range [start, end).
+	 * \return a list of locks from pending queue that overlap range [start, end),
+	 * so they might be available after removing a lock from this range.
 	 * Candidates are not guaranteed to be suitable for insertion,
 	 * it still needs to be checked with a call to fits() function.
 	 * This function effectively removes candidates from queue,
@@ -349,7 +502,7 @@ private:
 	void enqueue(uint32_t inode, Lock lock);
 
 	std::unordered_map<uint32_t, Locks> active_locks_;
-	std::unordered_map<uint32_t, LockQueue> pending_locks_;
+	std::unordered_map<uint32_t, PendingLocks> pending_locks_;
 };
 
 template<typename UnaryPredicate>
@@ -358,12 +511,9 @@ void FileLocks::removePending(uint32_t inode, UnaryPredicate pred) {
 	if (it == pending_locks_.end()) {
 		return;
 	}
-	LockQueue &queue = it->second;
+	PendingLocks &queue = it->second;
 
-	queue.erase(
-		std::remove_if(queue.begin(), queue.end(), pred),
-		queue.end()
-	);
+	queue.removeIf(pred);
 
 	// If last lock was unqueued, inode info can be removed from structure
 	if (queue.empty()) {
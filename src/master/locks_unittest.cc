@@ -323,3 +323,60 @@ TEST(LocksTest, Unqueue) {
 
 	locks.clear();
 }
+
+TEST(LocksTest, PendingLocksExtract) {
+	PendingLocks pending;
+	FileLocks::LockQueue queue;
+
+	pending.insert(LockRange(LockRange::Type::kShared, 0, 1000, owners[0]));
+	for (uint64_t i = 0; i < 100; ++i) {
+		pending.insert(LockRange(LockRange::Type::kExclusive, 10 * i, 10 * i + 5, owners[1]));
+	}
+	EXPECT_EQ(101U, pending.size());
+
+	// Only locks overlapping the range are extracted, including the long one
+	pending.extract(503, 521, queue);
+	ASSERT_EQ(4U, queue.size());
+	EXPECT_EQ(0U, queue[0].start);
+	EXPECT_EQ(500U, queue[1].start);
+	EXPECT_EQ(510U, queue[2].start);
+	EXPECT_EQ(520U, queue[3].start);
+	EXPECT_EQ(97U, pending.size());
+	queue.clear();
+
+	// Adjacent ranges do not overlap
+	pending.extract(495, 500, queue);
+	EXPECT_EQ(0U, queue.size());
+
+	pending.removeIf([](const LockRange &lock) { return lock.start >= 500; });
+	EXPECT_EQ(50U, pending.size());
+
+	uint64_t previous = 0;
+	for (const LockRange &lock : pending) {
+		EXPECT_LE(previous, lock.start);
+		previous = lock.start;
+	}
+
+	pending.extract(0, std::numeric_limits<uint64_t>::max(), queue);
+	EXPECT_EQ(50U, queue.size());
+	EXPECT_TRUE(pending.empty());
+	EXPECT_TRUE(pending.begin() == pending.end());
+}
+
+TEST(LocksTest, PendingLocksOrder) {
+	PendingLocks pending;
+	FileLocks::LockQueue queue;
+
+	// Enqueued locks go before locks with the same range, loaded ones after them
+	pending.insert(LockRange(LockRange::Type::kExclusive, 0, 10, owners[0]));
+	pending.insert(LockRange(LockRange::Type::kExclusive, 0, 10, owners[1]));
+	pending.pushBack(LockRange(LockRange::Type::kExclusive, 0, 10, owners[2]));
+	pending.insert(LockRange(LockRange::Type::kExclusive, 0, 5, owners[3]));
+
+	pending.extract(0, 1, queue);
+	ASSERT_EQ(4U, queue.size());
+	EXPECT_EQ(owners[3], queue[0].owner());
+	EXPECT_EQ(owners[1], queue[1].owner());
+	EXPECT_EQ(owners[0], queue[2].owner());
+	EXPECT_EQ(owners[2], queue[3].owner());
+}
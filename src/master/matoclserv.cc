@@ -74,9 +74,11 @@
 #include "master/filesystem_operations.h"
 #include "master/filesystem_periodic.h"
 #include "master/filesystem_snapshot.h"
+#include "master/hstorage_init.h"
 #include "master/masterconn.h"
 #include "master/matocsserv.h"
 #include "master/matomlserv.h"
+#include "master/metadata_reader_pool.h"
 #include "master/personality.h"
 #include "master/settrashtime_task.h"
 #include "protocol/cltoma.h"
@@ -246,6 +248,11 @@ static char *ListenPort;
 static uint32_t RejectOld;
 static uint32_t SessionSustainTime;
 
+// executes read-only requests of clients concurrently, see matoclserv_is_read_only()
+static MetadataReaderPool gMetadataReaderPool;
+static constexpr size_t kMaxReadOnlyBatchSize = 1024;
+static constexpr uint32_t kMaxMetadataReaderThreads = 64;
+
 static uint32_t gIoLimitsAccumulate_ms;
 static double gIoLimitsRefreshTime;
 static uint32_t gIoLimitsConfigId;
@@ -2078,11 +2085,7 @@ void matoclserv_fuse_lookup(matoclserventry *eptr,const uint8_t *data,uint32_t l
 	uint32_t inode,uid,gid;
 	uint8_t nleng;
 	const uint8_t *name;
-	uint32_t newinode;
-	Attributes attr;
 	uint32_t msgid;
-	uint8_t *ptr;
-	uint8_t status;
 	if (length<17) {
 		safs_pretty_syslog(LOG_NOTICE,"CLTOMA_FUSE_LOOKUP - wrong size (%" PRIu32 ")",length);
 		eptr->mode = KILL;
@@ -2100,28 +2103,40 @@ void matoclserv_fuse_lookup(matoclserventry *eptr,const uint8_t *data,uint32_t l
 	data += nleng;
 	uid = get32bit(&data);
 	gid = get32bit(&data);
-	status = matoclserv_check_group_cache(eptr, gid);
-	if (status == SAUNAFS_STATUS_OK) {
+
+	struct LookupResult {
+		uint8_t status;
+		uint32_t inode = 0;
+		Attributes attr;
+	};
+	auto result = std::make_shared<LookupResult>();
+	result->status = matoclserv_check_group_cache(eptr, gid);
+	MetadataReaderPool::Function execute = []() {};
+	if (result->status == SAUNAFS_STATUS_OK) {
 		FsContext context = matoclserv_get_context(eptr, uid, gid);
-		status = fs_lookup(context,inode,HString((char*)name, nleng),&newinode,attr);
-	}
-	ptr = matoclserv_createpacket(eptr,MATOCL_FUSE_LOOKUP,(status!=SAUNAFS_STATUS_OK)?5:43);
-	put32bit(&ptr,msgid);
-	if (status!=SAUNAFS_STATUS_OK) {
-		put8bit(&ptr,status);
-	} else {
-		put32bit(&ptr,newinode);
-		memcpy(ptr, attr.data(), attr.size());
-	}
-	eptr->sesdata->currentopstats[3]++;
+		// reader threads must not materialize lazy snapshots
+		fs_lazy_snapshot_prepare(context, inode);
+		execute = [result, context, inode, name = HString((char*)name, nleng)]() {
+			result->status = fs_lookup(context, inode, name, &result->inode, result->attr);
+		};
+	}
+	gMetadataReaderPool.add(std::move(execute), [eptr, msgid, result]() {
+		uint8_t *ptr = matoclserv_createpacket(eptr, MATOCL_FUSE_LOOKUP,
+				(result->status != SAUNAFS_STATUS_OK) ? 5 : 43);
+		put32bit(&ptr, msgid);
+		if (result->status != SAUNAFS_STATUS_OK) {
+			put8bit(&ptr, result->status);
+		} else {
+			put32bit(&ptr, result->inode);
+			memcpy(ptr, result->attr.data(), result->attr.size());
+		}
+		eptr->sesdata->currentopstats[3]++;
+	});
 }
 
 void matoclserv_fuse_getattr(matoclserventry *eptr,const uint8_t *data,uint32_t length) {
 	uint32_t inode,uid,gid;
-	Attributes attr;
 	uint32_t msgid;
-	uint8_t *ptr;
-	uint8_t status;
 	if (length!=16) {
 		safs_pretty_syslog(LOG_NOTICE,"CLTOMA_FUSE_GETATTR - wrong size (%" PRIu32 "/16)",length);
 		eptr->mode = KILL;
@@ -2131,21 +2146,33 @@ void matoclserv_fuse_getattr(matoclserventry *eptr,const uint8_t *data,uint32_t
 	inode = get32bit(&data);
 	uid = get32bit(&data);
 	gid = get32bit(&data);
-	status = matoclserv_check_group_cache(eptr, gid);
-	if (status == SAUNAFS_STATUS_OK) {
+
+	struct GetattrResult {
+		uint8_t status;
+		Attributes attr;
+	};
+	auto result = std::make_shared<GetattrResult>();
+	result->status = matoclserv_check_group_cache(eptr, gid);
+	MetadataReaderPool::Function execute = []() {};
+	if (result->status == SAUNAFS_STATUS_OK) {
 		FsContext context = matoclserv_get_context(eptr, uid, gid);
-		status = fs_getattr(context,inode,attr);
-	}
-	ptr = matoclserv_createpacket(eptr,MATOCL_FUSE_GETATTR,(status!=SAUNAFS_STATUS_OK)?5:39);
-	put32bit(&ptr,msgid);
-	if (status!=SAUNAFS_STATUS_OK) {
-		put8bit(&ptr,status);
-	} else {
-		memcpy(ptr, attr.data(), attr.size());
-	}
-	if (eptr->sesdata) {
-		eptr->sesdata->currentopstats[1]++;
-	}
+		execute = [result, context, inode]() {
+			result->status = fs_getattr(context, inode, result->attr);
+		};
+	}
+	gMetadataReaderPool.add(std::move(execute), [eptr, msgid, result]() {
+		uint8_t *ptr = matoclserv_createpacket(eptr, MATOCL_FUSE_GETATTR,
+				(result->status != SAUNAFS_STATUS_OK) ? 5 : 39);
+		put32bit(&ptr, msgid);
+		if (result->status != SAUNAFS_STATUS_OK) {
+			put8bit(&ptr, result->status);
+		} else {
+			memcpy(ptr, result->attr.data(), result->attr.size());
+		}
+		if (eptr->sesdata) {
+			eptr->sesdata->currentopstats[1]++;
+		}
+	});
 }
 
 void matoclserv_fuse_setattr(matoclserventry *eptr,const uint8_t *data,uint32_t length) {
@@ -2455,6 +2482,82 @@ void matoclserv_fuse_mknod(matoclserventry *eptr, PacketHeader header, const uin
 	}
 }
 
+static FuseBatchResult matoclserv_fuse_batch_operation(matoclserventry *eptr,
+		const FsContext &context, const FuseBatchOperation &operation,
+		const std::vector<FuseBatchResult> &results) {
+	FuseBatchResult result;
+	result.inode = operation.inode;
+	if (operation.inodeSource > 0) {
+		if (operation.inodeSource > results.size()) {
+			result.status = SAUNAFS_ERROR_EINVAL;
+			return result;
+		}
+		result.inode = results[operation.inodeSource - 1].inode;
+	}
+	uint32_t inode = result.inode;
+
+	switch (operation.type) {
+	case FuseBatchOperation::kMknod:
+		result.status = fs_mknod(context, inode, HString(operation.name), operation.nodeType,
+				operation.mode, operation.umask, operation.rdev, &result.inode,
+				result.attributes);
+		eptr->sesdata->currentopstats[8]++;
+		break;
+	case FuseBatchOperation::kOpen:
+		result.status = matoclserv_insert_openfile(eptr->sesdata, inode);
+		if (result.status == SAUNAFS_STATUS_OK) {
+			result.status = fs_opencheck(context, inode, operation.flags, result.attributes);
+		}
+		if (result.status == SAUNAFS_STATUS_OK
+				&& dcm_open(inode, eptr->sesdata->sessionid) == 0) {
+			result.attributes[1] &= (0xFF ^ (MATTR_ALLOWDATACACHE << 4));
+		}
+		eptr->sesdata->currentopstats[13]++;
+		break;
+	default:
+		result.status = SAUNAFS_ERROR_EINVAL;
+	}
+	return result;
+}
+
+/*
+ * Executes a sequence of dependent metadata operations in one go. Operations
+ * are executed in order until the first one fails; the reply contains results
+ * of all executed operations. Changes are flushed to the changelog once.
+ *
+ * Operations which succeeded before a failing one are not rolled back. Each of
+ * them has already been applied and written to the changelog, and undoing them
+ * would need compensating operations (e.g. an unlink which moves the new file
+ * to trash) rather than a real rollback. The client sees the same state as
+ * after separate requests, e.g. a file created by mknod whose open failed.
+ */
+void matoclserv_fuse_batch(matoclserventry *eptr, const uint8_t *data, uint32_t length) {
+	uint32_t messageId, uid, gid;
+	std::vector<FuseBatchOperation> operations;
+	cltoma::fuseBatch::deserialize(data, length, messageId, uid, gid, operations);
+
+	std::vector<FuseBatchResult> results;
+	uint8_t status = matoclserv_check_group_cache(eptr, gid);
+	if (status == SAUNAFS_STATUS_OK && (operations.empty()
+			|| operations.size() > FuseBatchOperation::kMaxOperations)) {
+		status = SAUNAFS_ERROR_EINVAL;
+	}
+	if (status != SAUNAFS_STATUS_OK) {
+		results.push_back(FuseBatchResult(status, 0, Attributes()));
+	} else {
+		FsContext context = matoclserv_get_context(eptr, uid, gid);
+		changelog_disable_flush();
+		for (const FuseBatchOperation &operation : operations) {
+			results.push_back(matoclserv_fuse_batch_operation(eptr, context, operation, results));
+			if (results.back().status != SAUNAFS_STATUS_OK) {
+				break;
+			}
+		}
+		changelog_enable_flush();
+	}
+	matoclserv_createpacket(eptr, matocl::fuseBatch::build(messageId, results));
+}
+
 void matoclserv_fuse_mkdir(matoclserventry *eptr, PacketHeader header, const uint8_t *data) {
 	uint32_t messageId, inode, uid, gid;
 	LegacyString<uint8_t> name;
@@ -3491,19 +3594,32 @@ void matoclserv_fuse_getxattr(matoclserventry *eptr,const uint8_t *data,uint32_t
 			}
 		}
 	} else {
-		uint8_t *attrvalue;
-		uint32_t avleng;
-		status = fs_getxattr(context,inode,opened,anleng,attrname,&avleng,&attrvalue);
-		ptr = matoclserv_createpacket(eptr,MATOCL_FUSE_GETXATTR,(status!=SAUNAFS_STATUS_OK)?5:8+((mode==XATTR_GMODE_GET_DATA)?avleng:0));
-		put32bit(&ptr,msgid);
-		if (status!=SAUNAFS_STATUS_OK) {
-			put8bit(&ptr,status);
-		} else {
-			put32bit(&ptr,avleng);
-			if (mode==XATTR_GMODE_GET_DATA && avleng>0) {
-				memcpy(ptr,attrvalue,avleng);
+		struct GetxattrResult {
+			uint8_t status;
+			const uint8_t *attrvalue = nullptr;
+			uint32_t avleng = 0;
+		};
+		// the value is copied by the reply, before anything can modify metadata
+		auto result = std::make_shared<GetxattrResult>();
+		std::string name((const char*)attrname, anleng);
+		auto execute = [result, context, inode, opened, name]() {
+			result->status = fs_getxattr(context, inode, opened, name.size(),
+					(const uint8_t*)name.data(), &result->avleng, &result->attrvalue);
+		};
+		gMetadataReaderPool.add(std::move(execute), [eptr, msgid, mode, result]() {
+			uint8_t *ptr = matoclserv_createpacket(eptr, MATOCL_FUSE_GETXATTR,
+					(result->status != SAUNAFS_STATUS_OK)
+					? 5 : 8 + ((mode == XATTR_GMODE_GET_DATA) ? result->avleng : 0));
+			put32bit(&ptr, msgid);
+			if (result->status != SAUNAFS_STATUS_OK) {
+				put8bit(&ptr, result->status);
+			} else {
+				put32bit(&ptr, result->avleng);
+				if (mode == XATTR_GMODE_GET_DATA && result->avleng > 0) {
+					memcpy(ptr, result->attrvalue, result->avleng);
+				}
 			}
-		}
+		});
 	}
 }
 
@@ -4223,9 +4339,16 @@ void matoclserv_manage_locks_unlock(matoclserventry *eptr, const uint8_t *data,
 	matoclserv_createpacket(eptr, std::move(reply));
 }
 
-void matoclserv_list_tasks(matoclserventry *eptr) {
-	std::vector<JobInfo> jobs_info = fs_get_current_tasks_info();
-	matoclserv_createpacket(eptr, matocl::listTasks::build(jobs_info));
+void matoclserv_list_tasks(matoclserventry *eptr, const uint8_t *data, uint32_t length) {
+	PacketVersion version;
+	deserializePacketVersionNoHeader(data, length, version);
+	if (version == cltoma::listTasks::kWithProgress) {
+		std::vector<JobProgressInfo> jobs_info = fs_get_current_tasks_progress(eventloop_time());
+		matoclserv_createpacket(eptr, matocl::listTasks::build(jobs_info));
+	} else {
+		std::vector<JobInfo> jobs_info = fs_get_current_tasks_info();
+		matoclserv_createpacket(eptr, matocl::listTasks::build(jobs_info));
+	}
 }
 
 void matoclserv_stop_task(matoclserventry *eptr, const uint8_t *data, uint32_t length) {
@@ -4750,7 +4873,17 @@ void matocl_beforedisconnect(matoclserventry *eptr) {
 	}
 }
 
+/// Requests which are executed by gMetadataReaderPool, in batches.
+static bool matoclserv_is_read_only(uint32_t type) {
+	return type == CLTOMA_FUSE_LOOKUP || type == CLTOMA_FUSE_GETATTR
+			|| type == CLTOMA_FUSE_GETXATTR;
+}
+
 void matoclserv_gotpacket(matoclserventry *eptr,uint32_t type,const uint8_t *data,uint32_t length) {
+	if (!matoclserv_is_read_only(type)) {
+		// the batch has to see metadata as it was before this request
+		gMetadataReaderPool.run();
+	}
 	if (type==ANTOAN_NOP) {
 		return;
 	}
@@ -4895,7 +5028,7 @@ void matoclserv_gotpacket(matoclserventry *eptr,uint32_t type,const uint8_t *dat
 					matoclserv_manage_locks_unlock(eptr,data,length);
 					break;
 				case SAU_CLTOMA_LIST_TASKS:
-					matoclserv_list_tasks(eptr);
+					matoclserv_list_tasks(eptr, data, length);
 					break;
 				case SAU_CLTOMA_STOP_TASK:
 					matoclserv_stop_task(eptr, data, length);
@@ -4945,6 +5078,9 @@ void matoclserv_gotpacket(matoclserventry *eptr,uint32_t type,const uint8_t *dat
 				case SAU_CLTOMA_FUSE_MKNOD:
 					matoclserv_fuse_mknod(eptr, PacketHeader(type, length), data);
 					break;
+				case SAU_CLTOMA_FUSE_BATCH:
+					matoclserv_fuse_batch(eptr, data, length);
+					break;
 				case CLTOMA_FUSE_MKDIR:
 				case SAU_CLTOMA_FUSE_MKDIR:
 					matoclserv_fuse_mkdir(eptr, PacketHeader(type, length), data);
@@ -5222,6 +5358,8 @@ void matoclserv_term(void) {
 	packetstruct *pptr,*pptrn;
 	chunklist *cl,*cln;
 
+	gMetadataReaderPool.setThreadCount(0);
+
 	safs_pretty_syslog(LOG_NOTICE,"main master server module: closing %s:%s",ListenHost,ListenPort);
 	tcpclose(lsock);
 
@@ -5313,6 +5451,7 @@ void matoclserv_read(matoclserventry *eptr) {
 			eptr->mode=HEADER;
 			eptr->inputpacket.bytesleft = 8;
 			eptr->inputpacket.startptr = eptr->hdrbuff;
+			size_t batchSize = gMetadataReaderPool.size();
 			matoclserv_gotpacket(eptr,type,eptr->inputpacket.packet,size);
 			stats_prcvd++;
 
@@ -5320,7 +5459,11 @@ void matoclserv_read(matoclserventry *eptr) {
 				free(eptr->inputpacket.packet);
 			}
 			eptr->inputpacket.packet=NULL;
-			break;
+			// keep reading requests which only joined the batch of read-only requests
+			if (gMetadataReaderPool.size() <= batchSize
+					|| gMetadataReaderPool.size() >= kMaxReadOnlyBatchSize) {
+				break;
+			}
 		}
 
 		if (watchdog.expired()) {
@@ -5480,6 +5623,7 @@ void matoclserv_serve(const std::vector<pollfd> &pdesc) {
 			}
 		}
 	}
+	gMetadataReaderPool.run();
 
 // write
 	for (eptr=matoclservhead ; eptr ; eptr=eptr->next) {
@@ -5613,6 +5757,16 @@ void  matoclserv_become_master() {
 	return;
 }
 
+static void matoclserv_metadata_readers_reload() {
+	uint32_t threads = cfg_get_maxvalue("METADATA_READER_THREADS", 0U, kMaxMetadataReaderThreads);
+	if (threads > 0 && !hstorage_supports_concurrent_reads()) {
+		safs_pretty_syslog(LOG_WARNING, "METADATA_READER_THREADS is not supported with "
+				"USE_BDB_FOR_NAME_STORAGE - serving all requests in the main thread");
+		threads = 0;
+	}
+	gMetadataReaderPool.setThreadCount(threads);
+}
+
 void matoclserv_reload(void) {
 	// Notify admins that reload was performed - put responses in their packet queues
 	for (matoclserventry* eptr = matoclservhead; eptr != nullptr; eptr = eptr->next) {
@@ -5634,6 +5788,7 @@ void matoclserv_reload(void) {
 	}
 
 	matoclserv_iolimits_reload();
+	matoclserv_metadata_readers_reload();
 
 	char *oldListenHost = ListenHost;
 	char *oldListenPort = ListenPort;
@@ -5693,6 +5848,7 @@ int matoclserv_networkinit(void) {
 		ListenPort = cfg_getstr("MATOCU_LISTEN_PORT","9421");
 	}
 	RejectOld = cfg_getuint32("REJECT_OLD_CLIENTS",0);
+	matoclserv_metadata_readers_reload();
 
 	if (matoclserv_iolimits_reload() != 0) {
 		return -1;
@@ -97,6 +97,8 @@ struct matocsserventry {
 	uint16_t wrepcounter;
 	uint16_t delcounter;
 	uint8_t load_factor;
+	uint32_t disk_queue_depth;      // deepest I/O queue among server's disks
+	uint32_t disk_latency_us;       // slowest mean I/O service time among server's disks
 
 	csdbentry *csdb; /*!< Pointer to database entry for chunkserver. */
 
@@ -387,7 +389,8 @@ std::vector<std::pair<matocsserventry *, ChunkPartType>> matocsserv_getservers_f
 			//
 			// weight = percent free spaces
 			const int64_t weight = 1024 * 1024 * (1. - matocsserv_get_usage(eptr));
-			getter.addServer(eptr, eptr->label, weight, eptr->version, eptr->load_factor);
+			getter.addServer(eptr, eptr->label, weight, eptr->version, eptr->load_factor,
+			                 eptr->disk_queue_depth, eptr->disk_latency_us);
 		}
 	}
 
@@ -1042,6 +1045,12 @@ void matocsserv_register_host(matocsserventry *eptr, uint32_t version, uint32_t
 	eptr->csdb = csdb_find(eptr->servip, eptr->servport);
 	safs_pretty_syslog(LOG_NOTICE, "chunkserver register begin (packet version: 5) - ip: %s, port: %"
 			PRIu16, eptr->servstrip, eptr->servport);
+	if (eptr->version >= kDiskLoadStatusVersion) {
+		// older chunkservers disconnect on unknown packets
+		eptr->outputPackets.push_back(OutputPacket());
+		matocs::statusVersion::serialize(eptr->outputPackets.back().packet,
+				cstoma::status::kDiskMetrics);
+	}
 	return;
 }
 
@@ -1156,8 +1165,15 @@ void matocsserv_sau_register_config(matocsserventry *eptr,
 }
 
 void matocsserv_sau_status(matocsserventry *eptr, const std::vector<uint8_t> &data) {
+	PacketVersion v;
+	deserializePacketVersionNoHeader(data, v);
 	uint8_t load_factor;
-	cstoma::status::deserialize(data, load_factor);
+	if (v == cstoma::status::kDiskMetrics) {
+		cstoma::status::deserialize(data, load_factor, eptr->disk_queue_depth,
+		                            eptr->disk_latency_us);
+	} else {
+		cstoma::status::deserialize(data, load_factor);
+	}
 	eptr->load_factor = load_factor;
 }
 
@@ -1536,6 +1552,8 @@ void matocsserv_serve(const std::vector<pollfd> &pdesc) {
 			eptr->delcounter = 0;
 			eptr->csdb = nullptr;
 			eptr->load_factor = 0;
+			eptr->disk_queue_depth = 0;
+			eptr->disk_latency_us = 0;
 			chunk_server_unlabelled_connected();
 		} else {
 			tcpclose(ns);
@@ -0,0 +1,108 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "master/metadata_reader_pool.h"
+
+MetadataReaderPool::~MetadataReaderPool() {
+	stopThreads();
+}
+
+void MetadataReaderPool::setThreadCount(unsigned count) {
+	if (count == threads_.size()) {
+		return;
+	}
+	run();
+	stopThreads();
+	terminate_ = false;
+	for (unsigned i = 0; i < count; ++i) {
+		threads_.emplace_back(&MetadataReaderPool::workerLoop, this, generation_);
+	}
+}
+
+void MetadataReaderPool::stopThreads() {
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		terminate_ = true;
+	}
+	batchStarted_.notify_all();
+	for (std::thread &thread : threads_) {
+		thread.join();
+	}
+	threads_.clear();
+}
+
+void MetadataReaderPool::add(Function execute, Function reply) {
+	if (threads_.empty()) {
+		execute();
+		reply();
+		return;
+	}
+	batch_.push_back({std::move(execute), std::move(reply)});
+}
+
+void MetadataReaderPool::executeRequests() {
+	for (size_t i = nextRequest_++; i < batch_.size(); i = nextRequest_++) {
+		batch_[i].execute();
+	}
+}
+
+void MetadataReaderPool::run() {
+	if (batch_.empty()) {
+		return;
+	}
+	nextRequest_ = 0;
+	if (batch_.size() == 1) {
+		executeRequests();
+	} else {
+		std::unique_lock<std::mutex> lock(mutex_);
+		busyWorkers_ = threads_.size();
+		++generation_;
+		lock.unlock();
+		batchStarted_.notify_all();
+
+		executeRequests();
+
+		lock.lock();
+		batchFinished_.wait(lock, [this]() { return busyWorkers_ == 0; });
+		++parallelBatches_;
+	}
+	for (Request &request : batch_) {
+		request.reply();
+	}
+	batch_.clear();
+}
+
+void MetadataReaderPool::workerLoop(uint64_t lastGeneration) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (true) {
+		batchStarted_.wait(lock, [&]() { return terminate_ || generation_ != lastGeneration; });
+		if (terminate_) {
+			return;
+		}
+		lastGeneration = generation_;
+		lock.unlock();
+
+		executeRequests();
+
+		lock.lock();
+		if (--busyWorkers_ == 0) {
+			batchFinished_.notify_one();
+		}
+	}
+}
@@ -0,0 +1,102 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Pool of threads executing read-only metadata requests of clients.
+ *
+ * The main thread adds requests to a batch and executes the whole batch with
+ * run(), which returns when all requests of the batch are done. The main thread
+ * takes part in the execution and nothing else runs on it in the meantime, so
+ * metadata is never modified while a batch is running and requests can read it
+ * concurrently without any locking. Executing a batch before every request
+ * which is not read-only keeps the result identical to serving all requests
+ * one by one.
+ *
+ * Each request consists of an execute function, called by any thread of the
+ * pool, and a reply function, called afterwards by the main thread in the
+ * order in which requests were added. Without worker threads requests are
+ * executed and replied to immediately by add().
+ */
+class MetadataReaderPool {
+public:
+	typedef std::function<void()> Function;
+
+	MetadataReaderPool() = default;
+	~MetadataReaderPool();
+
+	MetadataReaderPool(const MetadataReaderPool &) = delete;
+	MetadataReaderPool &operator=(const MetadataReaderPool &) = delete;
+
+	/// Changes the number of worker threads (0 disables batching).
+	void setThreadCount(unsigned count);
+
+	unsigned threadCount() const {
+		return threads_.size();
+	}
+
+	void add(Function execute, Function reply);
+
+	/// Executes all requests added since the last call and sends their replies.
+	void run();
+
+	size_t size() const {
+		return batch_.size();
+	}
+
+	/// Number of batches executed by more than one thread.
+	uint64_t parallelBatches() const {
+		return parallelBatches_;
+	}
+
+private:
+	struct Request {
+		Function execute;
+		Function reply;
+	};
+
+	/// Workers only take part in batches started after the given generation.
+	void workerLoop(uint64_t lastGeneration);
+	void executeRequests();
+	void stopThreads();
+
+	std::vector<Request> batch_;
+	std::vector<std::thread> threads_;
+
+	std::mutex mutex_;
+	std::condition_variable batchStarted_;
+	std::condition_variable batchFinished_;
+	uint64_t generation_ = 0;
+	unsigned busyWorkers_ = 0;
+	bool terminate_ = false;
+	std::atomic<size_t> nextRequest_{0};
+
+	uint64_t parallelBatches_ = 0;
+};
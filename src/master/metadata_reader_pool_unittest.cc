@@ -0,0 +1,73 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "master/metadata_reader_pool.h"
+
+#include <atomic>
+#include <gtest/gtest.h>
+
+TEST(MetadataReaderPoolTests, WithoutThreadsRequestsAreServedImmediately) {
+	MetadataReaderPool pool;
+	std::vector<int> events;
+	pool.add([&]() { events.push_back(1); }, [&]() { events.push_back(2); });
+	EXPECT_EQ(0U, pool.size());
+	EXPECT_EQ(std::vector<int>({1, 2}), events);
+}
+
+TEST(MetadataReaderPoolTests, RepliesAreSentInOrder) {
+	MetadataReaderPool pool;
+	pool.setThreadCount(4);
+	for (int batch = 0; batch < 100; ++batch) {
+		std::vector<int> results(50, 0);
+		std::vector<int> replies;
+		for (int i = 0; i < 50; ++i) {
+			pool.add([&results, i]() { results[i] = i * i; },
+			         [&results, &replies, i]() { replies.push_back(results[i]); });
+		}
+		EXPECT_EQ(50U, pool.size());
+		EXPECT_TRUE(replies.empty());
+		pool.run();
+		EXPECT_EQ(0U, pool.size());
+		ASSERT_EQ(50U, replies.size());
+		for (int i = 0; i < 50; ++i) {
+			EXPECT_EQ(i * i, replies[i]);
+		}
+	}
+	EXPECT_EQ(100U, pool.parallelBatches());
+}
+
+TEST(MetadataReaderPoolTests, ChangingThreadCountRunsPendingRequests) {
+	MetadataReaderPool pool;
+	std::atomic<int> executed{0};
+	int replied = 0;
+	pool.setThreadCount(2);
+	for (int i = 0; i < 10; ++i) {
+		pool.add([&]() { ++executed; }, [&]() { ++replied; });
+	}
+	pool.setThreadCount(8);
+	EXPECT_EQ(10, executed);
+	EXPECT_EQ(10, replied);
+
+	pool.add([&]() { ++executed; }, [&]() { ++replied; });
+	pool.add([&]() { ++executed; }, [&]() { ++replied; });
+	pool.setThreadCount(0);
+	EXPECT_EQ(12, executed);
+	EXPECT_EQ(12, replied);
+	EXPECT_EQ(0U, pool.threadCount());
+}
@@ -23,30 +23,86 @@
 
 void QuotaDatabase::remove(QuotaOwnerType owner_type, uint32_t owner_id, QuotaRigor rigor,
 		QuotaResource resource) {
+	applyPendingUsage(owner_type, owner_id);
 	auto &map = quota_data_[(int)owner_type];
 	auto it = map.find(owner_id);
 	if (it == map.end()) {
 		return;
 	}
 
+	bool had_hard_limit = hasHardLimit(it->second);
 	it->second[(int)rigor][(int)resource] = 0;
+	updateHardLimitCount(owner_type, had_hard_limit, hasHardLimit(it->second));
 	if (it->second == Limits()) {
 		map.erase(it);
 	}
 }
 
 void QuotaDatabase::remove(QuotaOwnerType owner_type, uint32_t owner_id) {
+	// usage changed before removal is removed too
+	applyPendingUsage(owner_type, owner_id);
 	auto &map = quota_data_[(int)owner_type];
 	auto it = map.find(owner_id);
 	if (it == map.end()) {
 		return;
 	}
 
+	updateHardLimitCount(owner_type, hasHardLimit(it->second), false);
 	map.erase(it);
 }
 
+void QuotaDatabase::addPendingUsage(QuotaOwnerType owner_type, uint32_t owner_id,
+		QuotaResource resource, int64_t delta) {
+	// Consecutive operations usually come from the same few owners, so recent entries
+	// are checked first.
+	for (auto it = pending_usage_.rbegin(); it != pending_usage_.rend(); ++it) {
+		if (it->owner_id == owner_id && it->owner_type == owner_type) {
+			it->delta[(int)resource] += delta;
+			return;
+		}
+	}
+	if (pending_usage_.size() >= kMaxPendingUsage) {
+		flushUsage();
+	}
+	PendingUsage usage{owner_type, owner_id, {{0, 0}}};
+	usage.delta[(int)resource] = delta;
+	pending_usage_.push_back(usage);
+}
+
+void QuotaDatabase::applyUsage(const PendingUsage &usage) {
+	if (usage.delta[0] == 0 && usage.delta[1] == 0) {
+		return;
+	}
+	Limits &entry = quota_data_[(int)usage.owner_type][usage.owner_id];
+	for (auto resource : {QuotaResource::kInodes, QuotaResource::kSize}) {
+		entry[(int)QuotaRigor::kUsed][(int)resource] += usage.delta[(int)resource];
+	}
+}
+
+void QuotaDatabase::applyPendingUsage(QuotaOwnerType owner_type, uint32_t owner_id) {
+	for (auto it = pending_usage_.begin(); it != pending_usage_.end(); ++it) {
+		if (it->owner_id == owner_id && it->owner_type == owner_type) {
+			applyUsage(*it);
+			*it = pending_usage_.back();
+			pending_usage_.pop_back();
+			return;
+		}
+	}
+}
+
+void QuotaDatabase::flushUsage() {
+	for (const auto &usage : pending_usage_) {
+		applyUsage(usage);
+	}
+	pending_usage_.clear();
+}
+
 bool QuotaDatabase::exceeds(QuotaOwnerType owner_type, uint32_t owner_id, QuotaRigor rigor,
-		const std::initializer_list<std::pair<QuotaResource, int64_t>> &resource_list) const {
+		const std::initializer_list<std::pair<QuotaResource, int64_t>> &resource_list) {
+	if (rigor == QuotaRigor::kHard && !hasHardLimits(owner_type)) {
+		return false;
+	}
+
 	const Limits *entry = get(owner_type, owner_id);
 	if (!entry) {
 		return false;
@@ -78,9 +134,11 @@ std::vector<QuotaEntry> QuotaDatabase::getEntries() const {
 	return result;
 }
 
-std::vector<QuotaEntry> QuotaDatabase::getEntriesWithStats() const {
+std::vector<QuotaEntry> QuotaDatabase::getEntriesWithStats() {
 	std::vector<QuotaEntry> result;
 
+	flushUsage();
+
 	for (auto owner_type :
 	     {QuotaOwnerType::kUser, QuotaOwnerType::kGroup, QuotaOwnerType::kInode}) {
 		for (const auto &data_entry : quota_data_[(int)owner_type]) {
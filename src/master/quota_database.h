@@ -25,6 +25,7 @@
 #include <cstdint>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include "common/hashfn.h"
 #include "protocol/quota.h"
@@ -43,7 +44,8 @@ public:
 	 * \param owner_id Entry id.
 	 * \return Pointer to full set of limits.
 	 */
-	const Limits *get(QuotaOwnerType owner_type, uint32_t owner_id) const {
+	const Limits *get(QuotaOwnerType owner_type, uint32_t owner_id) {
+		applyPendingUsage(owner_type, owner_id);
 		const auto &map = quota_data_[(int)owner_type];
 		auto it = map.find(owner_id);
 		if (it == map.end()) {
@@ -62,10 +64,18 @@ public:
 	 */
 	void set(QuotaOwnerType owner_type, uint32_t owner_id, QuotaRigor rigor, QuotaResource resource,
 	         uint64_t value) {
-		quota_data_[(int)owner_type][(int)owner_id][(int)rigor][(int)resource] = value;
+		Limits &entry = quota_data_[(int)owner_type][owner_id];
+		bool had_hard_limit = hasHardLimit(entry);
+		entry[(int)rigor][(int)resource] = value;
+		updateHardLimitCount(owner_type, had_hard_limit, hasHardLimit(entry));
 	}
 
 	/*! \brief Update quota for specific resource.
+	 *
+	 * Changes of usage are coalesced in a short list of pending changes and applied
+	 * to the database when the list is full, when usage of the owner is read
+	 * or when flushUsage is called.
+	 *
 	 * \param owner_type Quota entry type (user, group, inode (directory)).
 	 * \param owner_id Entry id.
 	 * \param rigor Resource rigor (soft, hard, used).
@@ -74,7 +84,25 @@ public:
 	 */
 	void update(QuotaOwnerType owner_type, uint32_t owner_id, QuotaRigor rigor,
 	            QuotaResource resource, int64_t delta) {
-		quota_data_[(int)owner_type][(int)owner_id][(int)rigor][(int)resource] += delta;
+		if (rigor == QuotaRigor::kUsed) {
+			addPendingUsage(owner_type, owner_id, resource, delta);
+			return;
+		}
+		Limits &entry = quota_data_[(int)owner_type][owner_id];
+		bool had_hard_limit = hasHardLimit(entry);
+		entry[(int)rigor][(int)resource] += delta;
+		updateHardLimitCount(owner_type, had_hard_limit, hasHardLimit(entry));
+	}
+
+	/*! \brief Apply all pending changes of usage. */
+	void flushUsage();
+
+	/*! \brief Checks if any owner of the given type has a hard limit.
+	 *
+	 * If it doesn't, no change of resources can exceed hard quota of owners of this type.
+	 */
+	bool hasHardLimits(QuotaOwnerType owner_type) const {
+		return hard_limit_count_[(int)owner_type] > 0;
 	}
 
 	/*! \brief Remove quota for specific resource.
@@ -97,6 +125,7 @@ public:
 	 * \param owner_id Entry id.
 	 */
 	void removeEmpty(QuotaOwnerType owner_type, uint32_t owner_id) {
+		applyPendingUsage(owner_type, owner_id);
 		auto &map = quota_data_[(int)owner_type];
 		auto it = map.find(owner_id);
 		if (it != map.end()) {
@@ -114,10 +143,10 @@ public:
 	 */
 	bool exceeds(
 	    QuotaOwnerType owner_type, uint32_t owner_id, QuotaRigor rigor,
-	    const std::initializer_list<std::pair<QuotaResource, int64_t>> &resource_list) const;
+	    const std::initializer_list<std::pair<QuotaResource, int64_t>> &resource_list);
 
 	/*! \brief Returns all quota entries (with used). */
-	std::vector<QuotaEntry> getEntriesWithStats() const;
+	std::vector<QuotaEntry> getEntriesWithStats();
 
 	/*! \brief Returns all quota entries (without used). */
 	std::vector<QuotaEntry> getEntries() const;
@@ -126,6 +155,34 @@ public:
 	uint64_t checksum() const;
 
 protected:
+	/// Change of usage of an owner, not applied to the database yet.
+	struct PendingUsage {
+		QuotaOwnerType owner_type;
+		uint32_t owner_id;
+		std::array<int64_t, 2> delta;
+	};
+
+	/// Maximal number of owners with pending changes of usage.
+	static constexpr size_t kMaxPendingUsage = 64;
+
+	static bool hasHardLimit(const Limits &entry) {
+		return entry[(int)QuotaRigor::kHard][(int)QuotaResource::kInodes] != 0 ||
+		       entry[(int)QuotaRigor::kHard][(int)QuotaResource::kSize] != 0;
+	}
+
+	void updateHardLimitCount(QuotaOwnerType owner_type, bool had_hard_limit,
+	                          bool has_hard_limit) {
+		hard_limit_count_[(int)owner_type] += (int)has_hard_limit - (int)had_hard_limit;
+	}
+
+	void addPendingUsage(QuotaOwnerType owner_type, uint32_t owner_id, QuotaResource resource,
+	                     int64_t delta);
+
+	/*! \brief Apply pending changes of usage of a single owner. */
+	void applyPendingUsage(QuotaOwnerType owner_type, uint32_t owner_id);
+
+	void applyUsage(const PendingUsage &usage);
+
 	static uint64_t hash(const QuotaEntry &entry) {
 		uint64_t hash = 0x2a9ae768d80f202f;  // some random number
 		hashCombine(hash, static_cast<uint8_t>(entry.entryKey.owner.ownerType),
@@ -149,4 +206,6 @@ protected:
 	}
 
 	std::array<DataTable, 3> quota_data_;
+	std::array<uint32_t, 3> hard_limit_count_{};  ///< Number of owners with a hard limit.
+	std::vector<PendingUsage> pending_usage_;
 };
@@ -159,3 +159,58 @@ TEST(QuotaDatabaseTests, Checksum) {
 	database.update(QuotaOwnerType::kGroup, 998, QuotaRigor::kUsed, QuotaResource::kInodes, 500);
 	EXPECT_EQ(checksum[7], database.checksum());
 }
+
+TEST(QuotaDatabaseTests, PendingUsage) {
+	QuotaDatabase database;
+	database.set(QuotaOwnerType::kUser, 999, QuotaRigor::kHard, QuotaResource::kInodes, 10);
+
+	// changes of many owners, more than can be pending at once
+	for (uint32_t uid = 0; uid < 1000; ++uid) {
+		database.update(QuotaOwnerType::kUser, uid, QuotaRigor::kUsed, QuotaResource::kInodes, 1);
+		database.update(QuotaOwnerType::kUser, 999, QuotaRigor::kUsed, QuotaResource::kSize, 2);
+	}
+	database.update(QuotaOwnerType::kUser, 999, QuotaRigor::kUsed, QuotaResource::kInodes, 8);
+	EXPECT_FALSE(database.exceeds(QuotaOwnerType::kUser, 999, QuotaRigor::kHard, {{QuotaResource::kInodes, 1}}));
+	EXPECT_TRUE(database.exceeds(QuotaOwnerType::kUser, 999, QuotaRigor::kHard, {{QuotaResource::kInodes, 2}}));
+	EXPECT_ENTRY_EQ(database.get(QuotaOwnerType::kUser, 999), 9U, 2000U, 0U, 10U, 0U, 0U);
+
+	database.update(QuotaOwnerType::kUser, 5, QuotaRigor::kUsed, QuotaResource::kSize, 7);
+	EXPECT_ENTRY_EQ(database.get(QuotaOwnerType::kUser, 5), 1U, 7U, 0U, 0U, 0U, 0U);
+
+	// usage of a removed owner is removed too
+	database.update(QuotaOwnerType::kUser, 6, QuotaRigor::kUsed, QuotaResource::kSize, 7);
+	database.remove(QuotaOwnerType::kUser, 6);
+	database.flushUsage();
+	EXPECT_EQ(nullptr, database.get(QuotaOwnerType::kUser, 6));
+
+	uint64_t inodes = 0;
+	for (const QuotaEntry &entry : database.getEntriesWithStats()) {
+		if (entry.entryKey.rigor == QuotaRigor::kUsed &&
+		    entry.entryKey.resource == QuotaResource::kInodes) {
+			inodes += entry.limit;
+		}
+	}
+	EXPECT_EQ(9U, inodes);
+}
+
+TEST(QuotaDatabaseTests, HasHardLimits) {
+	QuotaDatabase database;
+	EXPECT_FALSE(database.hasHardLimits(QuotaOwnerType::kUser));
+
+	database.set(QuotaOwnerType::kUser, 1, QuotaRigor::kSoft, QuotaResource::kInodes, 100);
+	database.update(QuotaOwnerType::kUser, 1, QuotaRigor::kUsed, QuotaResource::kInodes, 200);
+	EXPECT_FALSE(database.hasHardLimits(QuotaOwnerType::kUser));
+
+	database.set(QuotaOwnerType::kUser, 1, QuotaRigor::kHard, QuotaResource::kInodes, 100);
+	database.set(QuotaOwnerType::kUser, 1, QuotaRigor::kHard, QuotaResource::kSize, 100);
+	database.set(QuotaOwnerType::kUser, 2, QuotaRigor::kHard, QuotaResource::kSize, 100);
+	EXPECT_TRUE(database.hasHardLimits(QuotaOwnerType::kUser));
+	EXPECT_FALSE(database.hasHardLimits(QuotaOwnerType::kGroup));
+	EXPECT_FALSE(database.hasHardLimits(QuotaOwnerType::kInode));
+
+	database.remove(QuotaOwnerType::kUser, 1, QuotaRigor::kHard, QuotaResource::kInodes);
+	database.remove(QuotaOwnerType::kUser, 2);
+	EXPECT_TRUE(database.hasHardLimits(QuotaOwnerType::kUser));
+	database.set(QuotaOwnerType::kUser, 1, QuotaRigor::kHard, QuotaResource::kSize, 0);
+	EXPECT_FALSE(database.hasHardLimits(QuotaOwnerType::kUser));
+}
@@ -21,10 +21,51 @@
 
 #include "master/recursive_remove_task.h"
 
+#include "master/filesystem_snapshot.h"
+
 bool RemoveTask::isFinished() const {
 	return current_subtask_ == subtask_.end();
 }
 
+void RemoveTask::plan(uint32_t max_entries) {
+	FSNode *wd = fsnodes_id_to_node(parent_);
+	if (!wd || wd->type != FSNode::kDirectory) {
+		return;
+	}
+	// entries planned before are kept until the plans are discarded
+	size_t current = current_subtask_ - subtask_.begin();
+	size_t end = std::min(subtask_.size(), current + max_entries);
+	for (size_t i = std::max(current, planned_until_); i < end; ++i) {
+		const FSNode *child = fsnodes_lookup(static_cast<FSNodeDirectory*>(wd), subtask_[i]);
+		if (!child || child->type != FSNode::kDirectory ||
+		    planned_subtasks_.count(child->id)) {
+			continue;
+		}
+		SubtaskContainer &subtasks = planned_subtasks_[child->id];
+		subtasks.reserve(static_cast<const FSNodeDirectory*>(child)->entries.size());
+		for (const auto &entry : static_cast<const FSNodeDirectory*>(child)->entries) {
+			subtasks.push_back(static_cast<HString>(entry.first));
+		}
+	}
+	planned_until_ = std::max(planned_until_, end);
+}
+
+RemoveTask::SubtaskContainer RemoveTask::takeSubtasks(const FSNodeDirectory *child) {
+	SubtaskContainer subtasks;
+	// a plan is used only once, the directory is listed again if it is still not empty
+	auto it = planned_subtasks_.find(child->id);
+	if (it != planned_subtasks_.end()) {
+		subtasks = std::move(it->second);
+		planned_subtasks_.erase(it);
+		return subtasks;
+	}
+	subtasks.reserve(child->entries.size());
+	for (const auto &entry : child->entries) {
+		subtasks.push_back(static_cast<HString>(entry.first));
+	}
+	return subtasks;
+}
+
 int RemoveTask::retrieveNodes(FSNodeDirectory *&wd, FSNode *&child) {
 	FSNode *wd_tmp = fsnodes_id_to_node(parent_);
 	if (!wd_tmp) {
@@ -57,16 +98,12 @@ int RemoveTask::execute(uint32_t ts, intrusive_list<Task> &work_queue) {
 	if (status != SAUNAFS_STATUS_OK) {
 		return status;
 	}
+	fsnodes_lazy_snapshot_materialize(ts, child);
 	if (child->type == FSNode::kDirectory &&
 	    !static_cast<FSNodeDirectory*>(child)->entries.empty()) {
 
-		SubtaskContainer subtasks;
-		subtasks.reserve(
-			  static_cast<const FSNodeDirectory*>(child)->entries.size());
-		for (const auto &entry :
-				static_cast<FSNodeDirectory*>(child)->entries) {
-			subtasks.push_back(static_cast<HString>(entry.first));
-		}
+		SubtaskContainer subtasks =
+			  takeSubtasks(static_cast<const FSNodeDirectory*>(child));
 		auto task = new RemoveTask(std::move(subtasks),
 					    child->id, context_);
 		work_queue.push_front(*task);
@@ -79,6 +116,7 @@ int RemoveTask::execute(uint32_t ts, intrusive_list<Task> &work_queue) {
 		                FsStats::Rmdir : FsStats::Unlink];
 		doUnlink(ts, wd, child);
 		++current_subtask_;
+		++processed_entries_;
 		repeat_counter_ = 0;
 	}
 	return SAUNAFS_STATUS_OK;
@@ -22,6 +22,7 @@
 #include "common/platform.h"
 
 #include <memory>
+#include <unordered_map>
 
 #include "common/special_inode_defs.h"
 #include "master/filesystem_node.h"
@@ -64,6 +65,14 @@ public:
 
 	bool isFinished() const override;
 
+	/*! \brief Lists entries of directories which are going to be removed. */
+	void plan(uint32_t max_entries) override;
+
+	void discardPlan() override {
+		planned_subtasks_.clear();
+		planned_until_ = 0;
+	}
+
 	static std::string generateDescription(const std::string &target) {
 		return "Recursive remove: " + target;
 	}
@@ -74,6 +83,9 @@ private:
 	/*! \brief Execute unlink operation to remove node. */
 	void doUnlink(uint32_t ts, FSNodeDirectory *wd, FSNode *child);
 
+	/*! \brief Returns names of the directory's entries, from the plan if possible. */
+	SubtaskContainer takeSubtasks(const FSNodeDirectory *child);
+
 private:
 	static const uint32_t kMaxRepeatCounter = 3;
 
@@ -83,4 +95,6 @@ private:
 	uint32_t parent_;
 	std::shared_ptr<FsContext> context_;
 	uint32_t repeat_counter_;
+	std::unordered_map<uint32_t, SubtaskContainer> planned_subtasks_;
+	size_t planned_until_ = 0; /*!< Entries before this index were already planned. */
 };
@@ -707,6 +707,16 @@ int do_clone_node(const char* filename, uint64_t lv, uint32_t ts, const char* pt
 				HString((const char*)name), can_overwrite);
 }
 
+int do_lazy_clone(const char* filename, uint64_t lv, uint32_t ts, const char* ptr) {
+	uint32_t dst_inode, src_inode;
+	EAT(ptr,filename,lv,'(');
+	GETU32(dst_inode,ptr);
+	EAT(ptr,filename,lv,',');
+	GETU32(src_inode,ptr);
+	EAT(ptr,filename,lv,')');
+	return fs_apply_lazy_clone(ts, dst_inode, src_inode);
+}
+
 int do_symlink(const char* filename, uint64_t lv, uint32_t ts, const char* ptr) {
 	uint32_t parent,uid,gid,inode;
 	uint8_t name[256];
@@ -879,7 +889,9 @@ int restore_line(const char* filename, uint64_t lv, const char* line) {
 			}
 			break;
 		case 'L':
-			if (strncmp(ptr,"LENGTH",6)==0) {
+			if (strncmp(ptr,"LAZYCLONE",9)==0) {
+				status = do_lazy_clone(filename,lv,ts,ptr+9);
+			} else if (strncmp(ptr,"LENGTH",6)==0) {
 				status = do_length(filename,lv,ts,ptr+6);
 			} else if (strncmp(ptr,"LINK",4)==0) {
 				status = do_link(filename,lv,ts,ptr+4);
@@ -1029,6 +1041,8 @@ uint8_t restore(const char* filename, uint64_t newLogVersion, const char *ptr, R
 			if (verbosity > 0) {
 				safs_pretty_syslog(LOG_NOTICE, "%s: change %s", filename, ptr);
 			}
+			// materializations of lazy snapshots are replayed from their own entries
+			LazySnapshotHooksDisabler disabler;
 			int status = restore_line(filename,newLogVersion,ptr);
 			if (status<0) { // parse error - stop processing if requested
 				return (rigor == RestoreRigor::kIgnoreParseErrors ? 0 : SAUNAFS_ERROR_PARSE);
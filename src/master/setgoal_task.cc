@@ -25,27 +25,27 @@
 #include "master/filesystem_checksum.h"
 #include "master/filesystem_node.h"
 #include "master/filesystem_operations.h"
+#include "master/filesystem_snapshot.h"
 
 int SetGoalTask::execute(uint32_t ts, intrusive_list<Task> &work_queue) {
 	assert(current_inode_ != inode_list_.end());
 
 	uint32_t inode = *current_inode_;
 	++current_inode_;
+	++processed_entries_;
 	FSNode *node = fsnodes_id_to_node(inode);
 	if (!node) {
 		return SAUNAFS_ERROR_EINVAL;
 	}
+	fsnodes_lazy_snapshot_before_change(ts, node);
 
 	uint8_t result = setGoal(node, ts);
 
 	if (result != kNoAction) {
 		if (node->type == FSNode::kDirectory && (smode_ & SMODE_RMASK) &&
 		    !static_cast<const FSNodeDirectory *>(node)->entries.empty()) {
-			std::vector<uint32_t> inode_list;
-			inode_list.reserve(static_cast<const FSNodeDirectory *>(node)->entries.size());
-			for (const auto &entry : static_cast<const FSNodeDirectory *>(node)->entries) {
-				inode_list.push_back(entry.second->id);
-			}
+			std::vector<uint32_t> inode_list =
+			        takeChildren(static_cast<const FSNodeDirectory *>(node));
 			auto task = new SetGoalTask(std::move(inode_list), uid_, goal_, smode_, stats_);
 			work_queue.push_front(*task);
 		}
@@ -67,6 +67,42 @@ bool SetGoalTask::isFinished() const {
 	return current_inode_ == inode_list_.end();
 }
 
+void SetGoalTask::plan(uint32_t max_entries) {
+	if ((smode_ & SMODE_RMASK) == 0) {
+		return;
+	}
+	// entries planned before are kept until the plans are discarded
+	size_t current = current_inode_ - inode_list_.begin();
+	size_t end = std::min(inode_list_.size(), current + max_entries);
+	for (size_t i = std::max(current, planned_until_); i < end; ++i) {
+		const FSNode *node = fsnodes_id_to_node(inode_list_[i]);
+		if (!node || node->type != FSNode::kDirectory || planned_children_.count(node->id)) {
+			continue;
+		}
+		std::vector<uint32_t> &children = planned_children_[node->id];
+		children.reserve(static_cast<const FSNodeDirectory *>(node)->entries.size());
+		for (const auto &entry : static_cast<const FSNodeDirectory *>(node)->entries) {
+			children.push_back(entry.second->id);
+		}
+	}
+	planned_until_ = std::max(planned_until_, end);
+}
+
+std::vector<uint32_t> SetGoalTask::takeChildren(const FSNodeDirectory *node) {
+	std::vector<uint32_t> children;
+	auto it = planned_children_.find(node->id);
+	if (it != planned_children_.end()) {
+		children = std::move(it->second);
+		planned_children_.erase(it);
+		return children;
+	}
+	children.reserve(node->entries.size());
+	for (const auto &entry : node->entries) {
+		children.push_back(entry.second->id);
+	}
+	return children;
+}
+
 uint8_t SetGoalTask::setGoal(FSNode *node, uint32_t ts) {
 	if (node->type == FSNode::kFile || node->type == FSNode::kDirectory ||
 	    node->type == FSNode::kTrash || node->type == FSNode::kReserved) {
@@ -21,6 +21,8 @@
 
 #include "common/platform.h"
 
+#include <unordered_map>
+
 #include "master/filesystem_node.h"
 #include "master/task_manager.h"
 
@@ -63,6 +65,14 @@ public:
 
 	bool isFinished() const override;
 
+	/*! \brief Lists entries of directories which are going to be processed. */
+	void plan(uint32_t max_entries) override;
+
+	void discardPlan() override {
+		planned_children_.clear();
+		planned_until_ = 0;
+	}
+
 	static std::string generateDescription(const std::string &target, uint32_t trashtime) {
 		return "Setting trashtime (" + std::to_string(trashtime) + "): " + target;
 	}
@@ -70,8 +80,13 @@ public:
 	uint8_t setTrashtime(FSNode *node, uint32_t ts);
 
 private:
+	/*! \brief Returns inodes of the directory's entries, from the plan if possible. */
+	std::vector<uint32_t> takeChildren(const FSNodeDirectory *node);
+
 	std::vector<uint32_t> inode_list_;
 	std::vector<uint32_t>::iterator current_inode_;
+	std::unordered_map<uint32_t, std::vector<uint32_t>> planned_children_;
+	size_t planned_until_ = 0; /*!< Entries before this index were already planned. */
 
 	uint32_t uid_;
 	uint32_t trashtime_;
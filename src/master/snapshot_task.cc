@@ -25,13 +25,14 @@
 #include "master/filesystem_metadata.h"
 #include "master/filesystem_operations.h"
 #include "master/filesystem_quota.h"
+#include "master/filesystem_snapshot.h"
 
 int SnapshotTask::cloneNodeTest(FSNode *src_node, FSNode *dst_node, FSNodeDirectory *dst_parent) {
-	if (fsnodes_quota_exceeded_ug(src_node, {{QuotaResource::kInodes, 1}}) ||
-	    fsnodes_quota_exceeded_dir(dst_parent, {{QuotaResource::kInodes, 1}})) {
+	if (check_quota_ && (fsnodes_quota_exceeded_ug(src_node, {{QuotaResource::kInodes, 1}}) ||
+	    fsnodes_quota_exceeded_dir(dst_parent, {{QuotaResource::kInodes, 1}}))) {
 		return SAUNAFS_ERROR_QUOTA;
 	}
-	if (src_node->type == FSNode::kFile &&
+	if (check_quota_ && src_node->type == FSNode::kFile &&
 	    (fsnodes_quota_exceeded_ug(src_node, {{QuotaResource::kSize, 1}}) ||
 	     fsnodes_quota_exceeded_dir(dst_parent, {{QuotaResource::kSize, 1}}))) {
 		return SAUNAFS_ERROR_QUOTA;
@@ -166,16 +167,22 @@ void SnapshotTask::cloneDirectoryData(const FSNodeDirectory *src_node, FSNodeDir
 		return;
 	}
 	SubtaskContainer data;
-	data.reserve(src_node->entries.size());
-	for (const auto &entry : src_node->entries) {
-		auto local_id = entry.second->id;
-		data.emplace_back(std::move(local_id), (HString)entry.first);
+	auto planned = planned_subtasks_.find(src_node->id);
+	if (planned != planned_subtasks_.end()) {
+		data = std::move(planned->second);
+		planned_subtasks_.erase(planned);
+	} else {
+		data.reserve(src_node->entries.size());
+		for (const auto &entry : src_node->entries) {
+			auto local_id = entry.second->id;
+			data.emplace_back(std::move(local_id), (HString)entry.first);
+		}
 	}
 	if (!data.empty()) {
 		auto task = new SnapshotTask(std::move(data), orig_inode_,
 		                                           dst_node->id, 0, can_overwrite_,
 		                                           ignore_missing_src_,
-		                                           emit_changelog_, enqueue_work_);
+		                                           emit_changelog_, enqueue_work_, check_quota_);
 		local_tasks_.push_back(*task);
 	}
 }
@@ -199,9 +206,10 @@ void SnapshotTask::emitChangelog(uint32_t ts, uint32_t dst_inode) {
 		return;
 	}
 
+	uint8_t flags = can_overwrite_ | (check_quota_ ? 0 : kCloneWithoutQuotaCheck);
 	fs_changelog(ts, "CLONE(%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%s,%" PRIu8 ")",
 	             current_subtask_->first, dst_parent_inode_, dst_inode,
-	             fsnodes_escape_name(current_subtask_->second).c_str(), can_overwrite_);
+	             fsnodes_escape_name(current_subtask_->second).c_str(), flags);
 }
 
 int SnapshotTask::cloneNode(uint32_t ts) {
@@ -215,7 +223,14 @@ int SnapshotTask::cloneNode(uint32_t ts) {
 		return SAUNAFS_ERROR_EINVAL;
 	}
 
+	// lazy snapshots have to be copied before their entries are read or modified
+	fsnodes_lazy_snapshot_materialize(ts, src_node);
+	fsnodes_lazy_snapshot_before_change(ts, dst_parent);
+
 	FSNode *dst_node = fsnodes_lookup(dst_parent, current_subtask_->second);
+	if (dst_node) {
+		fsnodes_lazy_snapshot_before_change(ts, dst_node);
+	}
 
 	int status = cloneNodeTest(src_node, dst_node, dst_parent);
 	if (status != SAUNAFS_STATUS_OK) {
@@ -238,11 +253,34 @@ int SnapshotTask::cloneNode(uint32_t ts) {
 	return SAUNAFS_STATUS_OK;
 }
 
+void SnapshotTask::plan(uint32_t max_entries) {
+	if (!enqueue_work_) {
+		return;
+	}
+	// entries planned before are kept until the plans are discarded
+	size_t current = current_subtask_ - subtask_.begin();
+	size_t end = std::min(subtask_.size(), current + max_entries);
+	for (size_t i = std::max(current, planned_until_); i < end; ++i) {
+		const FSNode *src_node = fsnodes_id_to_node(subtask_[i].first);
+		if (!src_node || src_node->type != FSNode::kDirectory ||
+		    planned_subtasks_.count(src_node->id)) {
+			continue;
+		}
+		SubtaskContainer &data = planned_subtasks_[src_node->id];
+		data.reserve(static_cast<const FSNodeDirectory *>(src_node)->entries.size());
+		for (const auto &entry : static_cast<const FSNodeDirectory *>(src_node)->entries) {
+			data.emplace_back(entry.second->id, (HString)entry.first);
+		}
+	}
+	planned_until_ = std::max(planned_until_, end);
+}
+
 int SnapshotTask::execute(uint32_t ts, intrusive_list<Task> &work_queue) {
 	assert(current_subtask_ != subtask_.end());
 
 	int status = cloneNode(ts);
 	++current_subtask_;
+	++processed_entries_;
 
 	if (ignore_missing_src_ && status == SAUNAFS_ERROR_ENOENT) {
 		return SAUNAFS_STATUS_OK;
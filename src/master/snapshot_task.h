@@ -25,11 +25,17 @@
 #include <functional>
 #include <list>
 #include <string>
+#include <unordered_map>
 
 #include "master/task_manager.h"
 #include "master/filesystem_node.h"
 #include "master/hstring.h"
 
+/*! \brief Flag added to can_overwrite of CLONE changelog entries which were not checked
+ * against quota limits (entries of lazy snapshots), so that they are replayed the same way.
+ */
+constexpr uint8_t kCloneWithoutQuotaCheck = 0x80;
+
 /*! \brief Implementation of Snapshot Task to work with Task Manager.
  *
  * This class uses new approach to executing snapshots.
@@ -46,11 +52,12 @@ public:
 
 	SnapshotTask(SubtaskContainer &&subtask, uint32_t orig_inode, uint32_t dst_parent_inode,
 		     uint32_t dst_inode, uint8_t can_overwrite, uint8_t ignore_missing_src,
-		     bool emit_changelog, bool enqueue_work) :
+		     bool emit_changelog, bool enqueue_work, bool check_quota = true) :
 		     subtask_(std::move(subtask)), orig_inode_(orig_inode),
 		     dst_parent_inode_(dst_parent_inode),dst_inode_(dst_inode),
 		     can_overwrite_(can_overwrite), ignore_missing_src_(ignore_missing_src),
-		     emit_changelog_(emit_changelog), enqueue_work_(enqueue_work), local_tasks_() {
+		     emit_changelog_(emit_changelog), enqueue_work_(enqueue_work),
+		     check_quota_(check_quota), local_tasks_() {
 		assert(subtask_.size() == 1 || (subtask_.size() > 1 && dst_inode == 0));
 		current_subtask_ = subtask_.begin();
 	}
@@ -80,6 +87,14 @@ public:
 		return current_subtask_ == subtask_.end();
 	};
 
+	/*! \brief Lists entries of source directories which are going to be cloned. */
+	void plan(uint32_t max_entries) override;
+
+	void discardPlan() override {
+		planned_subtasks_.clear();
+		planned_until_ = 0;
+	}
+
 	static std::string generateDescription(const std::string &src, const std::string &dst) {
 		return "Creating snapshot: " + src + " -> " + dst;
 	}
@@ -120,6 +135,11 @@ private:
 	bool emit_changelog_;       /*!< If true change log message should be generated. */
 	bool enqueue_work_;         /*!< If true then new clone request should be created
 	                                 for source inode's children. */
+	bool check_quota_;          /*!< If false then quota limits are not checked (replay of
+	                                 a changelog or materialization of a lazy snapshot). */
 	intrusive_list<Task> local_tasks_; /*< List of snapshot tasks created by this
 	                                                   task for source inode's children. */
+	std::unordered_map<uint32_t, SubtaskContainer> planned_subtasks_; /*!< Entries of source
+	                                                   directories listed by plan(). */
+	size_t planned_until_ = 0; /*!< Entries before this index were already planned. */
 };
@@ -21,6 +21,8 @@
 
 #include "master/task_manager.h"
 
+#include <algorithm>
+
 #include "common/loop_watchdog.h"
 #include "master/filesystem_metadata.h"
 #include "master/filesystem_node.h"
@@ -30,6 +32,7 @@ void TaskManager::Job::finalize(int status) {
 	if (finish_callback_) {
 		finish_callback_(status);
 	}
+	planned_tasks_.clear();
 	tasks_.clear_and_dispose([](Task *ptr) { delete ptr; });
 }
 
@@ -37,6 +40,10 @@ void TaskManager::Job::finalizeTask(TaskIterator itask, int status) {
 	if (status || (itask->isFinished() && tasks_.size() <= 1)) {
 		finalize(status);
 	} else if (itask->isFinished()) {
+		auto it = std::find(planned_tasks_.begin(), planned_tasks_.end(), &*itask);
+		if (it != planned_tasks_.end()) {
+			planned_tasks_.erase(it);
+		}
 		tasks_.erase_and_dispose(itask, [](Task *ptr) { delete ptr; });
 	}
 }
@@ -44,18 +51,46 @@ void TaskManager::Job::finalizeTask(TaskIterator itask, int status) {
 void TaskManager::Job::processTask(uint32_t ts) {
 	if (!tasks_.empty()) {
 		auto i_front = tasks_.begin();
+		uint64_t processed_before = i_front->processedEntries();
 		int status = i_front->execute(ts, tasks_);
+		processed_entries_ += i_front->processedEntries() - processed_before;
 		finalizeTask(i_front, status);
 	}
 }
 
+void TaskManager::Job::startPlanning(TaskList &tasks, size_t max_tasks) {
+	size_t count = 0;
+	for (Task &task : tasks_) {
+		if (count++ >= max_tasks) {
+			break;
+		}
+		if (std::find(planned_tasks_.begin(), planned_tasks_.end(), &task) ==
+		    planned_tasks_.end()) {
+			planned_tasks_.push_back(&task);
+		}
+		tasks.push_back(&task);
+	}
+}
+
+void TaskManager::Job::discardPlans() {
+	for (Task *task : planned_tasks_) {
+		task->discardPlan();
+	}
+	planned_tasks_.clear();
+}
+
 JobInfo TaskManager::Job::getInfo() const {
 	return { id_, description_ };
 }
 
+JobProgressInfo TaskManager::Job::getProgressInfo(uint32_t ts) const {
+	return { id_, description_, processed_entries_, tasks_.size(),
+	         ts > start_time_ ? ts - start_time_ : 0 };
+}
+
 int TaskManager::submitTask(uint32_t taskid, uint32_t ts, int initial_batch_size, Task *task,
 	                    const std::string &description, const std::function<void(int)> &callback) {
-	Job new_job(taskid, description);
+	Job new_job(taskid, description, ts);
 
 	int done = 0;
 	int status = SAUNAFS_STATUS_OK;
@@ -66,12 +101,14 @@ int TaskManager::submitTask(uint32_t taskid, uint32_t ts, int initial_batch_size
 	});
 
 	new_job.addTask(task);
+	discardStalePlans();
 	for (int i = 0; i < initial_batch_size; i++) {
 		new_job.processTask(ts);
 		if (new_job.isFinished()) {
 			break;
 		}
 	}
+	plan_version_ = gMetadata->metaversion;
 
 	if (done) {
 		assert(new_job.isFinished());
@@ -92,6 +129,7 @@ int TaskManager::submitTask(uint32_t ts, int initial_batch_size, Task *task,
 void TaskManager::processJobs(uint32_t ts, int number_of_tasks) {
 	SignalLoopWatchdog watchdog;
 	JobIterator it = job_list_.begin();
+	discardStalePlans();
 	watchdog.start();
 	for (int i = 0; i < number_of_tasks; ++i) {
 		if (it == job_list_.end() || watchdog.expired()) {
@@ -107,6 +145,30 @@ void TaskManager::processJobs(uint32_t ts, int number_of_tasks) {
 			it = job_list_.begin();
 		}
 	}
+	plan_version_ = gMetadata->metaversion;
+}
+
+void TaskManager::discardStalePlans() {
+	if (gMetadata->metaversion != plan_version_) {
+		for (Job &job : job_list_) {
+			job.discardPlans();
+		}
+	}
+}
+
+TaskManager::TaskList TaskManager::startPlanning() {
+	TaskList tasks;
+	// copying entries of lazy snapshots modifies directories as a side effect
+	// of other changes, which would make plans of directories out of date
+	if (!gMetadata->lazy_snapshots.empty()) {
+		return tasks;
+	}
+	discardStalePlans();
+	plan_version_ = gMetadata->metaversion;
+	for (Job &job : job_list_) {
+		job.startPlanning(tasks, kMaxPlannedTasksPerJob);
+	}
+	return tasks;
 }
 
 TaskManager::JobsInfoContainer TaskManager::getCurrentJobsInfo() const {
@@ -118,6 +180,15 @@ TaskManager::JobsInfoContainer TaskManager::getCurrentJobsInfo() const {
 	return info;
 }
 
+TaskManager::JobsProgressContainer TaskManager::getCurrentJobsProgress(uint32_t ts) const {
+	JobsProgressContainer info;
+	info.reserve(job_list_.size());
+	for (const Job &j : job_list_) {
+		info.push_back(j.getProgressInfo(ts));
+	}
+	return info;
+}
+
 bool TaskManager::cancelJob(uint32_t job_id) {
 	for (auto it = job_list_.begin(); it != job_list_.end(); ++it) {
 		if (it->getId() == job_id) {
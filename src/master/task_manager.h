@@ -25,6 +25,7 @@
 #include <list>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "common/intrusive_list.h"
 #include "common/job_info.h"
@@ -34,6 +35,10 @@
  * This class is responsible for managing execution of tasks.
  * Submitting a task creates a new Job object. Job represents
  * the task itself + all subtasks it creates during its execution.
+ *
+ * Before executing a batch of tasks, their read-only part can be done in parallel,
+ * see startPlanning(). Only listing directories which are going to be processed is
+ * planned; changes of chunks, quota and the rest of metadata are done by execute().
  */
 class TaskManager {
 public:
@@ -49,22 +54,52 @@ public:
 		virtual int execute(uint32_t ts, intrusive_list<Task> &work_queue) = 0;
 
 		virtual bool isFinished() const = 0;
+
+		/*! \brief Number of entries (e.g. inodes) fully processed by this task. */
+		uint64_t processedEntries() const {
+			return processed_entries_;
+		}
+
+		/*! \brief Prepares data needed by the following calls of execute().
+		 *
+		 * Called while metadata is not being modified, possibly on another thread
+		 * and concurrently with plan() of other tasks, so the function may only read
+		 * metadata and modify the task itself. Plans made by the previous calls are
+		 * kept until discardPlan().
+		 * \param max_entries maximum number of entries of this task, counting from the
+		 *                    current one, which should have a plan.
+		 */
+		virtual void plan(uint32_t /*max_entries*/) {
+		}
+
+		/*! \brief Drops data prepared by plan(), as metadata changed in the meantime. */
+		virtual void discardPlan() {
+		}
+
+	protected:
+		uint64_t processed_entries_ = 0; /*!< To be increased by execute(). */
 	};
 
+	typedef std::vector<Task *> TaskList;
+
 	typedef typename intrusive_list<Task>::iterator TaskIterator;
 
 	/*! \brief Class representing the original task and all subtasks it created during execution*/
 	class Job {
 	public:
-		Job(uint32_t id, const std::string &description) :
-		    id_(id), description_(description),
-		    finish_callback_(), tasks_() {
+		Job(uint32_t id, const std::string &description, uint32_t start_time) :
+		    id_(id), description_(description), start_time_(start_time),
+		    processed_entries_(0), finish_callback_(), tasks_(),
+		    planned_tasks_() {
 		}
 
 		Job(Job &&other) : id_(std::move(other.id_)),
 				   description_(std::move(other.description_)),
+				   start_time_(other.start_time_),
+				   processed_entries_(other.processed_entries_),
 				   finish_callback_(std::move(other.finish_callback_)),
-				   tasks_(std::move(other.tasks_)) {
+				   tasks_(std::move(other.tasks_)),
+				   planned_tasks_(std::move(other.planned_tasks_)) {
 		}
 
 		~Job() {
@@ -84,6 +119,14 @@ public:
 		 */
 		void processTask(uint32_t ts);
 
+		/*! \brief Adds tasks which are going to be executed first to the list of tasks
+		 * to be planned. Tasks planned before are added again, so that they can plan
+		 * their following entries.
+		 * \param tasks list to which the tasks are added.
+		 * \param max_tasks maximum number of tasks to be added.
+		 */
+		void startPlanning(TaskList &tasks, size_t max_tasks);
+
 		void setFinishCallback(const std::function<void(int)> &finish_callback) {
 			finish_callback_ = finish_callback;
 		}
@@ -106,21 +149,32 @@ public:
 
 		JobInfo getInfo() const;
 
+		JobProgressInfo getProgressInfo(uint32_t ts) const;
+
+		void discardPlans();
+
 	private:
 		uint32_t id_;
 		std::string description_;
+		uint32_t start_time_;
+		uint64_t processed_entries_; /*!< Number of entries processed by this Job's tasks. */
 		std::function<void(int)> finish_callback_; /*!< Callback function called when all tasks
 		                                                that belong to this Job are done. */
 
 		intrusive_list<Task> tasks_; /*!< List of tasks that belong to this Job*/
+		TaskList planned_tasks_; /*!< Tasks which may have a plan. */
 	};
 
 	typedef typename std::list<Job> JobContainer;
 	typedef typename JobContainer::iterator JobIterator;
 	typedef typename std::vector<JobInfo> JobsInfoContainer;
+	typedef typename std::vector<JobProgressInfo> JobsProgressContainer;
+
+	/*! \brief Maximum number of tasks of a single Job planned at once. */
+	static constexpr size_t kMaxPlannedTasksPerJob = 64;
 
 public:
-	TaskManager() : job_list_(), next_job_id_(0) {
+	TaskManager() : job_list_(), next_job_id_(0), plan_version_(0) {
 	}
 
 	/*! \brief Submit task to be enqueued and executed by TaskManager.
@@ -160,9 +214,25 @@ public:
 	 */
 	void processJobs(uint32_t ts, int number_of_tasks);
 
+	/*! \brief Select tasks which should plan their work before the following processJobs().
+	 *
+	 * The caller has to call Task::plan() of each returned task before metadata is
+	 * modified again, which can be done in parallel. Plans are used as long as metadata
+	 * is modified by nothing but the tasks: a task changing a directory planned by
+	 * another one is no different from a change made after a task listed a directory
+	 * in execute(), but other changes (e.g. materializing lazy snapshots) are not.
+	 * \return tasks to be planned, empty if planning is not possible now.
+	 */
+	TaskList startPlanning();
+
 	/*! \brief Get information about all currently executed Job. */
 	JobsInfoContainer getCurrentJobsInfo() const;
 
+	/*! \brief Get progress of all currently executed Jobs.
+	 * \param ts current time stamp.
+	 */
+	JobsProgressContainer getCurrentJobsProgress(uint32_t ts) const;
+
 	/*! \brief Stop execution of a Job specified by given id. */
 	bool cancelJob(uint32_t job_id);
 
@@ -174,6 +244,11 @@ public:
 		return next_job_id_++;
 	}
 private:
+	/*! \brief Discards plans of all Jobs if metadata was modified by something else
+	 * than the tasks since the last task was executed. */
+	void discardStalePlans();
+
 	JobContainer job_list_; /*!< List with Jobs to execute. */
 	uint32_t next_job_id_;
+	uint64_t plan_version_; /*!< Metadata version after the last executed task. */
 };
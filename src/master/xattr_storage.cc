@@ -0,0 +1,323 @@
+/*
+   Copyright 2023 Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "master/xattr_storage.h"
+
+#include <cassert>
+#include <cstdlib>
+
+#include "common/massert.h"
+
+XattrStorage::XattrStorage()
+	: shards_(kShardCount),
+	  inodeCount_(0),
+	  attributeCount_(0) {
+}
+
+XattrStorage::~XattrStorage() {
+	clear();
+}
+
+void XattrStorage::clear() {
+	for (auto &shard : shards_) {
+		for (auto &entry : shard.slots) {
+			if (entry.inode != 0) {
+				free(entry.data);
+			}
+		}
+		shard.slots.clear();
+		shard.slots.shrink_to_fit();
+		shard.count = 0;
+	}
+	nameIds_.clear();
+	names_.clear();
+	freeNameIds_.clear();
+	inodeCount_ = 0;
+	attributeCount_ = 0;
+}
+
+const XattrStorage::InodeEntry *XattrStorage::find(uint32_t inode) const {
+	const Shard &shard = shards_[shardOf(inode)];
+	if (shard.count == 0) {
+		return nullptr;
+	}
+	uint32_t mask = shard.slots.size() - 1;
+	for (uint32_t slot = slotOf(shard, inode); shard.slots[slot].inode != 0;
+	     slot = (slot + 1) & mask) {
+		if (shard.slots[slot].inode == inode) {
+			return &shard.slots[slot];
+		}
+	}
+	return nullptr;
+}
+
+XattrStorage::InodeEntry *XattrStorage::find(uint32_t inode) {
+	return const_cast<InodeEntry *>(static_cast<const XattrStorage *>(this)->find(inode));
+}
+
+XattrStorage::InodeEntry &XattrStorage::insertInode(uint32_t inode) {
+	assert(inode != 0);
+	Shard &shard = shards_[shardOf(inode)];
+	// keep load factor below 3/4
+	if (4 * (shard.count + 1) > 3 * shard.slots.size()) {
+		grow(shard);
+	}
+	uint32_t mask = shard.slots.size() - 1;
+	uint32_t slot = slotOf(shard, inode);
+	while (shard.slots[slot].inode != 0) {
+		slot = (slot + 1) & mask;
+	}
+	InodeEntry &entry = shard.slots[slot];
+	entry = InodeEntry{inode, 0, 0, 0, 0, nullptr};
+	shard.count++;
+	inodeCount_++;
+	return entry;
+}
+
+void XattrStorage::grow(Shard &shard) {
+	std::vector<InodeEntry> old;
+	old.swap(shard.slots);
+	shard.slots.assign(old.empty() ? 4 : 2 * old.size(), InodeEntry{0, 0, 0, 0, 0, nullptr});
+	uint32_t mask = shard.slots.size() - 1;
+	for (const auto &entry : old) {
+		if (entry.inode == 0) {
+			continue;
+		}
+		uint32_t slot = slotOf(shard, entry.inode);
+		while (shard.slots[slot].inode != 0) {
+			slot = (slot + 1) & mask;
+		}
+		shard.slots[slot] = entry;
+	}
+}
+
+void XattrStorage::eraseSlot(Shard &shard, uint32_t slot) {
+	uint32_t mask = shard.slots.size() - 1;
+	// Backward shift deletion: move following entries of the probe sequence into the hole,
+	// so lookups never need tombstones.
+	uint32_t next = (slot + 1) & mask;
+	while (shard.slots[next].inode != 0) {
+		uint32_t home = slotOf(shard, shard.slots[next].inode);
+		if (((next - home) & mask) >= ((next - slot) & mask)) {
+			shard.slots[slot] = shard.slots[next];
+			slot = next;
+		}
+		next = (next + 1) & mask;
+	}
+	shard.slots[slot] = InodeEntry{0, 0, 0, 0, 0, nullptr};
+	shard.count--;
+	inodeCount_--;
+	if (shard.count == 0) {
+		shard.slots.clear();
+		shard.slots.shrink_to_fit();
+	}
+}
+
+uint32_t XattrStorage::findName(std::string_view name) const {
+	auto it = nameIds_.find(name);
+	return it == nameIds_.end() ? kNoName : it->second;
+}
+
+uint32_t XattrStorage::refName(std::string_view name) {
+	auto it = nameIds_.find(name);
+	if (it != nameIds_.end()) {
+		names_[it->second].refcount++;
+		return it->second;
+	}
+	uint32_t id;
+	if (!freeNameIds_.empty()) {
+		id = freeNameIds_.back();
+		freeNameIds_.pop_back();
+		names_[id] = Name{std::string(name), 1};
+	} else {
+		id = names_.size();
+		names_.push_back(Name{std::string(name), 1});
+	}
+	nameIds_.emplace(std::string(name), id);
+	return id;
+}
+
+void XattrStorage::unrefName(uint32_t id) {
+	Name &name = names_[id];
+	assert(name.refcount > 0);
+	if (--name.refcount == 0) {
+		nameIds_.erase(name.name);
+		name.name.clear();
+		name.name.shrink_to_fit();
+		freeNameIds_.push_back(id);
+	}
+}
+
+uint32_t XattrStorage::findRecord(const InodeEntry &entry, std::string_view name,
+		bool *found) const {
+	uint32_t offset = 0;
+	*found = false;
+	while (offset < entry.size) {
+		Record record = readRecord(entry.data + offset);
+		int cmp = names_[record.nameId].name.compare(name);
+		if (cmp == 0) {
+			*found = true;
+			break;
+		}
+		if (cmp > 0) {
+			break;
+		}
+		offset += kRecordHeaderSize + record.avleng;
+	}
+	return offset;
+}
+
+bool XattrStorage::get(uint32_t inode, uint8_t anleng, const uint8_t *attrname,
+		const uint8_t **attrvalue, uint32_t *avleng) const {
+	const InodeEntry *entry = find(inode);
+	if (!entry) {
+		return false;
+	}
+	// names which are not interned are not used by any inode
+	uint32_t name_id = findName(std::string_view((const char *)attrname, anleng));
+	if (name_id == kNoName) {
+		return false;
+	}
+	const uint8_t *ptr = entry->data;
+	const uint8_t *end = entry->data + entry->size;
+	while (ptr < end) {
+		Record record = readRecord(ptr);
+		if (record.nameId == name_id) {
+			*attrvalue = record.value;
+			*avleng = record.avleng;
+			return true;
+		}
+		ptr = record.value + record.avleng;
+	}
+	return false;
+}
+
+void XattrStorage::set(uint32_t inode, uint8_t anleng, const uint8_t *attrname, uint32_t avleng,
+		const uint8_t *attrvalue) {
+	std::string_view name((const char *)attrname, anleng);
+	InodeEntry *entry = find(inode);
+	if (!entry) {
+		entry = &insertInode(inode);
+	}
+
+	bool found;
+	uint32_t offset = findRecord(*entry, name, &found);
+	uint32_t name_id;
+	uint32_t old_size = 0;
+	if (found) {
+		Record old = readRecord(entry->data + offset);
+		name_id = old.nameId;
+		old_size = kRecordHeaderSize + old.avleng;
+		entry->avleng -= old.avleng;
+	} else {
+		name_id = refName(name);
+		entry->anleng += anleng + 1U;
+		attributeCount_++;
+	}
+
+	uint32_t size = entry->size - old_size + kRecordHeaderSize + avleng;
+	uint8_t *data = (uint8_t *)malloc(size);
+	passert(data);
+	uint8_t *ptr = data;
+	if (offset > 0) {
+		memcpy(ptr, entry->data, offset);
+		ptr += offset;
+	}
+	memcpy(ptr, &name_id, 4);
+	memcpy(ptr + 4, &avleng, 4);
+	ptr += kRecordHeaderSize;
+	if (avleng > 0) {
+		memcpy(ptr, attrvalue, avleng);
+		ptr += avleng;
+	}
+	uint32_t tail = entry->size - offset - old_size;
+	if (tail > 0) {
+		memcpy(ptr, entry->data + offset + old_size, tail);
+	}
+	free(entry->data);
+	entry->data = data;
+	entry->size = size;
+	entry->avleng += avleng;
+}
+
+bool XattrStorage::remove(uint32_t inode, uint8_t anleng, const uint8_t *attrname) {
+	InodeEntry *entry = find(inode);
+	if (!entry) {
+		return false;
+	}
+	std::string_view name((const char *)attrname, anleng);
+	bool found;
+	uint32_t offset = findRecord(*entry, name, &found);
+	if (!found) {
+		return false;
+	}
+	Record old = readRecord(entry->data + offset);
+	uint32_t old_size = kRecordHeaderSize + old.avleng;
+	if (old_size == entry->size) {
+		removeInode(inode);
+		return true;
+	}
+	unrefName(old.nameId);
+	attributeCount_--;
+	memmove(entry->data + offset, entry->data + offset + old_size,
+	        entry->size - offset - old_size);
+	entry->size -= old_size;
+	entry->anleng -= anleng + 1U;
+	entry->avleng -= old.avleng;
+	uint8_t *data = (uint8_t *)realloc(entry->data, entry->size);
+	if (data) {
+		entry->data = data;
+	}
+	return true;
+}
+
+void XattrStorage::removeInode(uint32_t inode) {
+	Shard &shard = shards_[shardOf(inode)];
+	InodeEntry *entry = find(inode);
+	if (!entry) {
+		return;
+	}
+	const uint8_t *ptr = entry->data;
+	const uint8_t *end = entry->data + entry->size;
+	while (ptr < end) {
+		Record record = readRecord(ptr);
+		unrefName(record.nameId);
+		attributeCount_--;
+		ptr = record.value + record.avleng;
+	}
+	free(entry->data);
+	eraseSlot(shard, entry - shard.slots.data());
+}
+
+uint64_t XattrStorage::memoryUsage() const {
+	uint64_t result = shards_.capacity() * sizeof(Shard);
+	for (const auto &shard : shards_) {
+		result += shard.slots.capacity() * sizeof(InodeEntry);
+		for (const auto &entry : shard.slots) {
+			if (entry.inode != 0) {
+				result += entry.size;
+			}
+		}
+	}
+	for (const auto &name : names_) {
+		result += sizeof(Name) + name.name.capacity();
+	}
+	result += nameIds_.size() * (sizeof(std::string) + sizeof(uint32_t) + 2 * sizeof(void *));
+	return result;
+}
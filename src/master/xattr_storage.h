@@ -0,0 +1,203 @@
+/*
+   Copyright 2023 Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/*! \brief Extended attributes of all inodes.
+ *
+ * Attributes of an inode are packed into a single buffer, sorted by name. Each attribute
+ * in the buffer is a name id (4B), a value length (4B) and the value. Names are interned,
+ * so a name used by many inodes (e.g. user.DOSATTRIB) is stored once.
+ *
+ * Inodes are indexed by open addressing tables (linear probing), split into kShardCount
+ * shards. An inode stays in its shard when a table grows, so shards can be used to walk
+ * over all attributes in several steps while attributes are being modified.
+ */
+class XattrStorage {
+public:
+	static constexpr uint32_t kShardCount = 65536;
+
+	/// Attributes of a single inode.
+	struct InodeEntry {
+		uint32_t inode;     ///< 0 for an empty slot
+		uint32_t anleng;    ///< Length of the list of names (each name followed by '\0').
+		uint32_t avleng;    ///< Sum of lengths of values.
+		uint32_t size;      ///< Size of data.
+		uint64_t checksum;  ///< Maintained by the owner of the storage.
+		uint8_t *data;      ///< Packed attributes.
+	};
+
+	XattrStorage();
+	~XattrStorage();
+
+	XattrStorage(const XattrStorage &) = delete;
+	XattrStorage &operator=(const XattrStorage &) = delete;
+
+	static uint32_t shardOf(uint32_t inode) {
+		return (inode * 0x72B5F387U) & (kShardCount - 1);
+	}
+
+	/*! \brief Find attributes of an inode.
+	 *
+	 * Returned pointer is valid until attributes of any inode from the same shard are
+	 * modified.
+	 */
+	const InodeEntry *find(uint32_t inode) const;
+	InodeEntry *find(uint32_t inode);
+
+	/*! \brief Find value of an attribute.
+	 *
+	 * \return true if the attribute exists. Value is valid until attributes
+	 *         of the inode are modified.
+	 */
+	bool get(uint32_t inode, uint8_t anleng, const uint8_t *attrname, const uint8_t **attrvalue,
+	         uint32_t *avleng) const;
+
+	/// Create or replace an attribute.
+	void set(uint32_t inode, uint8_t anleng, const uint8_t *attrname, uint32_t avleng,
+	         const uint8_t *attrvalue);
+
+	/// \return true if the attribute existed.
+	bool remove(uint32_t inode, uint8_t anleng, const uint8_t *attrname);
+
+	void removeInode(uint32_t inode);
+
+	/*! \brief Call f(name, anleng, value, avleng) for each attribute of an entry,
+	 *         in order of names.
+	 */
+	template <typename Func>
+	void forEachAttribute(const InodeEntry &entry, Func f) const {
+		const uint8_t *ptr = entry.data;
+		const uint8_t *end = entry.data + entry.size;
+		while (ptr < end) {
+			Record record = readRecord(ptr);
+			const std::string &name = names_[record.nameId].name;
+			f((const uint8_t *)name.data(), (uint8_t)name.size(), record.value, record.avleng);
+			ptr = record.value + record.avleng;
+		}
+	}
+
+	/// Call f(InodeEntry &) for each inode with attributes in a shard, in order of inodes.
+	template <typename Func>
+	void forEachInode(uint32_t shard, Func f) {
+		std::vector<InodeEntry *> entries;
+		entries.reserve(shards_[shard].count);
+		for (auto &entry : shards_[shard].slots) {
+			if (entry.inode != 0) {
+				entries.push_back(&entry);
+			}
+		}
+		std::sort(entries.begin(), entries.end(),
+		          [](const InodeEntry *a, const InodeEntry *b) { return a->inode < b->inode; });
+		for (InodeEntry *entry : entries) {
+			f(*entry);
+		}
+	}
+
+	/// Number of inodes with attributes.
+	uint64_t inodeCount() const {
+		return inodeCount_;
+	}
+
+	/// Number of attributes of all inodes.
+	uint64_t attributeCount() const {
+		return attributeCount_;
+	}
+
+	/// Number of distinct attribute names.
+	uint64_t nameCount() const {
+		return nameIds_.size();
+	}
+
+	/// Approximate number of bytes allocated for attributes.
+	uint64_t memoryUsage() const;
+
+	void clear();
+
+private:
+	struct Shard {
+		std::vector<InodeEntry> slots;  ///< Empty or a power of two number of slots.
+		uint32_t count = 0;
+	};
+
+	struct Name {
+		std::string name;
+		uint32_t refcount;
+	};
+
+	struct Record {
+		uint32_t nameId;
+		uint32_t avleng;
+		const uint8_t *value;
+	};
+
+	struct NameHash {
+		using is_transparent = void;
+		size_t operator()(std::string_view name) const {
+			return std::hash<std::string_view>()(name);
+		}
+	};
+
+	static constexpr uint32_t kRecordHeaderSize = 8;
+	static constexpr uint32_t kNoName = UINT32_MAX;
+
+	static Record readRecord(const uint8_t *ptr) {
+		Record record;
+		memcpy(&record.nameId, ptr, 4);
+		memcpy(&record.avleng, ptr + 4, 4);
+		record.value = ptr + kRecordHeaderSize;
+		return record;
+	}
+
+	static uint32_t slotOf(const Shard &shard, uint32_t inode) {
+		return (((uint64_t)inode * 0x9E3779B97F4A7C15ULL) >> 32) & (shard.slots.size() - 1);
+	}
+
+	uint32_t findName(std::string_view name) const;
+	uint32_t refName(std::string_view name);
+	void unrefName(uint32_t id);
+	int compareNames(uint32_t id, std::string_view name) const;
+
+	InodeEntry &insertInode(uint32_t inode);
+	void eraseSlot(Shard &shard, uint32_t slot);
+	void grow(Shard &shard);
+
+	/*! \brief Find a record in attributes of an inode.
+	 *
+	 * \return offset of the record or, if there is no such record,
+	 *         offset at which it should be inserted.
+	 */
+	uint32_t findRecord(const InodeEntry &entry, std::string_view name, bool *found) const;
+
+	std::vector<Shard> shards_;
+	std::unordered_map<std::string, uint32_t, NameHash, std::equal_to<>> nameIds_;
+	std::vector<Name> names_;
+	std::vector<uint32_t> freeNameIds_;
+	uint64_t inodeCount_;
+	uint64_t attributeCount_;
+};
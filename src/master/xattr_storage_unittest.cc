@@ -0,0 +1,132 @@
+/*
+   Copyright 2023 Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "master/xattr_storage.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+static void set(XattrStorage &storage, uint32_t inode, const std::string &name,
+		const std::string &value) {
+	storage.set(inode, name.size(), (const uint8_t *)name.data(), value.size(),
+	            (const uint8_t *)value.data());
+}
+
+static std::string get(const XattrStorage &storage, uint32_t inode, const std::string &name) {
+	const uint8_t *value;
+	uint32_t avleng;
+	if (!storage.get(inode, name.size(), (const uint8_t *)name.data(), &value, &avleng)) {
+		return "(none)";
+	}
+	return std::string((const char *)value, avleng);
+}
+
+static bool remove(XattrStorage &storage, uint32_t inode, const std::string &name) {
+	return storage.remove(inode, name.size(), (const uint8_t *)name.data());
+}
+
+static std::vector<std::string> names(const XattrStorage &storage, uint32_t inode) {
+	std::vector<std::string> result;
+	const XattrStorage::InodeEntry *entry = storage.find(inode);
+	if (entry) {
+		storage.forEachAttribute(*entry, [&](const uint8_t *name, uint8_t anleng,
+		                                     const uint8_t *, uint32_t) {
+			result.emplace_back((const char *)name, anleng);
+		});
+	}
+	return result;
+}
+
+TEST(XattrStorageTests, SetGetRemove) {
+	XattrStorage storage;
+	set(storage, 5, "user.b", "value b");
+	set(storage, 5, "user.a", "");
+	set(storage, 5, "user.c", "value c");
+	set(storage, 6, "user.b", "other");
+
+	EXPECT_EQ("value b", get(storage, 5, "user.b"));
+	EXPECT_EQ("", get(storage, 5, "user.a"));
+	EXPECT_EQ("other", get(storage, 6, "user.b"));
+	EXPECT_EQ("(none)", get(storage, 6, "user.a"));
+	EXPECT_EQ("(none)", get(storage, 7, "user.a"));
+	EXPECT_EQ(std::vector<std::string>({"user.a", "user.b", "user.c"}), names(storage, 5));
+	EXPECT_EQ(2U, storage.inodeCount());
+	EXPECT_EQ(4U, storage.attributeCount());
+	EXPECT_EQ(3U, storage.nameCount());
+
+	const XattrStorage::InodeEntry *entry = storage.find(5);
+	ASSERT_NE(nullptr, entry);
+	EXPECT_EQ(3U * 7U, entry->anleng);
+	EXPECT_EQ(14U, entry->avleng);
+
+	set(storage, 5, "user.b", "longer value b");
+	EXPECT_EQ("longer value b", get(storage, 5, "user.b"));
+	EXPECT_EQ("value c", get(storage, 5, "user.c"));
+	EXPECT_EQ(21U, storage.find(5)->avleng);
+	EXPECT_EQ(4U, storage.attributeCount());
+
+	EXPECT_TRUE(remove(storage, 5, "user.b"));
+	EXPECT_FALSE(remove(storage, 5, "user.b"));
+	EXPECT_EQ(std::vector<std::string>({"user.a", "user.c"}), names(storage, 5));
+	EXPECT_EQ("other", get(storage, 6, "user.b"));
+	EXPECT_EQ(3U, storage.nameCount());
+
+	EXPECT_TRUE(remove(storage, 6, "user.b"));
+	EXPECT_EQ(nullptr, storage.find(6));
+	EXPECT_EQ(2U, storage.nameCount());
+
+	storage.removeInode(5);
+	EXPECT_EQ(nullptr, storage.find(5));
+	EXPECT_EQ(0U, storage.inodeCount());
+	EXPECT_EQ(0U, storage.attributeCount());
+	EXPECT_EQ(0U, storage.nameCount());
+}
+
+TEST(XattrStorageTests, ManyInodes) {
+	XattrStorage storage;
+	const uint32_t kInodes = 200000;
+	for (uint32_t inode = 1; inode <= kInodes; ++inode) {
+		set(storage, inode, "user.DOSATTRIB", std::to_string(inode));
+	}
+	EXPECT_EQ(kInodes, storage.inodeCount());
+	EXPECT_EQ(1U, storage.nameCount());
+
+	// remove every other inode, so the probe sequences have holes
+	for (uint32_t inode = 1; inode <= kInodes; inode += 2) {
+		storage.removeInode(inode);
+	}
+	for (uint32_t inode = 1; inode <= kInodes; ++inode) {
+		ASSERT_EQ(inode % 2 == 0 ? std::to_string(inode) : "(none)",
+		          get(storage, inode, "user.DOSATTRIB"));
+	}
+
+	uint64_t visited = 0;
+	for (uint32_t shard = 0; shard < XattrStorage::kShardCount; ++shard) {
+		uint32_t previous = 0;
+		storage.forEachInode(shard, [&](XattrStorage::InodeEntry &entry) {
+			EXPECT_EQ(shard, XattrStorage::shardOf(entry.inode));
+			EXPECT_LT(previous, entry.inode);
+			previous = entry.inode;
+			++visited;
+		});
+	}
+	EXPECT_EQ(kInodes / 2, visited);
+}
@@ -0,0 +1,212 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "mount/block_cache.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "common/hashfn.h"
+#include "protocol/SFSCommunication.h"
+
+size_t BlockCache::KeyHash::operator()(const Key &key) const noexcept {
+	uint64_t seed = 0;
+	hashCombine(seed, key.inode, key.index, key.block);
+	return seed;
+}
+
+BlockCache::BlockCache(uint64_t capacity_bytes, unsigned shard_count)
+		: block_capacity_(0),
+		  protected_capacity_(0),
+		  hits_(0),
+		  misses_(0),
+		  inserts_(0),
+		  evictions_(0),
+		  blocks_(0) {
+	assert(shard_count > 0);
+	shards_.reserve(shard_count);
+	for (unsigned i = 0; i < shard_count; ++i) {
+		shards_.push_back(std::make_unique<Shard>());
+	}
+	reset(capacity_bytes);
+}
+
+BlockCache::~BlockCache() {
+	clear();
+}
+
+void BlockCache::reset(uint64_t capacity_bytes) {
+	clear();
+	uint64_t blocks = capacity_bytes / SFSBLOCKSIZE;
+	if (blocks == 0) {
+		block_capacity_ = 0;
+		protected_capacity_ = 0;
+		return;
+	}
+	block_capacity_ = std::max<uint64_t>(1, blocks / shards_.size());
+	protected_capacity_ = block_capacity_ * kProtectedPercent / 100;
+}
+
+BlockCache::Shard &BlockCache::shardFor(const Key &key) {
+	return *shards_[KeyHash()(key) % shards_.size()];
+}
+
+bool BlockCache::get(const Key &key, uint64_t chunk_id, uint32_t version,
+		uint32_t max_age_ms, std::vector<uint8_t> &buffer) {
+	if (!enabled()) {
+		return false;
+	}
+	Shard &shard = shardFor(key);
+	std::unique_lock lock(shard.mutex);
+
+	auto it = shard.entries.find(key);
+	if (it == shard.entries.end()) {
+		misses_++;
+		return false;
+	}
+	Entry *entry = it->second.get();
+	if (entry->chunk_id != chunk_id || entry->version != version
+	    || (max_age_ms > 0
+	        && entry->timer.elapsed_ms() + entry->initial_age_ms >= max_age_ms)) {
+		erase(shard, entry);
+		misses_++;
+		return false;
+	}
+
+	if (entry->is_protected) {
+		shard.protected_.erase(shard.protected_.iterator_to(*entry));
+	} else {
+		shard.probation.erase(shard.probation.iterator_to(*entry));
+		entry->is_protected = true;
+	}
+	shard.protected_.push_front(*entry);
+	// keep the protected segment within its limit by demoting its coldest blocks
+	while (shard.protected_.size() > protected_capacity_) {
+		Entry &demoted = shard.protected_.back();
+		shard.protected_.pop_back();
+		demoted.is_protected = false;
+		shard.probation.push_front(demoted);
+	}
+
+	buffer.insert(buffer.end(), entry->data.begin(), entry->data.end());
+	hits_++;
+	return true;
+}
+
+void BlockCache::put(const Key &key, uint64_t chunk_id, uint32_t version,
+		const uint8_t *data, uint32_t age_ms) {
+	if (!enabled()) {
+		return;
+	}
+	Shard &shard = shardFor(key);
+	std::unique_lock lock(shard.mutex);
+
+	auto it = shard.entries.find(key);
+	if (it != shard.entries.end()) {
+		Entry *entry = it->second.get();
+		entry->chunk_id = chunk_id;
+		entry->version = version;
+		entry->timer.reset();
+		entry->initial_age_ms = age_ms;
+		std::copy(data, data + SFSBLOCKSIZE, entry->data.begin());
+		return;
+	}
+
+	auto entry = std::make_unique<Entry>();
+	entry->key = key;
+	entry->chunk_id = chunk_id;
+	entry->version = version;
+	entry->initial_age_ms = age_ms;
+	entry->data.assign(data, data + SFSBLOCKSIZE);
+	shard.probation.push_front(*entry);
+	shard.inodes[key.inode].push_back(*entry);
+	shard.entries.emplace(key, std::move(entry));
+	inserts_++;
+	blocks_++;
+
+	evictIfNeeded(shard);
+}
+
+void BlockCache::evictIfNeeded(Shard &shard) {
+	while (shard.entries.size() > block_capacity_) {
+		LruList &victims = shard.probation.empty() ? shard.protected_ : shard.probation;
+		assert(!victims.empty());
+		erase(shard, &victims.back());
+		evictions_++;
+	}
+}
+
+void BlockCache::erase(Shard &shard, Entry *entry) {
+	if (entry->is_protected) {
+		shard.protected_.erase(shard.protected_.iterator_to(*entry));
+	} else {
+		shard.probation.erase(shard.probation.iterator_to(*entry));
+	}
+	auto inode_it = shard.inodes.find(entry->key.inode);
+	assert(inode_it != shard.inodes.end());
+	inode_it->second.erase(inode_it->second.iterator_to(*entry));
+	if (inode_it->second.empty()) {
+		shard.inodes.erase(inode_it);
+	}
+	shard.entries.erase(entry->key);
+	blocks_--;
+}
+
+void BlockCache::invalidate(uint32_t inode) {
+	if (!enabled()) {
+		return;
+	}
+	for (auto &shard : shards_) {
+		std::unique_lock lock(shard->mutex);
+		auto inode_it = shard->inodes.find(inode);
+		while (inode_it != shard->inodes.end()) {
+			// erase() drops the inode list together with its last entry
+			erase(*shard, &inode_it->second.front());
+			inode_it = shard->inodes.find(inode);
+		}
+	}
+}
+
+void BlockCache::clearShard(Shard &shard) {
+	blocks_ -= shard.entries.size();
+	shard.probation.clear();
+	shard.protected_.clear();
+	for (auto &inode : shard.inodes) {
+		inode.second.clear();
+	}
+	shard.inodes.clear();
+	shard.entries.clear();
+}
+
+void BlockCache::clear() {
+	for (auto &shard : shards_) {
+		std::unique_lock lock(shard->mutex);
+		clearShard(*shard);
+	}
+}
+
+BlockCache::Stats BlockCache::stats() const {
+	Stats result;
+	result.hits = hits_;
+	result.misses = misses_;
+	result.inserts = inserts_;
+	result.evictions = evictions_;
+	result.blocks = blocks_;
+	return result;
+}
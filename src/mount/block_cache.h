@@ -0,0 +1,153 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/intrusive/list.hpp>
+
+#include "common/time_utils.h"
+
+/**
+ * Process-wide cache of chunk blocks shared by all open files of the mount.
+ *
+ * Blocks are identified by (inode, chunk index, block in chunk) and tagged with
+ * the id and version of the chunk they were read from, so a block read from an
+ * older version of a chunk is never returned. The cache is split into shards,
+ * each one managed as a segmented LRU: new blocks are admitted to a probation
+ * segment and only promoted to the protected segment when they are hit again.
+ * Eviction starts from the probation segment, so a single sequential scan of a
+ * large file cannot push out the blocks which are read repeatedly.
+ */
+class BlockCache {
+public:
+	struct Key {
+		uint32_t inode;
+		uint32_t index;  ///< chunk index in the file
+		uint32_t block;  ///< block index in the chunk
+
+		bool operator==(const Key &other) const = default;
+		auto operator<=>(const Key &other) const = default;
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key &key) const noexcept;
+	};
+
+	struct Stats {
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t inserts = 0;
+		uint64_t evictions = 0;
+		uint64_t blocks = 0;
+	};
+
+	static constexpr unsigned kDefaultShardCount = 16;
+	/// Percentage of each shard reserved for blocks which were hit at least once.
+	static constexpr unsigned kProtectedPercent = 80;
+
+	/// A cache with zero capacity is disabled and never stores anything.
+	explicit BlockCache(uint64_t capacity_bytes = 0,
+	                    unsigned shard_count = kDefaultShardCount);
+	~BlockCache();
+
+	BlockCache(const BlockCache &) = delete;
+	BlockCache &operator=(const BlockCache &) = delete;
+
+	/// Drops all blocks and changes the memory budget of the cache.
+	void reset(uint64_t capacity_bytes);
+
+	bool enabled() const {
+		return block_capacity_ > 0;
+	}
+
+	/**
+	 * Appends a cached block to the buffer.
+	 * Blocks tagged with a different chunk id or version, or older than max_age_ms
+	 * (if non-zero) are dropped and reported as missing.
+	 * \return true if the block was found
+	 */
+	bool get(const Key &key, uint64_t chunk_id, uint32_t version,
+	         uint32_t max_age_ms, std::vector<uint8_t> &buffer);
+
+	/**
+	 * Stores a full block (SFSBLOCKSIZE bytes starting at data).
+	 * \param age_ms how old the data already is, e.g. when it comes from the
+	 *        on-disk cache, so that it still expires on time
+	 */
+	void put(const Key &key, uint64_t chunk_id, uint32_t version,
+	         const uint8_t *data, uint32_t age_ms = 0);
+
+	/// Removes all blocks of the given inode.
+	void invalidate(uint32_t inode);
+
+	void clear();
+
+	Stats stats() const;
+
+private:
+	struct Entry {
+		Key key;
+		uint64_t chunk_id;
+		uint32_t version;
+		bool is_protected = false;
+		Timer timer;
+		uint32_t initial_age_ms = 0;  ///< age of the data when it was stored
+		std::vector<uint8_t> data;
+		boost::intrusive::list_member_hook<> lru_member_hook;
+		boost::intrusive::list_member_hook<> inode_member_hook;
+	};
+
+	typedef boost::intrusive::list<Entry,
+	        boost::intrusive::member_hook<Entry, boost::intrusive::list_member_hook<>,
+	        &Entry::lru_member_hook>> LruList;
+	typedef boost::intrusive::list<Entry,
+	        boost::intrusive::member_hook<Entry, boost::intrusive::list_member_hook<>,
+	        &Entry::inode_member_hook>> InodeList;
+
+	struct Shard {
+		std::mutex mutex;
+		std::unordered_map<Key, std::unique_ptr<Entry>, KeyHash> entries;
+		std::unordered_map<uint32_t, InodeList> inodes;
+		LruList probation;
+		LruList protected_;
+	};
+
+	Shard &shardFor(const Key &key);
+	void erase(Shard &shard, Entry *entry);
+	void evictIfNeeded(Shard &shard);
+	void clearShard(Shard &shard);
+
+	std::vector<std::unique_ptr<Shard>> shards_;
+	uint64_t block_capacity_;        ///< per shard
+	uint64_t protected_capacity_;    ///< per shard
+
+	std::atomic<uint64_t> hits_;
+	std::atomic<uint64_t> misses_;
+	std::atomic<uint64_t> inserts_;
+	std::atomic<uint64_t> evictions_;
+	std::atomic<uint64_t> blocks_;
+};
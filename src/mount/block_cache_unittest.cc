@@ -0,0 +1,123 @@
+/*
+   Copyright 2023 Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "mount/block_cache.h"
+
+#include <gtest/gtest.h>
+
+#include "protocol/SFSCommunication.h"
+
+static std::vector<uint8_t> block(uint8_t value) {
+	return std::vector<uint8_t>(SFSBLOCKSIZE, value);
+}
+
+static bool cached(BlockCache &cache, uint32_t inode, uint32_t blockNumber,
+		uint32_t version = 1) {
+	std::vector<uint8_t> buffer;
+	return cache.get({inode, 0, blockNumber}, 1, version, 0, buffer);
+}
+
+TEST(BlockCacheTests, Disabled) {
+	BlockCache cache(0);
+	EXPECT_FALSE(cache.enabled());
+	cache.put({1, 0, 0}, 1, 1, block(1).data());
+	EXPECT_FALSE(cached(cache, 1, 0));
+	EXPECT_EQ(0U, cache.stats().blocks);
+}
+
+TEST(BlockCacheTests, PutAndGet) {
+	BlockCache cache(16 * SFSBLOCKSIZE, 1);
+	cache.put({1, 0, 3}, 1, 1, block(7).data());
+
+	std::vector<uint8_t> buffer(10, 0);
+	ASSERT_TRUE(cache.get({1, 0, 3}, 1, 1, 0, buffer));
+	ASSERT_EQ(10U + SFSBLOCKSIZE, buffer.size());
+	EXPECT_EQ(7, buffer.back());
+
+	EXPECT_FALSE(cached(cache, 1, 4));
+	EXPECT_FALSE(cached(cache, 2, 3));
+
+	BlockCache::Stats stats = cache.stats();
+	EXPECT_EQ(1U, stats.hits);
+	EXPECT_EQ(2U, stats.misses);
+	EXPECT_EQ(1U, stats.inserts);
+	EXPECT_EQ(1U, stats.blocks);
+}
+
+TEST(BlockCacheTests, VersionMismatchDropsBlock) {
+	BlockCache cache(16 * SFSBLOCKSIZE, 1);
+	cache.put({1, 0, 0}, 1, 1, block(1).data());
+	EXPECT_FALSE(cached(cache, 1, 0, 2));
+	EXPECT_EQ(0U, cache.stats().blocks);
+	EXPECT_FALSE(cached(cache, 1, 0, 1));
+}
+
+TEST(BlockCacheTests, Invalidate) {
+	BlockCache cache(64 * SFSBLOCKSIZE);
+	for (uint32_t i = 0; i < 8; ++i) {
+		cache.put({1, 0, i}, 1, 1, block(1).data());
+		cache.put({2, 0, i}, 1, 1, block(2).data());
+	}
+	cache.invalidate(1);
+	EXPECT_EQ(8U, cache.stats().blocks);
+	for (uint32_t i = 0; i < 8; ++i) {
+		EXPECT_FALSE(cached(cache, 1, i));
+		EXPECT_TRUE(cached(cache, 2, i));
+	}
+}
+
+TEST(BlockCacheTests, CapacityIsRespected) {
+	BlockCache cache(10 * SFSBLOCKSIZE, 1);
+	for (uint32_t i = 0; i < 100; ++i) {
+		cache.put({1, 0, i}, 1, 1, block(1).data());
+	}
+	BlockCache::Stats stats = cache.stats();
+	EXPECT_EQ(10U, stats.blocks);
+	EXPECT_EQ(90U, stats.evictions);
+	// the most recently inserted blocks survive
+	EXPECT_TRUE(cached(cache, 1, 99));
+	EXPECT_FALSE(cached(cache, 1, 0));
+}
+
+TEST(BlockCacheTests, ScanDoesNotEvictHotBlocks) {
+	BlockCache cache(10 * SFSBLOCKSIZE, 1);
+	for (uint32_t i = 0; i < 4; ++i) {
+		cache.put({1, 0, i}, 1, 1, block(1).data());
+		ASSERT_TRUE(cached(cache, 1, i));
+	}
+	// a long scan of another file only cycles through the probation segment
+	for (uint32_t i = 0; i < 1000; ++i) {
+		cache.put({2, 0, i}, 1, 1, block(2).data());
+	}
+	for (uint32_t i = 0; i < 4; ++i) {
+		EXPECT_TRUE(cached(cache, 1, i));
+	}
+	EXPECT_EQ(10U, cache.stats().blocks);
+}
+
+TEST(BlockCacheTests, PromotedBlocksKeepTheirAge) {
+	BlockCache cache(10 * SFSBLOCKSIZE, 1);
+	// e.g. a block read from the on-disk cache, stored there a minute ago
+	cache.put({1, 0, 0}, 1, 1, block(1).data(), 60000);
+	cache.put({1, 0, 1}, 1, 1, block(1).data());
+
+	std::vector<uint8_t> buffer;
+	EXPECT_FALSE(cache.get({1, 0, 0}, 1, 1, 1000, buffer));
+	EXPECT_TRUE(cache.get({1, 0, 1}, 1, 1, 1000, buffer));
+}
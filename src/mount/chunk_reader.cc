@@ -28,13 +28,15 @@
 #include "common/time_utils.h"
 #include "mount/global_chunkserver_stats.h"
 
-ChunkReader::ChunkReader(ChunkConnector& connector, ReadChunkLocator& _locator, double bandwidth_overuse)
+ChunkReader::ChunkReader(ChunkConnector& connector, ReadChunkLocator& _locator, double bandwidth_overuse,
+		unsigned stripe)
 		: connector_(connector),
 		  locator_(&_locator),
 		  inode_(0),
 		  index_(0),
 		  planner_(bandwidth_overuse),
-		  chunkAlreadyRead(false) {
+		  chunkAlreadyRead(false),
+		  stripe_(stripe) {
 }
 
 void ChunkReader::prepareReadingChunk(uint32_t inode, uint32_t index, bool force_prepare) {
@@ -57,6 +59,8 @@ void ChunkReader::prepareReadingChunk(uint32_t inode, uint32_t index, bool force
 	chunk_type_locations_.clear();
 
 	ChunkReadPlanner::ScoreContainer best_scores;
+	flat_map<ChunkPartType, uint32_t> best_pending_reads;
+	flat_map<ChunkPartType, std::vector<ChunkTypeWithAddress>> best_copies;
 
 	available_parts_.clear();
 	for (const ChunkTypeWithAddress& chunk_type_with_address : location_->locations) {
@@ -66,20 +70,28 @@ void ChunkReader::prepareReadingChunk(uint32_t inode, uint32_t index, bool force
 			continue;
 		}
 
-		float score = globalChunkserverStats.getStatisticsFor(chunk_type_with_address.address).score();
-		if (chunk_type_locations_.count(type) == 0) {
+		auto statistics = globalChunkserverStats.getStatisticsFor(chunk_type_with_address.address);
+		float score = statistics.score();
+		uint32_t pending_reads = statistics.pendingReads();
+		if (best_copies.count(type) == 0) {
 			// first location of this type, choose it (for now)
-			chunk_type_locations_[type] = chunk_type_with_address;
 			best_scores[type] = score;
+			best_pending_reads[type] = pending_reads;
 			available_parts_.push_back(type);
-		} else {
-			// we already know other locations
-			if (score > best_scores[type]) {
-				// this location is better, switch to it
-				chunk_type_locations_[type] = chunk_type_with_address;
-				best_scores[type] = score;
-			}
+		} else if (score < best_scores[type]
+				|| (score == best_scores[type] && pending_reads > best_pending_reads[type])) {
+			continue;
+		} else if (score > best_scores[type] || pending_reads < best_pending_reads[type]) {
+			// this location is better, switch to it
+			best_scores[type] = score;
+			best_pending_reads[type] = pending_reads;
+			best_copies[type].clear();
 		}
+		best_copies[type].push_back(chunk_type_with_address);
+	}
+	// spread stripes over equally good copies, the n-th stripe takes the n-th copy
+	for (const auto &copies : best_copies) {
+		chunk_type_locations_[copies.first] = copies.second[stripe_ % copies.second.size()];
 	}
 	planner_.setScores(std::move(best_scores));
 }
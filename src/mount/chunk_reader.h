@@ -40,7 +40,13 @@
 
 class ChunkReader {
 public:
-	ChunkReader(ChunkConnector& connector, ReadChunkLocator& _locator, double bandwidth_overuse);
+	/**
+	 * \param stripe index of the stripe read by this reader. Readers of different stripes
+	 * prefer different copies of a chunk when several equally good copies are available,
+	 * so that stripes read concurrently are served by different chunkservers.
+	 */
+	ChunkReader(ChunkConnector& connector, ReadChunkLocator& _locator, double bandwidth_overuse,
+			unsigned stripe = 0);
 
 	/**
 	 * Uses a locator to locate the chunk and chooses chunkservers to read from.
@@ -71,6 +77,9 @@ public:
 	uint32_t version() const {
 		return location_->version;
 	}
+	uint64_t fileLength() const {
+		return location_->fileLength;
+	}
 
 	/// Counter for the .saunafds_tweaks file.
 	static std::atomic<uint64_t> preparations;
@@ -86,4 +95,5 @@ private:
 	ReadPlanExecutor::ChunkTypeLocations chunk_type_locations_;
 	std::vector<ChunkTypeWithAddress> crcErrors_;
 	bool chunkAlreadyRead;
+	unsigned stripe_;
 };
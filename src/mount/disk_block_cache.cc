@@ -0,0 +1,280 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "mount/disk_block_cache.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include "common/crc.h"
+#include "common/slogger.h"
+#include "protocol/SFSCommunication.h"
+
+static constexpr const char *kDataFileName = "/saunafs_blocks.data";
+static constexpr const char *kIndexFileName = "/saunafs_blocks.index";
+
+/// Records must outlive the process, so their time is taken from the wall clock
+static uint64_t wall_clock_ms() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+	        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+DiskBlockCache::DiskBlockCache()
+		: data_fd_(-1),
+		  index_fd_(-1),
+		  generation_(0),
+		  hits_(0),
+		  misses_(0),
+		  inserts_(0),
+		  evictions_(0) {
+}
+
+DiskBlockCache::~DiskBlockCache() {
+	close();
+}
+
+bool DiskBlockCache::open(const std::string &directory, uint64_t capacity_bytes) {
+	close();
+	uint64_t slot_count = capacity_bytes / SFSBLOCKSIZE;
+	if (directory.empty() || slot_count == 0) {
+		return true;
+	}
+
+	std::string index_path = directory + kIndexFileName;
+	std::string data_path = directory + kDataFileName;
+	index_fd_ = ::open(index_path.c_str(), O_RDWR | O_CREAT, 0600);
+	if (index_fd_ < 0) {
+		safs_pretty_errlog(LOG_WARNING, "disk read cache: can't open %s", index_path.c_str());
+		return false;
+	}
+	// the same directory must not be shared by two mounts
+	if (flock(index_fd_, LOCK_EX | LOCK_NB) < 0) {
+		safs_pretty_errlog(LOG_WARNING, "disk read cache: can't lock %s", index_path.c_str());
+		close();
+		return false;
+	}
+	data_fd_ = ::open(data_path.c_str(), O_RDWR | O_CREAT, 0600);
+	if (data_fd_ < 0) {
+		safs_pretty_errlog(LOG_WARNING, "disk read cache: can't open %s", data_path.c_str());
+		close();
+		return false;
+	}
+	if (ftruncate(index_fd_, slot_count * sizeof(IndexRecord)) < 0
+	    || ftruncate(data_fd_, slot_count * SFSBLOCKSIZE) < 0) {
+		safs_pretty_errlog(LOG_WARNING, "disk read cache: can't resize cache files in %s",
+		                   directory.c_str());
+		close();
+		return false;
+	}
+
+	std::unique_lock lock(mutex_);
+	slots_.resize(slot_count);
+	loadIndex();
+	safs_pretty_syslog(LOG_INFO, "disk read cache: loaded %zu of %zu blocks from %s",
+	                   entries_.size(), slots_.size(), directory.c_str());
+	return true;
+}
+
+void DiskBlockCache::loadIndex() {
+	std::vector<IndexRecord> records(slots_.size());
+	ssize_t size = records.size() * sizeof(IndexRecord);
+	if (pread(index_fd_, records.data(), size, 0) != size) {
+		records.assign(slots_.size(), IndexRecord());
+	}
+	for (uint32_t slot = 0; slot < records.size(); ++slot) {
+		const IndexRecord &record = records[slot];
+		Key key{record.inode, record.index, record.block};
+		if (record.magic != kRecordMagic || entries_.count(key) > 0) {
+			slots_[slot].record = IndexRecord();
+			free_slots_.push_back(slot);
+			continue;
+		}
+		slots_[slot].record = record;
+		slots_[slot].lru_position = lru_.insert(lru_.end(), slot);
+		entries_.emplace(key, slot);
+	}
+}
+
+void DiskBlockCache::close() {
+	std::unique_lock lock(mutex_);
+	if (data_fd_ >= 0) {
+		::close(data_fd_);
+		data_fd_ = -1;
+	}
+	if (index_fd_ >= 0) {
+		::close(index_fd_);
+		index_fd_ = -1;
+	}
+	slots_.clear();
+	free_slots_.clear();
+	lru_.clear();
+	entries_.clear();
+	generation_++;
+}
+
+bool DiskBlockCache::writeRecord(uint32_t slot, const IndexRecord &record) {
+	slots_[slot].record = record;
+	return pwrite(index_fd_, &record, sizeof(record), slot * sizeof(IndexRecord))
+	       == sizeof(record);
+}
+
+void DiskBlockCache::release(uint32_t slot) {
+	const IndexRecord &record = slots_[slot].record;
+	entries_.erase(Key{record.inode, record.index, record.block});
+	lru_.erase(slots_[slot].lru_position);
+	writeRecord(slot, IndexRecord());
+	free_slots_.push_back(slot);
+}
+
+bool DiskBlockCache::acquireSlot(uint32_t &slot) {
+	if (free_slots_.empty()) {
+		// all the slots may be taken by puts which are still writing their data
+		if (lru_.empty()) {
+			return false;
+		}
+		release(lru_.back());
+		evictions_++;
+	}
+	slot = free_slots_.back();
+	free_slots_.pop_back();
+	return true;
+}
+
+bool DiskBlockCache::get(const Key &key, uint64_t chunk_id, uint32_t version,
+		uint32_t max_age_ms, std::vector<uint8_t> &buffer, uint32_t *age_ms) {
+	std::unique_lock lock(mutex_);
+	if (!enabled()) {
+		return false;
+	}
+	auto it = entries_.find(key);
+	if (it == entries_.end()) {
+		misses_++;
+		return false;
+	}
+	uint32_t slot = it->second;
+	IndexRecord record = slots_[slot].record;
+	uint64_t now_ms = wall_clock_ms();
+	// a time in the future means that the clock went back, the age is unknown
+	bool expired = record.insert_time_ms > now_ms
+	               || (max_age_ms > 0 && now_ms - record.insert_time_ms >= max_age_ms);
+	if (record.chunk_id != chunk_id || record.version != version || expired) {
+		release(slot);
+		misses_++;
+		return false;
+	}
+	lru_.splice(lru_.begin(), lru_, slots_[slot].lru_position);
+	int fd = data_fd_;
+	uint64_t generation = generation_;
+	lock.unlock();
+
+	size_t initial_size = buffer.size();
+	buffer.resize(initial_size + SFSBLOCKSIZE);
+	uint8_t *data = buffer.data() + initial_size;
+	bool valid = pread(fd, data, SFSBLOCKSIZE, static_cast<off_t>(slot) * SFSBLOCKSIZE)
+	             == SFSBLOCKSIZE
+	             && mycrc32(0, data, SFSBLOCKSIZE) == record.crc;
+	if (valid) {
+		if (age_ms) {
+			*age_ms = now_ms - record.insert_time_ms;
+		}
+		hits_++;
+		return true;
+	}
+
+	// the slot was reused in the meantime or its data is damaged
+	buffer.resize(initial_size);
+	lock.lock();
+	if (generation_ == generation
+	    && memcmp(&slots_[slot].record, &record, sizeof(record)) == 0) {
+		release(slot);
+	}
+	misses_++;
+	return false;
+}
+
+void DiskBlockCache::put(const Key &key, uint64_t chunk_id, uint32_t version,
+		const uint8_t *data) {
+	std::unique_lock lock(mutex_);
+	if (!enabled()) {
+		return;
+	}
+	// the block was fetched again because the cached copy expired or changed
+	auto it = entries_.find(key);
+	if (it != entries_.end()) {
+		release(it->second);
+	}
+	// the slot belongs to nobody until its data is written
+	uint32_t slot;
+	if (!acquireSlot(slot)) {
+		return;
+	}
+	int fd = data_fd_;
+	uint64_t generation = generation_;
+	lock.unlock();
+
+	bool written = pwrite(fd, data, SFSBLOCKSIZE, static_cast<off_t>(slot) * SFSBLOCKSIZE)
+	               == SFSBLOCKSIZE;
+	uint32_t crc = mycrc32(0, data, SFSBLOCKSIZE);
+
+	lock.lock();
+	if (generation_ != generation) {
+		return;
+	}
+	if (!written || entries_.count(key) > 0) {
+		free_slots_.push_back(slot);
+		return;
+	}
+	IndexRecord record{kRecordMagic, key.inode, key.index, key.block, chunk_id, version, crc,
+	                   wall_clock_ms()};
+	if (!writeRecord(slot, record)) {
+		writeRecord(slot, IndexRecord());
+		free_slots_.push_back(slot);
+		return;
+	}
+	slots_[slot].lru_position = lru_.insert(lru_.begin(), slot);
+	entries_.emplace(key, slot);
+	inserts_++;
+}
+
+void DiskBlockCache::invalidate(uint32_t inode) {
+	std::unique_lock lock(mutex_);
+	if (!enabled()) {
+		return;
+	}
+	auto it = entries_.lower_bound(Key{inode, 0, 0});
+	while (it != entries_.end() && it->first.inode == inode) {
+		uint32_t slot = (it++)->second;
+		release(slot);
+	}
+}
+
+DiskBlockCache::Stats DiskBlockCache::stats() const {
+	Stats result;
+	result.hits = hits_;
+	result.misses = misses_;
+	result.inserts = inserts_;
+	result.evictions = evictions_;
+	std::unique_lock lock(mutex_);
+	result.blocks = entries_.size();
+	return result;
+}
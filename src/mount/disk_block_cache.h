@@ -0,0 +1,134 @@
+/*
+   Copyright 2023      Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "mount/block_cache.h"
+
+/**
+ * Persistent cache of chunk blocks kept on a local disk, used as a second tier
+ * below the in-memory BlockCache.
+ *
+ * The cache consists of two files in the cache directory: a data file divided
+ * into slots of SFSBLOCKSIZE bytes and an index file with one record per slot.
+ * A record describes the block stored in its slot together with the version of
+ * the chunk the block was read from and the CRC of the data. Data is always
+ * written before its record and the CRC is verified on every hit, so a record
+ * left behind by a crash or a concurrent slot reuse is simply treated as a miss.
+ * The index is loaded when the cache is opened, so cached blocks survive
+ * remounts; blocks of chunks which were modified in the meantime are dropped
+ * on the first lookup, when their chunk version no longer matches.
+ *
+ * Chunk versions do not change on ordinary overwrites, so each record also
+ * keeps the (wall clock) time the block was stored and blocks older than the
+ * cache expiration time are dropped as well, like in BlockCache.
+ */
+class DiskBlockCache {
+public:
+	typedef BlockCache::Key Key;
+	typedef BlockCache::Stats Stats;
+
+	DiskBlockCache();
+	~DiskBlockCache();
+
+	DiskBlockCache(const DiskBlockCache &) = delete;
+	DiskBlockCache &operator=(const DiskBlockCache &) = delete;
+
+	/**
+	 * Opens (or creates) the cache in the given directory and loads its index.
+	 * An empty path or zero capacity disables the cache.
+	 * \return false if the cache files could not be opened
+	 */
+	bool open(const std::string &directory, uint64_t capacity_bytes);
+	void close();
+
+	bool enabled() const {
+		return data_fd_ >= 0;
+	}
+
+	/**
+	 * Appends a cached block to the buffer.
+	 * Blocks with a different chunk id or version, older than max_age_ms (if
+	 * non-zero), or with damaged data, are dropped and reported as missing.
+	 * \param age_ms if not null, set to the age of the returned block
+	 */
+	bool get(const Key &key, uint64_t chunk_id, uint32_t version,
+	         uint32_t max_age_ms, std::vector<uint8_t> &buffer,
+	         uint32_t *age_ms = nullptr);
+
+	/// Stores a full block (SFSBLOCKSIZE bytes starting at data), replacing
+	/// the cached copy of the block, if any.
+	void put(const Key &key, uint64_t chunk_id, uint32_t version,
+	         const uint8_t *data);
+
+	/// Removes all blocks of the given inode.
+	void invalidate(uint32_t inode);
+
+	Stats stats() const;
+
+private:
+	struct IndexRecord {
+		uint32_t magic;
+		uint32_t inode;
+		uint32_t index;
+		uint32_t block;
+		uint64_t chunk_id;
+		uint32_t version;
+		uint32_t crc;
+		uint64_t insert_time_ms;  ///< milliseconds since the epoch
+	};
+	static_assert(sizeof(IndexRecord) == 40, "IndexRecord must have no padding");
+
+	static constexpr uint32_t kRecordMagic = 0x53464444;  // "SFDD"
+
+	struct Slot {
+		IndexRecord record;
+		std::list<uint32_t>::iterator lru_position;
+	};
+
+	void loadIndex();
+	bool writeRecord(uint32_t slot, const IndexRecord &record);
+	void release(uint32_t slot);
+	bool acquireSlot(uint32_t &slot);
+
+	mutable std::mutex mutex_;
+	int data_fd_;
+	int index_fd_;
+	std::vector<Slot> slots_;
+	std::vector<uint32_t> free_slots_;
+	std::list<uint32_t> lru_;  ///< slots in use, most recently used first
+	std::map<Key, uint32_t> entries_;  ///< ordered, so blocks of an inode are adjacent
+	/// Changed by close(), so that reads and writes done without the lock do not touch
+	/// slots of a cache which was closed or reopened in the meantime
+	uint64_t generation_;
+
+	std::atomic<uint64_t> hits_;
+	std::atomic<uint64_t> misses_;
+	std::atomic<uint64_t> inserts_;
+	std::atomic<uint64_t> evictions_;
+};
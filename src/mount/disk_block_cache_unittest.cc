@@ -0,0 +1,198 @@
+/*
+   Copyright 2023 Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "mount/disk_block_cache.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+#include <gtest/gtest.h>
+
+#include "protocol/SFSCommunication.h"
+
+class DiskBlockCacheTests : public testing::Test {
+protected:
+	void SetUp() override {
+		char path[] = "/tmp/disk_block_cache_XXXXXX";
+		ASSERT_NE(nullptr, mkdtemp(path));
+		directory_ = path;
+	}
+
+	void TearDown() override {
+		std::error_code ec;
+		std::filesystem::remove_all(directory_, ec);
+	}
+
+	static std::vector<uint8_t> block(uint8_t value) {
+		return std::vector<uint8_t>(SFSBLOCKSIZE, value);
+	}
+
+	static bool cached(DiskBlockCache &cache, uint32_t inode, uint32_t blockNumber,
+			uint32_t version = 1) {
+		std::vector<uint8_t> buffer;
+		return cache.get({inode, 0, blockNumber}, 1, version, 0, buffer);
+	}
+
+	std::string directory_;
+};
+
+TEST_F(DiskBlockCacheTests, Disabled) {
+	DiskBlockCache cache;
+	ASSERT_TRUE(cache.open("", 16 * SFSBLOCKSIZE));
+	EXPECT_FALSE(cache.enabled());
+	cache.put({1, 0, 0}, 1, 1, block(1).data());
+	EXPECT_FALSE(cached(cache, 1, 0));
+}
+
+TEST_F(DiskBlockCacheTests, PutAndGet) {
+	DiskBlockCache cache;
+	ASSERT_TRUE(cache.open(directory_, 16 * SFSBLOCKSIZE));
+	cache.put({1, 0, 3}, 1, 1, block(7).data());
+
+	std::vector<uint8_t> buffer(10, 0);
+	ASSERT_TRUE(cache.get({1, 0, 3}, 1, 1, 0, buffer));
+	ASSERT_EQ(10U + SFSBLOCKSIZE, buffer.size());
+	EXPECT_EQ(7, buffer.back());
+
+	EXPECT_FALSE(cached(cache, 1, 4));
+	EXPECT_FALSE(cached(cache, 1, 3, 2));
+	EXPECT_FALSE(cached(cache, 1, 3, 1));
+}
+
+TEST_F(DiskBlockCacheTests, ExpiredBlocksAreDropped) {
+	DiskBlockCache cache;
+	ASSERT_TRUE(cache.open(directory_, 16 * SFSBLOCKSIZE));
+	cache.put({1, 0, 0}, 1, 1, block(1).data());
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+	std::vector<uint8_t> buffer;
+	uint32_t age_ms = 0;
+	ASSERT_TRUE(cache.get({1, 0, 0}, 1, 1, 10000, buffer, &age_ms));
+	EXPECT_GE(age_ms, 20U);
+	EXPECT_FALSE(cache.get({1, 0, 0}, 1, 1, 10, buffer));
+	EXPECT_EQ(0U, cache.stats().blocks);
+}
+
+TEST_F(DiskBlockCacheTests, PutReplacesCachedBlock) {
+	DiskBlockCache cache;
+	ASSERT_TRUE(cache.open(directory_, 16 * SFSBLOCKSIZE));
+	// an overwrite by another client does not change the chunk version
+	cache.put({1, 0, 0}, 1, 1, block(1).data());
+	cache.put({1, 0, 0}, 1, 1, block(2).data());
+
+	std::vector<uint8_t> buffer;
+	ASSERT_TRUE(cache.get({1, 0, 0}, 1, 1, 0, buffer));
+	EXPECT_EQ(2, buffer.front());
+	EXPECT_EQ(1U, cache.stats().blocks);
+}
+
+TEST_F(DiskBlockCacheTests, SurvivesReopen) {
+	{
+		DiskBlockCache cache;
+		ASSERT_TRUE(cache.open(directory_, 16 * SFSBLOCKSIZE));
+		for (uint32_t i = 0; i < 8; ++i) {
+			cache.put({1, 0, i}, 1, 1, block(i).data());
+		}
+	}
+	DiskBlockCache cache;
+	ASSERT_TRUE(cache.open(directory_, 16 * SFSBLOCKSIZE));
+	EXPECT_EQ(8U, cache.stats().blocks);
+	for (uint32_t i = 0; i < 8; ++i) {
+		std::vector<uint8_t> buffer;
+		ASSERT_TRUE(cache.get({1, 0, i}, 1, 1, 0, buffer));
+		EXPECT_EQ(i, buffer.front());
+	}
+}
+
+TEST_F(DiskBlockCacheTests, DamagedDataIsDropped) {
+	DiskBlockCache cache;
+	ASSERT_TRUE(cache.open(directory_, SFSBLOCKSIZE));
+	cache.put({1, 0, 0}, 1, 1, block(1).data());
+
+	int fd = open((directory_ + "/saunafs_blocks.data").c_str(), O_WRONLY);
+	ASSERT_GE(fd, 0);
+	uint8_t garbage = 2;
+	ASSERT_EQ(1, pwrite(fd, &garbage, 1, 100));
+	close(fd);
+
+	EXPECT_FALSE(cached(cache, 1, 0));
+	EXPECT_EQ(0U, cache.stats().blocks);
+}
+
+TEST_F(DiskBlockCacheTests, DirectoryIsLocked) {
+	DiskBlockCache cache;
+	ASSERT_TRUE(cache.open(directory_, 16 * SFSBLOCKSIZE));
+	DiskBlockCache other;
+	EXPECT_FALSE(other.open(directory_, 16 * SFSBLOCKSIZE));
+	EXPECT_FALSE(other.enabled());
+}
+
+TEST_F(DiskBlockCacheTests, EvictionAndInvalidation) {
+	DiskBlockCache cache;
+	ASSERT_TRUE(cache.open(directory_, 8 * SFSBLOCKSIZE));
+	for (uint32_t i = 0; i < 4; ++i) {
+		cache.put({1, 0, i}, 1, 1, block(1).data());
+	}
+	for (uint32_t i = 0; i < 8; ++i) {
+		cache.put({2, 0, i}, 1, 1, block(2).data());
+	}
+	DiskBlockCache::Stats stats = cache.stats();
+	EXPECT_EQ(8U, stats.blocks);
+	EXPECT_EQ(4U, stats.evictions);
+	EXPECT_FALSE(cached(cache, 1, 0));
+
+	cache.invalidate(2);
+	EXPECT_EQ(0U, cache.stats().blocks);
+	EXPECT_FALSE(cached(cache, 2, 7));
+}
+
+TEST_F(DiskBlockCacheTests, MorePutsInFlightThanSlots) {
+	DiskBlockCache cache;
+	ASSERT_TRUE(cache.open(directory_, 2 * SFSBLOCKSIZE));
+
+	std::vector<std::thread> threads;
+	for (uint32_t thread = 0; thread < 16; ++thread) {
+		threads.emplace_back([&cache, thread]() {
+			std::vector<uint8_t> data = block(thread);
+			for (uint32_t i = 0; i < 64; ++i) {
+				cache.put({thread, 0, i}, 1, 1, data.data());
+			}
+		});
+	}
+	// reopening while puts are writing must not let them use the new slots
+	for (int i = 0; i < 8; ++i) {
+		ASSERT_TRUE(cache.open(directory_, 2 * SFSBLOCKSIZE));
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+
+	EXPECT_LE(cache.stats().blocks, 2U);
+	for (uint32_t thread = 0; thread < 16; ++thread) {
+		for (uint32_t i = 0; i < 64; ++i) {
+			std::vector<uint8_t> buffer;
+			if (cache.get({thread, 0, i}, 1, 1, 0, buffer)) {
+				EXPECT_EQ(block(thread), buffer);
+			}
+		}
+	}
+}
@@ -231,7 +231,13 @@ static int mainloop(struct fuse_args *args, struct fuse_cmdline_opts *fuse_opts,
 	params.readahead_max_window_size_kB = gMountOptions.readaheadmaxwindowsize;
 	params.read_workers = gMountOptions.readworkers;
 	params.max_readahead_requests = gMountOptions.maxreadaheadrequests;
+	params.read_stripe_workers = gMountOptions.readstripeworkers;
+	params.read_stripe_size_kB = gMountOptions.readstripesize;
+	params.prewarmed_connections = gMountOptions.prewarmedconnections;
 	params.prefetch_xor_stripes = gMountOptions.prefetchxorstripes;
+	params.read_cache_size = gMountOptions.readcachesize;
+	params.disk_cache_path = gMountOptions.diskcachepath ? gMountOptions.diskcachepath : "";
+	params.disk_cache_size = gMountOptions.diskcachesize;
 	params.bandwidth_overuse = gMountOptions.bandwidthoveruse;
 	params.write_cache_size = gMountOptions.writecachesize;
 	params.write_workers = gMountOptions.writeworkers;
@@ -710,6 +716,8 @@ int main(int argc, char *argv[]) try {
 	free(gMountOptions.subfolder);
 	if (gMountOptions.iolimits)
 		free(gMountOptions.iolimits);
+	if (gMountOptions.diskcachepath)
+		free(gMountOptions.diskcachepath);
 	if (gDefaultMountpoint && gDefaultMountpoint != fuse_opts.mountpoint)
 		free(gDefaultMountpoint);
 	free(fuse_opts.mountpoint);
@@ -84,7 +84,13 @@ struct fuse_opt gSfsOptsStage2[] = {
 	SFS_OPT("readaheadmaxwindowsize=%d", readaheadmaxwindowsize, 4096),
 	SFS_OPT("readworkers=%d", readworkers, 1),
 	SFS_OPT("maxreadaheadrequests=%d", maxreadaheadrequests, 0),
+	SFS_OPT("readstripeworkers=%u", readstripeworkers, 0),
+	SFS_OPT("readstripesize=%u", readstripesize, 0),
+	SFS_OPT("sfsprewarmedconnections=%u", prewarmedconnections, 0),
 	SFS_OPT("sfsprefetchxorstripes", prefetchxorstripes, 1),
+	SFS_OPT("sfsreadcachesize=%u", readcachesize, 0),
+	SFS_OPT("sfsdiskcachepath=%s", diskcachepath, 0),
+	SFS_OPT("sfsdiskcachesize=%u", diskcachesize, 0),
 	SFS_OPT("sfschunkserverwriteto=%d", chunkserverwriteto, 0),
 	SFS_OPT("symlinkcachetimeout=%d", symlinkcachetimeout, 3600),
 	SFS_OPT("bandwidthoveruse=%lf", bandwidthoveruse, 1),
@@ -183,8 +189,21 @@ printf(
 "    -o readworkers=N            define number of read workers (default: %u)\n"
 "    -o maxreadaheadrequests=N   define number of readahead requests per inode "
 				"(default: %u)\n"
+"    -o readstripeworkers=N      define number of threads reading stripes of a "
+				"single large read concurrently (1 disables "
+				"striping) (default: %u)\n"
+"    -o readstripesize=KB        define size of a stripe of a large read in "
+				"kibibytes (default: %u)\n"
+"    -o sfsprewarmedconnections=N  define number of idle connections kept open "
+				"to each chunkserver in use (default: %u)\n"
 "    -o sfsprefetchxorstripes    prefetch full xor stripe on every first read "
 				"of a xor chunk\n"
+"    -o sfsreadcachesize=N       define size of read cache shared by all open "
+				"files in MiB (0 disables it) (default: %u)\n"
+"    -o sfsdiskcachepath=PATH    define directory for the persistent on-disk "
+				"read cache (default: NOT DEFINED - disabled)\n"
+"    -o sfsdiskcachesize=N       define size of the on-disk read cache in MiB "
+				"(default: %u)\n"
 "    -o sfschunkserverwriteto=MSEC  set chunkserver response timeout during "
 				"write operation in milliseconds (default: %u)\n"
 "    -o sfsnice=N                on startup sfsmount tries to change his "
@@ -242,6 +261,11 @@ printf(
 		SaunaClient::FsInitParams::kDefaultReadaheadMaxWindowSize,
 		SaunaClient::FsInitParams::kDefaultReadWorkers,
 		SaunaClient::FsInitParams::kDefaultMaxReadaheadRequests,
+		SaunaClient::FsInitParams::kDefaultReadStripeWorkers,
+		SaunaClient::FsInitParams::kDefaultReadStripeSize,
+		SaunaClient::FsInitParams::kDefaultPrewarmedConnections,
+		SaunaClient::FsInitParams::kDefaultReadCacheSize,
+		SaunaClient::FsInitParams::kDefaultDiskCacheSize,
 		SaunaClient::FsInitParams::kDefaultChunkserverWriteTo,
 		SaunaClient::FsInitParams::kDefaultWriteCacheSize,
 		SaunaClient::FsInitParams::kDefaultAclCacheSize,
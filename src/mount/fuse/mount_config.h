@@ -108,7 +108,13 @@ struct sfsopts_ {
 	int readaheadmaxwindowsize;
 	unsigned readworkers;
 	unsigned maxreadaheadrequests;
+	unsigned readstripeworkers;
+	unsigned readstripesize;
+	unsigned prewarmedconnections;
 	int prefetchxorstripes;
+	unsigned readcachesize;
+	char *diskcachepath;
+	unsigned diskcachesize;
 	unsigned symlinkcachetimeout;
 	double bandwidthoveruse;
 	int nonemptymount;
@@ -162,7 +168,13 @@ struct sfsopts_ {
 		readaheadmaxwindowsize(SaunaClient::FsInitParams::kDefaultReadaheadMaxWindowSize),
 		readworkers(SaunaClient::FsInitParams::kDefaultReadWorkers),
 		maxreadaheadrequests(SaunaClient::FsInitParams::kDefaultMaxReadaheadRequests),
+		readstripeworkers(SaunaClient::FsInitParams::kDefaultReadStripeWorkers),
+		readstripesize(SaunaClient::FsInitParams::kDefaultReadStripeSize),
+		prewarmedconnections(SaunaClient::FsInitParams::kDefaultPrewarmedConnections),
 		prefetchxorstripes(SaunaClient::FsInitParams::kDefaultPrefetchXorStripes),
+		readcachesize(SaunaClient::FsInitParams::kDefaultReadCacheSize),
+		diskcachepath(NULL),
+		diskcachesize(SaunaClient::FsInitParams::kDefaultDiskCacheSize),
 		symlinkcachetimeout(SaunaClient::FsInitParams::kDefaultSymlinkCacheTimeout),
 		bandwidthoveruse(SaunaClient::FsInitParams::kDefaultBandwidthOveruse),
 		nonemptymount(SaunaClient::FsInitParams::kDefaultNonEmptyMounts)
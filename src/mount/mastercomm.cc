@@ -1989,6 +1989,47 @@ uint8_t fs_opencheck(uint32_t inode, uint32_t uid, uint32_t gid, uint8_t flags,
 	return ret;
 }
 
+uint8_t fs_batch(uint32_t uid, uint32_t gid, const std::vector<FuseBatchOperation> &operations,
+		std::vector<FuseBatchResult> &results) {
+	threc* rec = fs_get_my_threc();
+	if (masterversion < kFuseBatchVersion) {
+		return SAUNAFS_ERROR_ENOTSUP;
+	}
+	auto message = cltoma::fuseBatch::build(rec->packetId, uid, gid, operations);
+	if (!fs_saucreatepacket(rec, message)) {
+		return SAUNAFS_ERROR_IO;
+	}
+	if (!fs_sausendandreceive(rec, SAU_MATOCL_FUSE_BATCH, message)) {
+		return SAUNAFS_ERROR_IO;
+	}
+	try {
+		uint32_t messageId;
+		matocl::fuseBatch::deserialize(message, messageId, results);
+		if (results.empty() || results.size() > operations.size()) {
+			fs_got_inconsistent("SAU_MATOCL_FUSE_BATCH", message.size(),
+					"wrong number of results " + std::to_string(results.size()));
+			return SAUNAFS_ERROR_IO;
+		}
+		for (size_t i = 0; i + 1 < results.size(); ++i) {
+			if (results[i].status != SAUNAFS_STATUS_OK) {
+				fs_got_inconsistent("SAU_MATOCL_FUSE_BATCH", message.size(),
+						"operation failed in the middle of a batch");
+				return SAUNAFS_ERROR_IO;
+			}
+		}
+		for (size_t i = 0; i < results.size(); ++i) {
+			if (results[i].status == SAUNAFS_STATUS_OK
+					&& operations[i].type == FuseBatchOperation::kOpen) {
+				fs_inc_acnt(results[i].inode);
+			}
+		}
+		return results.back().status;
+	} catch (Exception& ex) {
+		fs_got_inconsistent("SAU_MATOCL_FUSE_BATCH", message.size(), ex.what());
+		return SAUNAFS_ERROR_IO;
+	}
+}
+
 uint8_t fs_update_credentials(uint32_t key, const GroupCache::Groups &gids) {
 	threc* rec = fs_get_my_threc();
 	std::vector<uint8_t> message;
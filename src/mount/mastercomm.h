@@ -34,6 +34,7 @@
 #include "protocol/packet.h"
 #include "protocol/lock_info.h"
 #include "protocol/directory_entry.h"
+#include "protocol/fuse_batch.h"
 #include "protocol/named_inode_entry.h"
 
 void fs_getmasterlocation(uint8_t loc[14]);
@@ -63,6 +64,9 @@ uint8_t fs_getdir_plus(uint32_t inode,uint32_t uid,uint32_t gid,uint8_t addtocac
 uint8_t fs_getdir(uint32_t inode, uint32_t uid, uint32_t gid, uint64_t first_entry, uint64_t max_entries, std::vector<DirectoryEntry> &dir_entries);
 
 uint8_t fs_opencheck(uint32_t inode, uint32_t uid, uint32_t gid, uint8_t flags, Attributes &attr);
+// Returns the status of the last executed operation (the master stops at the first failure)
+uint8_t fs_batch(uint32_t uid, uint32_t gid, const std::vector<FuseBatchOperation> &operations,
+		std::vector<FuseBatchResult> &results);
 uint8_t fs_update_credentials(uint32_t key, const GroupCache::Groups &gids);
 void fs_release(uint32_t inode);
 
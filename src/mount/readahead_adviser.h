@@ -41,12 +41,39 @@ public:
 		uint32_t request_size;
 	};
 
+	/*! Single stream of requests issued against the same file handle.
+	 *
+	 * A stream is either sequential (each request starts where the previous
+	 * one ended) or strided (each request starts a constant distance after
+	 * the previous one, skipping some data in between).
+	 */
+	struct Stream {
+		uint64_t last_offset;
+		uint32_t last_size;
+		int64_t stride;           ///< confirmed stride, 0 if not strided
+		int64_t candidate_stride; ///< stride awaiting confirmation
+		uint64_t last_use;        ///< value of feed counter at last match
+		bool continued;           ///< matched by a request after its start
+
+		uint64_t nextSequentialOffset() const {
+			return last_offset + last_size;
+		}
+	};
+
 	static constexpr int kOppositeRequestThreshold = 4;
+	static constexpr unsigned kMaxStreams = 8;
+	/// Streams not matched by this many requests are forgotten
+	static constexpr uint64_t kStreamIdleRequests = 4 * kMaxStreams;
 
 	ReadaheadAdviser(uint32_t timeout_ms, uint32_t window_size_limit =
 	    SaunaClient::FsInitParams::kDefaultReadaheadMaxWindowSize * 1024,
 	    int oppositeRequestThreshold = kOppositeRequestThreshold) :
-		current_offset_(),
+		streams_(),
+		stream_count_(1),
+		feed_counter_(),
+		last_stride_(),
+		previous_offset_(),
+		previous_end_offset_(),
 		window_(kInitWindowSize),
 		random_candidates_(),
 		oppositeRequestThreshold_(oppositeRequestThreshold),
@@ -65,16 +92,20 @@ public:
 	 */
 	void feed(uint64_t offset, uint32_t size, bool &is_sequential) {
 		addToHistory(size);
-		is_sequential = difference(offset, current_offset_) <= kErrorThreshold;
+		bool is_strided = false;
+		is_sequential = classify(offset, size, is_strided);
 		updateShouldUseReadahead(is_sequential);
-		current_offset_ = offset + size;
 
 		if (timeout_ms_ == 0) {
 			window_ = 0;
 			return;
 		}
 
-		if (is_sequential) {
+		if (is_strided) {
+			// Window describes contiguous readahead, which is useless for
+			// strided streams -- they are prefetched request by request.
+			random_candidates_ = 0;
+		} else if (is_sequential) {
 			random_candidates_ = 0;
 			expand();
 		} else {
@@ -103,6 +134,30 @@ public:
 		       * kBytesInOneKiB;
 	}
 
+	/*!
+	 * \brief Stride of the stream matched by the last request.
+	 * \return distance between starts of consecutive requests of the stream,
+	 * or 0 if the last request was sequential or random
+	 */
+	int64_t lastStride() const {
+		return last_stride_;
+	}
+
+	/*!
+	 * \brief Number of streams currently read from this file handle.
+	 *
+	 * Only streams continued by some request count, so random requests, each
+	 * starting a stream of its own, do not multiply the readahead.
+	 * \return number of such streams, at least 1
+	 */
+	unsigned streamCount() const {
+		unsigned count = 0;
+		for (unsigned i = 0; i < stream_count_; ++i) {
+			count += streams_[i].continued ? 1 : 0;
+		}
+		return std::max(count, 1U);
+	}
+
 	/*!
 	 * \brief Count suggested readahead window size.
 	 * \return suggested readahead window size
@@ -149,6 +204,130 @@ private:
 		return x > y ? x - y : y - x;
 	}
 
+	/*!
+	 * \brief Calculates the absolute difference between two ```int64_t``` values.
+	 */
+	static uint64_t difference(int64_t x, int64_t y) {
+		return x > y ? x - y : y - x;
+	}
+
+	/*!
+	 * \brief Match request against tracked streams and update them.
+	 *
+	 * The request is sequential if it continues any tracked stream and
+	 * strided if it is the next step of a stream with a confirmed stride.
+	 * Requests starting inside data read by the previous request are always
+	 * random.
+	 * Unmatched requests start a new stream (replacing the least recently used
+	 * one if needed) with a candidate stride equal to the distance from the
+	 * nearest tracked stream. The stride gets confirmed when the next request
+	 * jumps by the same distance again.
+	 *
+	 * \param offset offset of read operation
+	 * \param size size of read operation
+	 * \param is_strided set to true if the request matched a strided stream
+	 * \return true if the request matched any stream
+	 */
+	bool classify(uint64_t offset, uint32_t size, bool &is_strided) {
+		feed_counter_++;
+		last_stride_ = 0;
+		expireStreams();
+
+		// Rereading data which was just read is neither sequential nor strided
+		bool is_overlapping = offset >= previous_offset_ &&
+		                      offset + kErrorThreshold < previous_end_offset_;
+		previous_offset_ = offset;
+		previous_end_offset_ = offset + size;
+
+		for (unsigned i = 0; i < stream_count_ && !is_overlapping; ++i) {
+			Stream &stream = streams_[i];
+			if (difference(offset, stream.nextSequentialOffset()) <= kErrorThreshold) {
+				stream.stride = 0;
+				stream.candidate_stride = 0;
+				stream.continued = true;
+				touch(stream, offset, size);
+				return true;
+			}
+		}
+
+		for (unsigned i = 0; i < stream_count_ && !is_overlapping; ++i) {
+			Stream &stream = streams_[i];
+			int64_t delta = offset - stream.last_offset;
+			int64_t expected = stream.stride != 0 ? stream.stride : stream.candidate_stride;
+			if (expected == 0 || difference(delta, expected) > kErrorThreshold ||
+			    !skipsData(delta, stream.last_size)) {
+				continue;
+			}
+			stream.stride = delta;
+			stream.candidate_stride = 0;
+			stream.continued = true;
+			touch(stream, offset, size);
+			last_stride_ = delta;
+			is_strided = true;
+			return true;
+		}
+
+		int64_t candidate_stride = 0;
+		for (unsigned i = 0; i < stream_count_ && !is_overlapping; ++i) {
+			int64_t delta = offset - streams_[i].last_offset;
+			if (skipsData(delta, streams_[i].last_size) &&
+			    (candidate_stride == 0 ||
+			     difference(delta, int64_t{0}) < difference(candidate_stride, int64_t{0}))) {
+				candidate_stride = delta;
+			}
+		}
+
+		Stream &stream = allocateStream();
+		stream.stride = 0;
+		stream.candidate_stride = candidate_stride;
+		stream.continued = false;
+		touch(stream, offset, size);
+		return false;
+	}
+
+	/*!
+	 * \brief Check if jumping by ```delta``` after a request of ```size``` bytes
+	 * skips enough data to be considered a stride rather than a sequential
+	 * continuation or an overlapping reread.
+	 */
+	static bool skipsData(int64_t delta, uint32_t size) {
+		// Keep a gap of at least two blocks, so block-aligned prefetches of
+		// consecutive steps never overlap.
+		return difference(delta, int64_t{0}) > static_cast<uint64_t>(size) + 2 * kErrorThreshold;
+	}
+
+	void touch(Stream &stream, uint64_t offset, uint32_t size) {
+		stream.last_offset = offset;
+		stream.last_size = size;
+		stream.last_use = feed_counter_;
+	}
+
+	/*!
+	 * \brief Forget the streams which were not matched for a while.
+	 */
+	void expireStreams() {
+		unsigned kept = 0;
+		for (unsigned i = 0; i < stream_count_; ++i) {
+			if (feed_counter_ - streams_[i].last_use <= kStreamIdleRequests) {
+				streams_[kept++] = streams_[i];
+			}
+		}
+		stream_count_ = kept;
+	}
+
+	Stream &allocateStream() {
+		if (stream_count_ < kMaxStreams) {
+			return streams_[stream_count_++];
+		}
+		Stream *victim = &streams_[0];
+		for (unsigned i = 1; i < stream_count_; ++i) {
+			if (streams_[i].last_use < victim->last_use) {
+				victim = &streams_[i];
+			}
+		}
+		return *victim;
+	}
+
 	/*!
 	 * \brief Convert from ms to ns.
 	 */
@@ -246,7 +425,14 @@ private:
 	static_assert(kHistoryCapacity >= (int)kHistoryValidityThreshold,
 			"History validity threshold must not be greater than history capacity");
 
-	uint64_t current_offset_;
+	// The first stream starts at the beginning of the file, so reading a file
+	// from its start is sequential right away.
+	std::array<Stream, kMaxStreams> streams_;
+	unsigned stream_count_;
+	uint64_t feed_counter_;
+	int64_t last_stride_;
+	uint64_t previous_offset_;
+	uint64_t previous_end_offset_;
 	unsigned window_;
 	int random_candidates_;
 
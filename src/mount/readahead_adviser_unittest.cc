@@ -21,6 +21,7 @@
 #include "common/platform.h"
 
 #include <gtest/gtest.h>
+#include <array>
 #include <random>
 
 #include "mount/readahead_adviser.h"
@@ -168,3 +169,145 @@ TEST(ReadaheadTests, SwitchReadaheadSuggestion) {
 		ASSERT_FALSE(readAdviser.shouldUseReadahead());
 	}
 }
+
+TEST(ReadaheadTests, ReadInterleavedSequentialStreams) {
+	ReadaheadAdviser readAdviser(kOneSecondInMs);
+
+	constexpr int kStreams = 4;
+	constexpr int kIterations = 32;
+	constexpr uint64_t kStreamDistance = 64 * kOffsetStep;
+	// Irregular distances between streams, so starting them is not strided
+	constexpr std::array<uint64_t, kStreams> kStreamStarts{0, 7, 3, 12};
+
+	for (int i = 0; i < kIterations; ++i) {
+		for (int stream = 0; stream < kStreams; ++stream) {
+			bool isSequential = false;
+			readAdviser.feed(
+			    kStreamStarts[stream] * kStreamDistance + i * kOffsetStep,
+			    kOffsetStep, isSequential);
+			// Only the first request of every stream looks random, except for
+			// the one reading from the beginning of the file
+			ASSERT_EQ(isSequential, i != 0 || kStreamStarts[stream] == 0);
+			ASSERT_EQ(readAdviser.lastStride(), 0);
+		}
+	}
+
+	ASSERT_TRUE(readAdviser.shouldUseReadahead());
+	ASSERT_EQ(readAdviser.streamCount(), (unsigned)kStreams);
+}
+
+TEST(ReadaheadTests, IdleStreamsExpire) {
+	ReadaheadAdviser readAdviser(kOneSecondInMs);
+
+	constexpr int kStreams = 4;
+	constexpr uint64_t kStreamDistance = 64 * kOffsetStep;
+	constexpr std::array<uint64_t, kStreams> kStreamStarts{0, 7, 3, 12};
+
+	for (int i = 0; i < 2; ++i) {
+		for (int stream = 0; stream < kStreams; ++stream) {
+			readAdviser.feed(
+			    kStreamStarts[stream] * kStreamDistance + i * kOffsetStep,
+			    kOffsetStep);
+		}
+	}
+	ASSERT_EQ(readAdviser.streamCount(), (unsigned)kStreams);
+
+	// Only the first stream goes on, the others are forgotten after a while
+	for (uint64_t i = 2; i <= 2 + ReadaheadAdviser::kStreamIdleRequests; ++i) {
+		readAdviser.feed(i * kOffsetStep, kOffsetStep);
+	}
+	ASSERT_EQ(readAdviser.streamCount(), 1U);
+}
+
+TEST(ReadaheadTests, RandomRequestsAreNotStreams) {
+	ReadaheadAdviser readAdviser(kOneSecondInMs);
+
+	std::mt19937 generator{1234};
+	std::uniform_int_distribution<uint64_t> distribution{0, 1024};
+
+	for (int i = 0; i < 64; ++i) {
+		readAdviser.feed(distribution(generator) * kOffsetStep, SFSBLOCKSIZE);
+	}
+
+	// Otherwise the readahead of a random reader would be multiplied
+	ASSERT_LE(readAdviser.streamCount(), 2U);
+}
+
+TEST(ReadaheadTests, ReadStrided) {
+	ReadaheadAdviser readAdviser(kOneSecondInMs);
+
+	constexpr int kIterations = 32;
+	constexpr uint32_t kRequestSize = 4 * SFSBLOCKSIZE;
+	constexpr int64_t kStride = 16 * SFSBLOCKSIZE;
+
+	int lastWindow = readAdviser.window();
+
+	for (int i = 0; i < kIterations; ++i) {
+		bool isSequential = false;
+		readAdviser.feed(kOffsetStep + i * kStride, kRequestSize, isSequential);
+		// Two requests are needed to guess the stride, third one confirms it
+		ASSERT_EQ(isSequential, i >= 2);
+		ASSERT_EQ(readAdviser.lastStride(), i >= 2 ? kStride : 0);
+		// Strided reads should not enlarge the sequential readahead window
+		ASSERT_LE(readAdviser.window(), lastWindow);
+		lastWindow = readAdviser.window();
+	}
+
+	ASSERT_TRUE(readAdviser.shouldUseReadahead());
+}
+
+TEST(ReadaheadTests, ReadStridedBackwards) {
+	ReadaheadAdviser readAdviser(kOneSecondInMs);
+
+	constexpr int kIterations = 32;
+	constexpr uint32_t kRequestSize = 4 * SFSBLOCKSIZE;
+	constexpr int64_t kStride = 16 * SFSBLOCKSIZE;
+	constexpr uint64_t kStart = kIterations * kStride;
+
+	for (int i = 0; i < kIterations; ++i) {
+		readAdviser.feed(kStart - i * kStride, kRequestSize);
+		ASSERT_EQ(readAdviser.lastStride(), i >= 2 ? -kStride : 0);
+	}
+
+	ASSERT_TRUE(readAdviser.shouldUseReadahead());
+}
+
+TEST(ReadaheadTests, ReadStridedWithSequentialStream) {
+	ReadaheadAdviser readAdviser(kOneSecondInMs);
+
+	constexpr int kIterations = 32;
+	constexpr uint32_t kRequestSize = 4 * SFSBLOCKSIZE;
+	constexpr int64_t kStride = 16 * SFSBLOCKSIZE;
+	constexpr uint64_t kSequentialStart = 1024 * kStride;
+
+	for (int i = 0; i < kIterations; ++i) {
+		bool isSequential = false;
+		readAdviser.feed(i * kStride, kRequestSize, isSequential);
+		if (i >= 3) {
+			ASSERT_TRUE(isSequential);
+			ASSERT_EQ(readAdviser.lastStride(), kStride);
+		}
+
+		readAdviser.feed(kSequentialStart + i * kRequestSize, kRequestSize,
+		                 isSequential);
+		ASSERT_EQ(isSequential, i != 0);
+		ASSERT_EQ(readAdviser.lastStride(), 0);
+	}
+}
+
+TEST(ReadaheadTests, ReadRandomIsNotStrided) {
+	ReadaheadAdviser readAdviser(kOneSecondInMs);
+
+	std::mt19937 generator{1234};
+	std::uniform_int_distribution<uint64_t> distribution{0, 1024};
+	constexpr int kIterations = 256;
+	int stridedRequests = 0;
+
+	for (int i = 0; i < kIterations; ++i) {
+		readAdviser.feed(distribution(generator) * kOffsetStep, SFSBLOCKSIZE);
+		stridedRequests += readAdviser.lastStride() != 0;
+	}
+
+	ASSERT_LE(stridedRequests, kIterations / 16);
+	ASSERT_FALSE(readAdviser.shouldUseReadahead());
+}
@@ -21,6 +21,7 @@
 #include "common/platform.h"
 #include "mount/readdata.h"
 
+#include <algorithm>
 #include <cerrno>
 #include <cinttypes>
 #include <condition_variable>
@@ -28,11 +29,14 @@
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <deque>
 #include <filesystem>
+#include <functional>
 #include <limits>
 #include <map>
+#include <memory>
 #include <mutex>
-#include <thread>
+#include <optional>
 
 #include "common/connection_pool.h"
 #include "common/datapack.h"
@@ -42,11 +46,15 @@
 #include "common/slogger.h"
 #include "common/sockets.h"
 #include "common/time_utils.h"
+#include "mount/block_cache.h"
 #include "mount/chunk_locator.h"
 #include "mount/chunk_reader.h"
+#include "mount/disk_block_cache.h"
+#include "mount/global_chunkserver_stats.h"
 #include "mount/mastercomm.h"
 #include "mount/readahead_adviser.h"
 #include "mount/readdata_cache.h"
+#include "mount/stats.h"
 #include "mount/tweaks.h"
 #include "protocol/SFSCommunication.h"
 
@@ -74,10 +82,8 @@ void ReadaheadRequests::tryNotify() {
 void ReadaheadRequests::clearAndNotify(const ReadaheadRequestPtr &reqPtr) {
 	// find the request
 	auto it = pendingRequests_.begin();
-	uint32_t index = 0;
 	while (it != pendingRequests_.end() && it->requestPtr != reqPtr) {
 		it++;
-		index++;
 	}
 
 	// this request already is not there
@@ -85,12 +91,26 @@ void ReadaheadRequests::clearAndNotify(const ReadaheadRequestPtr &reqPtr) {
 		return;
 	}
 
-	// remove all the requests that were considering this request successful
-	while (pendingRequests_.size() > index) {
-		pendingRequests_.back().requestPtr->error_code = reqPtr->error_code;
-		pendingRequests_.back().notify();
-		pendingRequests_.pop_back();
+	// remove all the requests that were considering this request successful,
+	// i.e. the following ones continuing its data; requests of other streams
+	// of the same file handle do not depend on it
+	uint64_t begin = reqPtr->request_offset();
+	uint64_t end = reqPtr->endOffset();
+	while (it != pendingRequests_.end()) {
+		const ReadaheadRequestPtr &request = it->requestPtr;
+		if (request != reqPtr && (request->request_offset() < begin ||
+		                          request->request_offset() > end)) {
+			it++;
+			continue;
+		}
+		end = std::max(end, request->endOffset());
+		request->error_code = reqPtr->error_code;
+		it->notify();
+		it = pendingRequests_.erase(it);
 	}
+
+	// the requests of other streams waiting behind it may be finished already
+	tryNotify();
 }
 
 uint64_t ReadaheadRequests::continuousOffsetRequested(
@@ -102,8 +122,8 @@ uint64_t ReadaheadRequests::continuousOffsetRequested(
 
 	auto it = pendingRequests_.begin();
 	while (it != pendingRequests_.end() && offset < endOffset) {
-		if (pendingRequests_.front().requestPtr->request_offset() <= offset &&
-		    pendingRequests_.front().requestPtr->endOffset() > offset) {
+		if (it->requestPtr->request_offset() <= offset &&
+		    it->requestPtr->endOffset() > offset) {
 			result.add(*(it->requestPtr->entry));
 			offset = it->requestPtr->endOffset();
 		}
@@ -120,6 +140,19 @@ uint64_t ReadaheadRequests::continuousOffsetRequested(
 	return offset;
 }
 
+uint64_t ReadaheadRequests::lastEndOffsetInRange(uint64_t begin,
+                                                 uint64_t end) const {
+	uint64_t lastEndOffset = 0;
+	for (const auto &req : pendingRequests_) {
+		if (req.requestPtr->request_offset() < end &&
+		    req.requestPtr->endOffset() > begin) {
+			lastEndOffset =
+			    std::max(lastEndOffset, req.requestPtr->endOffset());
+		}
+	}
+	return lastEndOffset;
+}
+
 std::stringstream ReadaheadRequests::toString() {
 	std::stringstream text;
 	int index = 0;
@@ -155,13 +188,19 @@ bool ReadaheadOperationsManager::request(ReadRecord *rrec, off_t fuseOffset,
 
 	rrec->cache.query(offset, size, result, false);
 
-	uint64_t recommendedSize = round_up_to_blocksize(
-	    std::max<uint64_t>(size, rrec->readahead_adviser.window()));
+	// Strided streams skip data between requests, so reading ahead past the
+	// end of the current request would only fetch data nobody asked for.
+	uint64_t recommendedSize =
+	    rrec->readahead_adviser.lastStride() != 0
+	        ? size
+	        : round_up_to_blocksize(std::max<uint64_t>(
+	              size, rrec->readahead_adviser.window()));
 
 	if (!result.empty() && result.frontOffset() <= offset &&
 	    offset + size <= result.endOffset()) {
 		// this query can be directly served from cache
-		addExtraRequests_(rrec, offset, recommendedSize, result.endOffset());
+		addReadaheadRequests_(rrec, fuseOffset, fuseSize, offset,
+		                      recommendedSize, result.endOffset());
 		return false;
 	}
 
@@ -181,8 +220,8 @@ bool ReadaheadOperationsManager::request(ReadRecord *rrec, off_t fuseOffset,
 	if (maximumRequestedOffset == offset + size) {
 		// this query can be directly served after succeeding at some
 		// pending read requests
-		addExtraRequests_(rrec, offset, recommendedSize,
-		                  maximumRequestedOffset);
+		addReadaheadRequests_(rrec, fuseOffset, fuseSize, offset,
+		                      recommendedSize, maximumRequestedOffset);
 		return true;
 	}
 
@@ -205,8 +244,8 @@ bool ReadaheadOperationsManager::request(ReadRecord *rrec, off_t fuseOffset,
 	waitingCVPtr = requestConditionVariablePair.cvPtr;
 	requestPtr = requestConditionVariablePair.requestPtr;
 
-	addExtraRequests_(rrec, offset, recommendedSize,
-	                  requestOffset + bytesToReadLeft);
+	addReadaheadRequests_(rrec, fuseOffset, fuseSize, offset, recommendedSize,
+	                      requestOffset + bytesToReadLeft);
 
 	return true;
 }
@@ -239,16 +278,21 @@ ReadaheadOperationsManager::addRequest_(ReadRecord *rrec,
 void ReadaheadOperationsManager::addExtraRequests_(
     ReadRecord *rrec, uint64_t currentOffset, uint64_t satisfyingSize,
     uint64_t maximumRequestedOffset) {
-	if (!rrec->readaheadRequests.empty()) {
-		maximumRequestedOffset = rrec->readaheadRequests.lastPendingRequest()
-		                             .requestPtr->endOffset();
-	}
-
 	uint64_t throughputWindow = rrec->readahead_adviser.throughputWindow();
 	uint64_t readaheadSize = std::min<uint64_t>(
 	    gMaxReadaheadRequests * satisfyingSize, throughputWindow);
 
-	while (rrec->readaheadRequests.size() < rrec->suggestedReadaheadReqs() &&
+	// Only requests scheduled for this stream matter, other streams of the
+	// same file handle are read ahead on their own.
+	maximumRequestedOffset = std::max(
+	    maximumRequestedOffset,
+	    rrec->readaheadRequests.lastEndOffsetInRange(
+	        currentOffset, currentOffset + readaheadSize));
+
+	uint64_t maxPendingRequests = static_cast<uint64_t>(
+	    rrec->suggestedReadaheadReqs()) * rrec->readahead_adviser.streamCount();
+
+	while (rrec->readaheadRequests.size() < maxPendingRequests &&
 	       maximumRequestedOffset < currentOffset + readaheadSize) {
 
 		auto it = rrec->cache.find(maximumRequestedOffset);
@@ -267,6 +311,59 @@ void ReadaheadOperationsManager::addExtraRequests_(
 	}
 }
 
+void ReadaheadOperationsManager::addStridedRequests_(ReadRecord *rrec,
+                                                     uint64_t fuseOffset,
+                                                     uint32_t fuseSize,
+                                                     int64_t stride) {
+	uint64_t throughputWindow = rrec->readahead_adviser.throughputWindow();
+	uint64_t readaheadSize = std::min<uint64_t>(
+	    gMaxReadaheadRequests * round_up_to_blocksize(fuseSize),
+	    throughputWindow);
+
+	uint64_t maxPendingRequests = static_cast<uint64_t>(
+	    rrec->suggestedReadaheadReqs()) * rrec->readahead_adviser.streamCount();
+
+	uint64_t stepOffset = fuseOffset;
+	uint64_t prefetchedSize = 0;
+	while (rrec->readaheadRequests.size() < maxPendingRequests) {
+		if (stride < 0 && stepOffset < static_cast<uint64_t>(-stride)) {
+			// next step would be before the beginning of the file
+			break;
+		}
+		stepOffset += stride;
+
+		uint64_t stepBegin = stepOffset / SFSBLOCKSIZE * SFSBLOCKSIZE;
+		uint64_t stepSize =
+		    round_up_to_blocksize(stepOffset + fuseSize) - stepBegin;
+		prefetchedSize += stepSize;
+		if (prefetchedSize > readaheadSize) {
+			break;
+		}
+
+		if (rrec->cache.find(stepBegin) != MISSING_OFFSET_PTR) {
+			continue;
+		}
+
+		ReadCache::Entry *entry = rrec->cache.forceInsert(stepBegin, stepSize);
+
+		// we are not going to use the return value from the addRequest_ call
+		RequestConditionVariablePair _ = addRequest_(rrec, entry);
+	}
+}
+
+void ReadaheadOperationsManager::addReadaheadRequests_(
+    ReadRecord *rrec, uint64_t fuseOffset, uint32_t fuseSize,
+    uint64_t currentOffset, uint64_t satisfyingSize,
+    uint64_t maximumRequestedOffset) {
+	int64_t stride = rrec->readahead_adviser.lastStride();
+	if (stride != 0) {
+		addStridedRequests_(rrec, fuseOffset, fuseSize, stride);
+	} else {
+		addExtraRequests_(rrec, currentOffset, satisfyingSize,
+		                  maximumRequestedOffset);
+	}
+}
+
 using ReadRecords = std::unordered_multimap<uint32_t, ReadRecord *>;
 using ReadRecordRange = std::pair<ReadRecords::iterator, ReadRecords::iterator>;
 
@@ -277,15 +374,26 @@ inline std::mutex gMutex;
 inline std::mutex gReadaheadOperationsManagerMutex;
 inline ReadRecords gActiveReadRecords;
 inline pthread_t delayedOpsThread;
+inline pthread_t prewarmThread;
+inline bool prewarmThreadStarted;
 inline std::vector<pthread_t> readOpsThreads;
+inline std::vector<pthread_t> stripeWorkerThreads;
+inline std::mutex gStripeJobsMutex;
+inline std::condition_variable gStripeJobsAvailable;
+inline std::deque<std::function<void()>> gStripeJobs;  // gStripeJobsMutex
+inline bool gStripeWorkersTerminate;                    // gStripeJobsMutex
 inline std::atomic<uint32_t> gChunkserverConnectTimeout_ms;
 inline std::atomic<uint32_t> gChunkserverWaveReadTimeout_ms;
 inline std::atomic<uint32_t> gChunkserverTotalReadTimeout_ms;
 inline uint32_t gReadWorkers;
+inline std::atomic<uint32_t> gReadStripeWorkers;
+inline std::atomic<uint32_t> gReadStripeSize;
 inline std::atomic<bool> gPrefetchXorStripes;
 inline bool readDataTerminate;
 inline std::atomic<uint32_t> maxRetries;
 inline double gBandwidthOveruse;
+inline BlockCache gBlockCache;
+inline DiskBlockCache gDiskBlockCache;
 
 const unsigned ReadaheadAdviser::kInitWindowSize;
 const int ReadaheadAdviser::kRandomThreshold;
@@ -313,6 +421,41 @@ bool read_data_get_prefetchxorstripes() {
 	return gPrefetchXorStripes;
 }
 
+/// .stats counters of a block cache, fed with the changes since the last update
+struct BlockCacheStatsNode {
+	uint64_t *hits;
+	uint64_t *misses;
+	uint64_t *inserts;
+	uint64_t *evictions;
+	uint64_t *blocks;
+	BlockCache::Stats last;
+
+	void init(const char *name, const BlockCache::Stats &current) {
+		statsnode *s;
+		s = stats_get_subnode(NULL, name, 0);
+		hits = stats_get_counterptr(stats_get_subnode(s, "hits", 0));
+		misses = stats_get_counterptr(stats_get_subnode(s, "misses", 0));
+		inserts = stats_get_counterptr(stats_get_subnode(s, "inserts", 0));
+		evictions = stats_get_counterptr(stats_get_subnode(s, "evictions", 0));
+		blocks = stats_get_counterptr(stats_get_subnode(s, "#blocks", 1));
+		last = current;
+	}
+
+	void update(const BlockCache::Stats &current) {
+		stats_lock();
+		*hits += current.hits - last.hits;
+		*misses += current.misses - last.misses;
+		*inserts += current.inserts - last.inserts;
+		*evictions += current.evictions - last.evictions;
+		*blocks = current.blocks;
+		stats_unlock();
+		last = current;
+	}
+};
+
+static BlockCacheStatsNode gBlockCacheStats;
+static BlockCacheStatsNode gDiskBlockCacheStats;
+
 inline void clear_active_read_records()
 {
 	std::unique_lock lock(gMutex);
@@ -328,14 +471,20 @@ void* read_data_delayed_ops(void *arg) {
 	(void)arg;
 	for (;;) {
 		gReadConnectionPool.cleanup();
+		gBlockCacheStats.update(gBlockCache.stats());
+		gDiskBlockCacheStats.update(gDiskBlockCache.stats());
 		std::unique_lock lock(gMutex);
 		if (readDataTerminate) {
 			return EMPTY_REQUEST;
 		}
 		auto readRecordIt = gActiveReadRecords.begin();
 		while (readRecordIt != gActiveReadRecords.end()) {
-			if (readRecordIt->second->refreshCounter < REFRESHTICKS) {
-				++(readRecordIt->second->refreshCounter);
+			// read_inode_ops() may set the counter meanwhile, it must not be
+			// pushed past REFRESHTICKS
+			auto &refreshCounter = readRecordIt->second->refreshCounter;
+			uint8_t ticks = refreshCounter;
+			while (ticks < REFRESHTICKS &&
+			       !refreshCounter.compare_exchange_weak(ticks, ticks + 1)) {
 			}
 
 			if (readRecordIt->second->expired &&
@@ -352,6 +501,41 @@ void* read_data_delayed_ops(void *arg) {
 	}
 }
 
+// Connecting may block for the whole connect timeout, so it is done apart from
+// the delayed ops, which would stop expiring read records meanwhile.
+void* read_data_prewarm_connections(void *arg) {
+	(void)arg;
+	for (;;) {
+		gChunkConnector.prewarmConnections(gChunkserverConnectTimeout_ms);
+		{
+			std::unique_lock lock(gMutex);
+			if (readDataTerminate) {
+				return EMPTY_REQUEST;
+			}
+		}
+		usleep(USECTICK);
+	}
+}
+
+// Reads stripes of large reads on behalf of other threads, see
+// read_striped_to_buffer()
+void* stripe_worker(void *arg) {
+	(void)arg;
+	for (;;) {
+		std::unique_lock lock(gStripeJobsMutex);
+		gStripeJobsAvailable.wait(lock, [] {
+			return gStripeWorkersTerminate || !gStripeJobs.empty();
+		});
+		if (gStripeJobs.empty()) {
+			return EMPTY_REQUEST;
+		}
+		auto job = std::move(gStripeJobs.front());
+		gStripeJobs.pop_front();
+		lock.unlock();
+		job();
+	}
+}
+
 void* read_worker(void *arg) {
 	(void)arg;
 	for (;;) {
@@ -397,17 +581,17 @@ void* read_worker(void *arg) {
 
 		if (error_code != SAUNAFS_STATUS_OK
 		    || request->error_code != SAUNAFS_STATUS_OK) {
-			// discard any leftover bytes from incorrect read
-			entry->buffer.clear();
-			entry->requested_size = 0;
-
-			// clear the list of read requests for this inode and notify waiting
-			// threads of this error
+			// clear the read requests of this stream and notify waiting
+			// threads of this error, while the size of the request is known
 			if (request->error_code == SAUNAFS_STATUS_OK) {
 				request->error_code = error_code;
 				readRecord->readaheadRequests.clearAndNotify(request);
 			}
 
+			// discard any leftover bytes from incorrect read
+			entry->buffer.clear();
+			entry->requested_size = 0;
+
 			readRecord->requestsInProcess--;
 			continue;
 		}
@@ -448,7 +632,13 @@ void read_data_init(uint32_t retries,
 		uint32_t read_workers,
 		uint32_t max_readahead_requests,
 		bool prefetchXorStripes,
-		double bandwidth_overuse) {
+		double bandwidth_overuse,
+		uint32_t read_cache_size_MB,
+		const std::string &disk_cache_path,
+		uint32_t disk_cache_size_MB,
+		uint32_t read_stripe_workers,
+		uint32_t read_stripe_size_kB,
+		uint32_t prewarmed_connections) {
 	pthread_attr_t thattr;
 
 	readDataTerminate = false;
@@ -463,17 +653,35 @@ void read_data_init(uint32_t retries,
 	gReadaheadMaxWindowSize = readahead_max_window_size_kB * 1024;
 	gReadWorkers = read_workers;
 	gMaxReadaheadRequests = max_readahead_requests;
+	gReadStripeWorkers = read_stripe_workers;
+	gReadStripeSize = read_stripe_size_kB * 1024;
 	gPrefetchXorStripes = prefetchXorStripes;
 	gBandwidthOveruse = bandwidth_overuse;
+	gBlockCache.reset(static_cast<uint64_t>(read_cache_size_MB) * 1024 * 1024);
+	gBlockCacheStats.init("read_cache", gBlockCache.stats());
+	gDiskBlockCache.open(disk_cache_path,
+	                     static_cast<uint64_t>(disk_cache_size_MB) * 1024 * 1024);
+	gDiskBlockCacheStats.init("disk_read_cache", gDiskBlockCache.stats());
 	gTweaks.registerVariable("PrefetchXorStripes", gPrefetchXorStripes);
 	gChunkConnector.setRoundTripTime(chunkserverRoundTripTime_ms);
 	gChunkConnector.setSourceIp(fs_getsrcip());
+	gChunkConnector.setChunkserverStats(&globalChunkserverStats);
+	gReadConnectionPool.setPrewarmedConnections(prewarmed_connections);
 	pthread_attr_init(&thattr);
 	pthread_attr_setstacksize(&thattr,0x100000);
 	pthread_create(&delayedOpsThread,&thattr,read_data_delayed_ops,NULL);
+	prewarmThreadStarted = prewarmed_connections > 0;
+	if (prewarmThreadStarted) {
+		pthread_create(&prewarmThread, &thattr, read_data_prewarm_connections, NULL);
+	}
 	readOpsThreads.resize(gReadWorkers);
 	for (auto &th : readOpsThreads)
 		pthread_create(&th, &thattr, read_worker, NULL);
+	gStripeWorkersTerminate = false;
+	// the thread reading a striped range reads stripes as well
+	stripeWorkerThreads.resize(read_stripe_workers > 1 ? read_stripe_workers - 1 : 0);
+	for (auto &th : stripeWorkerThreads)
+		pthread_create(&th, &thattr, stripe_worker, NULL);
 	pthread_attr_destroy(&thattr);
 
 	gTweaks.registerVariable("ReadMaxRetries", maxRetries);
@@ -483,6 +691,8 @@ void read_data_init(uint32_t retries,
 	gTweaks.registerVariable("CacheExpirationTime", gCacheExpirationTime_ms);
 	gTweaks.registerVariable("ReadaheadMaxWindowSize", gReadaheadMaxWindowSize);
 	gTweaks.registerVariable("MaxReadaheadRequests", gMaxReadaheadRequests);
+	gTweaks.registerVariable("ReadStripeWorkers", gReadStripeWorkers);
+	gTweaks.registerVariable("ReadStripeSize", gReadStripeSize);
 	gTweaks.registerVariable("ReadChunkPrepare", ChunkReader::preparations);
 	gTweaks.registerVariable("ReqExecutedTotal", ReadPlanExecutor::executions_total_);
 	gTweaks.registerVariable("ReqExecutedUsingAll", ReadPlanExecutor::executions_with_additional_operations_);
@@ -496,6 +706,9 @@ void read_data_term(void) {
 	}
 
 	pthread_join(delayedOpsThread, NULL);
+	if (prewarmThreadStarted) {
+		pthread_join(prewarmThread, NULL);
+	}
 	for (uint32_t i = 0; i < gReadWorkers; i++) {
 		gReadaheadOperationsManager.putTerminateRequest();
 	}
@@ -504,7 +717,19 @@ void read_data_term(void) {
 		pthread_join(thread, NULL);
 	}
 
+	{
+		std::unique_lock lock(gStripeJobsMutex);
+		gStripeWorkersTerminate = true;
+	}
+	gStripeJobsAvailable.notify_all();
+	for (auto &thread : stripeWorkerThreads) {
+		pthread_join(thread, NULL);
+	}
+	stripeWorkerThreads.clear();
+
 	clear_active_read_records();
+	gBlockCache.clear();
+	gDiskBlockCache.close();
 }
 
 void read_inode_ops(uint32_t inode) { // attributes of inode have been changed - force reconnect and clear cache
@@ -515,6 +740,10 @@ void read_inode_ops(uint32_t inode) { // attributes of inode have been changed -
 	for (auto it = range.first; it != range.second; ++it) {
 		it->second->refreshCounter = REFRESHTICKS; // force reconnect on forthcoming access
 	}
+	lock.unlock();
+
+	gBlockCache.invalidate(inode);
+	gDiskBlockCache.invalidate(inode);
 }
 
 int read_data_sleep_time_ms(int tryCounter) {
@@ -539,9 +768,90 @@ static void print_error_msg(ChunkReader& reader, uint32_t try_counter, const Exc
 	}
 }
 
-int read_to_buffer(ReadRecord *rrec, uint64_t current_offset,
-                   uint64_t bytes_to_read, std::vector<uint8_t> &read_buffer,
-                   uint64_t *bytes_read, ChunkReader &reader) {
+/**
+ * Appends a block from the shared caches to the buffer. Blocks found only in
+ * the on-disk cache are promoted to the in-memory one, keeping their age.
+ */
+static bool read_cached_block(const BlockCache::Key &key, const ChunkReader &reader,
+                              bool use_memory_cache, std::vector<uint8_t> &buffer) {
+	uint32_t max_age_ms = gCacheExpirationTime_ms;
+	if (use_memory_cache && gBlockCache.get(key, reader.chunkId(), reader.version(),
+	                                        max_age_ms, buffer)) {
+		return true;
+	}
+	uint32_t age_ms = 0;
+	if (gDiskBlockCache.get(key, reader.chunkId(), reader.version(), max_age_ms, buffer,
+	                        &age_ms)) {
+		if (use_memory_cache) {
+			gBlockCache.put(key, reader.chunkId(), reader.version(),
+			                buffer.data() + buffer.size() - SFSBLOCKSIZE, age_ms);
+		}
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Reads data from the prepared chunk, serving whole blocks from the shared
+ * block caches when possible and filling the caches with whole blocks which
+ * had to be fetched from chunkservers.
+ */
+static uint32_t read_chunk_data(ChunkReader &reader, std::vector<uint8_t> &buffer,
+                                uint32_t offset, uint32_t size,
+                                const Timeout &communication_timeout) {
+	// cacheexpirationtime=0 disables both caches, data may change at any time
+	bool use_memory_cache = gBlockCache.enabled() && gCacheExpirationTime_ms > 0;
+	bool use_disk_cache = gDiskBlockCache.enabled() && gCacheExpirationTime_ms > 0;
+	if ((!use_memory_cache && !use_disk_cache)
+	    || reader.chunkId() == 0 || offset % SFSBLOCKSIZE != 0) {
+		return reader.readData(buffer, offset, size,
+		                       gChunkserverConnectTimeout_ms,
+		                       gChunkserverWaveReadTimeout_ms,
+		                       communication_timeout, gPrefetchXorStripes);
+	}
+
+	size_t initial_buffer_size = buffer.size();
+	uint64_t offset_of_chunk = static_cast<uint64_t>(reader.index()) * SFSCHUNKSIZE;
+	BlockCache::Key key{reader.inode(), reader.index(), offset / SFSBLOCKSIZE};
+	uint32_t served = 0;
+	while (size - served >= SFSBLOCKSIZE
+	       && offset_of_chunk + offset + served + SFSBLOCKSIZE <= reader.fileLength()
+	       && read_cached_block(key, reader, use_memory_cache, buffer)) {
+		served += SFSBLOCKSIZE;
+		key.block++;
+	}
+
+	size_t fetched_offset = buffer.size();
+	uint32_t fetched;
+	try {
+		fetched = reader.readData(buffer, offset + served, size - served,
+		                          gChunkserverConnectTimeout_ms,
+		                          gChunkserverWaveReadTimeout_ms,
+		                          communication_timeout, gPrefetchXorStripes);
+	} catch (...) {
+		// the caller retries the whole range, so drop the blocks served so far
+		buffer.resize(initial_buffer_size);
+		throw;
+	}
+
+	for (uint32_t pos = 0; pos + SFSBLOCKSIZE <= fetched; pos += SFSBLOCKSIZE) {
+		const uint8_t *block = buffer.data() + fetched_offset + pos;
+		if (use_memory_cache) {
+			gBlockCache.put(key, reader.chunkId(), reader.version(), block);
+		}
+		if (use_disk_cache) {
+			gDiskBlockCache.put(key, reader.chunkId(), reader.version(), block);
+		}
+		key.block++;
+	}
+	return served + fetched;
+}
+
+static int read_range_to_buffer(ReadRecord *rrec, uint64_t current_offset,
+                                uint64_t bytes_to_read,
+                                std::vector<uint8_t> &read_buffer,
+                                uint64_t *bytes_read, ChunkReader &reader,
+                                bool force_prepare) {
 	uint32_t try_counter = 0;
 	uint32_t prepared_inode = 0; // this is always different than any real inode
 	uint32_t prepared_chunk_id = 0;
@@ -550,8 +860,6 @@ int read_to_buffer(ReadRecord *rrec, uint64_t current_offset,
 	// forced sleep between retries caused by recoverable failures
 	uint32_t sleep_time_ms = 0;
 
-	bool force_prepare = (rrec->refreshCounter == REFRESHTICKS);
-
 	while (bytes_to_read > 0) {
 		Timeout sleep_timeout = Timeout(std::chrono::milliseconds(sleep_time_ms));
 		// Increase communicationTimeout to sleepTime; longer poll() can't be worse
@@ -566,7 +874,6 @@ int read_to_buffer(ReadRecord *rrec, uint64_t current_offset,
 				prepared_chunk_id = chunk_id;
 				prepared_inode = rrec->inode;
 				force_prepare = false;
-				rrec->refreshCounter = 0;
 			}
 
 			uint64_t offset_of_chunk = static_cast<uint64_t>(chunk_id) * SFSCHUNKSIZE;
@@ -575,10 +882,9 @@ int read_to_buffer(ReadRecord *rrec, uint64_t current_offset,
 			if (size_in_chunk > bytes_to_read) {
 				size_in_chunk = bytes_to_read;
 			}
-			uint32_t bytes_read_from_chunk = reader.readData(
-					read_buffer, offset_in_chunk, size_in_chunk,
-					gChunkserverConnectTimeout_ms, gChunkserverWaveReadTimeout_ms,
-					communication_timeout, gPrefetchXorStripes);
+			uint32_t bytes_read_from_chunk = read_chunk_data(
+					reader, read_buffer, offset_in_chunk, size_in_chunk,
+					communication_timeout);
 			// No exceptions thrown. We can increase the counters and go to the next chunk
 			*bytes_read += bytes_read_from_chunk;
 			current_offset += bytes_read_from_chunk;
@@ -612,6 +918,142 @@ int read_to_buffer(ReadRecord *rrec, uint64_t current_offset,
 	return SAUNAFS_STATUS_OK;
 }
 
+/**
+ * Splits the range into stripes, which never cross chunk boundaries, and reads
+ * them concurrently: the calling thread with its own reader and up to
+ * workers - 1 stripe workers. Readers of consecutive stripes prefer different
+ * copies of a chunk, so a single large read is served by several chunkservers
+ * at once.
+ */
+static int read_striped_to_buffer(ReadRecord *rrec, uint64_t offset, uint64_t size,
+                                  uint32_t stripe_size, uint32_t workers,
+                                  std::vector<uint8_t> &read_buffer,
+                                  uint64_t *bytes_read, ChunkReader &reader,
+                                  bool force_prepare) {
+	struct Stripe {
+		uint64_t offset;
+		uint64_t size;
+		std::vector<uint8_t> buffer;
+		uint64_t bytes_read = 0;
+		int status = SAUNAFS_STATUS_OK;
+	};
+
+	// Shared with the stripe jobs, which may be started by a stripe worker
+	// only after this read has finished
+	struct StripedRead {
+		std::vector<Stripe> stripes;
+		size_t next_stripe = 0;  // mutex
+		unsigned active_jobs = 0;  // mutex
+		bool finished = false;  // mutex
+		std::mutex mutex;
+		std::condition_variable jobs_done;
+
+		// Reads the remaining stripes, returns false if there are none
+		bool readNextStripe(ReadRecord *rrec, ChunkReader *reader,
+		                    uint32_t stripe_size, bool force_prepare) {
+			std::unique_lock lock(mutex);
+			if (next_stripe >= stripes.size()) {
+				return false;
+			}
+			Stripe &stripe = stripes[next_stripe++];
+			lock.unlock();
+
+			std::optional<ChunkReader> stripe_reader;
+			if (!reader) {
+				stripe_reader.emplace(gChunkConnector, rrec->locator, gBandwidthOveruse,
+				                      stripe.offset / stripe_size);
+				reader = &*stripe_reader;
+			}
+			stripe.buffer.reserve(stripe.size);
+			stripe.status = read_range_to_buffer(rrec, stripe.offset, stripe.size,
+			                                     stripe.buffer, &stripe.bytes_read,
+			                                     *reader, force_prepare);
+			return true;
+		}
+	};
+
+	auto striped_read = std::make_shared<StripedRead>();
+	for (uint64_t begin = offset; begin < offset + size;) {
+		uint64_t end = std::min({(begin / stripe_size + 1) * stripe_size,
+		                         (begin / SFSCHUNKSIZE + 1) * SFSCHUNKSIZE,
+		                         offset + size});
+		striped_read->stripes.push_back({begin, end - begin, {}});
+		begin = end;
+	}
+
+	size_t jobs = std::min<size_t>({workers, striped_read->stripes.size(),
+	                                stripeWorkerThreads.size() + 1}) - 1;
+	{
+		std::unique_lock lock(gStripeJobsMutex);
+		for (size_t i = 0; i < jobs; ++i) {
+			gStripeJobs.push_back([striped_read, rrec, stripe_size, force_prepare]() {
+				std::unique_lock lock(striped_read->mutex);
+				if (striped_read->finished) {
+					return;
+				}
+				striped_read->active_jobs++;
+				lock.unlock();
+				while (striped_read->readNextStripe(rrec, nullptr, stripe_size,
+				                                    force_prepare)) {
+				}
+				lock.lock();
+				striped_read->active_jobs--;
+				striped_read->jobs_done.notify_all();
+			});
+		}
+	}
+	for (size_t i = 0; i < jobs; ++i) {
+		gStripeJobsAvailable.notify_one();
+	}
+
+	while (striped_read->readNextStripe(rrec, &reader, stripe_size, force_prepare)) {
+	}
+	{
+		// jobs not started yet won't touch the stripes anymore
+		std::unique_lock lock(striped_read->mutex);
+		striped_read->finished = true;
+		striped_read->jobs_done.wait(lock, [&striped_read] {
+			return striped_read->active_jobs == 0;
+		});
+	}
+
+	for (const Stripe &stripe : striped_read->stripes) {
+		if (stripe.status != SAUNAFS_STATUS_OK) {
+			return stripe.status;
+		}
+		read_buffer.insert(read_buffer.end(), stripe.buffer.begin(), stripe.buffer.end());
+		*bytes_read += stripe.bytes_read;
+		if (stripe.bytes_read < stripe.size) {
+			// end of file
+			break;
+		}
+	}
+	return SAUNAFS_STATUS_OK;
+}
+
+int read_to_buffer(ReadRecord *rrec, uint64_t current_offset,
+                   uint64_t bytes_to_read, std::vector<uint8_t> &read_buffer,
+                   uint64_t *bytes_read, ChunkReader &reader) {
+	// Checked and reset once per read, so all stripes of a read see the same
+	// value. A failed prepare is retried with force_prepare anyway.
+	bool force_prepare = false;
+	uint8_t ticks = REFRESHTICKS;
+	if (rrec->refreshCounter.compare_exchange_strong(ticks, 0)) {
+		force_prepare = true;
+	}
+
+	uint32_t stripe_workers = gReadStripeWorkers;
+	uint32_t stripe_size = round_up_to_blocksize(std::max<uint32_t>(gReadStripeSize, 1));
+	if (stripe_workers > 1 && !stripeWorkerThreads.empty()
+	    && bytes_to_read >= 2 * static_cast<uint64_t>(stripe_size)) {
+		return read_striped_to_buffer(rrec, current_offset, bytes_to_read, stripe_size,
+		                              stripe_workers, read_buffer, bytes_read, reader,
+		                              force_prepare);
+	}
+	return read_range_to_buffer(rrec, current_offset, bytes_to_read, read_buffer,
+	                            bytes_read, reader, force_prepare);
+}
+
 int read_data(ReadRecord *rrec, off_t fuseOffset, size_t fuseSize,
               uint64_t offset, uint32_t size, ReadCache::Result &ret) {
 	assert(size % SFSBLOCKSIZE == 0);
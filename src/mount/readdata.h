@@ -25,6 +25,7 @@
 #include <cinttypes>
 #include <list>
 #include <queue>
+#include <string>
 
 #include "mount/chunk_locator.h"
 #include "mount/chunk_reader.h"
@@ -138,6 +139,19 @@ struct ReadaheadRequests {
 	                                   ConditionVariablePtr &waitingCVPtr,
 	                                   ReadaheadRequestPtr &requestPtr);
 
+	/** \brief Find the end of the furthest pending request which overlaps the
+	 * given range of the file.
+	 *
+	 * Requests of other streams of the same file handle are ignored this way,
+	 * so every stream is prefetched independently.
+	 *
+	 * \param begin Start of the range.
+	 * \param end End of the range.
+	 * \return The largest end offset of the overlapping requests or 0 if
+	 * there is no such request.
+	 */
+	uint64_t lastEndOffsetInRange(uint64_t begin, uint64_t end) const;
+
 	inline bool empty() const {
 		return pendingRequests_.empty();
 	}
@@ -151,8 +165,9 @@ struct ReadaheadRequests {
 	}
 
 	/** \brief Given a non-successfully finishing request, propagate the error
-	 * to ALL the following requests, notifying threads waiting for these
-	 * requests and remove those following requests.
+	 * to the following requests continuing its data, notifying threads waiting
+	 * for these requests and remove those following requests. Requests of
+	 * other streams are kept.
 	 *
 	 * \param reqPtr The pointer to a non-successfully finishing request.
 	 */
@@ -312,6 +327,31 @@ private:
 	                       uint64_t satisfyingSize,
 	                       uint64_t maximumRequestedOffset);
 
+	/**
+	 * \brief Add requests for the next steps of a strided stream.
+	 *
+	 * Every step is prefetched as a separate request of the (block aligned)
+	 * size of the system request. The total prefetched size is bounded the
+	 * same way as in ```addExtraRequests_```.
+	 *
+	 * \param rrec The related ```ReadRecord```.
+	 * \param fuseOffset Real starting offset of the system request.
+	 * \param fuseSize Real size of the system request.
+	 * \param stride Distance between starts of consecutive requests.
+	 */
+	void addStridedRequests_(ReadRecord *rrec, uint64_t fuseOffset,
+	                         uint32_t fuseSize, int64_t stride);
+
+	/**
+	 * \brief Schedule readahead for the stream the last system request
+	 * belongs to, using ```addStridedRequests_``` for strided streams and
+	 * ```addExtraRequests_``` otherwise.
+	 */
+	void addReadaheadRequests_(ReadRecord *rrec, uint64_t fuseOffset,
+	                           uint32_t fuseSize, uint64_t currentOffset,
+	                           uint64_t satisfyingSize,
+	                           uint64_t maximumRequestedOffset);
+
 	using ReadaheadRequestContainer = std::queue<Request>;
 
 	ReadaheadRequestContainer readaheadRequestContainer_;
@@ -338,5 +378,11 @@ void read_data_init(uint32_t retries, uint32_t chunkserverRoundTripTime_ms,
                     uint32_t cache_expiration_time_ms,
                     uint32_t readahead_max_window_size_kB,
                     uint32_t read_workers, uint32_t max_readahead_requests,
-                    bool prefetchXorStripes, double bandwidth_overuse);
+                    bool prefetchXorStripes, double bandwidth_overuse,
+                    uint32_t read_cache_size_MB,
+                    const std::string &disk_cache_path,
+                    uint32_t disk_cache_size_MB,
+                    uint32_t read_stripe_workers,
+                    uint32_t read_stripe_size_kB,
+                    uint32_t prewarmed_connections);
 void read_data_term();
@@ -1889,9 +1889,25 @@ EntryParam create(Context &ctx, Inode parent, const char *name, mode_t mode,
 		throw RequestException(SAUNAFS_ERROR_EINVAL);
 	}
 
+	// mknod and open are sent in one request if the master supports batches
+	std::vector<FuseBatchOperation> operations{
+		FuseBatchOperation::mknod(parent, 0, std::string(name, nleng), TYPE_FILE, mode & 07777,
+				ctx.umask, 0),
+		FuseBatchOperation::open(0, 1, oflags)};
+	std::vector<FuseBatchResult> results;
 	RETRY_ON_ERROR_WITH_UPDATED_CREDENTIALS(status, ctx,
-		fs_mknod(parent,nleng,(const uint8_t*)name,TYPE_FILE,mode&07777,ctx.umask,ctx.uid,ctx.gid,0,inode,attr));
-	if (status != SAUNAFS_STATUS_OK) {
+		fs_batch(ctx.uid, ctx.gid, operations, results));
+	bool batched = (status != SAUNAFS_ERROR_ENOTSUP || !results.empty());
+	if (batched) {
+		if (!results.empty() && results[0].status == SAUNAFS_STATUS_OK) {
+			inode = results[0].inode;
+			attr = results[0].attributes;
+		}
+	} else {
+		RETRY_ON_ERROR_WITH_UPDATED_CREDENTIALS(status, ctx,
+			fs_mknod(parent,nleng,(const uint8_t*)name,TYPE_FILE,mode&07777,ctx.umask,ctx.uid,ctx.gid,0,inode,attr));
+	}
+	if (status != SAUNAFS_STATUS_OK && (!batched || results.size() < 2)) {
 		oplog_printf(ctx, "create (%lu,%s,-%s:0%04o) (mknod): %s",
 				(unsigned long int)parent,
 				name,
@@ -1900,9 +1916,11 @@ EntryParam create(Context &ctx, Inode parent, const char *name, mode_t mode,
 				saunafs_error_string(status));
 		throw RequestException(status);
 	}
-	Attributes tmp_attr;
-	RETRY_ON_ERROR_WITH_UPDATED_CREDENTIALS(status, ctx,
-		fs_opencheck(inode,ctx.uid,ctx.gid,oflags,tmp_attr));
+	if (!batched) {
+		Attributes tmp_attr;
+		RETRY_ON_ERROR_WITH_UPDATED_CREDENTIALS(status, ctx,
+			fs_opencheck(inode,ctx.uid,ctx.gid,oflags,tmp_attr));
+	}
 
 	if (status != SAUNAFS_STATUS_OK) {
 		oplog_printf(ctx, "create (%lu,%s,-%s:0%04o) (open): %s",
@@ -3316,7 +3334,13 @@ void fs_init(FsInitParams &params) {
 			params.read_workers,
 			params.max_readahead_requests,
 			params.prefetch_xor_stripes,
-			std::max(params.bandwidth_overuse, 1.));
+			std::max(params.bandwidth_overuse, 1.),
+			params.read_cache_size,
+			params.disk_cache_path,
+			params.disk_cache_size,
+			params.read_stripe_workers,
+			params.read_stripe_size_kB,
+			params.prewarmed_connections);
 	write_data_init(params.write_cache_size, params.io_retries, params.write_workers,
 			params.write_window_size, params.chunkserver_write_timeout_ms, params.cache_per_inode_percentage);
 
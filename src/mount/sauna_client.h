@@ -69,6 +69,12 @@ struct FsInitParams {
 	static constexpr unsigned kDefaultReadWorkers = 30;
 	static constexpr unsigned kDefaultMaxReadaheadRequests = 5;
 	static constexpr bool     kDefaultPrefetchXorStripes = false;
+	static constexpr unsigned kDefaultReadCacheSize = 0;
+	static constexpr const char *kDefaultDiskCachePath = "";
+	static constexpr unsigned kDefaultDiskCacheSize = 0;
+	static constexpr unsigned kDefaultReadStripeWorkers = 1;
+	static constexpr unsigned kDefaultReadStripeSize = 8192;
+	static constexpr unsigned kDefaultPrewarmedConnections = 0;
 
 	static constexpr float    kDefaultBandwidthOveruse = 1.0;
 	static constexpr unsigned kDefaultChunkserverWriteTo = 5000;
@@ -123,6 +129,12 @@ struct FsInitParams {
 	             read_workers(kDefaultReadWorkers),
 	             max_readahead_requests(kDefaultMaxReadaheadRequests),
 	             prefetch_xor_stripes(kDefaultPrefetchXorStripes),
+	             read_cache_size(kDefaultReadCacheSize),
+	             disk_cache_path(kDefaultDiskCachePath),
+	             disk_cache_size(kDefaultDiskCacheSize),
+	             read_stripe_workers(kDefaultReadStripeWorkers),
+	             read_stripe_size_kB(kDefaultReadStripeSize),
+	             prewarmed_connections(kDefaultPrewarmedConnections),
 	             bandwidth_overuse(kDefaultBandwidthOveruse),
 	             write_cache_size(kDefaultWriteCacheSize),
 	             write_workers(kDefaultWriteWorkers), write_window_size(kDefaultWriteWindowSize),
@@ -152,6 +164,12 @@ struct FsInitParams {
 	             read_workers(kDefaultReadWorkers),
 	             max_readahead_requests(kDefaultMaxReadaheadRequests),
 	             prefetch_xor_stripes(kDefaultPrefetchXorStripes),
+	             read_cache_size(kDefaultReadCacheSize),
+	             disk_cache_path(kDefaultDiskCachePath),
+	             disk_cache_size(kDefaultDiskCacheSize),
+	             read_stripe_workers(kDefaultReadStripeWorkers),
+	             read_stripe_size_kB(kDefaultReadStripeSize),
+	             prewarmed_connections(kDefaultPrewarmedConnections),
 	             bandwidth_overuse(kDefaultBandwidthOveruse),
 	             write_cache_size(kDefaultWriteCacheSize),
 	             write_workers(kDefaultWriteWorkers), write_window_size(kDefaultWriteWindowSize),
@@ -188,6 +206,12 @@ struct FsInitParams {
 	unsigned read_workers;
 	unsigned max_readahead_requests;
 	bool prefetch_xor_stripes;
+	unsigned read_cache_size;
+	std::string disk_cache_path;
+	unsigned disk_cache_size;
+	unsigned read_stripe_workers;
+	unsigned read_stripe_size_kB;
+	unsigned prewarmed_connections;
 	double bandwidth_overuse;
 
 	unsigned write_cache_size;
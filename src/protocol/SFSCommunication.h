@@ -559,7 +559,13 @@ enum class SugidClearMode {
 
 // 0x0494
 #define SAU_CSTOMA_STATUS (1000U + 172U)
-/// load:8
+/// version==0 load:8
+/// version==1 load:8 queuedepth:32 latencyus:32
+
+// 0x0495
+#define SAU_MATOCS_STATUS_VERSION (1000U + 173U)
+/// statusversion:32
+/// newest version of SAU_CSTOMA_STATUS the master accepts
 
 // CHUNKSERVER <-> CLIENT/CHUNKSERVER
 
@@ -1742,6 +1748,14 @@ enum class SugidClearMode {
 #define SAU_MATOCL_ADMIN_DUMP_CONFIG (1000U + 604U)
 /// config:STDSTRING
 
+// 0x645
+#define SAU_CLTOMA_FUSE_BATCH (1000U + 605U)
+/// msgid:32 uid:32 gid:32 operations:(vector<FuseBatchOperation>)
+
+// 0x646
+#define SAU_MATOCL_FUSE_BATCH (1000U + 606U)
+/// msgid:32 results:(vector<FuseBatchResult>)
+
 // CHUNKSERVER STATS
 
 // 0x0258
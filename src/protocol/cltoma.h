@@ -32,6 +32,7 @@
 #include "common/serialization_macros.h"
 #include "common/small_vector.h"
 #include "protocol/lock_info.h"
+#include "protocol/fuse_batch.h"
 #include "protocol/SFSCommunication.h"
 #include "protocol/packet.h"
 #include "protocol/quota.h"
@@ -58,6 +59,12 @@ SAUNAFS_DEFINE_PACKET_SERIALIZATION(cltoma, fuseMknod, SAU_CLTOMA_FUSE_MKNOD, 0,
 		uint32_t, gid,
 		uint32_t, rdev)
 
+SAUNAFS_DEFINE_PACKET_SERIALIZATION(cltoma, fuseBatch, SAU_CLTOMA_FUSE_BATCH, 0,
+		uint32_t, messageId,
+		uint32_t, uid,
+		uint32_t, gid,
+		std::vector<FuseBatchOperation>, operations)
+
 SAUNAFS_DEFINE_PACKET_SERIALIZATION(cltoma, fuseMkdir, SAU_CLTOMA_FUSE_MKDIR, 0,
 		uint32_t, messageId,
 		uint32_t, inode,
@@ -386,9 +393,13 @@ SAUNAFS_DEFINE_PACKET_SERIALIZATION(cltoma, fuseGetTrash, SAU_CLTOMA_FUSE_GETTRA
 		uint32_t, off,
 		uint32_t, max_entries)
 
+SAUNAFS_DEFINE_PACKET_VERSION(cltoma, listTasks, kStandard, 0)
+SAUNAFS_DEFINE_PACKET_VERSION(cltoma, listTasks, kWithProgress, 1)
 SAUNAFS_DEFINE_PACKET_SERIALIZATION(
-		cltoma, listTasks, SAU_CLTOMA_LIST_TASKS, 0,
+		cltoma, listTasks, SAU_CLTOMA_LIST_TASKS, kStandard,
 		bool, dummy)
+SAUNAFS_DEFINE_PACKET_SERIALIZATION(
+		cltoma, listTasks, SAU_CLTOMA_LIST_TASKS, kWithProgress)
 
 SAUNAFS_DEFINE_PACKET_SERIALIZATION(
 		cltoma, stopTask, SAU_CLTOMA_STOP_TASK, 0,
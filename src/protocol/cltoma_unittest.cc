@@ -172,3 +172,35 @@ TEST(CltomaCommunicationTests, FuseSetAcl) {
 	SAUNAFS_VERIFY_INOUT_PAIR(type);
 	EXPECT_EQ(aclIn, aclOut);
 }
+
+TEST(CltomaCommunicationTests, FuseBatch) {
+	SAUNAFS_DEFINE_INOUT_PAIR(uint32_t, messageId, 123, 0);
+	SAUNAFS_DEFINE_INOUT_PAIR(uint32_t, uid, 789, 0);
+	SAUNAFS_DEFINE_INOUT_PAIR(uint32_t, gid, 1011, 0);
+	std::vector<FuseBatchOperation> operationsIn{
+		FuseBatchOperation::mknod(17, 0, "file", TYPE_FILE, 0644, 022, 0),
+		FuseBatchOperation::open(0, 1, 3)};
+	std::vector<FuseBatchOperation> operationsOut;
+
+	std::vector<uint8_t> buffer;
+	ASSERT_NO_THROW(cltoma::fuseBatch::serialize(buffer,
+			messageIdIn, uidIn, gidIn, operationsIn));
+
+	verifyHeader(buffer, SAU_CLTOMA_FUSE_BATCH);
+	removeHeaderInPlace(buffer);
+	ASSERT_NO_THROW(cltoma::fuseBatch::deserialize(buffer.data(), buffer.size(),
+			messageIdOut, uidOut, gidOut, operationsOut));
+
+	SAUNAFS_VERIFY_INOUT_PAIR(messageId);
+	SAUNAFS_VERIFY_INOUT_PAIR(uid);
+	SAUNAFS_VERIFY_INOUT_PAIR(gid);
+	ASSERT_EQ(2U, operationsOut.size());
+	EXPECT_EQ(FuseBatchOperation::kMknod, operationsOut[0].type);
+	EXPECT_EQ(17U, operationsOut[0].inode);
+	EXPECT_EQ("file", static_cast<const std::string &>(operationsOut[0].name));
+	EXPECT_EQ(0644, operationsOut[0].mode);
+	EXPECT_EQ(022, operationsOut[0].umask);
+	EXPECT_EQ(FuseBatchOperation::kOpen, operationsOut[1].type);
+	EXPECT_EQ(1U, operationsOut[1].inodeSource);
+	EXPECT_EQ(3, operationsOut[1].flags);
+}
@@ -198,6 +198,15 @@ SAUNAFS_DEFINE_PACKET_SERIALIZATION(
 		cstoma, chunkLost, SAU_CSTOMA_CHUNK_LOST, kECChunks,
 		std::vector<ChunkWithType>, chunks)
 
+SAUNAFS_DEFINE_PACKET_VERSION(cstoma, status, kLoadFactorOnly, 0)
+SAUNAFS_DEFINE_PACKET_VERSION(cstoma, status, kDiskMetrics, 1)
 SAUNAFS_DEFINE_PACKET_SERIALIZATION(
-		cstoma, status, SAU_CSTOMA_STATUS, 0,
+		cstoma, status, SAU_CSTOMA_STATUS, kLoadFactorOnly,
 		uint8_t,  load)
+// queueDepth - largest number of I/Os in flight on any of the chunkserver's disks
+// latencyUs - largest mean service time of a single I/O on any of the disks (microseconds)
+SAUNAFS_DEFINE_PACKET_SERIALIZATION(
+		cstoma, status, SAU_CSTOMA_STATUS, kDiskMetrics,
+		uint8_t,  load,
+		uint32_t, queueDepth,
+		uint32_t, latencyUs)
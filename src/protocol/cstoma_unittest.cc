@@ -180,3 +180,21 @@ TEST(CstomaCommunicationTests, Status) {
 
 	SAUNAFS_VERIFY_INOUT_PAIR(load);
 }
+
+TEST(CstomaCommunicationTests, StatusWithDiskMetrics) {
+	SAUNAFS_DEFINE_INOUT_PAIR(uint8_t, load, 77, 0);
+	SAUNAFS_DEFINE_INOUT_PAIR(uint32_t, queueDepth, 31, 0);
+	SAUNAFS_DEFINE_INOUT_PAIR(uint32_t, latencyUs, 12500, 0);
+
+	std::vector<uint8_t> buffer;
+	ASSERT_NO_THROW(cstoma::status::serialize(buffer, loadIn, queueDepthIn, latencyUsIn));
+
+	verifyHeader(buffer, SAU_CSTOMA_STATUS);
+	removeHeaderInPlace(buffer);
+	verifyVersion(buffer, cstoma::status::kDiskMetrics);
+	ASSERT_NO_THROW(cstoma::status::deserialize(buffer, loadOut, queueDepthOut, latencyUsOut));
+
+	SAUNAFS_VERIFY_INOUT_PAIR(load);
+	SAUNAFS_VERIFY_INOUT_PAIR(queueDepth);
+	SAUNAFS_VERIFY_INOUT_PAIR(latencyUs);
+}
@@ -0,0 +1,86 @@
+/*
+   Copyright 2023 Leil Storage OÜ
+
+   This file is part of SaunaFS.
+
+   SaunaFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   SaunaFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with SaunaFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include "common/attributes.h"
+#include "common/legacy_string.h"
+#include "common/serialization_macros.h"
+
+/**
+ * One metadata operation of a SAU_CLTOMA_FUSE_BATCH request.
+ *
+ * Fields which are not used by the operation's type are ignored. The inode an
+ * operation works on (the parent directory for kMknod) is either
+ * given explicitly or, if inodeSource is not 0, it is the inode returned by
+ * operation number inodeSource - 1 of the same batch, e.g. a file created by
+ * an earlier kMknod.
+ */
+SERIALIZABLE_CLASS_BEGIN(FuseBatchOperation)
+SERIALIZABLE_CLASS_BODY(FuseBatchOperation,
+		uint8_t, type,
+		uint32_t, inode,
+		uint32_t, inodeSource,
+		LegacyString<uint8_t>, name,
+		uint8_t, nodeType,
+		uint16_t, mode,
+		uint16_t, umask,
+		uint32_t, rdev,
+		uint8_t, flags)
+
+	enum Type : uint8_t {
+		kMknod = 0,  ///< name, nodeType, mode, umask, rdev
+		kOpen = 1,   ///< flags (as in CLTOMA_FUSE_OPEN)
+		kTypeCount
+	};
+
+	/// Maximal number of operations in a single batch.
+	static constexpr uint32_t kMaxOperations = 256;
+
+	static FuseBatchOperation mknod(uint32_t parent, uint32_t parentSource,
+			const std::string &name, uint8_t nodeType, uint16_t mode, uint16_t umask,
+			uint32_t rdev) {
+		FuseBatchOperation operation;
+		operation.type = kMknod;
+		operation.inode = parent;
+		operation.inodeSource = parentSource;
+		operation.name = name;
+		operation.nodeType = nodeType;
+		operation.mode = mode;
+		operation.umask = umask;
+		operation.rdev = rdev;
+		return operation;
+	}
+
+	static FuseBatchOperation open(uint32_t inode, uint32_t inodeSource, uint8_t flags) {
+		FuseBatchOperation operation;
+		operation.type = kOpen;
+		operation.inode = inode;
+		operation.inodeSource = inodeSource;
+		operation.flags = flags;
+		return operation;
+	}
+SERIALIZABLE_CLASS_END;
+
+/// Result of one operation of a SAU_CLTOMA_FUSE_BATCH request.
+SAUNAFS_DEFINE_SERIALIZABLE_CLASS(FuseBatchResult,
+		uint8_t, status,
+		uint32_t, inode,
+		Attributes, attributes);
@@ -40,6 +40,7 @@
 #include "common/serialized_goal.h"
 #include "protocol/chunkserver_list_entry.h"
 #include "protocol/directory_entry.h"
+#include "protocol/fuse_batch.h"
 #include "protocol/lock_info.h"
 #include "protocol/named_inode_entry.h"
 #include "protocol/SFSCommunication.h"
@@ -65,6 +66,12 @@ SAUNAFS_DEFINE_PACKET_SERIALIZATION(
 		uint32_t, inode,
 		Attributes, attributes)
 
+// SAU_MATOCL_FUSE_BATCH
+SAUNAFS_DEFINE_PACKET_SERIALIZATION(
+		matocl, fuseBatch, SAU_MATOCL_FUSE_BATCH, 0,
+		uint32_t, messageId,
+		std::vector<FuseBatchResult>, results)
+
 // SAU_MATOCL_FUSE_MKDIR
 SAUNAFS_DEFINE_PACKET_VERSION(matocl, fuseMkdir, kStatusPacketVersion, 0)
 SAUNAFS_DEFINE_PACKET_VERSION(matocl, fuseMkdir, kResponsePacketVersion, 1)
@@ -438,9 +445,14 @@ SAUNAFS_DEFINE_PACKET_SERIALIZATION(
 		uint32_t, msgid,
 		std::vector<NamedInodeEntry>, entries)
 
+SAUNAFS_DEFINE_PACKET_VERSION(matocl, listTasks, kStandard, 0)
+SAUNAFS_DEFINE_PACKET_VERSION(matocl, listTasks, kWithProgress, 1)
 SAUNAFS_DEFINE_PACKET_SERIALIZATION(
-		matocl, listTasks, SAU_MATOCL_LIST_TASKS, 0,
+		matocl, listTasks, SAU_MATOCL_LIST_TASKS, kStandard,
 		std::vector<JobInfo>, jobs_info)
+SAUNAFS_DEFINE_PACKET_SERIALIZATION(
+		matocl, listTasks, SAU_MATOCL_LIST_TASKS, kWithProgress,
+		std::vector<JobProgressInfo>, jobs_info)
 
 SAUNAFS_DEFINE_PACKET_SERIALIZATION(
 		matocl, stopTask, SAU_MATOCL_STOP_TASK, 0,
@@ -134,6 +134,10 @@ SAUNAFS_DEFINE_PACKET_SERIALIZATION(
 		ChunkPartType, chunkType,
 		std::vector<ChunkTypeWithAddress>, sources)
 
+SAUNAFS_DEFINE_PACKET_SERIALIZATION(
+		matocs, statusVersion, SAU_MATOCS_STATUS_VERSION, 0,
+		PacketVersion, statusVersion)
+
 namespace matocs {
 namespace replicateChunk {
 
@@ -92,3 +92,17 @@ TEST(MatocsCommunicationTests, Replicate) {
 	SAUNAFS_VERIFY_INOUT_PAIR(chunkType);
 	SAUNAFS_VERIFY_INOUT_PAIR(serverList);
 }
+
+TEST(MatocsCommunicationTests, StatusVersion) {
+	SAUNAFS_DEFINE_INOUT_PAIR(PacketVersion, statusVersion, 1, 0);
+
+	std::vector<uint8_t> buffer;
+	ASSERT_NO_THROW(matocs::statusVersion::serialize(buffer, statusVersionIn));
+
+	verifyHeader(buffer, SAU_MATOCS_STATUS_VERSION);
+	removeHeaderInPlace(buffer);
+	verifyVersion(buffer, 0U);
+	ASSERT_NO_THROW(matocs::statusVersion::deserialize(buffer, statusVersionOut));
+
+	SAUNAFS_VERIFY_INOUT_PAIR(statusVersion);
+}
@@ -0,0 +1,36 @@
+timeout_set 20 minutes
+
+# Measures how many byte-range lock operations per second the master serves when
+# several processes hold thousands of small locks on a single file, like databases
+# and MPI-IO applications do. Each process locks its own stripes of the file, so no
+# lock has to wait, but every request is checked against all locks held on the file.
+CHUNKSERVERS=1 \
+	MOUNT_EXTRA_CONFIG="enablefilelocks=1,sfscachemode=NEVER" \
+	setup_local_empty_saunafs info
+
+workers=8
+locks_per_worker=4000
+
+results_dir=${TEMP_DIR}/byte_range_locks
+mkdir "$results_dir"
+touch "${info[mount0]}/file"
+
+for worker in $(seq 0 $((workers - 1))); do
+	python3 - > "${results_dir}/$worker" <<-END_OF_SCRIPT &
+	import fcntl, os, time
+	fd = os.open("${info[mount0]}/file", os.O_RDWR)
+	stripes = [i * ${workers} + ${worker} for i in range(${locks_per_worker})]
+	start = time.time()
+	for stripe in stripes:
+	    fcntl.lockf(fd, fcntl.LOCK_EX, 16, stripe * 16)
+	for stripe in stripes:
+	    fcntl.lockf(fd, fcntl.LOCK_UN, 16, stripe * 16)
+	print(2 * len(stripes) / (time.time() - start))
+	END_OF_SCRIPT
+done
+wait
+
+ops_per_second=$(cat "${results_dir}"/* | paste -sd+ | bc)
+echo -e "lock_ops_per_second\n${ops_per_second%.*}" \
+		| tee "${TEST_OUTPUT_DIR}/byte_range_locks_results.csv"
+assert_equals "$workers" "$(cat "${results_dir}"/* | grep -c .)"
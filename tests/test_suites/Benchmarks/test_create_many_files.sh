@@ -0,0 +1,35 @@
+timeout_set 20 minutes
+
+# Measures how many small files per second can be created (and written) depending
+# on the number of processes creating them in parallel.
+CHUNKSERVERS=1 \
+	MOUNT_EXTRA_CONFIG="sfscachemode=NEVER" \
+	setup_local_empty_saunafs info
+
+files_per_worker=2000
+
+results_dir=${TEMP_DIR}/create_many_files
+mkdir "$results_dir"
+
+for workers in 1 4 16; do
+	dir="${info[mount0]}/dir_${workers}"
+	mkdir "$dir"
+
+	start=$(date +%s.%N)
+	for worker in $(seq $workers); do
+		(
+			mkdir "$dir/$worker"
+			for file in $(seq $files_per_worker); do
+				echo "$file" > "$dir/$worker/$file"
+			done
+		) &
+	done
+	wait
+	end=$(date +%s.%N)
+
+	files_per_second=$(echo "$files_per_worker * $workers / ($end - $start)" | bc)
+	echo -e "${workers}_workers\n${files_per_second}" > "${results_dir}/$(printf %02d $workers).csv"
+	assert_equals $((files_per_worker * workers)) "$(find "$dir" -type f | wc -l)"
+done
+
+paste -d, "${results_dir}"/*.csv | tee "${TEST_OUTPUT_DIR}/create_many_files_results.csv"
@@ -0,0 +1,50 @@
+timeout_set 20 minutes
+
+# Measures how many small writes per second the master serves for files at the bottom
+# of a 50 levels deep directory tree, each file having hard links in several levels.
+# Directory statistics of the whole tree have to be exact after the writes.
+CHUNKSERVERS=1 \
+	MOUNT_EXTRA_CONFIG="sfscachemode=NEVER" \
+	setup_local_empty_saunafs info
+
+depth=50
+files=200
+links_per_file=5
+rounds=10
+
+cd "${info[mount0]}"
+dir=tree
+for level in $(seq $depth); do
+	dir="$dir/$level"
+done
+mkdir -p "$dir"
+
+for file in $(seq $files); do
+	touch "$dir/file_$file"
+	link_dir=tree
+	for link in $(seq $links_per_file); do
+		link_dir="$link_dir/$link"
+		ln "$dir/file_$file" "$link_dir/link_${file}"
+	done
+done
+
+start=$(date +%s.%N)
+for round in $(seq $rounds); do
+	for file in $(seq $files); do
+		head -c $((round * 1024)) /dev/zero > "$dir/file_$file"
+	done
+done
+end=$(date +%s.%N)
+
+writes_per_second=$(echo "$files * $rounds / ($end - $start)" | bc)
+echo -e "writes_per_second\n${writes_per_second}" \
+		| tee "${TEST_OUTPUT_DIR}/deep_tree_writes_results.csv"
+
+# each file is counted once in each directory that has a link to it
+expected_length=$((files * rounds * 1024))
+assert_equals $((files + 1)) "$(saunafs dirinfo -n "$dir" | awk '/inodes:/ {print $2}')"
+assert_equals $expected_length "$(saunafs dirinfo -n "$dir" | awk '/length:/ {print $2}')"
+assert_equals $((depth + 1 + files * (links_per_file + 1))) \
+		"$(saunafs dirinfo -n tree | awk '/inodes:/ {print $2}')"
+assert_equals $((expected_length * (links_per_file + 1))) \
+		"$(saunafs dirinfo -n tree | awk '/length:/ {print $2}')"
@@ -0,0 +1,45 @@
+timeout_set 20 minutes
+
+# Measures how many lookups per second the master serves depending on the
+# number of threads serving read-only requests (METADATA_READER_THREADS + 1).
+mounts=4
+MOUNTS=${mounts} \
+	CHUNKSERVERS=1 \
+	MASTER_EXTRA_CONFIG="METADATA_READER_THREADS = 0" \
+	MOUNT_EXTRA_CONFIG="sfsattrcacheto=0|sfsentrycacheto=0|sfsdirentrycacheto=0" \
+	setup_local_empty_saunafs info
+
+files=5000
+workers_per_mount=8
+rounds=5
+
+mkdir "${info[mount0]}/dir"
+touch $(seq -f "${info[mount0]}/dir/file_%g" $files)
+
+results_dir=${TEMP_DIR}/metadata_reader_threads
+mkdir "$results_dir"
+
+for threads in 1 2 4 8 16 32; do
+	sed -i -re "s/^(METADATA_READER_THREADS).*/\1 = $((threads - 1))/" "${info[master_cfg]}"
+	saunafs_master_daemon reload
+	sleep 2
+
+	start=$(date +%s.%N)
+	for mount_id in $(seq 0 $((mounts - 1))); do
+		for worker in $(seq $workers_per_mount); do
+			(
+				for round in $(seq $rounds); do
+					ls -l "${info[mount${mount_id}]}/dir" > /dev/null
+				done
+			) &
+		done
+	done
+	wait
+	end=$(date +%s.%N)
+
+	ops=$(( files * rounds * workers_per_mount * mounts ))
+	ops_per_second=$(echo "$ops / ($end - $start)" | bc)
+	echo -e "${threads}_threads\n${ops_per_second}" > "${results_dir}/$(printf %02d $threads).csv"
+done
+
+paste -d, "${results_dir}"/*.csv | tee "${TEST_OUTPUT_DIR}/metadata_reader_threads_results.csv"
@@ -0,0 +1,66 @@
+timeout_set 30 minutes
+
+# Measures how many files per second can be created and written with no quotas,
+# with a user quota and with directory quotas set on every level of a 20 levels
+# deep tree. Limits are high enough to never be reached.
+CHUNKSERVERS=1 \
+	SFSEXPORTS_EXTRA_OPTIONS="allcanchangequota" \
+	MOUNT_EXTRA_CONFIG="sfscachemode=NEVER" \
+	setup_local_empty_saunafs info
+
+depth=20
+files_per_worker=1000
+workers=8
+
+results_dir=${TEMP_DIR}/quota_enforcement
+mkdir "$results_dir"
+cd "${info[mount0]}"
+
+create_files() {
+	local dir=$1
+	local start=$(date +%s.%N)
+	for worker in $(seq $workers); do
+		(
+			mkdir "$dir/$worker"
+			for file in $(seq $files_per_worker); do
+				echo "$file" > "$dir/$worker/$file"
+			done
+		) &
+	done
+	wait
+	local end=$(date +%s.%N)
+	echo "$files_per_worker * $workers / ($end - $start)" | bc
+}
+
+make_tree() {
+	local dir=$1
+	for level in $(seq $depth); do
+		dir="$dir/$level"
+	done
+	mkdir -p "$dir"
+	echo "$dir"
+}
+
+dir=$(make_tree no_quota)
+echo -e "no_quota\n$(create_files "$dir")" > "${results_dir}/1.csv"
+
+saunafs setquota -u $(id -u) 0 1000000000 0 1000000000 .
+dir=$(make_tree user_quota)
+echo -e "user_quota\n$(create_files "$dir")" > "${results_dir}/2.csv"
+saunafs setquota -u $(id -u) 0 0 0 0 .
+
+dir=$(make_tree dir_quota)
+quota_dir=dir_quota
+for level in $(seq $depth); do
+	saunafs setquota -d 0 1000000000 0 1000000000 "$quota_dir"
+	quota_dir="$quota_dir/$level"
+done
+echo -e "dir_quota\n$(create_files "$dir")" > "${results_dir}/3.csv"
+
+paste -d, "${results_dir}"/*.csv | tee "${TEST_OUTPUT_DIR}/quota_enforcement_results.csv"
+
+assert_equals $((files_per_worker * workers)) "$(find "$dir" -type f | wc -l)"
+# usage of the top directory reflects all changes made by the benchmark
+quota_dir=$(readlink -m dir_quota)
+assert_equals $((files_per_worker * workers + workers + depth)) \
+		"$(saunafs repquota -d "$quota_dir" | grep "Directory $quota_dir " | awk '{print $7}')"
@@ -0,0 +1,47 @@
+timeout_set 30 minutes
+
+# Measures how fast a chunkserver which lost all its chunks gets them back
+# from the other chunkservers, for a few numbers of master job workers.
+chunks_count=200
+file_size_kb=$(( SAUNAFS_CHUNK_SIZE / 1024 ))
+
+CHUNKSERVERS=3 \
+	MOUNT_EXTRA_CONFIG="sfscachemode=NEVER" \
+	MASTER_EXTRA_CONFIG="CHUNKS_LOOP_MIN_TIME = 1`
+			`|CHUNKS_LOOP_MAX_CPU = 90`
+			`|CHUNKS_WRITE_REP_LIMIT = 1000`
+			`|CHUNKS_READ_REP_LIMIT = 1000`
+			`|OPERATIONS_DELAY_INIT = 0`
+			`|OPERATIONS_DELAY_DISCONNECT = 0" \
+	setup_local_empty_saunafs info
+
+chunks_health() {
+	saunafs-probe chunks-health --porcelain localhost "${info[matocl]}"
+}
+
+cd "${info[mount0]}"
+mkdir dir
+saunafs setgoal 3 dir
+FILE_SIZE=${file_size_kb}K file-generate $(seq -f "dir/file_%g" 1 $chunks_count)
+health_ok=$(chunks_health)
+
+for workers in 1 10 32; do
+	saunafs_chunkserver_daemon 0 stop
+	find_chunkserver_chunks 0 | xargs -d'\n' rm -f
+	assert_equals 0 $(find_chunkserver_metadata_chunks 0 | wc -l)
+
+	sed -i '/NR_OF_MASTER_JOB_WORKERS/d' "${info[chunkserver0_cfg]}"
+	echo "NR_OF_MASTER_JOB_WORKERS = $workers" >> "${info[chunkserver0_cfg]}"
+	saunafs_chunkserver_daemon 0 start
+
+	start_ms=$(date +%s%3N)
+	assert_success wait_for '[ "$health_ok" == "$(chunks_health)" ]' "20 minutes"
+	end_ms=$(date +%s%3N)
+
+	# Recovery throughput of the chunkserver in MiB/s
+	throughput=$(echo "scale=3; ${chunks_count} * ${file_size_kb} * 1000 / 1024 `
+			`/ (${end_ms} - ${start_ms})" | bc)
+	echo -e "workers_${workers}\n${throughput}" > "${TEMP_DIR}/workers_${workers}.csv"
+done
+
+paste -d, "${TEMP_DIR}"/workers_*.csv | tee "${TEST_OUTPUT_DIR}/replication_throughput_results.csv"
@@ -0,0 +1,34 @@
+assert_program_installed fio
+
+timeout_set 15 minutes
+
+CHUNKSERVERS=3 \
+	MOUNT_EXTRA_CONFIG="sfscachemode=NEVER" \
+	setup_local_empty_saunafs info
+
+file_size=$(( 4 * SAUNAFS_CHUNK_SIZE ))
+fio_output_dir=${TEMP_DIR}/fio_outputs
+mkdir "$fio_output_dir"
+
+cd "${info[mount0]}"
+
+# Large sequential writes let chunkservers coalesce consecutive blocks into a
+# single disk write; goal 3 also exercises the forwarding chain.
+for goal in 1 3; do
+	for bs in 64k 1M 4M; do
+		name="goal${goal}_${bs}"
+		touch "$name"
+		saunafs setgoal $goal "$name"
+		assert_success fio --name="$name" --filename="$name" --direct=1 --rw=write \
+			--bs="$bs" --size="$file_size" --end_fsync=1 \
+			--output-format=terse --terse-version=3 \
+			--output="${fio_output_dir}/${name}.txt"
+
+		# Field 48 of terse output is write bandwidth in KiB/s
+		bandwidth=$(awk -F';' '{print $48}' "${fio_output_dir}/${name}.txt")
+		echo -e "${name}\n${bandwidth}" > "${TEMP_DIR}/${name}.csv"
+		rm -f "$name"
+	done
+done
+
+paste -d, "${TEMP_DIR}"/goal*.csv | tee "${TEST_OUTPUT_DIR}/streaming_write_throughput_results.csv"
@@ -0,0 +1,39 @@
+assert_program_installed fio
+
+timeout_set 10 minutes
+
+CHUNKSERVERS=3 \
+	USE_RAMDISK=YES \
+	MOUNT_EXTRA_CONFIG="sfscachemode=NEVER" \
+	setup_local_empty_saunafs info
+
+file_size=$(( 4 * SAUNAFS_CHUNK_SIZE ))
+fio_output_dir=${TEMP_DIR}/fio_outputs
+mkdir "$fio_output_dir"
+
+cd "${info[mount0]}"
+FILE_SIZE=$file_size file-generate file
+
+# Each pattern is "<name> <fio rw> <block size>". Patterns with a ":<skip>"
+# suffix read a block and then skip the given amount of data, i.e. are strided.
+patterns=(
+	"sequential read 1M"
+	"strided_128k read:384k 128k"
+	"strided_1m read:3m 1M"
+	"random randread 1M"
+)
+
+for pattern in "${patterns[@]}"; do
+	read -r name rw bs <<< "$pattern"
+	drop_caches
+	assert_success fio --name="$name" --filename=file --direct=1 --rw="$rw" \
+		--bs="$bs" --size="$file_size" --runtime=60 \
+		--output-format=terse --terse-version=3 \
+		--output="${fio_output_dir}/${name}.txt"
+
+	# Field 7 of terse output is read bandwidth in KiB/s
+	bandwidth=$(awk -F';' '{print $7}' "${fio_output_dir}/${name}.txt")
+	echo -e "${name}\n${bandwidth}" > "${TEMP_DIR}/${name}.csv"
+done
+
+paste -d, "${TEMP_DIR}"/*.csv | tee "${TEST_OUTPUT_DIR}/strided_read_throughput_results.csv"
@@ -0,0 +1,50 @@
+timeout_set 4 hours
+
+# Measures memory used by the master per extended attribute, for files tagged with
+# a few attributes each (like Samba or backup tools do). Set XATTR_FILES to run it
+# at a larger scale, e.g. XATTR_FILES=33400000 gives 100M attributes.
+CHUNKSERVERS=1 \
+	MOUNT_EXTRA_CONFIG="sfscachemode=NEVER" \
+	setup_local_empty_saunafs info
+
+files=${XATTR_FILES:-100000}
+workers=16
+
+master_rss_kb() {
+	awk '/VmRSS/ {print $2}' /proc/$(pgrep -u saunafstest -x sfsmaster)/status
+}
+
+mkdir "${info[mount0]}/dir"
+for worker in $(seq 0 $((workers - 1))); do
+	(
+		mkdir "${info[mount0]}/dir/$worker"
+		cd "${info[mount0]}/dir/$worker"
+		for file in $(seq $worker $workers $((files - 1))); do
+			touch $file
+		done
+	) &
+done
+wait
+rss_before=$(master_rss_kb)
+
+for worker in $(seq 0 $((workers - 1))); do
+	(
+		cd "${info[mount0]}/dir/$worker"
+		for file in $(seq $worker $workers $((files - 1))); do
+			setfattr -n user.DOSATTRIB -v "dos-$file" $file
+			setfattr -n user.backup.id -v "$file" $file
+			setfattr -n user.checksum -v "0s$(head -c 48 /dev/urandom | base64 -w0)" $file
+		done
+	) &
+done
+wait
+rss_after=$(master_rss_kb)
+
+xattrs=$((files * 3))
+bytes_per_xattr=$(echo "($rss_after - $rss_before) * 1024 / $xattrs" | bc)
+echo -e "xattrs,master_bytes_per_xattr\n${xattrs},${bytes_per_xattr}" \
+		| tee "${TEST_OUTPUT_DIR}/xattr_memory_results.csv"
+
+checked_file=$((files / 2))
+assert_equals "dos-${checked_file}" "$(getfattr --only-values -n user.DOSATTRIB \
+		"${info[mount0]}/dir/$((checked_file % workers))/${checked_file}")"
@@ -0,0 +1,47 @@
+assert_program_installed fio
+
+timeout_set 30 minutes
+
+# Measures the write throughput of a chunkserver using an emulated zoned drive
+# (null_blk + zonefs), first on empty zones and then while overwriting the
+# same data again and again, so that the garbage collector has to reclaim the
+# zones holding the old copies of the blocks.
+USE_ZONED_DISKS=YES \
+	ZONE_SIZE_MB=64 \
+	NUMBER_OF_SEQ_ZONES=32 \
+	CHUNKSERVERS=1 \
+	MOUNT_EXTRA_CONFIG="sfscachemode=NEVER" \
+	setup_local_empty_saunafs info
+
+# Half of the sequential zones are live data
+file_size=$(( 4 * SAUNAFS_CHUNK_SIZE ))
+files_count=4
+overwrite_passes=4
+fio_output_dir=${TEMP_DIR}/fio_outputs
+mkdir "$fio_output_dir"
+
+cd "${info[mount0]}"
+
+run_fio() {
+	local name=$1
+	shift
+	assert_success fio --name="$name" --directory=. --nrfiles=$files_count \
+		--filesize="$file_size" --size=$(( files_count * file_size )) \
+		--bs=1M --direct=1 --end_fsync=1 --file_service_type=sequential \
+		--output-format=terse --terse-version=3 \
+		--output="${fio_output_dir}/${name}.txt" "$@"
+
+	# Field 48 of terse output is write bandwidth in KiB/s
+	bandwidth=$(awk -F';' '{print $48}' "${fio_output_dir}/${name}.txt")
+	echo -e "${name}\n${bandwidth}" > "${TEMP_DIR}/${name}.csv"
+}
+
+run_fio fresh_write --rw=write
+
+# Random 1M overwrites scatter the old copies over all the written zones
+for pass in $(seq 1 $overwrite_passes); do
+	run_fio "overwrite_${pass}" --rw=randwrite --overwrite=1
+done
+
+paste -d, "${TEMP_DIR}"/fresh_write.csv "${TEMP_DIR}"/overwrite_*.csv \
+	| tee "${TEST_OUTPUT_DIR}/zoned_write_throughput_results.csv"
@@ -0,0 +1,56 @@
+timeout_set 2 minutes
+
+master_cfg="METADATA_DUMP_PERIOD_SECONDS = 0"
+master_cfg+="|LAZY_SNAPSHOTS = 1"
+
+CHUNKSERVERS=2 \
+	MASTERSERVERS=2 \
+	USE_RAMDISK="YES" \
+	MOUNT_EXTRA_CONFIG="sfscachemode=NEVER,sfsdirentrycacheto=0" \
+	MASTER_EXTRA_CONFIG="$master_cfg" \
+	DEBUG_LOG_FAIL_ON="master.matoml_changelog_apply_error" \
+	setup_local_empty_saunafs info
+
+saunafs_master_n 1 start
+assert_eventually 'saunafs_shadow_synchronized 1'
+
+cd "${info[mount0]}"
+mkdir -p src/a/b src/c
+echo "old" > src/a/b/file
+echo "old" > src/c/file
+touch src/empty
+
+assert_success saunafs makesnapshot src snap
+assert_success grep -q LAZYCLONE "${info[master0_data_path]}"/changelog.sfs
+
+# Modifications of the source are not visible in the snapshot
+echo "new" > src/a/b/file
+rm src/c/file
+mkdir src/d
+assert_equals "old" "$(cat snap/a/b/file)"
+assert_equals "old" "$(cat snap/c/file)"
+assert_file_not_exists snap/d
+assert_file_exists snap/empty
+
+# Modifications of the snapshot are not visible in the source
+echo "snap" > snap/c/file
+rm -r snap/a
+assert_equals "new" "$(cat src/a/b/file)"
+assert_file_not_exists src/c/file
+
+# A snapshot of a snapshot
+assert_success saunafs makesnapshot snap snap2
+assert_success saunafs makesnapshot snap snap3
+rm -r snap
+assert_equals "snap" "$(cat snap2/c/file)"
+assert_equals "snap" "$(cat snap3/c/file)"
+assert_file_not_exists snap2/a
+
+# Shadow replays everything and the snapshots survive a restart of the master
+assert_eventually 'saunafs_shadow_synchronized 1'
+assert_success saunafs_admin_master save-metadata
+saunafs_master_daemon restart
+saunafs_wait_for_all_ready_chunkservers
+assert_equals "snap" "$(cat snap3/c/file)"
+assert_equals "new" "$(cat src/a/b/file)"
+assert_eventually 'saunafs_shadow_synchronized 1'
@@ -0,0 +1,40 @@
+timeout_set 2 minutes
+
+USE_RAMDISK=YES \
+	SFSEXPORTS_EXTRA_OPTIONS="allcanchangequota,ignoregid" \
+	MOUNT_EXTRA_CONFIG="sfscachemode=NEVER" \
+	setup_local_empty_saunafs info
+
+cd "${info[mount0]}"
+
+softlimit=10
+hardlimit=50
+
+# the quota is set two levels above the directory where files are created
+mkdir -p dir/a/b
+directory=$(readlink -m dir)
+saunafs setquota -d 0 0 $softlimit $hardlimit dir
+verify_dir_quota "Directory $directory -- 0 0 0 2 $softlimit $hardlimit" $directory
+
+# many parallel creates are handled by the master within the same loop iterations, before
+# directory statistics reach the ancestors, so they would overrun the limit of the ancestor
+seq 100 | xargs -P 20 -I{} touch dir/a/b/file{} 2>/dev/null || true
+assert_equals $((hardlimit - 2)) $(ls dir/a/b | wc -l)
+verify_dir_quota "Directory $directory -+ 0 0 0 $hardlimit $softlimit $hardlimit" $directory
+assert_awk_finds '/Disk quota exceeded/' "$(touch dir/a/b/file 2>&1)"
+assert_failure saunafs makesnapshot dir/a/b/file1 dir/a/b/snapshot
+
+# snapshots are checked against the quota also when metarestore replays changelogs
+rm dir/a/b/file1
+assert_success saunafs makesnapshot dir/a/b/file2 dir/a/b/snapshot
+assert_failure saunafs makesnapshot dir/a/b/file3 dir/a/b/snapshot2
+verify_dir_quota "Directory $directory -+ 0 0 0 $hardlimit $softlimit $hardlimit" $directory
+
+cd
+saunafs_master_daemon kill
+assert_success sfsmetarestore -d "${info[master_data_path]}" -a
+saunafs_master_daemon start
+saunafs_wait_for_all_ready_chunkservers
+cd "${info[mount0]}"
+verify_dir_quota "Directory $directory -+ 0 0 0 $hardlimit $softlimit $hardlimit" $directory
+assert_file_exists dir/a/b/snapshot
@@ -0,0 +1,46 @@
+timeout_set 3 minutes
+
+master_cfg="TASK_PLANNER_THREADS = 4"
+master_cfg+="|SNAPSHOT_INITIAL_BATCH_SIZE = 10"
+
+USE_RAMDISK="YES" \
+	CHUNKSERVERS=1 \
+	MOUNTS=1 \
+	MOUNT_EXTRA_CONFIG="sfscachemode=NEVER" \
+	MASTER_EXTRA_CONFIG="$master_cfg" \
+	setup_local_empty_saunafs info
+
+function dirgenerate() {
+	local level=$1
+	local suffix=$2
+	if [ "$level" -gt 0 ]; then
+		echo "data" >> file${level}
+		mkdir root${level}_${suffix}
+		cd root${level}_${suffix}
+		dirgenerate $((level - 1)) left
+		dirgenerate $((level - 1)) right
+		cd ..
+	fi
+}
+
+cd "${info[mount0]}"
+mkdir test
+cd test
+dirgenerate 10 a
+cd ..
+nodes=$(find test | wc -l)
+
+# Jobs bigger than the initial batch are finished in the background, using plans
+saunafs setgoal -r 2 test
+saunafs settrashtime -r 0 test
+assert_success saunafs_admin_master list-tasks
+assert_eventually '[[ $(saunafs getgoal -r test | grep "with goal" | grep -vc " 2 :") -eq 0 ]]'
+assert_eventually '[[ $(saunafs gettrashtime -r test | grep "with trashtime" | grep -vc " 0 :") -eq 0 ]]'
+
+assert_success saunafs makesnapshot test snapshot
+assert_eventually '[[ $(find snapshot | wc -l) -eq $nodes ]]'
+assert_equals "$(cd test && find . | sort)" "$(cd snapshot && find . | sort)"
+
+saunafs rremove test
+assert_eventually '[ ! -e test ]'
+assert_equals "$nodes" "$(find snapshot | wc -l)"
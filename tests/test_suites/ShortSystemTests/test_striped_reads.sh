@@ -0,0 +1,21 @@
+timeout_set 90 seconds
+
+CHUNKSERVERS=3 \
+	MOUNTS=2 \
+	USE_RAMDISK=YES \
+	MOUNT_EXTRA_CONFIG="sfscachemode=NEVER" \
+	MOUNT_1_EXTRA_CONFIG="readstripeworkers=8,readstripesize=1024" \
+	setup_local_empty_saunafs info
+
+cd "${info[mount0]}"
+mkdir dir
+saunafs setgoal 3 dir
+# A size which is not a multiple of the stripe size checks the end of file handling
+FILE_SIZE=$(( 3 * SAUNAFS_CHUNK_SIZE + 1234567 )) BLOCK_SIZE=12345 file-generate dir/file
+file-validate dir/file
+
+cd "${info[mount1]}"
+file-validate dir/file
+# Large reads crossing chunk boundaries are split into stripes read concurrently
+assert_success dd if=dir/file of=/dev/null bs=32M
+assert_equals "$(sha256sum < "${info[mount0]}/dir/file")" "$(dd if=dir/file bs=16M 2>/dev/null | sha256sum)"